@@ -0,0 +1,224 @@
+#include "nes-cdl.hpp"
+
+//flags can be the mapped .cdl file, if it's NULL the log only lives as long as we do
+internal NesCdl*
+nes_cdl_create_and_initialize(u32 count_prg_rom_banks, u8* flags) {
+
+    NesCdl* cdl = (NesCdl*)malloc(sizeof(NesCdl));
+    *cdl = {0};
+
+    cdl->count_prg_rom_banks = count_prg_rom_banks;
+    cdl->size                = count_prg_rom_banks * NES_CDL_PRG_ROM_BANK_SIZE;
+    cdl->flags               = flags;
+    cdl->flags_owned         = FALSE;
+
+    if (cdl->flags == NULL) {
+        cdl->flags       = (u8*)calloc(cdl->size, sizeof(u8));
+        cdl->flags_owned = TRUE;
+    }
+
+    //other tools put more in their logs than we do, we only trust our own bits
+    for (u32 offset = 0; offset < cdl->size; ++offset) {
+        cdl->flags[offset] &= NES_CDL_FLAGS_LOGGED;
+    }
+
+    cdl->analysis.flags = (u8*)calloc(cdl->size, sizeof(u8));
+
+    return cdl;
+}
+
+internal void
+nes_cdl_destroy(NesCdl* cdl) {
+
+    if (cdl->flags_owned == TRUE) {
+        free(cdl->flags);
+    }
+    free(cdl->analysis.flags);
+    free(cdl);
+}
+
+//what the static pass worked out about an address, 0 for anything below the prg rom
+internal u8
+nes_cdl_analysis_flags(NesCdl* cdl, nes_addr address) {
+
+    return (address >= NES_CDL_PRG_ROM_ADDR)
+        ? cdl->analysis.flags[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, address)]
+        : 0;
+}
+
+/*************
+ * RECORDING *
+ *************/
+
+internal void
+nes_cdl_record_instr(NesCdl* cdl, nes_addr pc, u32 size) {
+
+    if (pc < NES_CDL_PRG_ROM_ADDR) {
+        return;
+    }
+
+    cdl->flags[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, pc)] |= NES_CDL_FLAG_OPCODE;
+
+    for (u32 byte_index = 1; byte_index < size; ++byte_index) {
+        nes_addr operand_address = (nes_addr)(pc + byte_index);
+        if (operand_address >= NES_CDL_PRG_ROM_ADDR) {
+            cdl->flags[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, operand_address)] |= NES_CDL_FLAG_OPERAND;
+        }
+    }
+}
+
+internal void
+nes_cdl_record_data(NesCdl* cdl, nes_addr address) {
+
+    if (address >= NES_CDL_PRG_ROM_ADDR) {
+        cdl->flags[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, address)] |= NES_CDL_FLAG_DATA;
+    }
+}
+
+/*******************
+ * STATIC ANALYSIS *
+ *******************/
+
+struct NesCdlWorkList {
+    u32* offsets;
+    u32 count;
+};
+
+//marks a block boundary, and queues the block if nothing has walked it yet
+internal void
+nes_cdl_analysis_block_begin(NesCdl* cdl, NesCdlWorkList* work_list, nes_addr address, b32 jump_target) {
+
+    //jumps into ram or the io registers are someone else's problem
+    if (address < NES_CDL_PRG_ROM_ADDR) {
+        return;
+    }
+
+    NesCdlAnalysis* analysis = &cdl->analysis;
+    u32 offset = nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, address);
+
+    if (jump_target == TRUE && (analysis->flags[offset] & NES_CDL_FLAG_JUMP_TARGET) == 0) {
+        analysis->flags[offset] |= NES_CDL_FLAG_JUMP_TARGET;
+        ++analysis->count_jump_targets;
+    }
+
+    //every offset gets queued at most once, so the work list can't outgrow the rom
+    if ((analysis->flags[offset] & NES_CDL_FLAG_BLOCK_BEGIN) == 0) {
+        analysis->flags[offset] |= NES_CDL_FLAG_BLOCK_BEGIN;
+        ++analysis->count_blocks;
+        work_list->offsets[work_list->count++] = offset;
+    }
+}
+
+//decodes straight through from offset until the flow of control leaves
+internal void
+nes_cdl_analysis_walk(NesCdl* cdl, NesCdlWorkList* work_list, nes_val* prg_rom, u32 offset) {
+
+    NesCdlAnalysis* analysis = &cdl->analysis;
+
+    while (offset < cdl->size) {
+
+        //already decoded from here, or we'd be landing in the middle of another instruction
+        if (analysis->flags[offset] & NES_CDL_FLAG_CODE) {
+            return;
+        }
+
+        //the log has seen the cpu read this as data and never run it
+        u8 logged_flags = cdl->flags[offset];
+        if ((logged_flags & NES_CDL_FLAG_DATA) && (logged_flags & (NES_CDL_FLAG_OPCODE | NES_CDL_FLAG_OPERAND)) == 0) {
+            return;
+        }
+
+        nes_val op_code = prg_rom[offset];
+        NesCpuDisasmOpCode* disasm_op_code = nes_cpu_disasm_op_code(op_code);
+        if (disasm_op_code->valid != TRUE || offset + disasm_op_code->size > cdl->size) {
+            return;
+        }
+
+        analysis->flags[offset] |= NES_CDL_FLAG_INSTR;
+        for (u32 byte_index = 0; byte_index < disasm_op_code->size; ++byte_index) {
+            analysis->flags[offset + byte_index] |= NES_CDL_FLAG_CODE;
+        }
+        analysis->count_code_bytes += disasm_op_code->size;
+        ++analysis->count_instrs;
+
+        nes_addr address      = nes_memory_map_prg_rom_address(&cdl->prg_rom_banks, offset);
+        nes_addr next_address = (nes_addr)(address + disasm_op_code->size);
+        nes_addr operand_word = (nes_addr)((disasm_op_code->size == 3) ? ((prg_rom[offset + 2] << 8) | prg_rom[offset + 1]) : 0);
+
+        if (disasm_op_code->addr_mode == NesCpuAddressMode::relative) {
+            //branches relative to the address of the next instruction, both ways out start a block
+            nes_addr branch_target = (nes_addr)(next_address + (i8)prg_rom[offset + 1]);
+            nes_cdl_analysis_block_begin(cdl, work_list, branch_target, TRUE);
+            nes_cdl_analysis_block_begin(cdl, work_list, next_address, FALSE);
+            return;
+        }
+
+        switch (op_code) {
+
+            case NES_CPU_INSTR_JMP_ABS: {
+                nes_cdl_analysis_block_begin(cdl, work_list, operand_word, TRUE);
+            } return;
+
+            case NES_CPU_INSTR_JSR_ABS: {
+                //assume the subroutine comes back
+                nes_cdl_analysis_block_begin(cdl, work_list, operand_word, TRUE);
+                nes_cdl_analysis_block_begin(cdl, work_list, next_address, FALSE);
+            } return;
+
+            case NES_CPU_INSTR_JMP_IND: {
+                ++analysis->count_indirect_jumps;
+            } return;
+
+            case NES_CPU_INSTR_RTS_IMP:
+            case NES_CPU_INSTR_RTI_IMP:
+            case NES_CPU_INSTR_BRK_IMP: return;
+
+            default: break;
+        }
+
+        offset += disasm_op_code->size;
+    }
+}
+
+internal void
+nes_cdl_analysis_drain(NesCdl* cdl, NesCdlWorkList* work_list, nes_val* prg_rom) {
+
+    while (work_list->count > 0) {
+        u32 offset = work_list->offsets[--work_list->count];
+        nes_cdl_analysis_walk(cdl, work_list, prg_rom, offset);
+    }
+}
+
+//follows the flow of control out from the interrupt vectors and everything the log has seen run,
+//prg_rom is every bank back to back and the banks have to be mapped the way the cpu sees them
+internal void
+nes_cdl_analyze(NesCdl* cdl, nes_val* prg_rom) {
+
+    NesCdlAnalysis* analysis = &cdl->analysis;
+
+    u8* analysis_flags = analysis->flags;
+    memset(analysis_flags, 0, cdl->size);
+    *analysis       = {0};
+    analysis->flags = analysis_flags;
+
+    NesCdlWorkList work_list = {0};
+    work_list.offsets = (u32*)malloc(cdl->size * sizeof(u32));
+
+    //nmi, reset and irq/brk
+    for (u32 vector = 0xFFFA; vector <= 0xFFFE; vector += 2) {
+        nes_val vector_low  = prg_rom[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, (nes_addr)vector)];
+        nes_val vector_high = prg_rom[nes_memory_map_prg_rom_offset(&cdl->prg_rom_banks, (nes_addr)(vector + 1))];
+        nes_cdl_analysis_block_begin(cdl, &work_list, (nes_addr)((vector_high << 8) | vector_low), TRUE);
+    }
+    nes_cdl_analysis_drain(cdl, &work_list, prg_rom);
+
+    //the log fills in what we can't follow statically, like jump tables
+    for (u32 offset = 0; offset < cdl->size; ++offset) {
+        if ((cdl->flags[offset] & NES_CDL_FLAG_OPCODE) && (analysis->flags[offset] & NES_CDL_FLAG_CODE) == 0) {
+            nes_cdl_analysis_walk(cdl, &work_list, prg_rom, offset);
+            nes_cdl_analysis_drain(cdl, &work_list, prg_rom);
+        }
+    }
+
+    free(work_list.offsets);
+}
@@ -0,0 +1,61 @@
+#ifndef NES_CDL_HPP
+#define NES_CDL_HPP
+
+#include "nes-types.h"
+#include "nes-memory-map.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+//code/data log, one byte of flags for every prg rom byte saying how the cpu has used it
+//build with NES_CDL=0 and every hook compiles to nothing
+#ifndef NES_CDL
+#define NES_CDL 1
+#endif
+
+#define NES_CDL_FILE_EXTENSION    ".cdl"
+#define NES_CDL_PRG_ROM_BANK_SIZE NES_MEM_MAP_PRG_ROM_BANK_SIZE
+#define NES_CDL_PRG_ROM_ADDR      0x8000
+
+//logged by the cpu as it runs, these are what goes in the file
+#define NES_CDL_FLAG_OPCODE  0x01
+#define NES_CDL_FLAG_OPERAND 0x02
+#define NES_CDL_FLAG_DATA    0x04
+#define NES_CDL_FLAGS_LOGGED (NES_CDL_FLAG_OPCODE | NES_CDL_FLAG_OPERAND | NES_CDL_FLAG_DATA)
+
+//worked out by the static pass at load time, never saved
+#define NES_CDL_FLAG_CODE        0x01
+#define NES_CDL_FLAG_INSTR       0x02
+#define NES_CDL_FLAG_BLOCK_BEGIN 0x04
+#define NES_CDL_FLAG_JUMP_TARGET 0x08
+
+struct NesCdlAnalysis {
+    //one byte of NES_CDL_FLAG_CODE etc for every prg rom byte
+    u8* flags;
+    u32 count_code_bytes;
+    u32 count_instrs;
+    u32 count_blocks;
+    u32 count_jump_targets;
+    //jumps through a pointer we couldn't follow, the log usually covers where they land
+    u32 count_indirect_jumps;
+};
+
+struct NesCdl {
+    //points into the mapped .cdl file when there is one
+    u8* flags;
+    u32 size;
+    u32 count_prg_rom_banks;
+    NesMemoryMapPrgRomBanks prg_rom_banks;
+    //TRUE if flags was allocated here instead of mapped
+    b32 flags_owned;
+    NesCdlAnalysis analysis;
+};
+
+#if NES_CDL
+    #define NesCdlRecordInstr(cdl, pc, size) nes_cdl_record_instr(cdl, pc, size)
+    #define NesCdlRecordData(cdl, address)   nes_cdl_record_data(cdl, address)
+#else
+    #define NesCdlRecordInstr(cdl, pc, size)
+    #define NesCdlRecordData(cdl, address)
+#endif
+
+#endif //NES_CDL_HPP
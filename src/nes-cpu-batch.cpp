@@ -0,0 +1,527 @@
+#include "nes-cpu-batch.hpp"
+
+global NesCpuBatchOpCode nes_cpu_batch_op_codes[256];
+global volatile u32 nes_cpu_batch_op_codes_initialized = 0;
+
+//what the scalar handlers leave in the debug info, indexed by the lockstep ops
+global char* nes_cpu_batch_op_code_strs[NesCpuBatchOp::op_scalar] = {
+    "INSTR: LDA", "INSTR: LDX", "INSTR: LDY",
+    "INSTR: STA", "INSTR: STX", "INSTR: STY",
+    "INSTR: AND", "INSTR: ORA",
+    "INSTR: ADC", "INSTR: SBC",
+    "INSTR: CMP", "INSTR: CPX", "INSTR: CPY",
+    "INSTR: INC", "INSTR: DEC",
+    "INSTR: INX", "INSTR: INY", "INSTR: DEX", "INSTR: DEY",
+    "INSTR: TAX", "INSTR: TAY", "INSTR: TXA", "INSTR: TYA", "INSTR: TSX", "INSTR: TXS",
+    "INSTR: CLC", "INSTR: SEC", "INSTR: CLI", "INSTR: SEI", "INSTR: CLD", "INSTR: SED", "INSTR: CLV",
+    "INSTR: NOP",
+    "INSTR: BCC", "INSTR: BCS", "INSTR: BEQ", "INSTR: BNE", "INSTR: BMI", "INSTR: BPL", "INSTR: BVC", "INSTR: BVS",
+    "INSTR: BRK"
+};
+
+/**************
+ * VECTOR OPS *
+ **************/
+
+#if NES_CPU_BATCH_SSE2
+
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_load(u8* lanes)                                { return _mm_loadu_si128((__m128i*)lanes); }
+internal inline void              nes_cpu_batch_vec_store(u8* lanes, nes_cpu_batch_vec a)           { _mm_storeu_si128((__m128i*)lanes, a); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_set1(u8 value)                                  { return _mm_set1_epi8((char)value); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_and(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { return _mm_and_si128(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_or(nes_cpu_batch_vec a, nes_cpu_batch_vec b)    { return _mm_or_si128(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_xor(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { return _mm_xor_si128(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_andnot(nes_cpu_batch_vec a, nes_cpu_batch_vec b){ return _mm_andnot_si128(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_add(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { return _mm_add_epi8(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_sub(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { return _mm_sub_epi8(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_adds(nes_cpu_batch_vec a, nes_cpu_batch_vec b)  { return _mm_adds_epu8(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_subs(nes_cpu_batch_vec a, nes_cpu_batch_vec b)  { return _mm_subs_epu8(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_cmpeq(nes_cpu_batch_vec a, nes_cpu_batch_vec b) { return _mm_cmpeq_epi8(a, b); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_negative(nes_cpu_batch_vec a)                   { return _mm_cmplt_epi8(a, _mm_setzero_si128()); }
+internal inline u32               nes_cpu_batch_vec_movemask(nes_cpu_batch_vec a)                   { return (u32)_mm_movemask_epi8(a); }
+
+#else
+
+#define NES_CPU_BATCH_VEC_LANEWISE(expression)                                   \
+    nes_cpu_batch_vec result;                                                     \
+    for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {                      \
+        result.lanes[lane] = (u8)(expression);                                    \
+    }                                                                             \
+    return result;
+
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_load(u8* lanes)                                { nes_cpu_batch_vec result; memcpy(result.lanes, lanes, NES_CPU_BATCH_LANES); return result; }
+internal inline void              nes_cpu_batch_vec_store(u8* lanes, nes_cpu_batch_vec a)           { memcpy(lanes, a.lanes, NES_CPU_BATCH_LANES); }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_set1(u8 value)                                  { NES_CPU_BATCH_VEC_LANEWISE(value) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_and(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { NES_CPU_BATCH_VEC_LANEWISE(a.lanes[lane] & b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_or(nes_cpu_batch_vec a, nes_cpu_batch_vec b)    { NES_CPU_BATCH_VEC_LANEWISE(a.lanes[lane] | b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_xor(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { NES_CPU_BATCH_VEC_LANEWISE(a.lanes[lane] ^ b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_andnot(nes_cpu_batch_vec a, nes_cpu_batch_vec b){ NES_CPU_BATCH_VEC_LANEWISE(~a.lanes[lane] & b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_add(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { NES_CPU_BATCH_VEC_LANEWISE(a.lanes[lane] + b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_sub(nes_cpu_batch_vec a, nes_cpu_batch_vec b)   { NES_CPU_BATCH_VEC_LANEWISE(a.lanes[lane] - b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_adds(nes_cpu_batch_vec a, nes_cpu_batch_vec b)  { NES_CPU_BATCH_VEC_LANEWISE((a.lanes[lane] + b.lanes[lane] > 0xFF) ? 0xFF : a.lanes[lane] + b.lanes[lane]) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_subs(nes_cpu_batch_vec a, nes_cpu_batch_vec b)  { NES_CPU_BATCH_VEC_LANEWISE((a.lanes[lane] > b.lanes[lane]) ? a.lanes[lane] - b.lanes[lane] : 0) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_cmpeq(nes_cpu_batch_vec a, nes_cpu_batch_vec b) { NES_CPU_BATCH_VEC_LANEWISE((a.lanes[lane] == b.lanes[lane]) ? 0xFF : 0x00) }
+internal inline nes_cpu_batch_vec nes_cpu_batch_vec_negative(nes_cpu_batch_vec a)                   { NES_CPU_BATCH_VEC_LANEWISE((a.lanes[lane] & 0x80) ? 0xFF : 0x00) }
+
+internal inline u32
+nes_cpu_batch_vec_movemask(nes_cpu_batch_vec a) {
+
+    u32 mask = 0;
+    for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {
+        mask |= (u32)(a.lanes[lane] >> 7) << lane;
+    }
+    return mask;
+}
+
+#endif
+
+//picks a where mask is set and b everywhere else
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_vec_select(nes_cpu_batch_vec mask, nes_cpu_batch_vec a, nes_cpu_batch_vec b) {
+
+    return nes_cpu_batch_vec_or(nes_cpu_batch_vec_and(mask, a), nes_cpu_batch_vec_andnot(mask, b));
+}
+
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_vec_nonzero(nes_cpu_batch_vec a) {
+
+    return nes_cpu_batch_vec_xor(nes_cpu_batch_vec_cmpeq(a, nes_cpu_batch_vec_set1(0)), nes_cpu_batch_vec_set1(0xFF));
+}
+
+/*********
+ * TABLE *
+ *********/
+
+#define NES_CPU_BATCH_OP_CODE(mode, instr, base_cycles, access)                   \
+    {NesCpuBatchOp::op_##instr, NesCpuAddressMode::mode, base_cycles, access,     \
+     nes_cpu_operand_decode<NesCpuAddressMode::mode>,                             \
+     nes_cpu_operand_read<NesCpuAddressMode::mode>,                               \
+     nes_cpu_operand_write<NesCpuAddressMode::mode>}
+
+#define NES_CPU_BATCH_OP_CODE_SET(name, mode, instr, base_cycles)                 \
+    nes_cpu_batch_op_codes[NES_CPU_INSTR_##name] =                                \
+        NES_CPU_BATCH_OP_CODE(mode, instr, base_cycles, nes_cpu_batch_op_access(NesCpuBatchOp::op_##instr));
+
+//which of the lockstep ops go over the bus for their operand, the scalar ones do it themselves
+internal u8
+nes_cpu_batch_op_access(NesCpuBatchOp op) {
+
+    switch (op) {
+        case NesCpuBatchOp::op_lda: case NesCpuBatchOp::op_ldx: case NesCpuBatchOp::op_ldy:
+        case NesCpuBatchOp::op_and: case NesCpuBatchOp::op_ora:
+        case NesCpuBatchOp::op_adc: case NesCpuBatchOp::op_sbc:
+        case NesCpuBatchOp::op_cmp: case NesCpuBatchOp::op_cpx: case NesCpuBatchOp::op_cpy: {
+            return NES_CPU_OPERAND_ACCESS_READ;
+        }
+        case NesCpuBatchOp::op_sta: case NesCpuBatchOp::op_stx: case NesCpuBatchOp::op_sty: {
+            return NES_CPU_OPERAND_ACCESS_WRITE;
+        }
+        case NesCpuBatchOp::op_inc: case NesCpuBatchOp::op_dec: {
+            return NES_CPU_OPERAND_ACCESS_READ | NES_CPU_OPERAND_ACCESS_WRITE;
+        }
+        default: return 0;
+    }
+}
+
+//built from NES_CPU_OP_CODES like the other two cores, so the batch inherits every mode and cycle count
+//(mistakes included) instead of writing them down a second time
+//racing on it is harmless since everyone fills in the same entries
+internal void
+nes_cpu_batch_op_codes_initialize() {
+
+    if (AtomicLoadAcquireU32(&nes_cpu_batch_op_codes_initialized) != 0) {
+        return;
+    }
+
+    for (u32 op_code = 0; op_code < 256; ++op_code) {
+        nes_cpu_batch_op_codes[op_code] = NES_CPU_BATCH_OP_CODE(zero_page, nop, 2, 0);
+    }
+    NES_CPU_OP_CODES(NES_CPU_BATCH_OP_CODE_SET)
+
+    AtomicStoreReleaseU32(&nes_cpu_batch_op_codes_initialized, 1);
+}
+
+/*********
+ * BATCH *
+ *********/
+
+internal NesCpuBatch
+nes_cpu_batch_create_and_initialize(NesCpu** lanes, u32 count_lanes) {
+
+    ASSERT(count_lanes > 0 && count_lanes <= NES_CPU_BATCH_LANES);
+
+    nes_cpu_batch_op_codes_initialize();
+
+    NesCpuBatch batch = {0};
+    batch.count_lanes = count_lanes;
+
+    for (u32 lane = 0; lane < count_lanes; ++lane) {
+        batch.lanes[lane] = lanes[lane];
+    }
+
+    return batch;
+}
+
+//the same checks nes_cpu_run makes between instructions, a lane that fails one is done for this run
+internal inline void
+nes_cpu_batch_lane_update(NesCpuBatch* batch, u32 lane) {
+
+    NesCpu* cpu     = batch->lanes[lane];
+    NesCpuRun* run  = &batch->runs[lane];
+    u64 cycle_end   = batch->cycle_ends[lane];
+
+    if (run->cycle_count >= cycle_end ||
+        cpu->mem_map.debug.stopped == TRUE ||
+        nes_cpu_idle_loop_try_skip(cpu, run, cycle_end) == TRUE) {
+        batch->active_bits &= ~(1 << lane);
+    }
+}
+
+internal void
+nes_cpu_batch_step_scalar(NesCpuBatch* batch, u32 lane) {
+
+    nes_cpu_run_step(batch->lanes[lane], &batch->runs[lane]);
+
+    ++batch->scalar_lane_instructions;
+}
+
+//sets flags the same way nes_cpu_flag_check does, only ever on
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_flags_set(nes_cpu_batch_vec p, nes_cpu_batch_vec flags) {
+
+    return nes_cpu_batch_vec_or(p, flags);
+}
+
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_flags_clear(nes_cpu_batch_vec p, u8 flags) {
+
+    return nes_cpu_batch_vec_andnot(nes_cpu_batch_vec_set1(flags), p);
+}
+
+//zero and negative flags for an 8 bit result
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_flags_nz(nes_cpu_batch_vec value) {
+
+    nes_cpu_batch_vec flag_z = nes_cpu_batch_vec_and(nes_cpu_batch_vec_cmpeq(value, nes_cpu_batch_vec_set1(0)), nes_cpu_batch_vec_set1(1 << NES_CPU_FLAG_Z));
+    nes_cpu_batch_vec flag_n = nes_cpu_batch_vec_and(nes_cpu_batch_vec_negative(value), nes_cpu_batch_vec_set1(1 << NES_CPU_FLAG_N));
+    return nes_cpu_batch_vec_or(flag_z, flag_n);
+}
+
+//the scalar core treats a compare or subtract that borrows as a huge unsigned result,
+//which sets carry and negative and never zero
+internal inline nes_cpu_batch_vec
+nes_cpu_batch_flags_subtract(nes_cpu_batch_vec difference, nes_cpu_batch_vec borrow, u8 borrow_flags) {
+
+    return nes_cpu_batch_vec_select(borrow,
+        nes_cpu_batch_vec_set1(borrow_flags),
+        nes_cpu_batch_flags_nz(difference));
+}
+
+//the register and flag work of a lockstep op for all lanes at once, whatever isn't in the group is thrown away
+//stores get what goes back out to the operand, returns the lanes whose branch is taken
+internal u32
+nes_cpu_batch_execute(NesCpuBatchOp op, NesCpuBatchRegisters* registers, u8* operands, u8* stores) {
+
+    nes_cpu_batch_vec acc_a   = nes_cpu_batch_vec_load(registers->acc_a);
+    nes_cpu_batch_vec ir_x    = nes_cpu_batch_vec_load(registers->ir_x);
+    nes_cpu_batch_vec ir_y    = nes_cpu_batch_vec_load(registers->ir_y);
+    nes_cpu_batch_vec sp      = nes_cpu_batch_vec_load(registers->sp);
+    nes_cpu_batch_vec p       = nes_cpu_batch_vec_load(registers->p);
+    nes_cpu_batch_vec operand = nes_cpu_batch_vec_load(operands);
+
+    nes_cpu_batch_vec store   = nes_cpu_batch_vec_set1(0);
+    nes_cpu_batch_vec one     = nes_cpu_batch_vec_set1(1);
+    nes_cpu_batch_vec carry   = nes_cpu_batch_vec_and(p, one);
+    u32 branch_taken_bits     = 0;
+
+    switch (op) {
+
+        case NesCpuBatchOp::op_lda: acc_a = operand; p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(operand)); break;
+        case NesCpuBatchOp::op_ldx: ir_x  = operand; p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(operand)); break;
+        case NesCpuBatchOp::op_ldy: ir_y  = operand; p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(operand)); break;
+
+        case NesCpuBatchOp::op_sta: store = acc_a; break;
+        case NesCpuBatchOp::op_stx: store = ir_x;  break;
+        case NesCpuBatchOp::op_sty: store = ir_y;  break;
+
+        case NesCpuBatchOp::op_and: acc_a = nes_cpu_batch_vec_and(acc_a, operand); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(acc_a)); break;
+        case NesCpuBatchOp::op_ora: acc_a = nes_cpu_batch_vec_or(acc_a, operand);  p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(acc_a)); break;
+
+        case NesCpuBatchOp::op_adc: {
+            //a saturating add only differs from a wrapping one when the sum carries out
+            nes_cpu_batch_vec sum_1     = nes_cpu_batch_vec_add(acc_a, operand);
+            nes_cpu_batch_vec carry_1   = nes_cpu_batch_vec_xor(nes_cpu_batch_vec_cmpeq(nes_cpu_batch_vec_adds(acc_a, operand), sum_1), nes_cpu_batch_vec_set1(0xFF));
+            nes_cpu_batch_vec sum       = nes_cpu_batch_vec_add(sum_1, carry);
+            nes_cpu_batch_vec carry_2   = nes_cpu_batch_vec_xor(nes_cpu_batch_vec_cmpeq(nes_cpu_batch_vec_adds(sum_1, carry), sum), nes_cpu_batch_vec_set1(0xFF));
+            nes_cpu_batch_vec carry_out = nes_cpu_batch_vec_or(carry_1, carry_2);
+
+            //a 9 bit result sets carry, overflow and negative, and can't be zero
+            nes_cpu_batch_vec flags = nes_cpu_batch_vec_select(carry_out,
+                nes_cpu_batch_vec_set1((1 << NES_CPU_FLAG_C) | (1 << NES_CPU_FLAG_V) | (1 << NES_CPU_FLAG_N)),
+                nes_cpu_batch_flags_nz(sum));
+
+            acc_a = sum;
+            p     = nes_cpu_batch_flags_set(p, flags);
+        } break;
+
+        case NesCpuBatchOp::op_sbc: {
+            nes_cpu_batch_vec difference_1 = nes_cpu_batch_vec_sub(acc_a, operand);
+            nes_cpu_batch_vec borrow_1     = nes_cpu_batch_vec_nonzero(nes_cpu_batch_vec_subs(operand, acc_a));
+            nes_cpu_batch_vec difference   = nes_cpu_batch_vec_sub(difference_1, carry);
+            nes_cpu_batch_vec borrow_2     = nes_cpu_batch_vec_nonzero(nes_cpu_batch_vec_subs(carry, difference_1));
+            nes_cpu_batch_vec borrow       = nes_cpu_batch_vec_or(borrow_1, borrow_2);
+
+            acc_a = difference;
+            p     = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_subtract(difference, borrow,
+                (1 << NES_CPU_FLAG_C) | (1 << NES_CPU_FLAG_V) | (1 << NES_CPU_FLAG_N)));
+        } break;
+
+        case NesCpuBatchOp::op_cmp:
+        case NesCpuBatchOp::op_cpx:
+        case NesCpuBatchOp::op_cpy: {
+            nes_cpu_batch_vec value =
+                (op == NesCpuBatchOp::op_cmp) ? acc_a :
+                (op == NesCpuBatchOp::op_cpx) ? ir_x  :
+                                                ir_y;
+            nes_cpu_batch_vec difference = nes_cpu_batch_vec_sub(value, operand);
+            nes_cpu_batch_vec borrow     = nes_cpu_batch_vec_nonzero(nes_cpu_batch_vec_subs(operand, value));
+
+            p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_subtract(difference, borrow,
+                (1 << NES_CPU_FLAG_C) | (1 << NES_CPU_FLAG_N)));
+        } break;
+
+        case NesCpuBatchOp::op_inc: store = nes_cpu_batch_vec_add(operand, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(store)); break;
+        case NesCpuBatchOp::op_dec: store = nes_cpu_batch_vec_sub(operand, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(store)); break;
+
+        case NesCpuBatchOp::op_inx: ir_x = nes_cpu_batch_vec_add(ir_x, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_x)); break;
+        case NesCpuBatchOp::op_iny: ir_y = nes_cpu_batch_vec_add(ir_y, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_y)); break;
+        case NesCpuBatchOp::op_dex: ir_x = nes_cpu_batch_vec_sub(ir_x, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_x)); break;
+        case NesCpuBatchOp::op_dey: ir_y = nes_cpu_batch_vec_sub(ir_y, one); p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_y)); break;
+
+        case NesCpuBatchOp::op_tax: ir_x  = acc_a; p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(acc_a)); break;
+        case NesCpuBatchOp::op_tay: ir_y  = acc_a; p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(acc_a)); break;
+        case NesCpuBatchOp::op_txa: acc_a = ir_x;  p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_x));  break;
+        case NesCpuBatchOp::op_tya: acc_a = ir_y;  p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(ir_y));  break;
+        case NesCpuBatchOp::op_tsx: ir_x  = sp;    p = nes_cpu_batch_flags_set(p, nes_cpu_batch_flags_nz(sp));    break;
+        case NesCpuBatchOp::op_txs: sp    = ir_x;  break;
+
+        case NesCpuBatchOp::op_clc: p = nes_cpu_batch_flags_clear(p, 1 << NES_CPU_FLAG_C); break;
+        case NesCpuBatchOp::op_cli: p = nes_cpu_batch_flags_clear(p, 1 << NES_CPU_FLAG_I); break;
+        case NesCpuBatchOp::op_cld: p = nes_cpu_batch_flags_clear(p, 1 << NES_CPU_FLAG_D); break;
+        case NesCpuBatchOp::op_clv: p = nes_cpu_batch_flags_clear(p, 1 << NES_CPU_FLAG_V); break;
+        case NesCpuBatchOp::op_sec: p = nes_cpu_batch_flags_set(p, nes_cpu_batch_vec_set1(1 << NES_CPU_FLAG_C)); break;
+        case NesCpuBatchOp::op_sei: p = nes_cpu_batch_flags_set(p, nes_cpu_batch_vec_set1(1 << NES_CPU_FLAG_I)); break;
+        case NesCpuBatchOp::op_sed: p = nes_cpu_batch_flags_set(p, nes_cpu_batch_vec_set1(1 << NES_CPU_FLAG_D)); break;
+
+        case NesCpuBatchOp::op_bcc: case NesCpuBatchOp::op_bcs:
+        case NesCpuBatchOp::op_bne: case NesCpuBatchOp::op_beq:
+        case NesCpuBatchOp::op_bvc: case NesCpuBatchOp::op_bvs:
+        case NesCpuBatchOp::op_bpl: case NesCpuBatchOp::op_bmi: {
+            u8 flag = 0;
+            switch (op) {
+                case NesCpuBatchOp::op_bcc: case NesCpuBatchOp::op_bcs: flag = 1 << NES_CPU_FLAG_C; break;
+                case NesCpuBatchOp::op_bne: case NesCpuBatchOp::op_beq: flag = 1 << NES_CPU_FLAG_Z; break;
+                case NesCpuBatchOp::op_bvc: case NesCpuBatchOp::op_bvs: flag = 1 << NES_CPU_FLAG_V; break;
+                default:                                                flag = 1 << NES_CPU_FLAG_N; break;
+            }
+            b32 branch_if_set = (op == NesCpuBatchOp::op_bcs || op == NesCpuBatchOp::op_beq ||
+                                 op == NesCpuBatchOp::op_bvs || op == NesCpuBatchOp::op_bmi) ? TRUE : FALSE;
+
+            u32 flag_set_bits = nes_cpu_batch_vec_movemask(nes_cpu_batch_vec_nonzero(nes_cpu_batch_vec_and(p, nes_cpu_batch_vec_set1(flag))));
+            branch_taken_bits = (branch_if_set == TRUE) ? flag_set_bits : ~flag_set_bits;
+        } break;
+
+        default: break;
+    }
+
+    nes_cpu_batch_vec_store(registers->acc_a, acc_a);
+    nes_cpu_batch_vec_store(registers->ir_x,  ir_x);
+    nes_cpu_batch_vec_store(registers->ir_y,  ir_y);
+    nes_cpu_batch_vec_store(registers->sp,    sp);
+    nes_cpu_batch_vec_store(registers->p,     p);
+    nes_cpu_batch_vec_store(stores,           store);
+
+    return branch_taken_bits;
+}
+
+//one instruction on every lane in group_bits, they all have the same op code up next but can be anywhere
+//each lane still fetches, decodes and reads or writes its operand through the scalar core's own functions,
+//only the register and flag work is shared, and every hook in nes_cpu_instr_end sees each lane as usual
+internal void
+nes_cpu_batch_step_lockstep(NesCpuBatch* batch, u32 group_bits, NesCpuBatchOpCode* op_code) {
+
+    NesCpuBatchRegisters* registers = &batch->registers;
+
+    u8 operands[NES_CPU_BATCH_LANES] = {0};
+    u8 stores[NES_CPU_BATCH_LANES];
+
+    for (u32 lane = 0; lane < batch->count_lanes; ++lane) {
+
+        if (((group_bits >> lane) & 1) == 0) {
+            continue;
+        }
+
+        NesCpu* cpu    = batch->lanes[lane];
+        NesCpuRun* run = &batch->runs[lane];
+
+        //an execute breakpoint stops the lane before it fetches anything
+        if (nes_cpu_instr_begin(cpu, run, &batch->instr_pcs[lane], &batch->instr_registers[lane]) != TRUE) {
+            group_bits &= ~(1 << lane);
+            continue;
+        }
+
+        run->instr.addr_mode = op_code->addr_mode;
+        op_code->operand_decode(cpu, run);
+
+        if (op_code->operand_access & NES_CPU_OPERAND_ACCESS_READ) {
+            operands[lane] = op_code->operand_read(cpu, run);
+        }
+
+        registers->sp[lane]    = run->registers.sp;
+        registers->acc_a[lane] = run->registers.acc_a;
+        registers->ir_x[lane]  = run->registers.ir_x;
+        registers->ir_y[lane]  = run->registers.ir_y;
+        registers->p[lane]     = run->registers.p;
+    }
+
+    u32 branch_taken_bits = nes_cpu_batch_execute(op_code->op, registers, operands, stores);
+
+    for (u32 lane = 0; lane < batch->count_lanes; ++lane) {
+
+        if (((group_bits >> lane) & 1) == 0) {
+            continue;
+        }
+
+        NesCpu* cpu    = batch->lanes[lane];
+        NesCpuRun* run = &batch->runs[lane];
+
+        run->registers.sp    = registers->sp[lane];
+        run->registers.acc_a = registers->acc_a[lane];
+        run->registers.ir_x  = registers->ir_x[lane];
+        run->registers.ir_y  = registers->ir_y[lane];
+        run->registers.p     = registers->p[lane];
+
+        if (op_code->operand_access & NES_CPU_OPERAND_ACCESS_WRITE) {
+            op_code->operand_write(cpu, run, stores[lane]);
+        }
+
+        //branches are only ever relative
+        if ((branch_taken_bits >> lane) & 1) {
+            nes_cpu_branch_and_update_cycles<NesCpuAddressMode::relative>(cpu, run);
+        }
+
+        //all brk does itself is leave nes_cpu_flag_check to take the interrupt
+        if (op_code->op == NesCpuBatchOp::op_brk) {
+            run->instr.result.flag_b = TRUE;
+        }
+
+        cpu->debug_info.op_code_str = nes_cpu_batch_op_code_strs[op_code->op];
+
+        //every other flag is already in p, so the result's stay clear and nes_cpu_flag_check leaves them be
+        run->instr.result.cycles = op_code->base_cycles;
+        nes_cpu_instr_cycles_finish(cpu, run);
+
+        nes_cpu_instr_end(cpu, run, batch->instr_pcs[lane], &batch->instr_registers[lane]);
+
+        ++batch->lockstep_lane_instructions;
+    }
+
+    ++batch->lockstep_steps;
+}
+
+//runs every lane in lane_bits up to its own cycle end, the same as nes_cpu_run_until on each of them
+//the lane furthest back in the code leads and every other lane with the same op code up next goes with it,
+//so lanes running the same code meet up again after they branch different ways
+internal void
+nes_cpu_batch_run_until(NesCpuBatch* batch, u32 lane_bits, u64* cycle_ends) {
+
+    batch->active_bits = 0;
+
+    for (u32 lane = 0; lane < batch->count_lanes; ++lane) {
+
+        if (((lane_bits >> lane) & 1) == 0) {
+            continue;
+        }
+
+        NesCpu* cpu = batch->lanes[lane];
+
+#if NES_CPU_IDLE_LOOP_SKIP
+        //anything that happened since the last burst could change what a spin-wait reads
+        cpu->idle_loop.active = FALSE;
+#endif
+
+        if (cpu->interrupts_pending != 0 && cpu->mem_map.debug.stopped != TRUE) {
+            nes_cpu_interrupts_service(cpu);
+        }
+
+        batch->runs[lane]       = nes_cpu_run_load(cpu);
+        batch->cycle_ends[lane] = cycle_ends[lane];
+        batch->active_bits     |= 1 << lane;
+
+        nes_cpu_batch_lane_update(batch, lane);
+    }
+
+    while (batch->active_bits != 0) {
+
+        u32 lead_lane = NES_CPU_BATCH_LANES;
+        for (u32 lane = 0; lane < batch->count_lanes; ++lane) {
+            if (((batch->active_bits >> lane) & 1) &&
+                (lead_lane == NES_CPU_BATCH_LANES || batch->runs[lane].registers.pc < batch->runs[lead_lane].registers.pc)) {
+                lead_lane = lane;
+            }
+        }
+
+        //the op code is peeked straight out of memory, which only stands in for the fetch the lane is about to
+        //make over the bus if nothing on the page reacts to being read
+        NesCpu* lead_cpu = batch->lanes[lead_lane];
+        nes_addr lead_pc = batch->runs[lead_lane].registers.pc;
+        if (lead_cpu->mem_map.page_table.read_flags[lead_pc >> NES_MEM_MAP_PAGE_SHIFT] != 0) {
+            nes_cpu_batch_step_scalar(batch, lead_lane);
+            nes_cpu_batch_lane_update(batch, lead_lane);
+            continue;
+        }
+
+        nes_val op_code = *nes_memory_map_address(&lead_cpu->mem_map, lead_pc);
+
+        u32 group_bits = 1 << lead_lane;
+        for (u32 lane = lead_lane + 1; lane < batch->count_lanes; ++lane) {
+
+            if (((batch->active_bits >> lane) & 1) == 0) {
+                continue;
+            }
+
+            NesCpu* cpu = batch->lanes[lane];
+            nes_addr pc = batch->runs[lane].registers.pc;
+            if (cpu->mem_map.page_table.read_flags[pc >> NES_MEM_MAP_PAGE_SHIFT] == 0 &&
+                *nes_memory_map_address(&cpu->mem_map, pc) == op_code) {
+                group_bits |= 1 << lane;
+            }
+        }
+
+        NesCpuBatchOpCode* batch_op_code = &nes_cpu_batch_op_codes[op_code];
+
+        //a lane on its own gains nothing from the vectors
+        if (batch_op_code->op < NesCpuBatchOp::op_scalar && (group_bits & (group_bits - 1)) != 0) {
+            nes_cpu_batch_step_lockstep(batch, group_bits, batch_op_code);
+        }
+        else {
+            for (u32 lane = lead_lane; lane < batch->count_lanes; ++lane) {
+                if ((group_bits >> lane) & 1) {
+                    nes_cpu_batch_step_scalar(batch, lane);
+                }
+            }
+        }
+
+        for (u32 lane = lead_lane; lane < batch->count_lanes; ++lane) {
+            if ((group_bits >> lane) & 1) {
+                nes_cpu_batch_lane_update(batch, lane);
+            }
+        }
+    }
+
+    for (u32 lane = 0; lane < batch->count_lanes; ++lane) {
+        if ((lane_bits >> lane) & 1) {
+            nes_cpu_run_store(batch->lanes[lane], &batch->runs[lane]);
+        }
+    }
+}
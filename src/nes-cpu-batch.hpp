@@ -0,0 +1,90 @@
+#ifndef NES_CPU_BATCH_HPP
+#define NES_CPU_BATCH_HPP
+
+#include "nes-types.h"
+#include "nes-cpu.hpp"
+#include "nes-cpu-instr.hpp"
+
+//one 8 bit register for every lane fits in a single sse2 register
+#define NES_CPU_BATCH_LANES 16
+
+//sse2 is always there on x64, anywhere else the vector ops fall back to plain loops
+#ifndef NES_CPU_BATCH_SSE2
+    #if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+        #define NES_CPU_BATCH_SSE2 1
+    #else
+        #define NES_CPU_BATCH_SSE2 0
+    #endif
+#endif
+
+#if NES_CPU_BATCH_SSE2
+    #include <emmintrin.h>
+    typedef __m128i nes_cpu_batch_vec;
+#else
+    struct nes_cpu_batch_vec {
+        u8 lanes[NES_CPU_BATCH_LANES];
+    };
+#endif
+
+//every handler NES_CPU_OP_CODES names, the ones before op_scalar run in lockstep and
+//the rest step each lane through nes_cpu_run_step
+enum NesCpuBatchOp {
+    op_lda, op_ldx, op_ldy,
+    op_sta, op_stx, op_sty,
+    op_and, op_ora,
+    op_adc, op_sbc,
+    op_cmp, op_cpx, op_cpy,
+    op_inc, op_dec,
+    op_inx, op_iny, op_dex, op_dey,
+    op_tax, op_tay, op_txa, op_tya, op_tsx, op_txs,
+    op_clc, op_sec, op_cli, op_sei, op_cld, op_sed, op_clv,
+    op_nop,
+    op_bcc, op_bcs, op_beq, op_bne, op_bmi, op_bpl, op_bvc, op_bvs,
+    op_brk,
+    op_scalar,
+    op_asl, op_lsr, op_rol, op_ror,
+    op_php, op_pla, op_plp,
+    op_jmp, op_jsr, op_rts, op_rti
+};
+
+//the same address mode functions the scalar core specializes for the op code, so every lane
+//goes over its bus exactly the way nes_cpu_run_step would
+struct NesCpuBatchOpCode {
+    NesCpuBatchOp op;
+    NesCpuAddressMode addr_mode;
+    u32 base_cycles;
+    //NES_CPU_OPERAND_ACCESS_READ and/or NES_CPU_OPERAND_ACCESS_WRITE for the lockstep ops that touch the operand
+    u8 operand_access;
+    void    (*operand_decode)(NesCpu*, NesCpuRun*);
+    nes_val (*operand_read)(NesCpu*, NesCpuRun*);
+    void    (*operand_write)(NesCpu*, NesCpuRun*, nes_val);
+};
+
+//struct of arrays, lane i of every register lives at index i
+struct NesCpuBatchRegisters {
+    u8 sp[NES_CPU_BATCH_LANES];
+    u8 acc_a[NES_CPU_BATCH_LANES];
+    u8 ir_x[NES_CPU_BATCH_LANES];
+    u8 ir_y[NES_CPU_BATCH_LANES];
+    u8 p[NES_CPU_BATCH_LANES];
+};
+
+struct NesCpuBatch {
+    //each lane is a full cpu owned by the caller, the batch only borrows it
+    NesCpu* lanes[NES_CPU_BATCH_LANES];
+    u32 count_lanes;
+    //every lane's registers and counters while a run is going, the same local nes_cpu_run keeps
+    NesCpuRun runs[NES_CPU_BATCH_LANES];
+    u64 cycle_ends[NES_CPU_BATCH_LANES];
+    u32 active_bits;
+    //where each lane's instruction started and its registers going in, for nes_cpu_instr_end
+    nes_addr instr_pcs[NES_CPU_BATCH_LANES];
+    NesCpuRegisters instr_registers[NES_CPU_BATCH_LANES];
+    NesCpuBatchRegisters registers;
+    //how the work got done
+    u64 lockstep_steps;
+    u64 lockstep_lane_instructions;
+    u64 scalar_lane_instructions;
+};
+
+#endif //NES_CPU_BATCH_HPP
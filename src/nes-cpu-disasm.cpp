@@ -0,0 +1,325 @@
+#include "nes-cpu-disasm.hpp"
+
+global NesCpuDisasmTable nes_cpu_disasm_table;
+global b32               nes_cpu_disasm_table_initialized = FALSE;
+
+internal u8
+nes_cpu_disasm_instr_size_from_address_mode(NesCpuAddressMode addr_mode) {
+
+    switch (addr_mode) {
+        case NesCpuAddressMode::implied:
+        case NesCpuAddressMode::accumulator:         return 1;
+        case NesCpuAddressMode::immediate:
+        case NesCpuAddressMode::zero_page:
+        case NesCpuAddressMode::zero_page_indexed_x:
+        case NesCpuAddressMode::zero_page_indexed_y:
+        case NesCpuAddressMode::relative:
+        case NesCpuAddressMode::indexed_indirect_x:
+        case NesCpuAddressMode::indirect_indexed_y:  return 2;
+        case NesCpuAddressMode::absolute:
+        case NesCpuAddressMode::absolute_indexed_x:
+        case NesCpuAddressMode::absolute_indexed_y:
+        case NesCpuAddressMode::indirect:            return 3;
+        default:                                     return 1;
+    }
+}
+
+internal char*
+nes_cpu_disasm_address_mode_str(NesCpuAddressMode addr_mode) {
+
+    switch (addr_mode) {
+        case NesCpuAddressMode::zero_page:           return "ZP";
+        case NesCpuAddressMode::zero_page_indexed_x: return "ZP-X";
+        case NesCpuAddressMode::zero_page_indexed_y: return "ZP-Y";
+        case NesCpuAddressMode::absolute:            return "ABS";
+        case NesCpuAddressMode::absolute_indexed_x:  return "ABS-X";
+        case NesCpuAddressMode::absolute_indexed_y:  return "ABS-Y";
+        case NesCpuAddressMode::indirect:            return "IND";
+        case NesCpuAddressMode::implied:             return "IMP";
+        case NesCpuAddressMode::accumulator:         return "ACC";
+        case NesCpuAddressMode::immediate:           return "IMM";
+        case NesCpuAddressMode::relative:            return "REL";
+        case NesCpuAddressMode::indexed_indirect_x:  return "IND-X";
+        case NesCpuAddressMode::indirect_indexed_y:  return "IND-Y";
+        default:                                     return "???";
+    }
+}
+
+internal void
+nes_cpu_disasm_table_set(nes_val op_code, char* mnemonic, NesCpuAddressMode addr_mode) {
+
+    NesCpuDisasmOpCode* entry = &nes_cpu_disasm_table.op_codes[op_code];
+    entry->mnemonic  = mnemonic;
+    entry->addr_mode = addr_mode;
+    entry->size      = nes_cpu_disasm_instr_size_from_address_mode(addr_mode);
+    entry->valid     = TRUE;
+}
+
+internal void
+nes_cpu_disasm_table_initialize() {
+
+    if (nes_cpu_disasm_table_initialized == TRUE) {
+        return;
+    }
+
+    //anything we don't know about is shown as a one byte unknown op code
+    for (u32 op_code = 0; op_code < 256; ++op_code) {
+        nes_cpu_disasm_table.op_codes[op_code].mnemonic  = "???";
+        nes_cpu_disasm_table.op_codes[op_code].addr_mode = NesCpuAddressMode::implied;
+        nes_cpu_disasm_table.op_codes[op_code].size      = 1;
+        nes_cpu_disasm_table.op_codes[op_code].valid     = FALSE;
+    }
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_ABS,   "ADC", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_ABS_X, "ADC", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_ABS_Y, "ADC", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_IMM,   "ADC", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_IND_X, "ADC", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_IND_Y, "ADC", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_ZP,    "ADC", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ADC_ZP_X,  "ADC", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_ABS,   "AND", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_ABS_X, "AND", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_ABS_Y, "AND", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_IMM,   "AND", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_IND_X, "AND", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_IND_Y, "AND", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_ZP,    "AND", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_AND_ZP_X,  "AND", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ASL_ACC,   "ASL", NesCpuAddressMode::accumulator);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ASL_ABS,   "ASL", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ASL_ABS_X, "ASL", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ASL_ZP,    "ASL", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ASL_ZP_X,  "ASL", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BCC_REL,   "BCC", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BCS_REL,   "BCS", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BEQ_REL,   "BEQ", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BIT_ABS,   "BIT", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BIT_ZP,    "BIT", NesCpuAddressMode::zero_page);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BMI_REL,   "BMI", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BNE_REL,   "BNE", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BPL_REL,   "BPL", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BRK_IMP,   "BRK", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BVC_REL,   "BVC", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_BVS_REL,   "BVS", NesCpuAddressMode::relative);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CLC_IMP,   "CLC", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CLD_IMP,   "CLD", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CLI_IMP,   "CLI", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CLV_IMP,   "CLV", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_ABS,   "CMP", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_ABS_X, "CMP", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_ABS_Y, "CMP", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_IMM,   "CMP", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_IND_X, "CMP", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_IND_Y, "CMP", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_ZP,    "CMP", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CMP_ZP_X,  "CMP", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPX_ABS,   "CPX", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPX_IMM,   "CPX", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPX_ZP,    "CPX", NesCpuAddressMode::zero_page);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPY_ABS,   "CPY", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPY_IMM,   "CPY", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_CPY_ZP,    "CPY", NesCpuAddressMode::zero_page);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEC_ABS,   "DEC", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEC_ABS_X, "DEC", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEC_ZP,    "DEC", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEC_ZP_X,  "DEC", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEX_IMP,   "DEX", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_DEY_IMP,   "DEY", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_ABS,   "EOR", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_ABS_X, "EOR", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_ABS_Y, "EOR", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_IMM,   "EOR", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_IND_X, "EOR", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_IND_Y, "EOR", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_ZP,    "EOR", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_EOR_ZP_X,  "EOR", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INC_ABS,   "INC", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INC_ABS_X, "INC", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INC_ZP,    "INC", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INC_ZP_X,  "INC", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INX_IMP,   "INX", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_INY_IMP,   "INY", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_JMP_ABS,   "JMP", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_JMP_IND,   "JMP", NesCpuAddressMode::indirect);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_JSR_ABS,   "JSR", NesCpuAddressMode::absolute);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_ABS,   "LDA", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_ABS_X, "LDA", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_ABS_Y, "LDA", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_IMM,   "LDA", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_IND_X, "LDA", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_IND_Y, "LDA", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_ZP,    "LDA", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDA_ZP_X,  "LDA", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDX_ABS,   "LDX", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDX_ABS_Y, "LDX", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDX_IMM,   "LDX", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDX_ZP,    "LDX", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDX_ZP_Y,  "LDX", NesCpuAddressMode::zero_page_indexed_y);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDY_ABS,   "LDY", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDY_ABS_X, "LDY", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDY_IMM,   "LDY", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDY_ZP,    "LDY", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LDY_ZP_X,  "LDY", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LSR_ACC,   "LSR", NesCpuAddressMode::accumulator);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LSR_ABS,   "LSR", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LSR_ABS_X, "LSR", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LSR_ZP,    "LSR", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_LSR_ZP_X,  "LSR", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_NOP_IMP,   "NOP", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_ABS,   "ORA", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_ABS_X, "ORA", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_ABS_Y, "ORA", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_IMM,   "ORA", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_IND_X, "ORA", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_IND_Y, "ORA", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_ZP,    "ORA", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ORA_ZP_X,  "ORA", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_PHA_IMP,   "PHA", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_PHP_IMP,   "PHP", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_PLA_IMP,   "PLA", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_PLP_IMP,   "PLP", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROL_ACC,   "ROL", NesCpuAddressMode::accumulator);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROL_ABS,   "ROL", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROL_ABS_X, "ROL", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROL_ZP,    "ROL", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROL_ZP_X,  "ROL", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROR_ACC,   "ROR", NesCpuAddressMode::accumulator);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROR_ABS,   "ROR", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROR_ABS_X, "ROR", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROR_ZP,    "ROR", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_ROR_ZP_X,  "ROR", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_RTI_IMP,   "RTI", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_RTS_IMP,   "RTS", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_ABS,   "SBC", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_ABS_X, "SBC", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_ABS_Y, "SBC", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_IMM,   "SBC", NesCpuAddressMode::immediate);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_IND_X, "SBC", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_IND_Y, "SBC", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_ZP,    "SBC", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SBC_ZP_X,  "SBC", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SEC_IMP,   "SEC", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SED_IMP,   "SED", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_SEI_IMP,   "SEI", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_ABS,   "STA", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_ABS_X, "STA", NesCpuAddressMode::absolute_indexed_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_ABS_Y, "STA", NesCpuAddressMode::absolute_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_IND_X, "STA", NesCpuAddressMode::indexed_indirect_x);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_IND_Y, "STA", NesCpuAddressMode::indirect_indexed_y);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_ZP,    "STA", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STA_ZP_X,  "STA", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STX_ABS,   "STX", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STX_ZP,    "STX", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STX_ZP_Y,  "STX", NesCpuAddressMode::zero_page_indexed_y);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STY_ABS,   "STY", NesCpuAddressMode::absolute);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STY_ZP,    "STY", NesCpuAddressMode::zero_page);
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_STY_ZP_X,  "STY", NesCpuAddressMode::zero_page_indexed_x);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TAX_IMP,   "TAX", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TAY_IMP,   "TAY", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TSX_IMP,   "TSX", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TXA_IMP,   "TXA", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TXS_IMP,   "TXS", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_set(NES_CPU_INSTR_TYA_IMP,   "TYA", NesCpuAddressMode::implied);
+
+    nes_cpu_disasm_table_initialized = TRUE;
+}
+
+internal NesCpuDisasmOpCode*
+nes_cpu_disasm_op_code(nes_val op_code) {
+
+    nes_cpu_disasm_table_initialize();
+    return &nes_cpu_disasm_table.op_codes[op_code];
+}
+
+//instr_bytes points at the op code, followed by up to two operand bytes
+internal void
+nes_cpu_disasm_format(nes_addr pc, nes_val* instr_bytes, char* disasm_str) {
+
+    NesCpuDisasmOpCode* op_code = nes_cpu_disasm_op_code(instr_bytes[0]);
+
+    nes_val  operand_lower = instr_bytes[1];
+    nes_addr operand_word  = (instr_bytes[2] << 8) | instr_bytes[1];
+
+    switch (op_code->addr_mode) {
+        case NesCpuAddressMode::zero_page:           sprintf(disasm_str, "%s $%02X",     op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::zero_page_indexed_x: sprintf(disasm_str, "%s $%02X,X",   op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::zero_page_indexed_y: sprintf(disasm_str, "%s $%02X,Y",   op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::absolute:            sprintf(disasm_str, "%s $%04X",     op_code->mnemonic, operand_word);  break;
+        case NesCpuAddressMode::absolute_indexed_x:  sprintf(disasm_str, "%s $%04X,X",   op_code->mnemonic, operand_word);  break;
+        case NesCpuAddressMode::absolute_indexed_y:  sprintf(disasm_str, "%s $%04X,Y",   op_code->mnemonic, operand_word);  break;
+        case NesCpuAddressMode::indirect:            sprintf(disasm_str, "%s ($%04X)",   op_code->mnemonic, operand_word);  break;
+        case NesCpuAddressMode::accumulator:         sprintf(disasm_str, "%s A",         op_code->mnemonic);                break;
+        case NesCpuAddressMode::immediate:           sprintf(disasm_str, "%s #$%02X",    op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::indexed_indirect_x:  sprintf(disasm_str, "%s ($%02X,X)", op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::indirect_indexed_y:  sprintf(disasm_str, "%s ($%02X),Y", op_code->mnemonic, operand_lower); break;
+        case NesCpuAddressMode::relative: {
+            //branch targets are relative to the address of the next instruction
+            nes_addr branch_target = pc + 2 + (i8)operand_lower;
+            sprintf(disasm_str, "%s $%04X", op_code->mnemonic, branch_target);
+        } break;
+        default: {
+            if (op_code->valid == TRUE) {
+                sprintf(disasm_str, "%s", op_code->mnemonic);
+            }
+            else {
+                sprintf(disasm_str, ".db $%02X", instr_bytes[0]);
+            }
+        } break;
+    }
+}
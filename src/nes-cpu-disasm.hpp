@@ -0,0 +1,22 @@
+#ifndef NES_CPU_DISASM_HPP
+#define NES_CPU_DISASM_HPP
+
+#include "nes-types.h"
+#include "nes-cpu.hpp"
+#include "nes-cpu-instr.hpp"
+
+#define NES_CPU_DISASM_STR_SIZE 32
+
+struct NesCpuDisasmOpCode {
+    char* mnemonic;
+    NesCpuAddressMode addr_mode;
+    //total instruction size in bytes, including the op code
+    u8 size;
+    b32 valid;
+};
+
+struct NesCpuDisasmTable {
+    NesCpuDisasmOpCode op_codes[256];
+};
+
+#endif //NES_CPU_DISASM_HPP
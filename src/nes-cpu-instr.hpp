@@ -178,4 +178,194 @@
 #define NES_CPU_INSTR_LDX_ZP_Y  0xB6
 #define NES_CPU_INSTR_STX_ZP_Y  0x96
 
+//every op code the core knows: the name after NES_CPU_INSTR_, the address mode, the handler and the base cycles
+//the switch core (nes_cpu_instr_execute), the computed goto core (nes-cpu-threaded.cpp) and the batch core
+//(nes-cpu-batch.cpp) are all built from this, so an op code only ever gets written down once, mistakes included (cpx decodes as zero page, eor runs cmp,
+//bit and pha do nothing)
+//anything not in here runs as a zero page nop
+#define NES_CPU_OP_CODES(op) \
+    op(ADC_IMM,   immediate,           adc, 2) \
+    op(ADC_ZP,    zero_page,           adc, 3) \
+    op(ADC_ZP_X,  zero_page_indexed_x, adc, 4) \
+    op(ADC_ABS,   absolute,            adc, 4) \
+    op(ADC_ABS_X, absolute_indexed_x,  adc, 4) \
+    op(ADC_ABS_Y, absolute_indexed_y,  adc, 4) \
+    op(ADC_IND_X, indexed_indirect_x,  adc, 6) \
+    op(ADC_IND_Y, indirect_indexed_y,  adc, 5) \
+                                               \
+    op(AND_IMM,   immediate,           and, 2) \
+    op(AND_ZP,    zero_page,           and, 3) \
+    op(AND_ZP_X,  zero_page_indexed_x, and, 4) \
+    op(AND_ABS,   absolute,            and, 4) \
+    op(AND_ABS_X, absolute_indexed_x,  and, 4) \
+    op(AND_ABS_Y, absolute_indexed_y,  and, 4) \
+    op(AND_IND_X, indexed_indirect_x,  and, 6) \
+    op(AND_IND_Y, indirect_indexed_y,  and, 5) \
+                                               \
+    op(ASL_ACC,   accumulator,         asl, 2) \
+    op(ASL_ZP,    zero_page,           asl, 5) \
+    op(ASL_ZP_X,  zero_page_indexed_x, asl, 6) \
+    op(ASL_ABS,   absolute,            asl, 6) \
+    op(ASL_ABS_X, absolute_indexed_x,  asl, 7) \
+                                               \
+    op(BCC_REL,   relative,            bcc, 2) \
+    op(BCS_REL,   relative,            bcs, 2) \
+    op(BEQ_REL,   relative,            beq, 2) \
+                                               \
+    op(BIT_ZP,    zero_page,           nop, 2) \
+    op(BIT_ABS,   absolute,            nop, 2) \
+                                               \
+    op(BMI_REL,   relative,            bmi, 2) \
+    op(BNE_REL,   relative,            bne, 2) \
+    op(BPL_REL,   relative,            bpl, 2) \
+    op(BVC_REL,   relative,            bvc, 2) \
+    op(BVS_REL,   relative,            bvs, 2) \
+                                               \
+    op(BRK_IMP,   implied,             brk, 7) \
+    op(CLC_IMP,   implied,             clc, 2) \
+    op(CLD_IMP,   implied,             cld, 2) \
+    op(CLI_IMP,   implied,             cli, 2) \
+    op(CLV_IMP,   implied,             clv, 2) \
+                                               \
+    op(CMP_IMM,   immediate,           cmp, 2) \
+    op(CMP_ZP,    zero_page,           cmp, 2) \
+    op(CMP_ZP_X,  zero_page_indexed_x, cmp, 2) \
+    op(CMP_ABS,   absolute,            cmp, 3) \
+    op(CMP_ABS_X, absolute_indexed_x,  cmp, 3) \
+    op(CMP_ABS_Y, absolute_indexed_y,  cmp, 3) \
+    op(CMP_IND_X, indexed_indirect_x,  cmp, 2) \
+    op(CMP_IND_Y, indirect_indexed_y,  cmp, 2) \
+                                               \
+    op(CPX_IMM,   zero_page,           cpx, 2) \
+    op(CPX_ZP,    zero_page,           cpx, 3) \
+    op(CPX_ABS,   zero_page,           cpx, 4) \
+                                               \
+    op(CPY_IMM,   immediate,           cpy, 2) \
+    op(CPY_ZP,    zero_page,           cpy, 3) \
+    op(CPY_ABS,   absolute,            cpy, 4) \
+                                               \
+    op(DEC_ZP,    zero_page,           dec, 5) \
+    op(DEC_ZP_X,  zero_page_indexed_x, dec, 6) \
+    op(DEC_ABS,   absolute,            dec, 6) \
+    op(DEC_ABS_X, absolute_indexed_x,  dec, 7) \
+                                               \
+    op(DEX_IMP,   implied,             dex, 2) \
+    op(DEY_IMP,   implied,             dey, 2) \
+                                               \
+    op(EOR_IMM,   immediate,           cmp, 2) \
+    op(EOR_ZP,    zero_page,           cmp, 3) \
+    op(EOR_ZP_X,  zero_page_indexed_x, cmp, 4) \
+    op(EOR_ABS,   absolute,            cmp, 4) \
+    op(EOR_ABS_X, absolute_indexed_x,  cmp, 4) \
+    op(EOR_ABS_Y, absolute_indexed_y,  cmp, 4) \
+    op(EOR_IND_X, indexed_indirect_x,  cmp, 6) \
+    op(EOR_IND_Y, indirect_indexed_y,  cmp, 5) \
+                                               \
+    op(INC_ZP,    zero_page,           inc, 5) \
+    op(INC_ZP_X,  zero_page_indexed_x, inc, 6) \
+    op(INC_ABS,   absolute,            inc, 6) \
+    op(INC_ABS_X, absolute_indexed_x,  inc, 7) \
+                                               \
+    op(INX_IMP,   implied,             inx, 2) \
+    op(INY_IMP,   implied,             iny, 2) \
+                                               \
+    op(JMP_ABS,   absolute,            jmp, 3) \
+    op(JMP_IND,   indirect,            jmp, 5) \
+                                               \
+    op(JSR_ABS,   absolute,            jsr, 6) \
+                                               \
+    op(LDA_IMM,   immediate,           lda, 2) \
+    op(LDA_ZP,    zero_page,           lda, 3) \
+    op(LDA_ZP_X,  zero_page_indexed_x, lda, 4) \
+    op(LDA_ABS,   absolute,            lda, 4) \
+    op(LDA_ABS_X, absolute_indexed_x,  lda, 4) \
+    op(LDA_ABS_Y, absolute_indexed_y,  lda, 4) \
+    op(LDA_IND_X, indexed_indirect_x,  lda, 6) \
+    op(LDA_IND_Y, indirect_indexed_y,  lda, 5) \
+                                               \
+    op(LDX_IMM,   immediate,           ldx, 2) \
+    op(LDX_ZP,    zero_page,           ldx, 3) \
+    op(LDX_ZP_Y,  zero_page_indexed_y, ldx, 4) \
+    op(LDX_ABS,   absolute,            ldx, 4) \
+    op(LDX_ABS_Y, absolute_indexed_y,  ldx, 4) \
+                                               \
+    op(LDY_IMM,   immediate,           ldy, 2) \
+    op(LDY_ZP,    zero_page,           ldy, 3) \
+    op(LDY_ZP_X,  zero_page_indexed_x, ldy, 4) \
+    op(LDY_ABS,   absolute,            ldy, 4) \
+    op(LDY_ABS_X, absolute_indexed_x,  ldy, 4) \
+                                               \
+    op(LSR_ACC,   accumulator,         lsr, 2) \
+    op(LSR_ZP,    zero_page,           lsr, 5) \
+    op(LSR_ZP_X,  zero_page_indexed_x, lsr, 6) \
+    op(LSR_ABS,   absolute,            lsr, 6) \
+    op(LSR_ABS_X, absolute_indexed_x,  lsr, 7) \
+                                               \
+    op(NOP_IMP,   implied,             nop, 2) \
+                                               \
+    op(ORA_IMM,   immediate,           ora, 2) \
+    op(ORA_ZP,    zero_page,           ora, 3) \
+    op(ORA_ZP_X,  zero_page_indexed_x, ora, 4) \
+    op(ORA_ABS,   absolute,            ora, 4) \
+    op(ORA_ABS_X, absolute_indexed_x,  ora, 4) \
+    op(ORA_ABS_Y, absolute_indexed_y,  ora, 4) \
+    op(ORA_IND_X, indexed_indirect_x,  ora, 6) \
+    op(ORA_IND_Y, indirect_indexed_y,  ora, 5) \
+                                               \
+    op(PHA_IMP,   implied,             nop, 2) \
+    op(PHP_IMP,   implied,             php, 3) \
+    op(PLA_IMP,   implied,             pla, 4) \
+    op(PLP_IMP,   implied,             plp, 4) \
+                                               \
+    op(ROL_ACC,   accumulator,         rol, 2) \
+    op(ROL_ZP,    zero_page,           rol, 5) \
+    op(ROL_ZP_X,  zero_page_indexed_x, rol, 6) \
+    op(ROL_ABS,   absolute,            rol, 6) \
+    op(ROL_ABS_X, absolute_indexed_x,  rol, 7) \
+                                               \
+    op(ROR_ACC,   accumulator,         ror, 2) \
+    op(ROR_ZP,    zero_page,           ror, 5) \
+    op(ROR_ZP_X,  zero_page_indexed_x, ror, 6) \
+    op(ROR_ABS,   absolute,            ror, 6) \
+    op(ROR_ABS_X, absolute_indexed_x,  ror, 7) \
+                                               \
+    op(RTI_IMP,   implied,             rti, 6) \
+    op(RTS_IMP,   implied,             rts, 6) \
+                                               \
+    op(SBC_IMM,   immediate,           sbc, 2) \
+    op(SBC_ZP,    zero_page,           sbc, 3) \
+    op(SBC_ZP_X,  zero_page_indexed_x, sbc, 4) \
+    op(SBC_ABS,   absolute,            sbc, 4) \
+    op(SBC_ABS_X, absolute_indexed_x,  sbc, 4) \
+    op(SBC_ABS_Y, absolute_indexed_y,  sbc, 4) \
+    op(SBC_IND_X, indexed_indirect_x,  sbc, 6) \
+    op(SBC_IND_Y, indirect_indexed_y,  sbc, 5) \
+                                               \
+    op(SEC_IMP,   implied,             sec, 2) \
+    op(SED_IMP,   implied,             sed, 2) \
+    op(SEI_IMP,   implied,             sei, 2) \
+                                               \
+    op(STA_ZP,    zero_page,           sta, 3) \
+    op(STA_ZP_X,  zero_page_indexed_x, sta, 4) \
+    op(STA_ABS,   absolute,            sta, 4) \
+    op(STA_ABS_X, absolute_indexed_x,  sta, 5) \
+    op(STA_ABS_Y, absolute_indexed_y,  sta, 5) \
+    op(STA_IND_X, indexed_indirect_x,  sta, 6) \
+    op(STA_IND_Y, indirect_indexed_y,  sta, 6) \
+                                               \
+    op(STX_ZP,    zero_page,           stx, 3) \
+    op(STX_ZP_Y,  zero_page_indexed_y, stx, 4) \
+    op(STX_ABS,   absolute,            stx, 4) \
+                                               \
+    op(STY_ZP,    zero_page,           sty, 3) \
+    op(STY_ZP_X,  zero_page_indexed_x, sty, 4) \
+    op(STY_ABS,   absolute,            sty, 4) \
+                                               \
+    op(TAX_IMP,   implied,             tax, 2) \
+    op(TAY_IMP,   implied,             tay, 2) \
+    op(TSX_IMP,   implied,             tsx, 2) \
+    op(TXA_IMP,   implied,             txa, 2) \
+    op(TXS_IMP,   implied,             txs, 2) \
+    op(TYA_IMP,   implied,             tya, 2)
+
 #endif //NES_CPU_INSTR_HPP
\ No newline at end of file
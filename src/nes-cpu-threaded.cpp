@@ -0,0 +1,58 @@
+#include "nes-cpu-threaded.hpp"
+
+#if NES_CPU_THREADED
+
+//one op code's work and then straight on to the next op code's handler, every handler has a jump
+//of its own so the branch predictor learns which op codes tend to follow which
+#define NES_CPU_THREADED_HANDLER(name, mode, instr, base_cycles)    \
+    handler_##name: {                                               \
+        NES_CPU_OP_CODE_EXECUTE(mode, instr, base_cycles);          \
+        nes_cpu_instr_end(cpu, run, instr_pc, &instr_registers);    \
+        NES_CPU_THREADED_DISPATCH();                                \
+    }
+
+//the same checks nes_cpu_run makes between instructions, then the next op code's handler
+#define NES_CPU_THREADED_DISPATCH()                                 \
+    if (run->cycle_count >= cycle_end ||                            \
+        cpu->mem_map.debug.stopped == TRUE ||                       \
+        nes_cpu_idle_loop_try_skip(cpu, run, cycle_end) == TRUE ||  \
+        nes_cpu_instr_begin(cpu, run, &instr_pc, &instr_registers) != TRUE) { \
+        nes_cpu_run_store(cpu, run);                                \
+        return;                                                     \
+    }                                                               \
+    goto *dispatch[run->instr.op_code];
+
+#define NES_CPU_THREADED_DISPATCH_SET(name, mode, instr, base_cycles) \
+    dispatch[NES_CPU_INSTR_##name] = &&handler_##name;
+
+//the computed goto build of nes_cpu_run, reached through it
+internal void
+nes_cpu_threaded_run(NesCpu* cpu, u64 cycle_end) {
+
+    //a label's address only exists in here, so the table is filled on the first call
+    //racing on it is harmless since everyone fills in the same addresses
+    local void* dispatch[256];
+    local volatile u32 dispatch_initialized = 0;
+
+    if (AtomicLoadAcquireU32(&dispatch_initialized) == 0) {
+        for (u32 op_code = 0; op_code < 256; ++op_code) {
+            dispatch[op_code] = &&handler_unknown;
+        }
+        NES_CPU_OP_CODES(NES_CPU_THREADED_DISPATCH_SET)
+        AtomicStoreReleaseU32(&dispatch_initialized, 1);
+    }
+
+    //the registers and counters live in here until the burst is over
+    NesCpuRun run_locals = nes_cpu_run_load(cpu);
+    NesCpuRun* run       = &run_locals;
+
+    nes_addr instr_pc;
+    NesCpuRegisters instr_registers;
+
+    NES_CPU_THREADED_DISPATCH();
+
+    NES_CPU_OP_CODES(NES_CPU_THREADED_HANDLER)
+    NES_CPU_THREADED_HANDLER(unknown, zero_page, nop, 2)
+}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef NES_CPU_THREADED_HPP
+#define NES_CPU_THREADED_HPP
+
+#include "nes-types.h"
+#include "nes-cpu.hpp"
+#include "nes-cpu-instr.hpp"
+
+#endif //NES_CPU_THREADED_HPP
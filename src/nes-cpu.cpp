@@ -1,130 +1,244 @@
 #include "nes-cpu.hpp"
+#include "nes-cpu-disasm.cpp"
+#include "nes-cdl.cpp"
+#include "nes-trace.cpp"
 
-internal void
-nes_cpu_stack_push(NesCpu* cpu, nes_val value) {
+//page one is plain ram unless a watchpoint or the dirty tracking wants to see the access,
+//so the stack goes straight to NesMemoryMapRam::stack and sp wraps on its own as a u8
+#define NES_CPU_STACK_PAGE (NES_MEM_MAP_STACK_ADDR >> NES_MEM_MAP_PAGE_SHIFT)
 
-    nes_memory_map_write(&cpu->mem_map, (cpu->registers.sp + NES_MEM_MAP_STACK_ADDR), value);
-    
-    //the stack goes in reverse, so if we are getting down to the beginning
-    //of the stack's address space, we need to reset the stack pointer to the
-    //top
+internal inline void
+nes_cpu_stack_push(NesCpu* cpu, NesCpuRun* run, nes_val value) {
+
+#if NES_TRACE
+    //pushes skip the operand, so the trace has to hear about them separately
+    if (cpu->trace) {
+        nes_trace_stack_write(cpu->trace, run->registers.sp, 1);
+    }
+#endif
 
-    //otherwise, we just decrement the stack pointer
-    if (cpu->registers.sp == NES_MEM_MAP_STACK_PTR_END) {
-        cpu->registers.sp = NES_MEM_MAP_STACK_PTR_BEGIN;
+    if (cpu->mem_map.page_table.write_flags[NES_CPU_STACK_PAGE] == 0) {
+        cpu->mem_map.ram.stack[run->registers.sp] = value;
     } else {
-        --cpu->registers.sp;
+        nes_memory_map_write(&cpu->mem_map, (NES_MEM_MAP_STACK_ADDR + run->registers.sp), value);
     }
+
+    //the stack grows down, going past the bottom of page one wraps back to the top
+    --run->registers.sp;
 }
 
-internal nes_val
-nes_cpu_stack_pull(NesCpu* cpu) {
+internal inline nes_val
+nes_cpu_stack_pull(NesCpu* cpu, NesCpuRun* run) {
 
-    nes_val stack_val = nes_memory_map_read(&cpu->mem_map, (NES_MEM_MAP_STACK_ADDR + cpu->registers.sp));
+    nes_val stack_val;
 
-    //update the stack pointer
-    //the stack is reverse, so we incriment the pointer
-    //if it gets to the top of the stack's address space,
-    //it needs to be reset to the bottom 
-    if (cpu->registers.sp == NES_MEM_MAP_STACK_PTR_BEGIN) {
-        cpu->registers.sp = NES_MEM_MAP_STACK_PTR_END;
+    if (cpu->mem_map.page_table.read_flags[NES_CPU_STACK_PAGE] == 0) {
+        stack_val = cpu->mem_map.ram.stack[run->registers.sp];
     } else {
-        ++cpu->registers.sp;
+        stack_val = nes_memory_map_read(&cpu->mem_map, (NES_MEM_MAP_STACK_ADDR + run->registers.sp));
     }
 
+    //and shrinks back up, wrapping past the top of page one to the bottom
+    ++run->registers.sp;
+
     return stack_val;
 }
 
+//interrupt entry pushes two bytes back to back, the page flags only need checking once for both
+internal inline void
+nes_cpu_stack_push_pair(NesCpu* cpu, NesCpuRun* run, nes_val first, nes_val second) {
+
+    if (cpu->mem_map.page_table.write_flags[NES_CPU_STACK_PAGE] != 0) {
+        nes_cpu_stack_push(cpu, run, first);
+        nes_cpu_stack_push(cpu, run, second);
+        return;
+    }
+
+#if NES_TRACE
+    if (cpu->trace) {
+        nes_trace_stack_write(cpu->trace, run->registers.sp, 2);
+    }
+#endif
+
+    u8* stack = cpu->mem_map.ram.stack;
+    u8 sp     = run->registers.sp;
+
+    stack[sp]           = first;
+    stack[(u8)(sp - 1)] = second;
+    run->registers.sp   = (u8)(sp - 2);
+}
+
+//and rti pulls the same two back off
+internal inline void
+nes_cpu_stack_pull_pair(NesCpu* cpu, NesCpuRun* run, nes_val* first, nes_val* second) {
+
+    if (cpu->mem_map.page_table.read_flags[NES_CPU_STACK_PAGE] != 0) {
+        *first  = nes_cpu_stack_pull(cpu, run);
+        *second = nes_cpu_stack_pull(cpu, run);
+        return;
+    }
+
+    u8* stack = cpu->mem_map.ram.stack;
+    u8 sp     = run->registers.sp;
+
+    *first            = stack[sp];
+    *second           = stack[(u8)(sp + 1)];
+    run->registers.sp = (u8)(sp + 2);
+}
 
 internal void 
-nes_cpu_flag_set(NesCpu* cpu, u8 flag) {
+nes_cpu_flag_set(NesCpuRun* run, u8 flag) {
 
-    SetBitInByte(flag, cpu->registers.p);
+    SetBitInByte(flag, run->registers.p);
 }
 
 internal void
-nes_cpu_flag_clear(NesCpu* cpu, u8 flag) {
+nes_cpu_flag_clear(NesCpuRun* run, u8 flag) {
 
-    ClearBitInByte(flag, cpu->registers.p);
+    ClearBitInByte(flag, run->registers.p);
 }
 
 internal u8
-nes_cpu_flag_read(NesCpu* cpu, u8 flag) {
+nes_cpu_flag_read(NesCpuRun* run, u8 flag) {
 
-    return (ReadBitInByte(flag, cpu->registers.p));
+    return (ReadBitInByte(flag, run->registers.p));
 }
 
 
 internal void
-nes_cpu_interrupt(NesCpu* cpu, NesCpuInterruptType interrupt_type) {
+nes_cpu_run_interrupt(NesCpu* cpu, NesCpuRun* run, NesCpuInterruptType interrupt_type) {
 
-    if (interrupt_type == NesCpuInterruptType::IRQ) {
+    nes_val return_val;
+
+    if (interrupt_type == NesCpuInterruptType::BRK) {
         //this is a software interrupt, we start by pushing PC+2 to the stack as the return address
         //PC+1 is spacing for a break mark and is not needed
-        nes_cpu_stack_push(cpu, nes_memory_map_read(&cpu->mem_map, cpu->registers.pc+2));
+        return_val = nes_memory_map_read(&cpu->mem_map, run->registers.pc+2);
     } 
     else {
         //push the program counter onto the stack
-        nes_cpu_stack_push(cpu, cpu->registers.pc);
+        return_val = (nes_val)run->registers.pc;
     }
 
-    //push the status register onto the stack
-    nes_cpu_stack_push(cpu, cpu->registers.p);    
+    //then the status register on top of it, the line going off between instructions pushes it with
+    //the break flag clear so the handler can tell it apart from a brk
+    nes_val status_val = run->registers.p;
+    if (interrupt_type == NesCpuInterruptType::IRQ) {
+        ClearBitInByte(NES_CPU_FLAG_B, status_val);
+    }
+    nes_cpu_stack_push_pair(cpu, run, return_val, status_val);
 
     //set the address for the interrupt routine
     switch (interrupt_type) {
+        //brk and irq share a vector
+        case NesCpuInterruptType::BRK:
         case NesCpuInterruptType::IRQ: {
-            cpu->registers.pc = NES_CPU_INTERRUPT_VECTOR_BRK;
+            run->registers.pc = NES_CPU_INTERRUPT_VECTOR_BRK;
         } break;
         case NesCpuInterruptType::NMI: {
-            cpu->registers.pc = NES_CPU_INTERRUPT_VECTOR_NMI;
+            run->registers.pc = NES_CPU_INTERRUPT_VECTOR_NMI;
         } break;
         case NesCpuInterruptType::RST: {
-            cpu->registers.pc = NES_CPU_INTERRUPT_VECTOR_RST;
+            run->registers.pc = NES_CPU_INTERRUPT_VECTOR_RST;
         } break;
         default: {
             //by default hardware reset
-            cpu->registers.pc = NES_CPU_INTERRUPT_VECTOR_RST;
+            run->registers.pc = NES_CPU_INTERRUPT_VECTOR_RST;
         } break;
     }
 
-    int x = ((nes_val*)cpu)[65532];
-    int y = ((nes_val*)cpu)[0xFFFC];
-
     //clear the other status values
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_C);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_Z);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_I);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_D);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_B);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_V);
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_N);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_C);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_Z);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_I);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_D);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_B);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_V);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_N);
 
     //set the result interrupt disable flag to true
-    nes_cpu_flag_set(cpu,NES_CPU_FLAG_I);
+    nes_cpu_flag_set(run, NES_CPU_FLAG_I);
+}
+
+//everything outside the cpu only ever sees the registers and counters as they were when the last run stopped
+internal NesCpuRun
+nes_cpu_run_load(NesCpu* cpu) {
+
+    NesCpuRun run;
+    run.registers         = cpu->registers;
+    run.instr             = cpu->current_instr;
+    run.cycle_count       = cpu->cycle_count;
+    run.instruction_count = cpu->instruction_count;
+    return run;
 }
 
 internal void
-nes_cpu_flag_check(NesCpu* cpu, u8 flag) {
+nes_cpu_run_store(NesCpu* cpu, NesCpuRun* run) {
+
+    cpu->registers         = run->registers;
+    cpu->current_instr     = run->instr;
+    cpu->cycle_count       = run->cycle_count;
+    cpu->instruction_count = run->instruction_count;
+}
+
+//for interrupts raised from outside, between runs
+internal void
+nes_cpu_interrupt(NesCpu* cpu, NesCpuInterruptType interrupt_type) {
+
+    NesCpuRun run = nes_cpu_run_load(cpu);
+    nes_cpu_run_interrupt(cpu, &run, interrupt_type);
+    nes_cpu_run_store(cpu, &run);
+}
+
+//devices raise their line whenever they like, the cpu only looks at it between runs
+internal void
+nes_cpu_interrupt_raise(NesCpu* cpu, u8 interrupt) {
+
+    cpu->interrupts_pending |= interrupt;
+}
+
+internal void
+nes_cpu_interrupt_release(NesCpu* cpu, u8 interrupt) {
+
+    cpu->interrupts_pending &= ~interrupt;
+}
+
+//called at the start of every run, which is always an event boundary
+internal void
+nes_cpu_interrupts_service(NesCpu* cpu) {
+
+    //nmi wins over irq, and since irq sets the interrupt disable flag only one can go per boundary anyway
+    if (cpu->interrupts_pending & NES_CPU_INTERRUPT_PENDING_NMI) {
+        cpu->interrupts_pending &= ~NES_CPU_INTERRUPT_PENDING_NMI;
+        nes_cpu_interrupt(cpu, NesCpuInterruptType::NMI);
+    }
+    else if ((cpu->interrupts_pending & NES_CPU_INTERRUPT_PENDING_IRQ) &&
+             (ReadBitInByte(NES_CPU_FLAG_I, cpu->registers.p)) == 0) {
+        nes_cpu_interrupt(cpu, NesCpuInterruptType::IRQ);
+    }
+}
+
+internal void
+nes_cpu_flag_check(NesCpu* cpu, NesCpuRun* run, u8 flag) {
         
-    u16 result = cpu->current_instr.result.value;
+    u16 result = run->instr.result.value;
 
     switch (flag) {
         case NES_CPU_FLAG_C: {
-            if (result > 255) SetBitInByte(NES_CPU_FLAG_C,cpu->registers.p);
+            if (result > 255) SetBitInByte(NES_CPU_FLAG_C,run->registers.p);
         } break;
         case NES_CPU_FLAG_Z: {
-            if (result == 0) SetBitInByte(NES_CPU_FLAG_Z,cpu->registers.p);
+            if (result == 0) SetBitInByte(NES_CPU_FLAG_Z,run->registers.p);
         } break;
         case NES_CPU_FLAG_V: {
-            if (result > 0xFF) SetBitInByte(NES_CPU_FLAG_V,cpu->registers.p);
+            if (result > 0xFF) SetBitInByte(NES_CPU_FLAG_V,run->registers.p);
         } break;
         case NES_CPU_FLAG_N: {
-            if (result > 127) SetBitInByte(NES_CPU_FLAG_N,cpu->registers.p);
+            if (result > 127) SetBitInByte(NES_CPU_FLAG_N,run->registers.p);
         } break;
         case NES_CPU_FLAG_B: {
-            if (nes_cpu_flag_read(cpu,NES_CPU_FLAG_I) == 0) {
-                nes_cpu_interrupt(cpu, NesCpuInterruptType::IRQ);
+            if (nes_cpu_flag_read(run, NES_CPU_FLAG_I) == 0) {
+                nes_cpu_run_interrupt(cpu, run, NesCpuInterruptType::BRK);
             }
         } break;
         default: break;
@@ -132,26 +246,70 @@ nes_cpu_flag_check(NesCpu* cpu, u8 flag) {
 }
 
 internal nes_val
-nes_cpu_program_read(NesCpu* cpu) {
+nes_cpu_program_read(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_val read_val = nes_memory_map_read(&cpu->mem_map, cpu->registers.pc);
-    ++cpu->registers.pc;
+    nes_val read_val = nes_memory_map_read(&cpu->mem_map, run->registers.pc);
+    ++run->registers.pc;
     return (read_val);
 }
 
 internal nes_val
-nes_cpu_program_read_indexed(NesCpu* cpu, nes_val offset) {
+nes_cpu_program_read_indexed(NesCpu* cpu, NesCpuRun* run, nes_val offset) {
 
-    nes_val read_val = (nes_cpu_program_read(cpu) + offset);
-    ++cpu->registers.pc;
+    nes_val read_val = (nes_cpu_program_read(cpu, run) + offset);
+    ++run->registers.pc;
     return (read_val);
 }
 
 internal void
 nes_cpu_update_prg_rom(NesCpu* cpu, nes_val* low_bank, nes_val* high_bank) {
 
-    // memmove(cpu->mem_map.prg_rom.lower_bank, low_bank,  NES_MEM_MAP_LOWER_PRG_ROM_SIZE); 
-    // memmove(cpu->mem_map.prg_rom.upper_bank, high_bank, NES_MEM_MAP_UPPER_PRG_ROM_SIZE); 
+    memmove(cpu->mem_map.prg_rom.lower_bank, low_bank,  NES_MEM_MAP_LOWER_PRG_ROM_SIZE); 
+    memmove(cpu->mem_map.prg_rom.upper_bank, high_bank, NES_MEM_MAP_UPPER_PRG_ROM_SIZE); 
+}
+
+internal void
+nes_cpu_operand_set_address(NesCpuRun* run, nes_addr address) {
+
+    run->instr.operand_address = address;
+}
+
+//the accumulator is the only operand that isn't on the bus, everything else gets read over it once,
+//so registers with read side effects behave
+template <NesCpuAddressMode addr_mode>
+internal inline nes_val
+nes_cpu_operand_read(NesCpu* cpu, NesCpuRun* run) {
+
+    if (addr_mode == NesCpuAddressMode::accumulator) {
+        return run->registers.acc_a;
+    }
+
+    NesCpuInstruction* instr = &run->instr;
+
+    if (instr->operand_loaded != TRUE) {
+        instr->operand_value   = nes_memory_map_read(&cpu->mem_map, instr->operand_address);
+        instr->operand_loaded  = TRUE;
+        instr->operand_access |= NES_CPU_OPERAND_ACCESS_READ;
+    }
+
+    return instr->operand_value;
+}
+
+template <NesCpuAddressMode addr_mode>
+internal inline void
+nes_cpu_operand_write(NesCpu* cpu, NesCpuRun* run, nes_val value) {
+
+    if (addr_mode == NesCpuAddressMode::accumulator) {
+        run->registers.acc_a = value;
+        return;
+    }
+
+    NesCpuInstruction* instr = &run->instr;
+
+    nes_memory_map_write(&cpu->mem_map, instr->operand_address, value);
+    instr->operand_value   = value;
+    instr->operand_loaded  = TRUE;
+    instr->operand_access |= NES_CPU_OPERAND_ACCESS_WRITE;
 }
 
 
@@ -160,112 +318,140 @@ nes_cpu_reset(NesCpu* cpu) {
     nes_cpu_interrupt(cpu, NesCpuInterruptType::RST);
 }
 
-internal void
-nes_cpu_decode_operand_address_from_address_mode(NesCpu* cpu) {
+//addr_mode is known at compile time, so every op code only gets its own mode's case
+template <NesCpuAddressMode addr_mode>
+internal inline void
+nes_cpu_operand_decode(NesCpu* cpu, NesCpuRun* run) {
 
     nes_addr address = 0;
     nes_addr addr_lower = 0; 
     nes_addr addr_upper = 0;
 
-    switch(cpu->current_instr.addr_mode) {
+    switch (addr_mode) {
         
         case NesCpuAddressMode::zero_page: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: ZP   ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            address = nes_cpu_program_read(cpu);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            address = nes_cpu_program_read(cpu, run);
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
         } break;
 
         case NesCpuAddressMode::zero_page_indexed_x: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: ZP-X ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            address = nes_cpu_program_read_indexed(cpu, cpu->registers.ir_x);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            address = nes_cpu_program_read_indexed(cpu, run, run->registers.ir_x);
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
         } break;
 
         case NesCpuAddressMode::zero_page_indexed_y: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: ZP-Y ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            address = nes_cpu_program_read_indexed(cpu, cpu->registers.ir_y);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            address = nes_cpu_program_read_indexed(cpu, run, run->registers.ir_y);
 
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
             
         } break;
 
         case NesCpuAddressMode::absolute: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  ABS ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_lower = nes_cpu_program_read(cpu);
-            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_upper = nes_cpu_program_read(cpu);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_lower = nes_cpu_program_read(cpu, run);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_upper = nes_cpu_program_read(cpu, run);
 
             address = (addr_upper << 8) + addr_lower;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
         } break;
 
         case NesCpuAddressMode::absolute_indexed_x: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: ABS-X");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_lower = nes_cpu_program_read(cpu);
-            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_upper = nes_cpu_program_read(cpu);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_lower = nes_cpu_program_read(cpu, run);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_upper = nes_cpu_program_read(cpu, run);
 
-            address = (addr_upper << 8) + addr_lower + cpu->registers.ir_x;
+            address = (addr_upper << 8) + addr_lower + run->registers.ir_x;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
-            cpu->current_instr.result.page_boundary_crossed = 
+            run->instr.result.page_boundary_crossed = 
                 (((addr_upper << 8) + addr_lower) & 0xFF00) != (address * 0xFF00);
 
         } break;
 
         case NesCpuAddressMode::absolute_indexed_y: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: ABS-Y");
+#endif
             
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_lower = nes_cpu_program_read(cpu);
-            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_upper = nes_cpu_program_read(cpu);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_lower = nes_cpu_program_read(cpu, run);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_upper = nes_cpu_program_read(cpu, run);
 
 
-            address = (addr_upper << 8) + addr_lower + cpu->registers.ir_y;
+            address = (addr_upper << 8) + addr_lower + run->registers.ir_y;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
-            cpu->current_instr.result.page_boundary_crossed = 
+            run->instr.result.page_boundary_crossed = 
                 (((addr_upper << 8) + addr_lower) & 0xFF00) != (address * 0xFF00);
 
         } break;
 
         case NesCpuAddressMode::indirect: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  IND ");
+#endif
 
             nes_addr addr_indirect_lower = 0;
             nes_addr addr_indirect_upper = 0;
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_lower = nes_cpu_program_read(cpu);
-            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            addr_upper = nes_cpu_program_read(cpu);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_lower = nes_cpu_program_read(cpu, run);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            addr_upper = nes_cpu_program_read(cpu, run);
 
             nes_addr indirect_addr = (addr_indirect_upper << 8) + addr_indirect_lower;
 
@@ -274,80 +460,97 @@ nes_cpu_decode_operand_address_from_address_mode(NesCpu* cpu) {
 
             address = (addr_upper << 8) + addr_lower;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
         } break;
 
         //nothing to do, no memory used
         case NesCpuAddressMode::implied: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  IMP ");
+#endif
 
         } break;
         
+        //the handlers go straight to the register
         case NesCpuAddressMode::accumulator: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  ACC ");
-            
-            cpu->current_instr.operand_addr = &cpu->registers.acc_a;
-            
+#endif
+
         } break;
 
         case NesCpuAddressMode::immediate: {
             
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  IMM ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            *cpu->current_instr.operand_addr = nes_cpu_program_read(cpu);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            nes_cpu_operand_set_address(run, run->registers.pc);
+            nes_cpu_program_read(cpu, run);
 
         } break;
 
         case NesCpuAddressMode::relative: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE:  REL ");
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            *cpu->current_instr.operand_addr = nes_cpu_program_read(cpu);
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            nes_cpu_operand_set_address(run, run->registers.pc);
+            nes_cpu_program_read(cpu, run);
 
         } break;
 
         case NesCpuAddressMode::indexed_indirect_x: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: IND-X");
+#endif
 
             nes_addr zero_page_addr = 0;
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            zero_page_addr = nes_cpu_program_read(cpu);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            zero_page_addr = nes_cpu_program_read(cpu, run);
 
 
-            nes_addr addr_indirect_lower = nes_memory_map_read(&cpu->mem_map,zero_page_addr + cpu->registers.ir_x);
-            nes_addr addr_indirect_upper = nes_memory_map_read(&cpu->mem_map,zero_page_addr + cpu->registers.ir_x + 1);
+            nes_addr addr_indirect_lower = nes_memory_map_read(&cpu->mem_map,zero_page_addr + run->registers.ir_x);
+            nes_addr addr_indirect_upper = nes_memory_map_read(&cpu->mem_map,zero_page_addr + run->registers.ir_x + 1);
 
             address = (addr_indirect_upper << 8) + addr_indirect_lower;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
         } break;
 
         case NesCpuAddressMode::indirect_indexed_y: {
 
+#if NES_CPU_DEBUG_LOG
             sprintf(cpu->debug_info.addr_mode_str,"MODE: IND-Y");
+#endif
 
             nes_addr zero_page_addr = 0;
 
 
-            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-            zero_page_addr = nes_cpu_program_read(cpu);
+#if NES_CPU_DEBUG_LOG
+            sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+#endif
+            zero_page_addr = nes_cpu_program_read(cpu, run);
 
             nes_addr addr_indirect_lower = nes_memory_map_read(&cpu->mem_map,zero_page_addr);
             nes_addr addr_indirect_upper = nes_memory_map_read(&cpu->mem_map,zero_page_addr + 1);
 
-            address = (addr_indirect_upper << 8) + addr_indirect_lower + cpu->registers.ir_y;
+            address = (addr_indirect_upper << 8) + addr_indirect_lower + run->registers.ir_y;
 
-            cpu->current_instr.operand_addr = nes_memory_map_address(&cpu->mem_map,address);
+            nes_cpu_operand_set_address(run, address);
 
-            cpu->current_instr.result.page_boundary_crossed = 
+            run->instr.result.page_boundary_crossed = 
                 (((addr_indirect_upper << 8) + addr_indirect_lower) & 0xFF00) != (address * 0xFF00);
 
         } break;
@@ -356,1114 +559,826 @@ nes_cpu_decode_operand_address_from_address_mode(NesCpu* cpu) {
     }
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_branch_and_update_cycles(NesCpu* cpu) {
+nes_cpu_branch_and_update_cycles(NesCpu* cpu, NesCpuRun* run) {
+
+        //the offset is signed so loops can branch backwards
+        i8 branch_offset = (i8)nes_cpu_operand_read<addr_mode>(cpu, run);
 
         //add 1 cycle for branching to same page, add 2 cycles for branching to different page
-        cpu->current_instr.result.branch_cycles = 
-            (cpu->registers.pc & 0xFF00) == ((cpu->registers.pc + *cpu->current_instr.operand_addr) & 0xFF00)
+        run->instr.result.branch_cycles = 
+            (run->registers.pc & 0xFF00) == ((nes_addr)(run->registers.pc + branch_offset) & 0xFF00)
             ? 1
             : 2;     
 
         //update program counter
-        cpu->registers.pc += *cpu->current_instr.operand_addr;
+        run->registers.pc += branch_offset;
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_adc(NesCpu* cpu) {
+nes_cpu_instr_adc(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->current_instr.result.value = cpu->registers.acc_a + *cpu->current_instr.operand_addr + nes_cpu_flag_read(cpu, NES_CPU_FLAG_C);
+    run->instr.result.value = run->registers.acc_a + nes_cpu_operand_read<addr_mode>(cpu, run) + nes_cpu_flag_read(run, NES_CPU_FLAG_C);
     
-    cpu->registers.acc_a = (nes_val)cpu->current_instr.result.value;
+    run->registers.acc_a = (nes_val)run->instr.result.value;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_v = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_v = TRUE;
 
     cpu->debug_info.op_code_str = "INSTR: ADC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_and(NesCpu* cpu) {
+nes_cpu_instr_and(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->current_instr.result.value = cpu->registers.acc_a & *cpu->current_instr.operand_addr;
+    run->instr.result.value = run->registers.acc_a & nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->registers.acc_a = (nes_val)cpu->current_instr.result.value;
+    run->registers.acc_a = (nes_val)run->instr.result.value;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
 
     cpu->debug_info.op_code_str = "INSTR: AND";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_asl(NesCpu* cpu) {
+nes_cpu_instr_asl(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr << 1;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run) << 1;
 
-    *cpu->current_instr.operand_addr = (nes_val)cpu->current_instr.result.value;
+    nes_cpu_operand_write<addr_mode>(cpu, run, (nes_val)run->instr.result.value);
     
     cpu->debug_info.op_code_str = "INSTR: ASL";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bcc(NesCpu* cpu) {
+nes_cpu_instr_bcc(NesCpu* cpu, NesCpuRun* run) {
 
-    if (nes_cpu_flag_read(cpu, NES_CPU_FLAG_C) == 0) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_C) == 0) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
     
     cpu->debug_info.op_code_str = "INSTR: BCC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bcs(NesCpu* cpu) {
+nes_cpu_instr_bcs(NesCpu* cpu, NesCpuRun* run) {
 
-    if (nes_cpu_flag_read(cpu, NES_CPU_FLAG_C) == 1) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_C) == 1) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
     
     cpu->debug_info.op_code_str = "INSTR: BCS";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_beq(NesCpu* cpu) {
+nes_cpu_instr_beq(NesCpu* cpu, NesCpuRun* run) {
 
-    if (nes_cpu_flag_read(cpu,NES_CPU_FLAG_Z) == 1) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_Z) == 1) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
 
     cpu->debug_info.op_code_str = "INSTR: BEQ";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bit(NesCpu* cpu) {
+nes_cpu_instr_bit(NesCpu* cpu, NesCpuRun* run) {
 
     //transfer bit 6 of operand to V flag
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_V);
-    if (ReadBitInByte(6, *cpu->current_instr.operand_addr) == 1) {
-        nes_cpu_flag_set(cpu,NES_CPU_FLAG_V);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_V);
+    if (ReadBitInByte(6, nes_cpu_operand_read<addr_mode>(cpu, run)) == 1) {
+        nes_cpu_flag_set(run, NES_CPU_FLAG_V);
     }
 
     //transfer bit 7 of operand to N flag
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_N);
-    if (ReadBitInByte(7, *cpu->current_instr.operand_addr) == 1) {
-        nes_cpu_flag_set(cpu,NES_CPU_FLAG_N);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_N);
+    if (ReadBitInByte(7, nes_cpu_operand_read<addr_mode>(cpu, run)) == 1) {
+        nes_cpu_flag_set(run, NES_CPU_FLAG_N);
     }
 
     //the result of A and Operand will be used for the zero flag
-    cpu->current_instr.result.value = (cpu->registers.acc_a & *cpu->current_instr.operand_addr);
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.value = (run->registers.acc_a & nes_cpu_operand_read<addr_mode>(cpu, run));
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: BIT";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bmi(NesCpu* cpu) {
+nes_cpu_instr_bmi(NesCpu* cpu, NesCpuRun* run) {
 
-    if (nes_cpu_flag_read(cpu,NES_CPU_FLAG_N) == 1) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_N) == 1) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
     
     cpu->debug_info.op_code_str = "INSTR: BMI";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bne(NesCpu* cpu) {
+nes_cpu_instr_bne(NesCpu* cpu, NesCpuRun* run) {
 
-    if (nes_cpu_flag_read(cpu,NES_CPU_FLAG_Z) == 0) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_Z) == 0) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
     
     cpu->debug_info.op_code_str = "INSTR: BNE";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bpl(NesCpu* cpu) {
+nes_cpu_instr_bpl(NesCpu* cpu, NesCpuRun* run) {
     
-    if (nes_cpu_flag_read(cpu,NES_CPU_FLAG_N) == 0) {
-        nes_cpu_branch_and_update_cycles(cpu);
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_N) == 0) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
     }
     
     cpu->debug_info.op_code_str = "INSTR: BPL";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_brk(NesCpu* cpu) {
+nes_cpu_instr_brk(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->current_instr.result.flag_b = TRUE;
+    run->instr.result.flag_b = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: BRK";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bvc(NesCpu* cpu) {
+nes_cpu_instr_bvc(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.pc += nes_cpu_flag_read(cpu,NES_CPU_FLAG_V) == 0 ? *cpu->current_instr.operand_addr : 0;
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_V) == 0) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
+    }
     
     cpu->debug_info.op_code_str = "INSTR: BVC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_bvs(NesCpu* cpu) {
+nes_cpu_instr_bvs(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.pc += nes_cpu_flag_read(cpu,NES_CPU_FLAG_V) == 1 ? *cpu->current_instr.operand_addr : 0;
+    if (nes_cpu_flag_read(run, NES_CPU_FLAG_V) == 1) {
+        nes_cpu_branch_and_update_cycles<addr_mode>(cpu, run);
+    }
     
     cpu->debug_info.op_code_str = "INSTR: BVS";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_clc(NesCpu* cpu) {
+nes_cpu_instr_clc(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_C);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_C);
     
     cpu->debug_info.op_code_str = "INSTR: CLC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_cld(NesCpu* cpu) {
+nes_cpu_instr_cld(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_D);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_D);
     
     cpu->debug_info.op_code_str = "INSTR: CLD";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_cli(NesCpu* cpu) {
+nes_cpu_instr_cli(NesCpu* cpu, NesCpuRun* run) {
 
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_I);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_I);
     
     cpu->debug_info.op_code_str = "INSTR: CLI";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_clv(NesCpu* cpu) {
+nes_cpu_instr_clv(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_V);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_V);
     
     cpu->debug_info.op_code_str = "INSTR: CLV";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_cmp(NesCpu* cpu) {
+nes_cpu_instr_cmp(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = (cpu->registers.acc_a - *cpu->current_instr.operand_addr);
+    run->instr.result.value = (run->registers.acc_a - nes_cpu_operand_read<addr_mode>(cpu, run));
 
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: CMP";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_cpx(NesCpu* cpu) {
+nes_cpu_instr_cpx(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = (cpu->registers.ir_x - *cpu->current_instr.operand_addr);
+    run->instr.result.value = (run->registers.ir_x - nes_cpu_operand_read<addr_mode>(cpu, run));
     
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: CPX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_cpy(NesCpu* cpu) {
+nes_cpu_instr_cpy(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = (cpu->registers.ir_y - *cpu->current_instr.operand_addr);
+    run->instr.result.value = (run->registers.ir_y - nes_cpu_operand_read<addr_mode>(cpu, run));
     
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: CPY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_dec(NesCpu* cpu) {
+nes_cpu_instr_dec(NesCpu* cpu, NesCpuRun* run) {
 
-    --(*cpu->current_instr.operand_addr);
+    nes_cpu_operand_write<addr_mode>(cpu, run, nes_cpu_operand_read<addr_mode>(cpu, run) - 1);
 
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: DEC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_dex(NesCpu* cpu) {
+nes_cpu_instr_dex(NesCpu* cpu, NesCpuRun* run) {
     
-    --cpu->registers.ir_x;
+    --run->registers.ir_x;
 
-    cpu->current_instr.result.value = cpu->registers.ir_x;
+    run->instr.result.value = run->registers.ir_x;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: DEX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_dey(NesCpu* cpu) {
+nes_cpu_instr_dey(NesCpu* cpu, NesCpuRun* run) {
     
-    --cpu->registers.ir_y;
+    --run->registers.ir_y;
 
-    cpu->current_instr.result.value = cpu->registers.ir_y;
+    run->instr.result.value = run->registers.ir_y;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: DEY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_eor(NesCpu* cpu) {
+nes_cpu_instr_eor(NesCpu* cpu, NesCpuRun* run) {
  
-    cpu->current_instr.result.value = (cpu->registers.acc_a ^ *cpu->current_instr.operand_addr);
+    run->instr.result.value = (run->registers.acc_a ^ nes_cpu_operand_read<addr_mode>(cpu, run));
 
-    cpu->registers.acc_a = (nes_val)cpu->current_instr.result.value;
+    run->registers.acc_a = (nes_val)run->instr.result.value;
  
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: EOR";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_inc(NesCpu* cpu) {
+nes_cpu_instr_inc(NesCpu* cpu, NesCpuRun* run) {
     
-    ++(*cpu->current_instr.operand_addr);
+    nes_cpu_operand_write<addr_mode>(cpu, run, nes_cpu_operand_read<addr_mode>(cpu, run) + 1);
 
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: INC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_inx(NesCpu* cpu) {
+nes_cpu_instr_inx(NesCpu* cpu, NesCpuRun* run) {
 
-    ++cpu->registers.ir_x;
+    ++run->registers.ir_x;
 
-    cpu->current_instr.result.value = cpu->registers.ir_x;
+    run->instr.result.value = run->registers.ir_x;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: INX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_iny(NesCpu* cpu) {
+nes_cpu_instr_iny(NesCpu* cpu, NesCpuRun* run) {
     
-    ++cpu->registers.ir_y;
+    ++run->registers.ir_y;
 
-    cpu->current_instr.result.value = cpu->registers.ir_y;
+    run->instr.result.value = run->registers.ir_y;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: INY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_jmp(NesCpu* cpu) {
+nes_cpu_instr_jmp(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.pc = *cpu->current_instr.operand_addr;
+    run->registers.pc = nes_cpu_operand_read<addr_mode>(cpu, run);
     
     cpu->debug_info.op_code_str = "INSTR: JMP";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_jsr(NesCpu* cpu) {
+nes_cpu_instr_jsr(NesCpu* cpu, NesCpuRun* run) {
 
-    nes_cpu_stack_push(cpu, cpu->registers.sp);
+    nes_cpu_stack_push(cpu, run, run->registers.sp);
 
-    cpu->registers.pc = *cpu->current_instr.operand_addr;
+    run->registers.pc = nes_cpu_operand_read<addr_mode>(cpu, run);
     
     cpu->debug_info.op_code_str = "INSTR: JSR";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_lda(NesCpu* cpu) {
+nes_cpu_instr_lda(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.acc_a = *cpu->current_instr.operand_addr;
+    run->registers.acc_a = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.value = cpu->registers.acc_a; 
+    run->instr.result.value = run->registers.acc_a; 
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: LDA";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_ldx(NesCpu* cpu) {
+nes_cpu_instr_ldx(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.ir_x = *cpu->current_instr.operand_addr;
+    run->registers.ir_x = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.value = cpu->registers.ir_x; 
+    run->instr.result.value = run->registers.ir_x; 
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: LDX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_ldy(NesCpu* cpu) {
+nes_cpu_instr_ldy(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.ir_y = *cpu->current_instr.operand_addr;
+    run->registers.ir_y = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.value = cpu->registers.ir_y; 
+    run->instr.result.value = run->registers.ir_y; 
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: LDY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_lsr(NesCpu* cpu) {
+nes_cpu_instr_lsr(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
-    cpu->current_instr.result.value >>= 1;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
+    run->instr.result.value >>= 1;
     
-    *cpu->current_instr.operand_addr = (nes_val)cpu->current_instr.result.value;
+    nes_cpu_operand_write<addr_mode>(cpu, run, (nes_val)run->instr.result.value);
 
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_N);
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_z = TRUE;
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_N);
     
     cpu->debug_info.op_code_str = "INSTR: LSR";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_nop(NesCpu* cpu) {
+nes_cpu_instr_nop(NesCpu* cpu, NesCpuRun* run) {
     
     //¯\_(ツ)_/¯
     
     cpu->debug_info.op_code_str = "INSTR: NOP";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_ora(NesCpu* cpu) {
+nes_cpu_instr_ora(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = (cpu->registers.acc_a | *cpu->current_instr.operand_addr);
+    run->instr.result.value = (run->registers.acc_a | nes_cpu_operand_read<addr_mode>(cpu, run));
 
-    cpu->registers.acc_a = (nes_val)cpu->current_instr.result.value;
+    run->registers.acc_a = (nes_val)run->instr.result.value;
  
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: ORA";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_pha(NesCpu* cpu) {
+nes_cpu_instr_pha(NesCpu* cpu, NesCpuRun* run) {
 
-    nes_cpu_stack_push(cpu, cpu->registers.acc_a);
+    nes_cpu_stack_push(cpu, run, run->registers.acc_a);
     
     cpu->debug_info.op_code_str = "INSTR: PHA";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_php(NesCpu* cpu) {
+nes_cpu_instr_php(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_stack_push(cpu, cpu->registers.p);
+    nes_cpu_stack_push(cpu, run, run->registers.p);
 }
 
-internal void 
-nes_cpu_instr_pla(NesCpu* cpu) {
+template <NesCpuAddressMode addr_mode>
+internal void
+nes_cpu_instr_pla(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.acc_a = nes_cpu_stack_pull(cpu);
+    run->registers.acc_a = nes_cpu_stack_pull(cpu, run);
 
-    cpu->current_instr.result.value = cpu->registers.acc_a;
+    run->instr.result.value = run->registers.acc_a;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: PLA";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_plp(NesCpu* cpu) {
+nes_cpu_instr_plp(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.p = nes_cpu_stack_pull(cpu);
+    run->registers.p = nes_cpu_stack_pull(cpu, run);
     
     cpu->debug_info.op_code_str = "INSTR: PLP";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_rol(NesCpu* cpu) {
+nes_cpu_instr_rol(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
-    cpu->current_instr.result.value <<= 1;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
+    run->instr.result.value <<= 1;
     
-    *cpu->current_instr.operand_addr = (nes_val)cpu->current_instr.result.value;
+    nes_cpu_operand_write<addr_mode>(cpu, run, (nes_val)run->instr.result.value);
 
-    *cpu->current_instr.operand_addr += nes_cpu_flag_read(cpu, NES_CPU_FLAG_C);
+    nes_cpu_operand_write<addr_mode>(cpu, run, nes_cpu_operand_read<addr_mode>(cpu, run) + nes_cpu_flag_read(run, NES_CPU_FLAG_C));
 
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
-    cpu->current_instr.result.flag_n = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: ROL";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_ror(NesCpu* cpu) {
+nes_cpu_instr_ror(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
-    cpu->current_instr.result.value >>= 1;
-    cpu->current_instr.result.value += (nes_cpu_flag_read(cpu, NES_CPU_FLAG_C) << 8);
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
+    run->instr.result.value >>= 1;
+    run->instr.result.value += (nes_cpu_flag_read(run, NES_CPU_FLAG_C) << 8);
 
-    cpu->current_instr.result.value = *cpu->current_instr.operand_addr;
+    run->instr.result.value = nes_cpu_operand_read<addr_mode>(cpu, run);
 
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
-    cpu->current_instr.result.flag_n = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: ROR";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_rti(NesCpu* cpu) {
+nes_cpu_instr_rti(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.p = nes_cpu_stack_pull(cpu);
-    cpu->registers.pc = nes_cpu_stack_pull(cpu);
+    nes_val return_val;
+    nes_cpu_stack_pull_pair(cpu, run, &run->registers.p, &return_val);
+    run->registers.pc = return_val;
 
-    nes_cpu_flag_clear(cpu,NES_CPU_FLAG_B);
+    nes_cpu_flag_clear(run, NES_CPU_FLAG_B);
     
     cpu->debug_info.op_code_str = "INSTR: RTI";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_rts(NesCpu* cpu) {
+nes_cpu_instr_rts(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.pc = nes_cpu_stack_pull(cpu) + 1;
+    run->registers.pc = nes_cpu_stack_pull(cpu, run) + 1;
     
     cpu->debug_info.op_code_str = "INSTR: RTS";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sbc(NesCpu* cpu) {
+nes_cpu_instr_sbc(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->current_instr.result.value = cpu->registers.acc_a - *cpu->current_instr.operand_addr - nes_cpu_flag_read(cpu, NES_CPU_FLAG_C);
+    run->instr.result.value = run->registers.acc_a - nes_cpu_operand_read<addr_mode>(cpu, run) - nes_cpu_flag_read(run, NES_CPU_FLAG_C);
     
-    cpu->registers.acc_a = (nes_val)cpu->current_instr.result.value;
+    run->registers.acc_a = (nes_val)run->instr.result.value;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
-    cpu->current_instr.result.flag_c = TRUE;
-    cpu->current_instr.result.flag_v = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
+    run->instr.result.flag_c = TRUE;
+    run->instr.result.flag_v = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: SBC";
     
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sec(NesCpu* cpu) {
+nes_cpu_instr_sec(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_set(cpu,NES_CPU_FLAG_C);
+    nes_cpu_flag_set(run, NES_CPU_FLAG_C);
     
     cpu->debug_info.op_code_str = "INSTR: SEC";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sed(NesCpu* cpu) {
+nes_cpu_instr_sed(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_set(cpu,NES_CPU_FLAG_D);
+    nes_cpu_flag_set(run, NES_CPU_FLAG_D);
     
     cpu->debug_info.op_code_str = "INSTR: SED";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sei(NesCpu* cpu) {
+nes_cpu_instr_sei(NesCpu* cpu, NesCpuRun* run) {
     
-    nes_cpu_flag_set(cpu,NES_CPU_FLAG_I);
+    nes_cpu_flag_set(run, NES_CPU_FLAG_I);
     
     cpu->debug_info.op_code_str = "INSTR: SEI";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sta(NesCpu* cpu) {
+nes_cpu_instr_sta(NesCpu* cpu, NesCpuRun* run) {
     
-    *cpu->current_instr.operand_addr = cpu->registers.acc_a;
+    nes_cpu_operand_write<addr_mode>(cpu, run, run->registers.acc_a);
 
     cpu->debug_info.op_code_str = "INSTR: STA";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_stx(NesCpu* cpu) {
+nes_cpu_instr_stx(NesCpu* cpu, NesCpuRun* run) {
     
-    *cpu->current_instr.operand_addr = cpu->registers.ir_x;
+    nes_cpu_operand_write<addr_mode>(cpu, run, run->registers.ir_x);
     
     cpu->debug_info.op_code_str = "INSTR: STX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_sty(NesCpu* cpu) {
+nes_cpu_instr_sty(NesCpu* cpu, NesCpuRun* run) {
     
-    *cpu->current_instr.operand_addr = cpu->registers.ir_y;
+    nes_cpu_operand_write<addr_mode>(cpu, run, run->registers.ir_y);
     
     cpu->debug_info.op_code_str = "INSTR: STY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_tax(NesCpu* cpu) {
+nes_cpu_instr_tax(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.ir_x = cpu->registers.acc_a;
+    run->registers.ir_x = run->registers.acc_a;
 
-    cpu->current_instr.result.value = cpu->registers.ir_x;
+    run->instr.result.value = run->registers.ir_x;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: TAX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_tay(NesCpu* cpu) {
+nes_cpu_instr_tay(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.ir_y = cpu->registers.acc_a;
+    run->registers.ir_y = run->registers.acc_a;
 
-    cpu->current_instr.result.value = cpu->registers.ir_y;
+    run->instr.result.value = run->registers.ir_y;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: TAY";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_tsx(NesCpu* cpu) {
+nes_cpu_instr_tsx(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.ir_x = cpu->registers.sp;
+    run->registers.ir_x = run->registers.sp;
 
-    cpu->current_instr.result.value = cpu->registers.ir_x;
+    run->instr.result.value = run->registers.ir_x;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: TSX";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_txa(NesCpu* cpu) {
+nes_cpu_instr_txa(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.acc_a = cpu->registers.ir_x;
+    run->registers.acc_a = run->registers.ir_x;
 
-    cpu->current_instr.result.value = cpu->registers.acc_a;
+    run->instr.result.value = run->registers.acc_a;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: TXA";
 }
 
-internal void 
-nes_cpu_instr_txs(NesCpu* cpu) {
+template <NesCpuAddressMode addr_mode>
+internal void
+nes_cpu_instr_txs(NesCpu* cpu, NesCpuRun* run) {
     
-    cpu->registers.sp = cpu->registers.ir_x;
+    run->registers.sp = run->registers.ir_x;
     
     cpu->debug_info.op_code_str = "INSTR: TXS";
 }
 
+template <NesCpuAddressMode addr_mode>
 internal void
-nes_cpu_instr_tya(NesCpu* cpu) {
+nes_cpu_instr_tya(NesCpu* cpu, NesCpuRun* run) {
 
-    cpu->registers.acc_a = cpu->registers.ir_y;
+    run->registers.acc_a = run->registers.ir_y;
 
-    cpu->current_instr.result.value = cpu->registers.acc_a;
+    run->instr.result.value = run->registers.acc_a;
 
-    cpu->current_instr.result.flag_n = TRUE;
-    cpu->current_instr.result.flag_z = TRUE;
+    run->instr.result.flag_n = TRUE;
+    run->instr.result.flag_z = TRUE;
     
     cpu->debug_info.op_code_str = "INSTR: TYA";
 }
 
-internal void
-nes_cpu_addr_mode_decode_from_instr(NesCpu* cpu) {
-
-    switch (cpu->current_instr.op_code) {
+//the cycles on top of an instruction's base cost
+internal inline void
+nes_cpu_instr_cycles_finish(NesCpu* cpu, NesCpuRun* run) {
 
-        //accumulator
-        case NES_CPU_INSTR_ASL_ACC:
-        case NES_CPU_INSTR_LSR_ACC:
-        case NES_CPU_INSTR_ROL_ACC:
-        case NES_CPU_INSTR_ROR_ACC: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::accumulator;
-        } break;
-
-        //absolute
-        case NES_CPU_INSTR_ADC_ABS:
-        case NES_CPU_INSTR_AND_ABS:
-        case NES_CPU_INSTR_ASL_ABS:
-        case NES_CPU_INSTR_BIT_ABS:
-        case NES_CPU_INSTR_CMP_ABS:
-        case NES_CPU_INSTR_CPY_ABS:
-        case NES_CPU_INSTR_DEC_ABS:
-        case NES_CPU_INSTR_EOR_ABS:
-        case NES_CPU_INSTR_INC_ABS:
-        case NES_CPU_INSTR_JMP_ABS:
-        case NES_CPU_INSTR_JSR_ABS:
-        case NES_CPU_INSTR_LDA_ABS:
-        case NES_CPU_INSTR_LDX_ABS:
-        case NES_CPU_INSTR_LDY_ABS:
-        case NES_CPU_INSTR_LSR_ABS:
-        case NES_CPU_INSTR_ORA_ABS:
-        case NES_CPU_INSTR_ROL_ABS:
-        case NES_CPU_INSTR_ROR_ABS:
-        case NES_CPU_INSTR_SBC_ABS:
-        case NES_CPU_INSTR_STA_ABS:
-        case NES_CPU_INSTR_STX_ABS:
-        case NES_CPU_INSTR_STY_ABS: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::absolute;
-        } break;
+    //if we crossed a page boundary (aka an indexed operation toggled a bit in the MSB)
+    //we add one cycle
+    if (run->instr.result.page_boundary_crossed) {
+        ++run->instr.result.cycles;
+    }
 
-        //absolute x indexed
-        case NES_CPU_INSTR_ADC_ABS_X:
-        case NES_CPU_INSTR_AND_ABS_X:
-        case NES_CPU_INSTR_ASL_ABS_X:
-        case NES_CPU_INSTR_CMP_ABS_X:
-        case NES_CPU_INSTR_DEC_ABS_X:
-        case NES_CPU_INSTR_EOR_ABS_X:
-        case NES_CPU_INSTR_INC_ABS_X:
-        case NES_CPU_INSTR_LDA_ABS_X:
-        case NES_CPU_INSTR_LDY_ABS_X:
-        case NES_CPU_INSTR_LSR_ABS_X:
-        case NES_CPU_INSTR_ORA_ABS_X:
-        case NES_CPU_INSTR_ROL_ABS_X:
-        case NES_CPU_INSTR_ROR_ABS_X:
-        case NES_CPU_INSTR_SBC_ABS_X:
-        case NES_CPU_INSTR_STA_ABS_X: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::absolute_indexed_x;
-        } break;
+    //add any cycles from branches
+    //if a branch didn't orrur, it will just be 0
+    run->instr.result.cycles += run->instr.result.branch_cycles;
+#if NES_CPU_DEBUG_LOG
+    sprintf(cpu->debug_info.cyc_str, "CYC: %d",run->instr.result.cycles);
+#endif
+}
 
-        //absolute y indexed
-        case NES_CPU_INSTR_ADC_ABS_Y:
-        case NES_CPU_INSTR_AND_ABS_Y:
-        case NES_CPU_INSTR_CMP_ABS_Y:
-        case NES_CPU_INSTR_EOR_ABS_Y:
-        case NES_CPU_INSTR_LDA_ABS_Y:
-        case NES_CPU_INSTR_LDX_ABS_Y:
-        case NES_CPU_INSTR_ORA_ABS_Y:
-        case NES_CPU_INSTR_SBC_ABS_Y:
-        case NES_CPU_INSTR_STA_ABS_Y: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::absolute_indexed_y;
-        } break;
+//one op code start to finish, decoding its operand and running its handler are both specialized on
+//its address mode, so nothing about the mode gets looked at while the instruction runs
+template <NesCpuAddressMode addr_mode, void (*instr)(NesCpu*, NesCpuRun*), u32 base_cycles>
+internal inline void
+nes_cpu_op_code_execute(NesCpu* cpu, NesCpuRun* run) {
 
-        //immediate
-        case NES_CPU_INSTR_ADC_IMM:
-        case NES_CPU_INSTR_AND_IMM:
-        case NES_CPU_INSTR_CMP_IMM:
-        case NES_CPU_INSTR_CPY_IMM:
-        case NES_CPU_INSTR_EOR_IMM:
-        case NES_CPU_INSTR_LDA_IMM:
-        case NES_CPU_INSTR_LDX_IMM:
-        case NES_CPU_INSTR_LDY_IMM:
-        case NES_CPU_INSTR_ORA_IMM:
-        case NES_CPU_INSTR_SBC_IMM: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::immediate;
-        } break;
+    //still wanted after the fact by the code/data log, the trace and the idle loop check
+    run->instr.addr_mode = addr_mode;
 
-        //implied
-        case NES_CPU_INSTR_BRK_IMP:
-        case NES_CPU_INSTR_CLC_IMP:
-        case NES_CPU_INSTR_CLD_IMP:
-        case NES_CPU_INSTR_CLI_IMP:
-        case NES_CPU_INSTR_CLV_IMP:
-        case NES_CPU_INSTR_DEX_IMP:
-        case NES_CPU_INSTR_DEY_IMP:
-        case NES_CPU_INSTR_INX_IMP:
-        case NES_CPU_INSTR_INY_IMP:
-        case NES_CPU_INSTR_NOP_IMP:
-        case NES_CPU_INSTR_PHA_IMP:
-        case NES_CPU_INSTR_PHP_IMP:
-        case NES_CPU_INSTR_PLA_IMP:
-        case NES_CPU_INSTR_PLP_IMP:
-        case NES_CPU_INSTR_RTI_IMP:
-        case NES_CPU_INSTR_RTS_IMP:
-        case NES_CPU_INSTR_SEC_IMP:
-        case NES_CPU_INSTR_SED_IMP:
-        case NES_CPU_INSTR_SEI_IMP:
-        case NES_CPU_INSTR_TAX_IMP:
-        case NES_CPU_INSTR_TAY_IMP:
-        case NES_CPU_INSTR_TSX_IMP:
-        case NES_CPU_INSTR_TXA_IMP:
-        case NES_CPU_INSTR_TXS_IMP:
-        case NES_CPU_INSTR_TYA_IMP: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::implied;
-        } break;
+    nes_cpu_operand_decode<addr_mode>(cpu, run);
 
-        //indirect
-        case NES_CPU_INSTR_JMP_IND: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::indirect;
-        } break;
+    instr(cpu, run);
 
-        //indirect x
-        case NES_CPU_INSTR_ADC_IND_X:
-        case NES_CPU_INSTR_AND_IND_X:
-        case NES_CPU_INSTR_CMP_IND_X:
-        case NES_CPU_INSTR_EOR_IND_X:
-        case NES_CPU_INSTR_LDA_IND_X:
-        case NES_CPU_INSTR_ORA_IND_X:
-        case NES_CPU_INSTR_SBC_IND_X:
-        case NES_CPU_INSTR_STA_IND_X: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::indexed_indirect_x;
-        } break;
+    run->instr.result.cycles = base_cycles;
+    nes_cpu_instr_cycles_finish(cpu, run);
+}
 
-        //indirect y
-        case NES_CPU_INSTR_ADC_IND_Y:        
-        case NES_CPU_INSTR_AND_IND_Y:
-        case NES_CPU_INSTR_CMP_IND_Y:
-        case NES_CPU_INSTR_EOR_IND_Y:
-        case NES_CPU_INSTR_LDA_IND_Y:
-        case NES_CPU_INSTR_ORA_IND_Y:
-        case NES_CPU_INSTR_SBC_IND_Y:
-        case NES_CPU_INSTR_STA_IND_Y: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::indirect_indexed_y;
-        } break;
+#define NES_CPU_OP_CODE_EXECUTE(mode, instr, base_cycles) \
+    nes_cpu_op_code_execute<NesCpuAddressMode::mode, nes_cpu_instr_##instr<NesCpuAddressMode::mode>, base_cycles>(cpu, run)
 
-        //relative
-        case NES_CPU_INSTR_BCC_REL:
-        case NES_CPU_INSTR_BCS_REL:
-        case NES_CPU_INSTR_BEQ_REL:
-        case NES_CPU_INSTR_BMI_REL:
-        case NES_CPU_INSTR_BNE_REL:
-        case NES_CPU_INSTR_BPL_REL: 
-        case NES_CPU_INSTR_BVC_REL:
-        case NES_CPU_INSTR_BVS_REL: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::relative;
-        } break;
+#define NES_CPU_OP_CODE_EXECUTE_CASE(name, mode, instr, base_cycles) \
+    case NES_CPU_INSTR_##name: NES_CPU_OP_CODE_EXECUTE(mode, instr, base_cycles); break;
 
-        //zero paged
-        case NES_CPU_INSTR_ADC_ZP:
-        case NES_CPU_INSTR_AND_ZP:
-        case NES_CPU_INSTR_ASL_ZP:
-        case NES_CPU_INSTR_BIT_ZP:
-        case NES_CPU_INSTR_CMP_ZP:
-        case NES_CPU_INSTR_CPY_ZP:
-        case NES_CPU_INSTR_DEC_ZP:
-        case NES_CPU_INSTR_EOR_ZP:
-        case NES_CPU_INSTR_INC_ZP:
-        case NES_CPU_INSTR_LDA_ZP:
-        case NES_CPU_INSTR_LDX_ZP:
-        case NES_CPU_INSTR_LDY_ZP:
-        case NES_CPU_INSTR_LSR_ZP:
-        case NES_CPU_INSTR_ORA_ZP:
-        case NES_CPU_INSTR_ROL_ZP:
-        case NES_CPU_INSTR_ROR_ZP:
-        case NES_CPU_INSTR_SBC_ZP:
-        case NES_CPU_INSTR_STA_ZP:
-        case NES_CPU_INSTR_STX_ZP:
-        case NES_CPU_INSTR_STY_ZP: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::zero_page;
-        } break; 
-
-        //zero paged x indexed
-        case NES_CPU_INSTR_ADC_ZP_X:
-        case NES_CPU_INSTR_AND_ZP_X:
-        case NES_CPU_INSTR_ASL_ZP_X:
-        case NES_CPU_INSTR_CMP_ZP_X:
-        case NES_CPU_INSTR_DEC_ZP_X:
-        case NES_CPU_INSTR_EOR_ZP_X:
-        case NES_CPU_INSTR_INC_ZP_X:
-        case NES_CPU_INSTR_LDA_ZP_X:
-        case NES_CPU_INSTR_LDY_ZP_X:
-        case NES_CPU_INSTR_LSR_ZP_X:
-        case NES_CPU_INSTR_ORA_ZP_X:
-        case NES_CPU_INSTR_ROL_ZP_X:
-        case NES_CPU_INSTR_ROR_ZP_X:
-        case NES_CPU_INSTR_SBC_ZP_X:
-        case NES_CPU_INSTR_STA_ZP_X:
-        case NES_CPU_INSTR_STY_ZP_X: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::zero_page_indexed_x;
-        } break;
+internal void 
+nes_cpu_instr_execute(NesCpu* cpu, NesCpuRun* run) {
 
-        //zero paged y indexed
-        case NES_CPU_INSTR_LDX_ZP_Y:
-        case NES_CPU_INSTR_STX_ZP_Y: {
-            cpu->current_instr.addr_mode = NesCpuAddressMode::zero_page_indexed_y;
-        } break;
-    }
-}
+    switch (run->instr.op_code) {
 
-internal void 
-nes_cpu_instr_execute(NesCpu* cpu) {
-
-    switch (cpu->current_instr.op_code) {
-
-        case NES_CPU_INSTR_ADC_IMM:   nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 2; break;  
-        case NES_CPU_INSTR_ADC_ZP:    nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_ADC_ZP_X:  nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ADC_ABS:   nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ADC_ABS_X: nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ADC_ABS_Y: nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ADC_IND_X: nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ADC_IND_Y: nes_cpu_instr_adc(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_AND_IMM:   nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_AND_ZP:    nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_AND_ZP_X:  nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_AND_ABS:   nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_AND_ABS_X: nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_AND_ABS_Y: nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_AND_IND_X: nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_AND_IND_Y: nes_cpu_instr_and(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_ASL_ACC:   nes_cpu_instr_asl(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_ASL_ZP:    nes_cpu_instr_asl(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_ASL_ZP_X:  nes_cpu_instr_asl(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ASL_ABS:   nes_cpu_instr_asl(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ASL_ABS_X: nes_cpu_instr_asl(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        //branches
-        case NES_CPU_INSTR_BCC_REL:   nes_cpu_instr_bcc(cpu); cpu->current_instr.result.cycles = 2; break; 
-        case NES_CPU_INSTR_BCS_REL:   nes_cpu_instr_bcs(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_BEQ_REL:   nes_cpu_instr_beq(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_BMI_REL:   nes_cpu_instr_bmi(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_BNE_REL:   nes_cpu_instr_bne(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_BPL_REL:   nes_cpu_instr_bpl(cpu); cpu->current_instr.result.cycles = 2; break; 
-        case NES_CPU_INSTR_BVC_REL:   nes_cpu_instr_bvc(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_BVS_REL:   nes_cpu_instr_bvs(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_BRK_IMP:   nes_cpu_instr_brk(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_CLC_IMP:   nes_cpu_instr_clc(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CLD_IMP:   nes_cpu_instr_cld(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CLI_IMP:   nes_cpu_instr_cli(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CLV_IMP:   nes_cpu_instr_clv(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_CMP_IMM:   nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_CMP_ZP:    nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CMP_ZP_X:  nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CMP_ABS:   nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_CMP_ABS_X: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_CMP_ABS_Y: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_CMP_IND_X: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CMP_IND_Y: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_CPX_IMM:   nes_cpu_instr_cpx(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CPX_ZP:    nes_cpu_instr_cpx(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_CPX_ABS:   nes_cpu_instr_cpx(cpu); cpu->current_instr.result.cycles = 4; break;
-
-        case NES_CPU_INSTR_CPY_IMM:   nes_cpu_instr_cpy(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_CPY_ZP:    nes_cpu_instr_cpy(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_CPY_ABS:   nes_cpu_instr_cpy(cpu); cpu->current_instr.result.cycles = 4; break;
-        
-        case NES_CPU_INSTR_DEC_ZP:    nes_cpu_instr_dec(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_DEC_ZP_X:  nes_cpu_instr_dec(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_DEC_ABS:   nes_cpu_instr_dec(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_DEC_ABS_X: nes_cpu_instr_dec(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_DEX_IMP:   nes_cpu_instr_dex(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_DEY_IMP:   nes_cpu_instr_dey(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_EOR_IMM:   nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_EOR_ZP:    nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_EOR_ZP_X:  nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_EOR_ABS:   nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_EOR_ABS_X: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_EOR_ABS_Y: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_EOR_IND_X: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_EOR_IND_Y: nes_cpu_instr_cmp(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_INC_ZP:    nes_cpu_instr_inc(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_INC_ZP_X:  nes_cpu_instr_inc(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_INC_ABS:   nes_cpu_instr_inc(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_INC_ABS_X: nes_cpu_instr_inc(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_INX_IMP:   nes_cpu_instr_inx(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_INY_IMP:   nes_cpu_instr_iny(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_JMP_ABS:   nes_cpu_instr_jmp(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_JMP_IND:   nes_cpu_instr_jmp(cpu); cpu->current_instr.result.cycles = 5; break;
-        
-        case NES_CPU_INSTR_JSR_ABS:   nes_cpu_instr_jsr(cpu); cpu->current_instr.result.cycles = 6; break;
-
-        case NES_CPU_INSTR_LDA_IMM:   nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_LDA_ZP:    nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_LDA_ZP_X:  nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDA_ABS:   nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDA_ABS_X: nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDA_ABS_Y: nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDA_IND_X: nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_LDA_IND_Y: nes_cpu_instr_lda(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_LDX_IMM:   nes_cpu_instr_ldx(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_LDX_ZP:    nes_cpu_instr_ldx(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_LDX_ZP_Y:  nes_cpu_instr_ldx(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDX_ABS:   nes_cpu_instr_ldx(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDX_ABS_Y: nes_cpu_instr_ldx(cpu); cpu->current_instr.result.cycles = 4; break;
-
-        case NES_CPU_INSTR_LDY_IMM:   nes_cpu_instr_ldy(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_LDY_ZP:    nes_cpu_instr_ldy(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_LDY_ZP_X:  nes_cpu_instr_ldy(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDY_ABS:   nes_cpu_instr_ldy(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_LDY_ABS_X: nes_cpu_instr_ldy(cpu); cpu->current_instr.result.cycles = 4; break;
-
-        case NES_CPU_INSTR_LSR_ACC:   nes_cpu_instr_lsr(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_LSR_ZP:    nes_cpu_instr_lsr(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_LSR_ZP_X:  nes_cpu_instr_lsr(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_LSR_ABS:   nes_cpu_instr_lsr(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_LSR_ABS_X: nes_cpu_instr_lsr(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_NOP_IMP:   nes_cpu_instr_nop(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_ORA_IMM:   nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_ORA_ZP:    nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_ORA_ZP_X:  nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ORA_ABS:   nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ORA_ABS_X: nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ORA_ABS_Y: nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_ORA_IND_X: nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ORA_IND_Y: nes_cpu_instr_ora(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_PHP_IMP:   nes_cpu_instr_php(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_PLA_IMP:   nes_cpu_instr_pla(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_PLP_IMP:   nes_cpu_instr_plp(cpu); cpu->current_instr.result.cycles = 4; break;
-        
-        case NES_CPU_INSTR_ROL_ACC:   nes_cpu_instr_rol(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_ROL_ZP:    nes_cpu_instr_rol(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_ROL_ZP_X:  nes_cpu_instr_rol(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ROL_ABS:   nes_cpu_instr_rol(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ROL_ABS_X: nes_cpu_instr_rol(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_ROR_ACC:   nes_cpu_instr_ror(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_ROR_ZP:    nes_cpu_instr_ror(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_ROR_ZP_X:  nes_cpu_instr_ror(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ROR_ABS:   nes_cpu_instr_ror(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_ROR_ABS_X: nes_cpu_instr_ror(cpu); cpu->current_instr.result.cycles = 7; break;
-
-        case NES_CPU_INSTR_RTI_IMP:   nes_cpu_instr_rti(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_RTS_IMP:   nes_cpu_instr_rts(cpu); cpu->current_instr.result.cycles = 6; break;
-
-        case NES_CPU_INSTR_SBC_IMM:   nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 2; break;   
-        case NES_CPU_INSTR_SBC_ZP:    nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_SBC_ZP_X:  nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_SBC_ABS:   nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_SBC_ABS_X: nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_SBC_ABS_Y: nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_SBC_IND_X: nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_SBC_IND_Y: nes_cpu_instr_sbc(cpu); cpu->current_instr.result.cycles = 5; break;
-
-        case NES_CPU_INSTR_SEC_IMP:   nes_cpu_instr_sec(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_SED_IMP:   nes_cpu_instr_sed(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_SEI_IMP:   nes_cpu_instr_sei(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        case NES_CPU_INSTR_STA_ZP:    nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_STA_ZP_X:  nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_STA_ABS:   nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_STA_ABS_X: nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_STA_ABS_Y: nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 5; break;
-        case NES_CPU_INSTR_STA_IND_X: nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 6; break;
-        case NES_CPU_INSTR_STA_IND_Y: nes_cpu_instr_sta(cpu); cpu->current_instr.result.cycles = 6; break;
-
-        case NES_CPU_INSTR_STX_ZP:    nes_cpu_instr_stx(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_STX_ZP_Y:  nes_cpu_instr_stx(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_STX_ABS:   nes_cpu_instr_stx(cpu); cpu->current_instr.result.cycles = 4; break;
-
-        case NES_CPU_INSTR_STY_ZP:    nes_cpu_instr_sty(cpu); cpu->current_instr.result.cycles = 3; break;
-        case NES_CPU_INSTR_STY_ZP_X:  nes_cpu_instr_sty(cpu); cpu->current_instr.result.cycles = 4; break;
-        case NES_CPU_INSTR_STY_ABS:   nes_cpu_instr_sty(cpu); cpu->current_instr.result.cycles = 4; break;
-
-        case NES_CPU_INSTR_TAX_IMP:   nes_cpu_instr_tax(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_TAY_IMP:   nes_cpu_instr_tay(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_TSX_IMP:   nes_cpu_instr_tsx(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_TXA_IMP:   nes_cpu_instr_txa(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_TXS_IMP:   nes_cpu_instr_txs(cpu); cpu->current_instr.result.cycles = 2; break;
-        case NES_CPU_INSTR_TYA_IMP:   nes_cpu_instr_tya(cpu); cpu->current_instr.result.cycles = 2; break;
-
-        //default assume NOP
-        default: nes_cpu_instr_nop(cpu); break;
-    }
+        NES_CPU_OP_CODES(NES_CPU_OP_CODE_EXECUTE_CASE)
 
-    //if we crossed a page boundary (aka an indexed operation toggled a bit in the MSB)
-    //we add one cycle
-    if (cpu->current_instr.result.page_boundary_crossed) {
-        ++cpu->current_instr.result.cycles;
+        //default assume NOP, which still takes time so a frame always finishes
+        default: NES_CPU_OP_CODE_EXECUTE(zero_page, nop, 2); break;
     }
-
-    //add any cycles from branches
-    //if a branch didn't orrur, it will just be 0
-    cpu->current_instr.result.cycles += cpu->current_instr.result.branch_cycles;
-    sprintf(cpu->debug_info.cyc_str, "CYC: %d",cpu->current_instr.result.cycles);
 }
 
 internal void
-nes_cpu_flag_check(NesCpu* cpu) {
+nes_cpu_flag_check(NesCpu* cpu, NesCpuRun* run) {
     
     //check the flags
-    if (cpu->current_instr.result.flag_c) {
-        nes_cpu_flag_check(cpu,NES_CPU_FLAG_C);
+    if (run->instr.result.flag_c) {
+        nes_cpu_flag_check(cpu, run,NES_CPU_FLAG_C);
     }
-    if (cpu->current_instr.result.flag_z) {
-        nes_cpu_flag_check(cpu,NES_CPU_FLAG_Z);
+    if (run->instr.result.flag_z) {
+        nes_cpu_flag_check(cpu, run,NES_CPU_FLAG_Z);
     }
-    if (cpu->current_instr.result.flag_b) {
-        nes_cpu_flag_check(cpu,NES_CPU_FLAG_B);
+    if (run->instr.result.flag_b) {
+        nes_cpu_flag_check(cpu, run,NES_CPU_FLAG_B);
     }
-    if (cpu->current_instr.result.flag_v) {
-        nes_cpu_flag_check(cpu,NES_CPU_FLAG_V);
+    if (run->instr.result.flag_v) {
+        nes_cpu_flag_check(cpu, run,NES_CPU_FLAG_V);
     }
-    if (cpu->current_instr.result.flag_n) {
-        nes_cpu_flag_check(cpu,NES_CPU_FLAG_N);
+    if (run->instr.result.flag_n) {
+        nes_cpu_flag_check(cpu, run,NES_CPU_FLAG_N);
     }
 }
 
 internal void
 nes_cpu_create_and_intialize_debug_info(NesCpu* cpu) {
 
-    cpu->debug_info.pc_str          = (char*)malloc(sizeof(char) * 10);
-    cpu->debug_info.acc_str         = (char*)malloc(sizeof(char) * 8);
-    cpu->debug_info.sp_str          = (char*)malloc(sizeof(char) * 14);
-    cpu->debug_info.op_code_str     = (char*)malloc(sizeof(char) * 10);
-    cpu->debug_info.ind_x_str       = (char*)malloc(sizeof(char) * 10);
-    cpu->debug_info.ind_y_str       = (char*)malloc(sizeof(char) * 10);
-    cpu->debug_info.pc_p0_val_str   = (char*)malloc(sizeof(char) * 8);
-    cpu->debug_info.pc_p1_val_str   = (char*)malloc(sizeof(char) * 8);
-    cpu->debug_info.pc_p2_val_str   = (char*)malloc(sizeof(char) * 8);
-    cpu->debug_info.addr_mode_str   = (char*)malloc(sizeof(char) * 20);
-    cpu->debug_info.cyc_str         = (char*)malloc(sizeof(char) * 10);
+    //the op code string always points at a literal set by the instruction, so it isn't allocated
+    cpu->debug_info.op_code_str     = "INSTR: ---";
+    cpu->debug_info.pc_str          = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.acc_str         = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.sp_str          = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.ind_x_str       = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.ind_y_str       = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.pc_p0_val_str   = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.pc_p1_val_str   = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.pc_p2_val_str   = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.addr_mode_str   = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
+    cpu->debug_info.cyc_str         = (char*)malloc(sizeof(char) * NES_CPU_DEBUG_STR_SIZE);
     cpu->debug_info.debug_str       = (char*)malloc(sizeof(char) * 256);
 }
 
 internal void
 nes_cpu_destroy_and_free_debug_info(NesCpu* cpu) {
 
-    cpu->debug_info = {0};
     free(cpu->debug_info.pc_str);
     free(cpu->debug_info.acc_str);
     free(cpu->debug_info.sp_str);
-    free(cpu->debug_info.op_code_str);
     free(cpu->debug_info.ind_x_str);
     free(cpu->debug_info.ind_y_str);
     free(cpu->debug_info.pc_p0_val_str);
     free(cpu->debug_info.pc_p1_val_str);
     free(cpu->debug_info.pc_p2_val_str);
+    free(cpu->debug_info.addr_mode_str);
     free(cpu->debug_info.cyc_str);
     free(cpu->debug_info.debug_str);
+    cpu->debug_info = {0};
 }
 
+//the log peeks straight at memory like the trace does, going over the bus could
+//set off a register's read side effects or a watchpoint and the log has to be invisible
 internal void
-nes_cpu_log_register_values(NesCpu* cpu) {
+nes_cpu_log_register_values(NesCpu* cpu, NesCpuRun* run) {
 
-    sprintf(cpu->debug_info.pc_p0_val_str,     "PC+0: %02X",nes_memory_map_read(&cpu->mem_map,cpu->registers.pc));
-    sprintf(cpu->debug_info.pc_str,            "PC: $%04X",cpu->registers.pc);
+    sprintf(cpu->debug_info.pc_p0_val_str,     "PC+0: %02X",*nes_memory_map_address(&cpu->mem_map, run->registers.pc));
+    sprintf(cpu->debug_info.pc_str,            "PC: $%04X",run->registers.pc);
     sprintf(cpu->debug_info.pc_p1_val_str,     "PC+1: --");
     sprintf(cpu->debug_info.pc_p2_val_str,     "PC+2: --");
-    sprintf(cpu->debug_info.acc_str,           "ACC: %02X",cpu->registers.acc_a);
-    sprintf(cpu->debug_info.sp_str,            "SP: $%02X -> %02X",cpu->registers.sp, nes_memory_map_read(&cpu->mem_map,cpu->registers.sp));
-    sprintf(cpu->debug_info.ind_x_str,         "IND X: %02X",cpu->registers.ir_x);
-    sprintf(cpu->debug_info.ind_y_str,         "IND Y: %02X",cpu->registers.ir_y);
+    sprintf(cpu->debug_info.acc_str,           "ACC: %02X",run->registers.acc_a);
+    sprintf(cpu->debug_info.sp_str,            "SP: $%02X -> %02X",run->registers.sp, *nes_memory_map_address(&cpu->mem_map, (nes_addr)(NES_MEM_MAP_STACK_ADDR + run->registers.sp)));
+    sprintf(cpu->debug_info.ind_x_str,         "IND X: %02X",run->registers.ir_x);
+    sprintf(cpu->debug_info.ind_y_str,         "IND Y: %02X",run->registers.ir_y);
 }
 
 internal void
@@ -1485,34 +1400,375 @@ nes_cpu_log_debug_info(NesCpu* cpu) {
 
 }
 
+internal b32
+nes_cpu_idle_loop_address_is_passive(nes_addr address) {
+
+    //ram, sram and prg rom only change when the cpu writes to them
+    if (address <= NES_MEM_MAP_RAM_END || address >= NES_MEM_MAP_SRAM_ADDR) {
+        return TRUE;
+    }
+
+    //ppu status (and its mirrors) only changes on ppu events, and reading it
+    //twice in a row gives the same value
+    if (address >= NES_MEM_MAP_IO_REG_BEGIN && address < NES_MEM_MAP_UPPER_IO_REG_ADDR) {
+        return ((address & 0x0007) == 0x0002) ? TRUE : FALSE;
+    }
+
+    //everything else (controllers, apu, mappers) can change on a read
+    return FALSE;
+}
+
+//an idle loop can only load, compare and branch, anything that
+//writes memory or touches the stack would make skipping it visible
+internal b32
+nes_cpu_idle_loop_instr_is_passive(NesCpu* cpu, nes_addr instr_pc, NesCpuDisasmOpCode* op_code) {
+
+    if (op_code->valid == FALSE) {
+        return FALSE;
+    }
+
+    switch (*nes_memory_map_address(&cpu->mem_map, instr_pc)) {
+
+        case NES_CPU_INSTR_LDA_IMM: case NES_CPU_INSTR_LDA_ZP: case NES_CPU_INSTR_LDA_ABS:
+        case NES_CPU_INSTR_LDX_IMM: case NES_CPU_INSTR_LDX_ZP: case NES_CPU_INSTR_LDX_ABS:
+        case NES_CPU_INSTR_LDY_IMM: case NES_CPU_INSTR_LDY_ZP: case NES_CPU_INSTR_LDY_ABS:
+        case NES_CPU_INSTR_AND_IMM: case NES_CPU_INSTR_AND_ZP: case NES_CPU_INSTR_AND_ABS:
+        case NES_CPU_INSTR_ORA_IMM: case NES_CPU_INSTR_ORA_ZP: case NES_CPU_INSTR_ORA_ABS:
+        case NES_CPU_INSTR_EOR_IMM: case NES_CPU_INSTR_EOR_ZP: case NES_CPU_INSTR_EOR_ABS:
+        case NES_CPU_INSTR_CMP_IMM: case NES_CPU_INSTR_CMP_ZP: case NES_CPU_INSTR_CMP_ABS:
+        case NES_CPU_INSTR_CPX_IMM: case NES_CPU_INSTR_CPX_ZP: case NES_CPU_INSTR_CPX_ABS:
+        case NES_CPU_INSTR_CPY_IMM: case NES_CPU_INSTR_CPY_ZP: case NES_CPU_INSTR_CPY_ABS:
+        case NES_CPU_INSTR_BIT_ZP:  case NES_CPU_INSTR_BIT_ABS:
+        case NES_CPU_INSTR_BCC_REL: case NES_CPU_INSTR_BCS_REL:
+        case NES_CPU_INSTR_BEQ_REL: case NES_CPU_INSTR_BNE_REL:
+        case NES_CPU_INSTR_BMI_REL: case NES_CPU_INSTR_BPL_REL:
+        case NES_CPU_INSTR_BVC_REL: case NES_CPU_INSTR_BVS_REL:
+        case NES_CPU_INSTR_NOP_IMP: break;
+        default: return FALSE;
+    }
+
+    if (op_code->addr_mode == NesCpuAddressMode::absolute) {
+        nes_addr address = (*nes_memory_map_address(&cpu->mem_map, (nes_addr)(instr_pc + 2)) << 8) | *nes_memory_map_address(&cpu->mem_map, (nes_addr)(instr_pc + 1));
+        return nes_cpu_idle_loop_address_is_passive(address);
+    }
+
+    return TRUE;
+}
+
+//the body is decoded straight out of memory, the guest isn't reading it so the bus
+//and any watchpoints on it mustn't see it
+internal b32
+nes_cpu_idle_loop_body_is_passive(NesCpu* cpu, nes_addr loop_pc, nes_addr branch_pc) {
+
+    nes_addr instr_pc = loop_pc;
+
+    while (instr_pc < branch_pc) {
+
+        NesCpuDisasmOpCode* op_code = nes_cpu_disasm_op_code(*nes_memory_map_address(&cpu->mem_map, instr_pc));
+        if (nes_cpu_idle_loop_instr_is_passive(cpu, instr_pc, op_code) == FALSE) {
+            return FALSE;
+        }
+        instr_pc += op_code->size;
+    }
+
+    //the body has to decode cleanly up to the closing branch
+    return (instr_pc == branch_pc) ? TRUE : FALSE;
+}
+
+//called after every taken backward branch or jump
 internal void
-nes_cpu_tick(NesCpu* cpu) {
+nes_cpu_idle_loop_check(NesCpu* cpu, NesCpuRun* run, nes_addr branch_pc) {
 
-    nes_cpu_destroy_and_free_debug_info(cpu);
-    nes_cpu_create_and_intialize_debug_info(cpu);
+    NesCpuIdleLoop* idle_loop = &cpu->idle_loop;
 
-    nes_cpu_log_register_values(cpu);
+    if (idle_loop->branch_pc != branch_pc || idle_loop->loop_pc != run->registers.pc) {
 
-    //set the previous instruction and clear current instruction
-    cpu->previous_instr = cpu->current_instr;
-    cpu->current_instr = {0};
+        //a different loop, remember where we are and wait for the next iteration
+        idle_loop->branch_pc = branch_pc;
+        idle_loop->loop_pc   = run->registers.pc;
+        idle_loop->passive   = nes_cpu_idle_loop_body_is_passive(cpu, idle_loop->loop_pc, branch_pc);
+        idle_loop->active    = FALSE;
+    }
+    else if (idle_loop->passive == TRUE) {
+
+        //if a passive iteration left every register the way the last one did,
+        //every iteration after it will too until something outside the cpu changes
+        NesCpuRegisters* previous = &idle_loop->registers;
+        NesCpuRegisters* current  = &run->registers;
+
+        idle_loop->active = (previous->acc_a == current->acc_a &&
+                             previous->ir_x  == current->ir_x  &&
+                             previous->ir_y  == current->ir_y  &&
+                             previous->sp    == current->sp    &&
+                             previous->p     == current->p)
+            ? TRUE
+            : FALSE;
+
+        idle_loop->loop_cycles       = run->cycle_count - idle_loop->cycle_count;
+        idle_loop->loop_instructions = run->instruction_count - idle_loop->instruction_count;
+    }
 
-    //get the instruction
-    cpu->current_instr.op_code = nes_cpu_program_read(cpu);
+    idle_loop->registers         = run->registers;
+    idle_loop->cycle_count       = run->cycle_count;
+    idle_loop->instruction_count = run->instruction_count;
+}
+
+//jumps ahead by as many whole iterations as fit before cycle_end, the cpu ends up in exactly
+//the state it would have after running them, so emulation stays cycle exact
+internal void
+nes_cpu_idle_loop_skip(NesCpu* cpu, NesCpuRun* run, u64 cycle_end) {
+
+    NesCpuIdleLoop* idle_loop = &cpu->idle_loop;
+
+    if (idle_loop->loop_cycles == 0 || run->cycle_count >= cycle_end) {
+        return;
+    }
+
+    u64 count_iterations = (cycle_end - run->cycle_count) / idle_loop->loop_cycles;
+
+    run->cycle_count       += count_iterations * idle_loop->loop_cycles;
+    run->instruction_count += count_iterations * idle_loop->loop_instructions;
+
+    idle_loop->cycle_count       = run->cycle_count;
+    idle_loop->instruction_count = run->instruction_count;
+    idle_loop->skipped_cycles   += count_iterations * idle_loop->loop_cycles;
+}
+
+#if NES_TRACE
+//registers are what they were before the instruction ran
+internal void
+nes_cpu_trace_instr(NesCpu* cpu, NesCpuRun* run, nes_addr instr_pc, NesCpuRegisters* registers) {
 
-    //decode the address mode
-    nes_cpu_addr_mode_decode_from_instr(cpu);
+    u32 size = nes_cpu_disasm_op_code(run->instr.op_code)->size;
 
-    //decode the operand address from the address mode
-    nes_cpu_decode_operand_address_from_address_mode(cpu);
+    NesTraceRecord record;
+    record.cycle       = run->cycle_count;
+    record.pc          = instr_pc;
+    record.op_code     = run->instr.op_code;
+    //straight out of memory, the cpu already fetched these and reading a register twice could change it
+    record.operands[0] = (size > 1) ? *nes_memory_map_address(&cpu->mem_map, (nes_addr)(instr_pc + 1)) : 0;
+    record.operands[1] = (size > 2) ? *nes_memory_map_address(&cpu->mem_map, (nes_addr)(instr_pc + 2)) : 0;
+    record.acc_a       = registers->acc_a;
+    record.ir_x        = registers->ir_x;
+    record.ir_y        = registers->ir_y;
+    record.sp          = registers->sp;
+    record.p           = registers->p;
+    record.address     = run->instr.operand_address;
+    record.access      = 0;
+
+    //immediate and relative operands were fetched as part of the instruction, not as data
+    if (run->instr.addr_mode != NesCpuAddressMode::immediate &&
+        run->instr.addr_mode != NesCpuAddressMode::relative) {
+        if (run->instr.operand_access & NES_CPU_OPERAND_ACCESS_READ)  record.access |= NES_TRACE_RECORD_FLAG_READ;
+        if (run->instr.operand_access & NES_CPU_OPERAND_ACCESS_WRITE) record.access |= NES_TRACE_RECORD_FLAG_WRITE;
+    }
+
+    nes_trace_record(cpu->trace, &record);
+}
+#endif
+
+//everything that comes before an instruction's own work, up to fetching its op code
+//returns FALSE if an execute breakpoint stopped the cpu instead
+internal inline b32
+nes_cpu_instr_begin(NesCpu* cpu, NesCpuRun* run, nes_addr* instr_pc, NesCpuRegisters* instr_registers) {
+
+    //pages without an execute breakpoint never get past this one load
+    if (cpu->mem_map.page_table.execute_flags[run->registers.pc >> NES_MEM_MAP_PAGE_SHIFT] != 0 &&
+        nes_memory_map_execute_trap(&cpu->mem_map, run->registers.pc) == TRUE) {
+        return FALSE;
+    }
+
+#if NES_CPU_DEBUG_LOG
+    nes_cpu_log_register_values(cpu, run);
+#endif
+
+    //clear the current instruction
+    run->instr = {0};
+
+    *instr_pc        = run->registers.pc;
+    *instr_registers = run->registers;
+
+    //get the instruction
+    run->instr.op_code = nes_cpu_program_read(cpu, run);
+
+    return TRUE;
+}
 
-    //execute the instruction
-    nes_cpu_instr_execute(cpu);
+//everything that comes after an instruction's own work, the same no matter how it was dispatched
+internal inline void
+nes_cpu_instr_end(NesCpu* cpu, NesCpuRun* run, nes_addr instr_pc, NesCpuRegisters* instr_registers) {
 
     //check the flags affected by the result
-    nes_cpu_flag_check(cpu);
+    nes_cpu_flag_check(cpu, run);
 
+#if NES_PROFILER
+    if (cpu->profiler) {
+        NesProfilerRecordInstr(cpu->profiler, instr_pc, run->instr.op_code, run->instr.result.cycles);
+    }
+#endif
+
+#if NES_CDL
+    if (cpu->cdl) {
+        NesCdlRecordInstr(cpu->cdl, instr_pc, nes_cpu_disasm_op_code(run->instr.op_code)->size);
+        //immediate and relative operands were fetched as part of the instruction, not as data
+        if (run->instr.operand_loaded == TRUE &&
+            run->instr.addr_mode != NesCpuAddressMode::immediate &&
+            run->instr.addr_mode != NesCpuAddressMode::relative) {
+            NesCdlRecordData(cpu->cdl, run->instr.operand_address);
+        }
+    }
+#endif
+
+#if NES_TRACE
+    if (cpu->trace) {
+        nes_cpu_trace_instr(cpu, run, instr_pc, instr_registers);
+    }
+#endif
+
+    run->cycle_count += run->instr.result.cycles;
+    ++run->instruction_count;
+
+    //a write to $4014 keeps the cpu off the bus while the page goes over to oam
+    if (cpu->mem_map.oam_dma.stall == TRUE) {
+        run->cycle_count += NES_MEM_MAP_OAM_DMA_CYCLES + (run->cycle_count & 1);
+        cpu->mem_map.oam_dma.stall = FALSE;
+    }
+
+#if NES_CPU_IDLE_LOOP_SKIP
+    //a short jump or taken branch backwards (or onto itself) might be a spin-wait
+    if ((run->instr.addr_mode == NesCpuAddressMode::relative || run->instr.op_code == NES_CPU_INSTR_JMP_ABS) &&
+        run->registers.pc <= instr_pc &&
+        (instr_pc - run->registers.pc) <= NES_CPU_IDLE_LOOP_MAX_SIZE) {
+        nes_cpu_idle_loop_check(cpu, run, instr_pc);
+    }
+#endif
+
+#if NES_CPU_DEBUG_LOG
     nes_cpu_log_debug_info(cpu);
+#endif
+}
+
+internal inline void
+nes_cpu_run_step(NesCpu* cpu, NesCpuRun* run) {
+
+    nes_addr instr_pc;
+    NesCpuRegisters instr_registers;
+    if (nes_cpu_instr_begin(cpu, run, &instr_pc, &instr_registers) != TRUE) {
+        return;
+    }
+
+    //decode the operand and execute the instruction
+    nes_cpu_instr_execute(cpu, run);
+
+    nes_cpu_instr_end(cpu, run, instr_pc, &instr_registers);
+}
+
+//a single instruction, for callers that step the cpu one at a time
+internal void
+nes_cpu_tick(NesCpu* cpu) {
+
+    NesCpuRun run = nes_cpu_run_load(cpu);
+    nes_cpu_run_step(cpu, &run);
+    nes_cpu_run_store(cpu, &run);
+}
+
+//skipped iterations never run, so anything that has to see every instruction turns skipping off
+internal inline b32
+nes_cpu_idle_loop_skip_allowed(NesCpu* cpu) {
+
+    //they don't touch the bus either, so nothing could trap in them
+    if (cpu->mem_map.debug.count_watchpoints != 0) {
+        return FALSE;
+    }
+
+#if NES_PROFILER
+    //spin-waits are the hottest code a game has, the profiler has to count them
+    if (cpu->profiler) {
+        return FALSE;
+    }
+#endif
+
+#if NES_TRACE
+    //a trace is a record per instruction, skipped iterations would leave holes in the numbering and the cycles
+    if (cpu->trace) {
+        return FALSE;
+    }
+#endif
+
+    return TRUE;
+}
+
+//called between instructions, returns TRUE if skipping a spin-wait took the cpu all the way to cycle_end
+internal inline b32
+nes_cpu_idle_loop_try_skip(NesCpu* cpu, NesCpuRun* run, u64 cycle_end) {
+
+#if NES_CPU_IDLE_LOOP_SKIP
+    if (cpu->idle_loop.active == TRUE && run->registers.pc == cpu->idle_loop.loop_pc && nes_cpu_idle_loop_skip_allowed(cpu) == TRUE) {
+        nes_cpu_idle_loop_skip(cpu, run, cycle_end);
+        return (run->cycle_count >= cycle_end) ? TRUE : FALSE;
+    }
+#endif
+
+    return FALSE;
+}
+
+#if NES_CPU_THREADED
+//in nes-cpu-threaded.cpp, which comes after this file
+internal void nes_cpu_threaded_run(NesCpu* cpu, u64 cycle_end);
+#endif
+
+//runs the cpu for cycle_budget cycles (give or take the last instruction) and returns how many it ran,
+//the caller handles whatever event is scheduled at the end
+//a watchpoint firing stops it early, check mem_map.debug.stopped
+internal u64
+nes_cpu_run(NesCpu* cpu, u64 cycle_budget) {
+
+#if NES_CPU_IDLE_LOOP_SKIP
+    //anything that happened since the last burst could change what a spin-wait reads,
+    //so the loop has to prove itself again with a real iteration
+    cpu->idle_loop.active = FALSE;
+#endif
+
+    //the one place pending interrupts get looked at, so the instructions themselves never have to
+    if (cpu->interrupts_pending != 0 && cpu->mem_map.debug.stopped != TRUE) {
+        nes_cpu_interrupts_service(cpu);
+    }
+
+    u64 cycle_start = cpu->cycle_count;
+    u64 cycle_end   = cycle_start + cycle_budget;
+
+#if NES_CPU_THREADED
+    if (cpu->reference_core != TRUE) {
+        nes_cpu_threaded_run(cpu, cycle_end);
+        return cpu->cycle_count - cycle_start;
+    }
+#endif
+
+    //the registers and counters live in here until the burst is over
+    NesCpuRun run_locals = nes_cpu_run_load(cpu);
+    NesCpuRun* run       = &run_locals;
+
+    while (run->cycle_count < cycle_end && cpu->mem_map.debug.stopped != TRUE) {
+
+        if (nes_cpu_idle_loop_try_skip(cpu, run, cycle_end) == TRUE) {
+            break;
+        }
+
+        nes_cpu_run_step(cpu, run);
+    }
+
+    nes_cpu_run_store(cpu, run);
+
+    return cpu->cycle_count - cycle_start;
+}
+
+//runs until the cpu reaches cycle_end, scheduler events are kept in absolute cycles
+//a run with nothing left to do still takes whatever interrupt is pending
+internal void
+nes_cpu_run_until(NesCpu* cpu, u64 cycle_end) {
+
+    u64 cycle_budget = (cycle_end > cpu->cycle_count) ? (cycle_end - cpu->cycle_count) : 0;
+    nes_cpu_run(cpu, cycle_budget);
 }
 
 internal NesCpu
@@ -1522,5 +1778,10 @@ nes_cpu_create_and_initialize() {
     //todo - create constant
     cpu.registers.sp = 0xFD;
 
+    nes_memory_map_initialize(&cpu.mem_map);
+
+    //the debug strings are reused by every tick
+    nes_cpu_create_and_intialize_debug_info(&cpu);
+
     return cpu;
 }
\ No newline at end of file
@@ -5,10 +5,17 @@
 #include "nes-memory-map.hpp"
 #include "nes-memory-map.cpp"
 #include "nes-cpu-instr.hpp"
+#include "nes-profiler.cpp"
+#include "nes-cdl.hpp"
+#include "nes-trace.hpp"
 #include <stdio.h>
 #include <stdlib.h>
 
+//the per instruction debug strings, expensive enough that batch builds turn them off
+#ifndef NES_CPU_DEBUG_LOG
 #define NES_CPU_DEBUG_LOG 1
+#endif
+#define NES_CPU_DEBUG_STR_SIZE 32
 
 
 struct NesCpuRegisters {
@@ -71,13 +78,68 @@ struct NesCpuInstrResult {
     b32 page_boundary_crossed;
 };
 
+#define NES_CPU_OPERAND_ACCESS_READ  0x01
+#define NES_CPU_OPERAND_ACCESS_WRITE 0x02
+
 struct NesCpuInstruction {
     nes_val op_code;
-    nes_val* operand_addr;
+    //where a memory operand is on the bus, the handlers know from their address mode whether there is one
+    nes_addr operand_address;
+    //the operand is only read off the bus once, so registers with read side effects behave
+    nes_val operand_value;
+    b32 operand_loaded;
+    //NES_CPU_OPERAND_ACCESS_READ and/or NES_CPU_OPERAND_ACCESS_WRITE once it's been over the bus
+    u8 operand_access;
     NesCpuAddressMode addr_mode;
     NesCpuInstrResult result;
 };
 
+//what every instruction touches, copied out of NesCpu when a run starts and back when it stops
+//so the hot loop works on a local the compiler can keep in registers
+struct NesCpuRun {
+    NesCpuRegisters registers;
+    NesCpuInstruction instr;
+    u64 cycle_count;
+    u64 instruction_count;
+};
+
+//skip spin-waits that can't change anything until the next event
+#ifndef NES_CPU_IDLE_LOOP_SKIP
+#define NES_CPU_IDLE_LOOP_SKIP 1
+#endif
+
+//dispatch straight from one op code's handler to the next with computed gotos (nes-cpu-threaded.cpp)
+//instead of going through the execute switch, only gcc and clang can take a label's address
+#ifndef NES_CPU_THREADED
+    #if defined(__GNUC__)
+        #define NES_CPU_THREADED 1
+    #else
+        #define NES_CPU_THREADED 0
+    #endif
+#endif
+
+//how far back a branch can go and still be considered a spin-wait
+#define NES_CPU_IDLE_LOOP_MAX_SIZE 16
+
+struct NesCpuIdleLoop {
+    //the backward branch that closes the loop and the address it jumps to
+    nes_addr branch_pc;
+    nes_addr loop_pc;
+    //the loop body only reads memory that can't change without an event
+    b32 passive;
+    //two back to back iterations left the cpu in the same state
+    b32 active;
+    //cpu state right after the branch was last taken
+    NesCpuRegisters registers;
+    u64 cycle_count;
+    u64 instruction_count;
+    //cost of one iteration
+    u64 loop_cycles;
+    u64 loop_instructions;
+    //running total of cycles we didn't have to emulate
+    u64 skipped_cycles;
+};
+
 struct NesCpuDebugInfo {
     char* pc_str;
     char* pc_p0_val_str;
@@ -97,18 +159,43 @@ struct NesCpu {
     NesMemoryMap mem_map;
     NesCpuRegisters registers;    
     NesCpuInstruction current_instr;
-    NesCpuInstruction previous_instr;
     NesCpuDebugInfo debug_info;
+    //running totals since power on
+    u64 cycle_count;
+    u64 instruction_count;
+    NesCpuIdleLoop idle_loop;
+    //NES_CPU_INTERRUPT_PENDING_* raised by the devices, taken when the next run starts
+    u8 interrupts_pending;
+#if NES_PROFILER
+    NesProfiler* profiler;
+#endif
+#if NES_CDL
+    NesCdl* cdl;
+#endif
+#if NES_TRACE
+    NesTrace* trace;
+#endif
+#if NES_CPU_THREADED
+    //runs the switch dispatched core instead, so the two can be checked against each other
+    b32 reference_core;
+#endif
 };
 
+//brk goes through the same entry as the interrupts, irq is only ever the hardware line
 enum NesCpuInterruptType {
     IRQ,
     NMI,
-    RST
+    RST,
+    BRK
 };
 
 #define NES_CPU_INTERRUPT_VECTOR_NMI 0xFFFA
 #define NES_CPU_INTERRUPT_VECTOR_RST 0xFFFC
 #define NES_CPU_INTERRUPT_VECTOR_BRK 0xFFFE
 
+//the lines the devices pull, nmi is an edge and is cleared once it's taken,
+//irq is a level and stays up until whoever raised it lets go
+#define NES_CPU_INTERRUPT_PENDING_NMI 0x01
+#define NES_CPU_INTERRUPT_PENDING_IRQ 0x02
+
 #endif //NES_CPU_HPP
@@ -1,5 +1,167 @@
 #include "nes-emulator.hpp"
 
+//files we keep for a rom sit next to it with the extension swapped out
+internal void
+nes_emulator_save_file_name(char* rom_path, char* extension, char* save_file_name) {
+
+    u32 extension_index = 0;
+    u32 char_index      = 0;
+    for (; rom_path[char_index] != '\0' && char_index < NES_EMULATOR_SAVE_FILE_NAME_SIZE - 1; ++char_index) {
+        char path_char = rom_path[char_index];
+        save_file_name[char_index] = path_char;
+        if (path_char == '.') {
+            extension_index = char_index;
+        }
+        //a dot in a directory name isn't an extension
+        if (path_char == '/' || path_char == '\\') {
+            extension_index = 0;
+        }
+    }
+    if (extension_index == 0) {
+        extension_index = char_index;
+    }
+
+    u32 extension_size = (u32)strlen(extension) + 1;
+    if (extension_index + extension_size > NES_EMULATOR_SAVE_FILE_NAME_SIZE) {
+        extension_index = NES_EMULATOR_SAVE_FILE_NAME_SIZE - extension_size;
+    }
+    memcpy(&save_file_name[extension_index], extension, extension_size);
+}
+
+internal void
+nes_emulator_save_file_open(NesEmulator* emulator, char* rom_path) {
+
+    NesEmulatorSaveFile* save_file = &emulator->save_file;
+    save_file->size = NES_MEM_MAP_SRAM_SIZE;
+    nes_emulator_save_file_name(rom_path, NES_EMULATOR_SAVE_FILE_EXTENSION, save_file->file_name);
+
+    {
+        NesTimelineScoped("map_save_file", NES_TIMELINE_CATEGORY_IO);
+        emulator->platform_callbacks.map_save_file(save_file);
+    }
+
+    //a missing save file comes back zeroed, which is what sram powers up as here anyway
+    if (save_file->memory) {
+        memcpy(emulator->cpu.mem_map.sram, save_file->memory, NES_MEM_MAP_SRAM_SIZE);
+
+        //from here on writes to sram get flagged for the save file too, a page that's already dirty
+        //for the state hash won't trap again until it's hashed, so every page starts out dirty
+        NesMemoryMapPageTable* page_table = &emulator->cpu.mem_map.page_table;
+        page_table->dirty_sram_bits = NES_MEM_MAP_DIRTY_SAVE_FILE;
+        for (u32 page = NES_MEM_MAP_DIRTY_SRAM_BEGIN; page < NES_MEM_MAP_DIRTY_UPPER_END; ++page) {
+            page_table->dirty[page] |= NES_MEM_MAP_DIRTY_SAVE_FILE;
+        }
+    }
+}
+
+//the cpu writes straight into the memory map, so the mapped file doubles as the copy of what's already
+//on disk, only the pages the bus saw a write to get compared and the ones that differ get flushed
+internal void
+nes_emulator_save_file_flush(NesEmulator* emulator) {
+
+    NesEmulatorSaveFile* save_file = &emulator->save_file;
+    if (!save_file->memory) {
+        return;
+    }
+
+    NesTimelineScoped("flush_save_file", NES_TIMELINE_CATEGORY_IO);
+
+    NesMemoryMap* mem_map = &emulator->cpu.mem_map;
+    u32 mem_map_pages_per_page = NES_EMULATOR_SAVE_FILE_PAGE_SIZE / NES_MEM_MAP_PAGE_SIZE;
+
+    for (u32 page_index = 0; page_index < NES_EMULATOR_SAVE_FILE_PAGES; ++page_index) {
+
+        //a save file page covers a run of memory map pages, any one of them being dirty is enough
+        u32 first_mem_map_page = NES_MEM_MAP_DIRTY_SRAM_BEGIN + (page_index * mem_map_pages_per_page);
+        b32 page_dirty = FALSE;
+        for (u32 mem_map_page = first_mem_map_page; mem_map_page < first_mem_map_page + mem_map_pages_per_page; ++mem_map_page) {
+            if (mem_map->page_table.dirty[mem_map_page] & NES_MEM_MAP_DIRTY_SAVE_FILE) {
+                page_dirty = TRUE;
+                nes_memory_map_dirty_clear(mem_map, mem_map_page, NES_MEM_MAP_DIRTY_SAVE_FILE);
+            }
+        }
+        if (page_dirty != TRUE) {
+            continue;
+        }
+
+        u32 page_offset = page_index * NES_EMULATOR_SAVE_FILE_PAGE_SIZE;
+        nes_val* sram_page = &mem_map->sram[page_offset];
+        nes_val* file_page = &save_file->memory[page_offset];
+
+        //writing back the value that was already there still dirties the page
+        if (memcmp(sram_page, file_page, NES_EMULATOR_SAVE_FILE_PAGE_SIZE) != 0) {
+            memcpy(file_page, sram_page, NES_EMULATOR_SAVE_FILE_PAGE_SIZE);
+            emulator->platform_callbacks.flush_save_file(save_file, page_offset, NES_EMULATOR_SAVE_FILE_PAGE_SIZE);
+            ++save_file->pages_flushed;
+        }
+    }
+}
+
+//call on shutdown, everything still dirty goes out and we wait for it
+internal void
+nes_emulator_save_file_close(NesEmulator* emulator) {
+
+    NesEmulatorSaveFile* save_file = &emulator->save_file;
+    if (!save_file->memory) {
+        return;
+    }
+
+    nes_emulator_save_file_flush(emulator);
+
+    //nothing left to flush to, sram writes go back to only dirtying the state hash
+    emulator->cpu.mem_map.page_table.dirty_sram_bits = 0;
+
+    NesTimelineScoped("unmap_save_file", NES_TIMELINE_CATEGORY_IO);
+    emulator->platform_callbacks.unmap_save_file(save_file);
+    save_file->memory = NULL;
+}
+
+#if NES_CDL
+
+//the code/data log goes through the same mapped file as sram, so it's on disk as the cpu writes it
+internal void
+nes_emulator_cdl_open(NesEmulator* emulator, char* rom_path) {
+
+    NesEmulatorSaveFile* cdl_file = &emulator->cdl_file;
+    cdl_file->size = emulator->rom.header.count_16kb_prg_rom_banks * NES_CDL_PRG_ROM_BANK_SIZE;
+    nes_emulator_save_file_name(rom_path, NES_CDL_FILE_EXTENSION, cdl_file->file_name);
+
+    {
+        NesTimelineScoped("map_cdl_file", NES_TIMELINE_CATEGORY_IO);
+        emulator->platform_callbacks.map_save_file(cdl_file);
+    }
+
+    emulator->cpu.cdl = nes_cdl_create_and_initialize(emulator->rom.header.count_16kb_prg_rom_banks, cdl_file->memory);
+
+    //nrom maps the first two banks, a single bank is mirrored into both windows
+    nes_memory_map_prg_rom_banks_map(&emulator->cpu.cdl->prg_rom_banks, 0, (emulator->rom.header.count_16kb_prg_rom_banks > 1) ? 1 : 0);
+
+    {
+        NesTimelineScoped("cdl_analyze", NES_TIMELINE_CATEGORY_CPU);
+        nes_cdl_analyze(emulator->cpu.cdl, (nes_val*)emulator->rom.prg_rom);
+    }
+}
+
+internal void
+nes_emulator_cdl_close(NesEmulator* emulator) {
+
+    if (emulator->cpu.cdl == NULL) {
+        return;
+    }
+
+    nes_cdl_destroy(emulator->cpu.cdl);
+    emulator->cpu.cdl = NULL;
+
+    NesEmulatorSaveFile* cdl_file = &emulator->cdl_file;
+    if (cdl_file->memory) {
+        NesTimelineScoped("unmap_cdl_file", NES_TIMELINE_CATEGORY_IO);
+        emulator->platform_callbacks.unmap_save_file(cdl_file);
+        cdl_file->memory = NULL;
+    }
+}
+
+#endif
+
 internal NesEmulator
 nes_emulator_create_and_initialize(char* rom_path,
                                    NesEmulatorPlatformCallbacks platform_callbacks) {
@@ -7,39 +169,669 @@ nes_emulator_create_and_initialize(char* rom_path,
     //open the ROM file
     NesEmulatorFileBuffer rom_buffer = {0};
     rom_buffer.file_name = rom_path;
-    platform_callbacks.open_and_read_file(&rom_buffer);    
+    {
+        NesTimelineScoped("open_and_read_file", NES_TIMELINE_CATEGORY_IO);
+        platform_callbacks.open_and_read_file(&rom_buffer);    
+    }
 
     NesEmulator nes_emulator        = {0};
     nes_emulator.cpu                = nes_cpu_create_and_initialize();
+    nes_emulator.ppu                = nes_ppu_create_and_initialize();
     nes_emulator.platform_callbacks = platform_callbacks;
+    nes_emulator.log                = nes_log_create_and_initialize();
     
     //initialize the rom
     nes_emulator.rom                = nes_rom_create_and_initialize(rom_buffer.file_buffer);
     platform_callbacks.close_and_free_file(&rom_buffer);
     ASSERT(nes_emulator.rom.header.valid);
 
+#if NES_PROFILER
+    nes_emulator.cpu.profiler = nes_profiler_create_and_initialize(nes_emulator.rom.header.count_16kb_prg_rom_banks);
+#endif
+
+    //we need to read from the rom and update the CPU prg rom banks
+    {
+        NesTimelineScoped("prg_rom_switch", NES_TIMELINE_CATEGORY_MAPPER);
+        NesRomPrgRomBankRead rom_read = nes_rom_prg_rom_read(&nes_emulator.rom);
+        nes_cpu_update_prg_rom(&nes_emulator.cpu, rom_read.low_bank.memory, rom_read.high_bank.memory);
+    }
+
+    //nrom has a single fixed chr bank
+    if (nes_emulator.rom.header.count_8kb_vrom_banks > 0) {
+        nes_ppu_update_pattern_tables(&nes_emulator.ppu, nes_emulator.rom.chr_rom[0].memory);
+    }
+
+#if NES_PROFILER
+    //nrom maps the first two banks, a single bank is mirrored into both windows
+    nes_memory_map_prg_rom_banks_map(&nes_emulator.cpu.profiler->prg_rom_banks, 0, (nes_emulator.rom.header.count_16kb_prg_rom_banks > 1) ? 1 : 0);
+#endif
+
+#if NES_CDL
+    //the static pass needs the prg rom banks mapped
+    nes_emulator_cdl_open(&nes_emulator, rom_path);
+#endif
+
+    //load the save before the reset so the game sees it on boot
+    if (nes_emulator.rom.header.battery_backed_ram_present == TRUE) {
+        nes_emulator_save_file_open(&nes_emulator, rom_path);
+    }
+
+    //reset and we are ready to go
+    nes_cpu_reset(&nes_emulator.cpu);
+
     return nes_emulator;
 }
 
-internal b32
-nes_emulator_update_and_render(NesEmulator* emulator) {
+//a second machine running the same rom, starting from wherever this one is
+//it gets its own cpu debug strings and frame buffer, but no log, save file or code/data log
+internal NesEmulator
+nes_emulator_create_copy(NesEmulator* emulator) {
 
-    NesEmulatorFileBuffer log_file_buffer = {0};
-    log_file_buffer.file_name = "nes-emulator-log.txt";
-    log_file_buffer.file_buffer.buffer_size = 256;
-    log_file_buffer.file_buffer.buffer_contents = "HELLO WORLD!!!";
+    NesEmulator copy = *emulator;
 
-    emulator->platform_callbacks.open_and_write_to_file(&log_file_buffer);
+    copy.log       = NULL;
+    copy.save_file = {0};
+    copy.cdl_file  = {0};
+#if NES_CDL
+    copy.cpu.cdl   = NULL;
+#endif
+#if NES_PROFILER
+    copy.cpu.profiler = NULL;
+#endif
+#if NES_TRACE
+    copy.cpu.trace    = NULL;
+#endif
 
-    //we need to read from the rom and update the CPU prg rom banks
-    NesRomPrgRomBankRead rom_read = nes_rom_prg_rom_read(&emulator->rom);
-    nes_cpu_update_prg_rom(&emulator->cpu, rom_read.low_bank.memory, rom_read.high_bank.memory);
+    nes_cpu_create_and_intialize_debug_info(&copy.cpu);
 
-    //reset and we are ready to go
-    nes_cpu_reset(&emulator->cpu);
+    copy.ppu.observation  = NULL;
+    copy.ppu.frame_buffer = (u8*)malloc(NES_PPU_FRAME_BUFFER_SIZE);
+    copy.ppu.row_emphasis = (u8*)malloc(NES_PPU_FRAME_BUFFER_HEIGHT);
+    memcpy(copy.ppu.frame_buffer, emulator->ppu.frame_buffer, NES_PPU_FRAME_BUFFER_SIZE);
+    memcpy(copy.ppu.row_emphasis, emulator->ppu.row_emphasis, NES_PPU_FRAME_BUFFER_HEIGHT);
+
+    return copy;
+}
+
+//only for copies, the rom belongs to the emulator they were copied from
+internal void
+nes_emulator_destroy_copy(NesEmulator* copy) {
+
+    nes_cpu_destroy_and_free_debug_info(&copy->cpu);
+    nes_ppu_destroy(&copy->ppu);
+}
+
+internal void
+nes_emulator_set_controller(NesEmulator* emulator, u32 controller_index, nes_val buttons) {
+
+    ASSERT(controller_index < NES_MEM_MAP_CONTROLLER_COUNT);
+    emulator->cpu.mem_map.controllers.buttons[controller_index] = buttons;
+}
+
+internal void
+nes_emulator_snapshot_save(NesEmulator* emulator, NesEmulatorSnapshot* snapshot) {
+
+    NesTimelineScoped("snapshot_save", NES_TIMELINE_CATEGORY_FRAME);
+
+    NesCpu* cpu = &emulator->cpu;
+
+    snapshot->registers         = cpu->registers;
+    snapshot->current_instr     = cpu->current_instr;
+    snapshot->cycle_count       = cpu->cycle_count;
+    snapshot->instruction_count = cpu->instruction_count;
+    snapshot->idle_loop         = cpu->idle_loop;
+    snapshot->interrupts_pending = cpu->interrupts_pending;
+    snapshot->ram               = cpu->mem_map.ram;
+    snapshot->io_registers      = cpu->mem_map.io_registers;
+    memcpy(snapshot->expansion_rom, cpu->mem_map.expansion_rom, NES_MEM_MAP_EXPANSION_ROM_SIZE);
+    memcpy(snapshot->sram, cpu->mem_map.sram, NES_MEM_MAP_SRAM_SIZE);
+    snapshot->controllers       = cpu->mem_map.controllers;
+    snapshot->ppu               = emulator->ppu;
+    snapshot->frame_count       = emulator->frame_count;
+    snapshot->state_hash_count_updates = emulator->state_hash.count_updates;
+}
+
+internal void
+nes_emulator_snapshot_restore(NesEmulator* emulator, NesEmulatorSnapshot* snapshot) {
+
+    NesTimelineScoped("snapshot_restore", NES_TIMELINE_CATEGORY_FRAME);
+
+    NesCpu* cpu = &emulator->cpu;
+
+    cpu->registers              = snapshot->registers;
+    cpu->current_instr          = snapshot->current_instr;
+    cpu->cycle_count            = snapshot->cycle_count;
+    cpu->instruction_count      = snapshot->instruction_count;
+    cpu->idle_loop              = snapshot->idle_loop;
+    cpu->interrupts_pending     = snapshot->interrupts_pending;
+    cpu->mem_map.ram            = snapshot->ram;
+    cpu->mem_map.io_registers   = snapshot->io_registers;
+    memcpy(cpu->mem_map.expansion_rom, snapshot->expansion_rom, NES_MEM_MAP_EXPANSION_ROM_SIZE);
+    memcpy(cpu->mem_map.sram, snapshot->sram, NES_MEM_MAP_SRAM_SIZE);
+    cpu->mem_map.controllers    = snapshot->controllers;
+    emulator->frame_count       = snapshot->frame_count;
+
+    //dirty pages stay dirty until the next hash, so going back to a snapshot taken since
+    //then is already covered, anything older could differ anywhere
+    if (snapshot->state_hash_count_updates != emulator->state_hash.count_updates) {
+        nes_memory_map_dirty_all(&cpu->mem_map);
+    }
+
+    //the frame buffer isn't part of the snapshot, the last frame drawn stays on screen
+    u8* frame_buffer                = emulator->ppu.frame_buffer;
+    u8* row_emphasis                = emulator->ppu.row_emphasis;
+    NesPpuObservation* observation  = emulator->ppu.observation;
+    emulator->ppu                   = snapshot->ppu;
+    emulator->ppu.frame_buffer      = frame_buffer;
+    emulator->ppu.row_emphasis      = row_emphasis;
+    emulator->ppu.observation       = observation;
+}
+
+//the memory map holds on to the page the cpu sent over, the ppu takes it between bursts
+internal void
+nes_emulator_oam_dma(NesEmulator* emulator) {
+
+    NesMemoryMapOamDma* oam_dma = &emulator->cpu.mem_map.oam_dma;
+    if (oam_dma->pending == TRUE) {
+        nes_ppu_oam_dma(&emulator->ppu, oam_dma->page);
+        oam_dma->pending = FALSE;
+    }
+}
+
+//returns FALSE if a watchpoint stopped the cpu partway, calling it again picks the frame up where it stopped
+internal b32
+nes_emulator_run_frame(NesEmulator* emulator, b32 render) {
+
+    NesTimelineScoped("run_frame", NES_TIMELINE_CATEGORY_FRAME);
+
+    emulator->ppu.render_skip = (render == TRUE) ? FALSE : TRUE;
 
     //hold on to your butts...
-    nes_cpu_tick(&emulator->cpu);
+    //the cpu runs in bursts up to the end of each scanline, then the ppu catches up
+    //any cycles the cpu overshoots by are taken out of the next burst
+    //sprite evaluation runs on every frame, drawn or not, since games poll sprite 0 hit to time their splits
+    NesPpuScanlineResult scanline_result = {0};
+    NesPpuSpriteEvaluation sprite_evaluation = {0};
+    do {
+        nes_ppu_sprite_evaluation(&emulator->ppu, &emulator->cpu.mem_map, &sprite_evaluation);
+        {
+            NesTimelineScoped("cpu_burst", NES_TIMELINE_CATEGORY_CPU);
+
+            //a hit splits the burst so the cpu sees the flag on the right cycle
+            if (sprite_evaluation.sprite_0_hit == TRUE) {
+                nes_cpu_run_until(&emulator->cpu, sprite_evaluation.sprite_0_hit_cpu_cycle);
+                nes_emulator_oam_dma(emulator);
+                if (emulator->cpu.mem_map.debug.stopped == TRUE) {
+                    return FALSE;
+                }
+                nes_ppu_sprite_0_hit(&emulator->ppu, &emulator->cpu.mem_map);
+            }
+            nes_cpu_run_until(&emulator->cpu, nes_ppu_scanline_end_cpu_cycle(&emulator->ppu));
+            nes_emulator_oam_dma(emulator);
+        }
+        //the ppu hasn't caught up yet, so this scanline runs again from the top when we resume
+        if (emulator->cpu.mem_map.debug.stopped == TRUE) {
+            return FALSE;
+        }
+        {
+            NesTimelineScoped("ppu_scanline", NES_TIMELINE_CATEGORY_PPU);
+            nes_ppu_scanline(&emulator->ppu, &emulator->cpu.mem_map, &sprite_evaluation, &scanline_result);
+        }
+        //taken when the next burst starts
+        if (scanline_result.nmi == TRUE) {
+            nes_cpu_interrupt_raise(&emulator->cpu, NES_CPU_INTERRUPT_PENDING_NMI);
+        }
+    } while (scanline_result.frame_complete != TRUE);
+
+    ++emulator->frame_count;
 
     return TRUE;
-}
\ No newline at end of file
+}
+
+//nes_emulator_run_frame on up to NES_CPU_BATCH_LANES machines at once, a scanline at a time so each burst
+//goes through the batch cpu with every machine in it, none of them can have a watchpoint that might stop it
+internal void
+nes_emulator_run_frame_batch(NesEmulator** emulators, u32 count_emulators, b32 render) {
+
+    NesTimelineScoped("run_frame_batch", NES_TIMELINE_CATEGORY_FRAME);
+
+    NesCpu* cpus[NES_CPU_BATCH_LANES];
+    NesPpuScanlineResult scanline_results[NES_CPU_BATCH_LANES];
+    NesPpuSpriteEvaluation sprite_evaluations[NES_CPU_BATCH_LANES];
+    u64 cycle_ends[NES_CPU_BATCH_LANES];
+
+    for (u32 lane = 0; lane < count_emulators; ++lane) {
+        emulators[lane]->ppu.render_skip = (render == TRUE) ? FALSE : TRUE;
+        cpus[lane]                       = &emulators[lane]->cpu;
+        scanline_results[lane]           = {0};
+        sprite_evaluations[lane]         = {0};
+    }
+
+    NesCpuBatch batch = nes_cpu_batch_create_and_initialize(cpus, count_emulators);
+
+    //a machine drops out once its frame is done, they don't all have to finish on the same scanline
+    u32 running_bits = (1 << count_emulators) - 1;
+    while (running_bits != 0) {
+
+        u32 sprite_0_hit_bits = 0;
+        for (u32 lane = 0; lane < count_emulators; ++lane) {
+            if ((running_bits >> lane) & 1) {
+                nes_ppu_sprite_evaluation(&emulators[lane]->ppu, &emulators[lane]->cpu.mem_map, &sprite_evaluations[lane]);
+                if (sprite_evaluations[lane].sprite_0_hit == TRUE) {
+                    sprite_0_hit_bits |= 1 << lane;
+                    cycle_ends[lane]   = sprite_evaluations[lane].sprite_0_hit_cpu_cycle;
+                }
+            }
+        }
+
+        {
+            NesTimelineScoped("cpu_burst", NES_TIMELINE_CATEGORY_CPU);
+
+            //a hit splits the burst so the cpu sees the flag on the right cycle
+            if (sprite_0_hit_bits != 0) {
+                nes_cpu_batch_run_until(&batch, sprite_0_hit_bits, cycle_ends);
+                for (u32 lane = 0; lane < count_emulators; ++lane) {
+                    if ((sprite_0_hit_bits >> lane) & 1) {
+                        nes_emulator_oam_dma(emulators[lane]);
+                        nes_ppu_sprite_0_hit(&emulators[lane]->ppu, &emulators[lane]->cpu.mem_map);
+                    }
+                }
+            }
+
+            for (u32 lane = 0; lane < count_emulators; ++lane) {
+                if ((running_bits >> lane) & 1) {
+                    cycle_ends[lane] = nes_ppu_scanline_end_cpu_cycle(&emulators[lane]->ppu);
+                }
+            }
+            nes_cpu_batch_run_until(&batch, running_bits, cycle_ends);
+        }
+
+        for (u32 lane = 0; lane < count_emulators; ++lane) {
+
+            if (((running_bits >> lane) & 1) == 0) {
+                continue;
+            }
+
+            NesEmulator* emulator = emulators[lane];
+            nes_emulator_oam_dma(emulator);
+
+            {
+                NesTimelineScoped("ppu_scanline", NES_TIMELINE_CATEGORY_PPU);
+                nes_ppu_scanline(&emulator->ppu, &emulator->cpu.mem_map, &sprite_evaluations[lane], &scanline_results[lane]);
+            }
+            //taken when the next burst starts
+            if (scanline_results[lane].nmi == TRUE) {
+                nes_cpu_interrupt_raise(&emulator->cpu, NES_CPU_INTERRUPT_PENDING_NMI);
+            }
+            if (scanline_results[lane].frame_complete == TRUE) {
+                ++emulator->frame_count;
+                running_bits &= ~(1 << lane);
+            }
+        }
+    }
+}
+
+/**************
+ * STATE HASH *
+ **************/
+
+internal u64
+nes_emulator_hash_bytes(void* data, u32 size, u64 seed) {
+
+    u8* bytes = (u8*)data;
+    u64 hash  = seed ^ ((u64)size * NES_EMULATOR_STATE_HASH_MULTIPLIER);
+
+    u32 byte_index = 0;
+    for (; byte_index + sizeof(u64) <= size; byte_index += sizeof(u64)) {
+        u64 word;
+        memcpy(&word, &bytes[byte_index], sizeof(u64));
+        hash = (hash ^ word) * NES_EMULATOR_STATE_HASH_MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+    for (; byte_index < size; ++byte_index) {
+        hash = (hash ^ bytes[byte_index]) * NES_EMULATOR_STATE_HASH_MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+
+    return hash ^ (hash >> 32);
+}
+
+//the dirty pages get rehashed, everything small enough to not be worth tracking
+//(registers, io registers, oam and the palette) is hashed every time
+internal u64
+nes_emulator_state_hash_update(NesEmulator* emulator) {
+
+    NesTimelineScoped("state_hash", NES_TIMELINE_CATEGORY_FRAME);
+
+    NesEmulatorStateHash* state_hash = &emulator->state_hash;
+    NesMemoryMap* mem_map = &emulator->cpu.mem_map;
+
+    for (u32 page = 0; page < NES_MEM_MAP_PAGE_COUNT; ++page) {
+
+        if ((mem_map->page_table.dirty[page] & NES_MEM_MAP_DIRTY_STATE_HASH) == 0 || nes_memory_map_dirty_page(page) != page) {
+            continue;
+        }
+
+        //pages are seeded with their number so two pages holding the same bytes don't cancel out
+        nes_val* page_memory = nes_memory_map_address(mem_map, (nes_addr)(page << NES_MEM_MAP_PAGE_SHIFT));
+        u64 page_hash = nes_emulator_hash_bytes(page_memory, NES_MEM_MAP_PAGE_SIZE, page);
+
+        state_hash->pages_hash ^= state_hash->page_hashes[page] ^ page_hash;
+        state_hash->page_hashes[page] = page_hash;
+        ++state_hash->pages_rehashed;
+
+        nes_memory_map_dirty_clear(mem_map, page, NES_MEM_MAP_DIRTY_STATE_HASH);
+    }
+
+    //the struct padding isn't ours to hash, so the registers go in one at a time
+    NesCpuRegisters* registers = &emulator->cpu.registers;
+    u64 registers_state[5];
+    registers_state[0] = ((u64)registers->pc << 40) | ((u64)registers->sp << 32) | ((u64)registers->acc_a << 24) |
+                         ((u64)registers->ir_x << 16) | ((u64)registers->ir_y << 8) | (u64)registers->p;
+    registers_state[1] = emulator->cpu.cycle_count;
+    registers_state[2] = emulator->frame_count;
+    registers_state[3] = emulator->ppu.scanline;
+    //an interrupt still waiting on the line or a held strobe changes what happens next just as much
+    registers_state[4] = ((u64)emulator->cpu.interrupts_pending << 32) | (u32)mem_map->controllers.strobe;
+
+    u64 hash = state_hash->pages_hash;
+    hash = nes_emulator_hash_bytes(registers_state, sizeof(registers_state), hash);
+    hash = nes_emulator_hash_bytes(mem_map->io_registers.io_registers_lower, NES_MEM_MAP_LOWER_IO_REG_SIZE, hash);
+    //the rest of the upper registers' page is expansion rom, too little of it to track
+    hash = nes_emulator_hash_bytes(nes_memory_map_address(mem_map, NES_MEM_MAP_UPPER_IO_REG_ADDR), NES_MEM_MAP_UPPER_IO_REG_SIZE, hash);
+    hash = nes_emulator_hash_bytes(&mem_map->expansion_rom[0], NES_MEM_MAP_PAGE_SIZE - (NES_MEM_MAP_EXPANSION_ROM_ADDR & NES_MEM_MAP_PAGE_MASK), hash);
+    hash = nes_emulator_hash_bytes(mem_map->controllers.shift, NES_MEM_MAP_CONTROLLER_COUNT, hash);
+    hash = nes_emulator_hash_bytes(emulator->ppu.oam, NES_PPU_OAM_SIZE, hash);
+    hash = nes_emulator_hash_bytes(emulator->ppu.palette, NES_PPU_PALETTE_SIZE, hash);
+
+    state_hash->hash = hash;
+    ++state_hash->count_updates;
+
+    return hash;
+}
+
+//the hash as of the end of the last update
+internal u64
+nes_emulator_state_hash(NesEmulator* emulator) {
+
+    return emulator->state_hash.hash;
+}
+
+internal void
+nes_emulator_set_run_ahead_frames(NesEmulator* emulator, u32 run_ahead_frames) {
+
+    emulator->run_ahead_frames = (run_ahead_frames > NES_EMULATOR_RUN_AHEAD_MAX_FRAMES)
+        ? NES_EMULATOR_RUN_AHEAD_MAX_FRAMES
+        : run_ahead_frames;
+}
+
+//render is per frame, frames nobody will see still run the cpu and every ppu side effect but skip the pixels
+//returns FALSE if the frame stopped on a watchpoint, see nes_emulator_debug_continue
+internal b32
+nes_emulator_update_and_render(NesEmulator* emulator, b32 render) {
+
+    NesTimelineScoped("update_and_render", NES_TIMELINE_CATEGORY_FRAME);
+
+    if (emulator->log) {
+        nes_log_printf(emulator->log, "frame: %llu cycles: %llu instructions: %llu\n",
+            emulator->frame_count,
+            emulator->cpu.cycle_count,
+            emulator->cpu.instruction_count);
+    }
+
+    //run-ahead frames get rolled back, so they can't be allowed to trap
+    if (emulator->run_ahead_frames == 0 || emulator->cpu.mem_map.debug.count_watchpoints > 0) {
+        if (nes_emulator_run_frame(emulator, render) != TRUE) {
+            return FALSE;
+        }
+    }
+    else {
+        //the real frame, this is the one that sticks but nobody gets to see it
+        nes_emulator_run_frame(emulator, FALSE);
+
+        {
+            NesTimelineScoped("run_ahead", NES_TIMELINE_CATEGORY_FRAME);
+
+            //the trace, profiler and code/data log only get what really ran
+#if NES_TRACE
+            NesTrace* trace = emulator->cpu.trace;
+            emulator->cpu.trace = NULL;
+#endif
+#if NES_PROFILER
+            NesProfiler* profiler = emulator->cpu.profiler;
+            emulator->cpu.profiler = NULL;
+#endif
+#if NES_CDL
+            NesCdl* cdl = emulator->cpu.cdl;
+            emulator->cpu.cdl = NULL;
+#endif
+
+            //run ahead with the same input and only draw the last frame, then throw it all away
+            nes_emulator_snapshot_save(emulator, &emulator->run_ahead_snapshot);
+            for (u32 frame_index = 1; frame_index <= emulator->run_ahead_frames; ++frame_index) {
+                nes_emulator_run_frame(emulator, (frame_index == emulator->run_ahead_frames) ? render : FALSE);
+            }
+            nes_emulator_snapshot_restore(emulator, &emulator->run_ahead_snapshot);
+
+#if NES_TRACE
+            emulator->cpu.trace = trace;
+#endif
+#if NES_PROFILER
+            emulator->cpu.profiler = profiler;
+#endif
+#if NES_CDL
+            emulator->cpu.cdl = cdl;
+#endif
+        }
+    }
+
+    //only the real frame's sram is left at this point, run-ahead has been rolled back
+    nes_emulator_save_file_flush(emulator);
+
+    nes_emulator_state_hash_update(emulator);
+
+    return TRUE;
+}
+
+//nes_emulator_update_and_render for a batch of machines all drawing the same frames, the ones that run ahead or
+//could stop on a watchpoint go one at a time and the rest share the batch cpu
+internal void
+nes_emulator_update_and_render_batch(NesEmulator** emulators, u32 count_emulators, b32 render) {
+
+    ASSERT(count_emulators <= NES_CPU_BATCH_LANES);
+
+    NesEmulator* batch_emulators[NES_CPU_BATCH_LANES];
+    u32 count_batch_emulators = 0;
+
+    for (u32 emulator_index = 0; emulator_index < count_emulators; ++emulator_index) {
+
+        NesEmulator* emulator = emulators[emulator_index];
+
+        if (emulator->run_ahead_frames != 0 ||
+            emulator->cpu.mem_map.debug.count_watchpoints > 0 ||
+            emulator->cpu.mem_map.debug.stopped == TRUE) {
+            nes_emulator_update_and_render(emulator, render);
+            continue;
+        }
+
+        if (emulator->log) {
+            nes_log_printf(emulator->log, "frame: %llu cycles: %llu instructions: %llu\n",
+                emulator->frame_count,
+                emulator->cpu.cycle_count,
+                emulator->cpu.instruction_count);
+        }
+
+        batch_emulators[count_batch_emulators++] = emulator;
+    }
+
+    if (count_batch_emulators == 0) {
+        return;
+    }
+
+    nes_emulator_run_frame_batch(batch_emulators, count_batch_emulators, render);
+
+    for (u32 emulator_index = 0; emulator_index < count_batch_emulators; ++emulator_index) {
+        nes_emulator_save_file_flush(batch_emulators[emulator_index]);
+        nes_emulator_state_hash_update(batch_emulators[emulator_index]);
+    }
+}
+
+/*************
+ * DEBUGGING *
+ *************/
+
+//returns the watchpoint index or -1 if there's no room, only the pages in the range leave the fast path
+internal i32
+nes_emulator_watchpoint_add(NesEmulator* emulator, nes_addr address_begin, nes_addr address_end, u8 watch_flags) {
+
+    return nes_memory_map_watchpoint_add(&emulator->cpu.mem_map, address_begin, address_end, watch_flags);
+}
+
+internal void
+nes_emulator_watchpoint_remove(NesEmulator* emulator, u32 watchpoint_index) {
+
+    nes_memory_map_watchpoint_remove(&emulator->cpu.mem_map, watchpoint_index);
+}
+
+internal void
+nes_emulator_debug_continue(NesEmulator* emulator) {
+
+    nes_memory_map_debug_resume(&emulator->cpu.mem_map, emulator->cpu.registers.pc);
+}
+
+#if NES_PROFILER
+
+internal void
+nes_emulator_profiler_read_instr_bytes(NesEmulator* emulator, i32 bank, nes_addr pc, nes_val* instr_bytes) {
+
+    for (u32 byte_index = 0; byte_index < 3; ++byte_index) {
+
+        instr_bytes[byte_index] = 0;
+
+        if (bank < 0) {
+            //only ram can be disassembled below the prg rom
+            nes_addr address = pc + byte_index;
+            if (address <= NES_MEM_MAP_RAM_END) {
+                instr_bytes[byte_index] = nes_memory_map_read(&emulator->cpu.mem_map, address);
+            }
+        }
+        else {
+            //don't read past the end of the bank
+            u32 bank_offset = (pc & (NES_ROM_SIZE_PRG_ROM_BANK - 1)) + byte_index;
+            if (bank_offset < NES_ROM_SIZE_PRG_ROM_BANK) {
+                instr_bytes[byte_index] = emulator->rom.prg_rom[bank].memory[bank_offset];
+            }
+        }
+    }
+}
+
+internal void
+nes_emulator_profiler_write_report(NesEmulator* emulator) {
+
+    NesProfiler* profiler = emulator->cpu.profiler;
+
+    u32 hot_spot_indices[NES_PROFILER_REPORT_HOT_SPOTS];
+    u32 op_code_indices[NES_PROFILER_REPORT_OP_CODES];
+
+    u32 count_hot_spots = nes_profiler_top_counters(profiler->pc_counters, profiler->count_pc_counters, hot_spot_indices, NES_PROFILER_REPORT_HOT_SPOTS);
+    u32 count_op_codes  = nes_profiler_top_counters(profiler->op_code_counters, 256, op_code_indices, NES_PROFILER_REPORT_OP_CODES);
+
+    //every line in the report is well under 128 characters
+    u32 report_size = (count_hot_spots + count_op_codes + 16) * 128;
+    char* report = (char*)malloc(report_size);
+    char* report_write = report;
+
+    //avoid dividing by zero if nothing ran
+    u64 total_cycles = (profiler->total_cycles > 0) ? profiler->total_cycles : 1;
+
+    report_write += sprintf(report_write, "NES PROFILER REPORT\n");
+    report_write += sprintf(report_write, "instructions: %llu cycles: %llu\n\n", profiler->total_instructions, profiler->total_cycles);
+
+    report_write += sprintf(report_write, "HOT SPOTS\n");
+    report_write += sprintf(report_write, " BANK | ADDR  | %-6s | %-12s | %-12s | %%CYC   | INSTR\n", "FLOW", "EXEC", "CYCLES");
+
+    for (u32 hot_spot_index = 0; hot_spot_index < count_hot_spots; ++hot_spot_index) {
+
+        u32 counter_index = hot_spot_indices[hot_spot_index];
+        NesProfilerCounter* counter = &profiler->pc_counters[counter_index];
+
+        i32 bank = 0;
+        nes_addr pc = 0;
+        nes_profiler_counter_address(profiler, counter_index, &bank, &pc);
+
+        nes_val instr_bytes[3];
+        nes_emulator_profiler_read_instr_bytes(emulator, bank, pc, instr_bytes);
+
+        char disasm_str[NES_CPU_DISASM_STR_SIZE];
+        nes_cpu_disasm_format(pc, instr_bytes, disasm_str);
+
+        char bank_str[8];
+        if (bank < 0) sprintf(bank_str, "--");
+        else          sprintf(bank_str, "%02X", bank);
+
+        //jump targets and block starts out of the static pass, a hot one is usually a loop head
+        const char* flow_str = "";
+#if NES_CDL
+        if (emulator->cpu.cdl && bank >= 0) {
+            u8 analysis_flags = nes_cdl_analysis_flags(emulator->cpu.cdl, pc);
+            if      (analysis_flags & NES_CDL_FLAG_JUMP_TARGET) flow_str = "target";
+            else if (analysis_flags & NES_CDL_FLAG_BLOCK_BEGIN) flow_str = "block";
+        }
+#endif
+
+        report_write += sprintf(report_write, " %-4s | $%04X | %-6s | %-12llu | %-12llu | %6.2f | %s\n",
+            bank_str,
+            pc,
+            flow_str,
+            counter->exec_count,
+            counter->cycle_count,
+            (100.0 * counter->cycle_count) / total_cycles,
+            disasm_str);
+    }
+
+    report_write += sprintf(report_write, "\nOP CODES\n");
+    report_write += sprintf(report_write, " OP | INSTR | MODE  | %-12s | %-12s | %%CYC\n", "EXEC", "CYCLES");
+
+    for (u32 op_code_index = 0; op_code_index < count_op_codes; ++op_code_index) {
+
+        nes_val op_code = (nes_val)op_code_indices[op_code_index];
+        NesProfilerCounter* counter = &profiler->op_code_counters[op_code];
+        NesCpuDisasmOpCode* disasm_op_code = nes_cpu_disasm_op_code(op_code);
+
+        report_write += sprintf(report_write, " %02X | %-5s | %-5s | %-12llu | %-12llu | %6.2f\n",
+            op_code,
+            disasm_op_code->mnemonic,
+            nes_cpu_disasm_address_mode_str(disasm_op_code->addr_mode),
+            counter->exec_count,
+            counter->cycle_count,
+            (100.0 * counter->cycle_count) / total_cycles);
+    }
+
+    NesEmulatorFileBuffer report_file_buffer = {0};
+    report_file_buffer.file_name = NES_PROFILER_REPORT_FILE_NAME;
+    report_file_buffer.file_buffer.buffer_size = (u64)(report_write - report);
+    report_file_buffer.file_buffer.buffer_contents = report;
+
+    emulator->platform_callbacks.open_and_write_to_file(&report_file_buffer);
+
+    free(report);
+}
+
+#endif
+
+
+#if NES_TIMELINE
+
+internal void
+nes_emulator_timeline_write(NesEmulator* emulator) {
+
+    NesEmulatorFileBuffer timeline_file_buffer = {0};
+    timeline_file_buffer.file_name   = NES_TIMELINE_FILE_NAME;
+    timeline_file_buffer.file_buffer = nes_timeline_export_chrome_trace();
+
+    emulator->platform_callbacks.open_and_write_to_file(&timeline_file_buffer);
+
+    free(timeline_file_buffer.file_buffer.buffer_contents);
+}
+
+#endif
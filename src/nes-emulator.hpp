@@ -2,7 +2,12 @@
 #define NES_EMULATOR_HPP
 
 #include "nes-types.h"
+#include "nes-timeline.cpp"
+#include "nes-log.cpp"
 #include "nes-cpu.cpp"
+#include "nes-cpu-threaded.cpp"
+#include "nes-cpu-batch.cpp"
+#include "nes-ppu.cpp"
 #include "nes-rom.cpp"
 
 struct NesEmulatorFileBuffer {
@@ -10,20 +15,90 @@ struct NesEmulatorFileBuffer {
     Buffer file_buffer;
 };
 
+#define NES_EMULATOR_SAVE_FILE_NAME_SIZE 260
+#define NES_EMULATOR_SAVE_FILE_EXTENSION ".sav"
+//the granularity we flush at, matches the os page size
+#define NES_EMULATOR_SAVE_FILE_PAGE_SIZE 0x1000
+#define NES_EMULATOR_SAVE_FILE_PAGES     (NES_MEM_MAP_SRAM_SIZE / NES_EMULATOR_SAVE_FILE_PAGE_SIZE)
+
+//battery backed sram lives on disk in a memory mapped file, memory is NULL when the cart has no battery
+struct NesEmulatorSaveFile {
+    char file_name[NES_EMULATOR_SAVE_FILE_NAME_SIZE];
+    nes_val* memory;
+    u32 size;
+    //whatever the platform has to hold on to until the file is unmapped
+    void* platform_file;
+    u64 pages_flushed;
+};
+
 typedef void (*file_read_callback)(NesEmulatorFileBuffer* file_buffer);
 typedef void (*file_close_callback)(NesEmulatorFileBuffer* file_buffer);
 typedef void (*file_write_callback)(NesEmulatorFileBuffer* file_buffer);
+typedef void (*save_file_map_callback)(NesEmulatorSaveFile* save_file);
+//asks the os to start writing back part of the mapping, this must not wait on the disk
+typedef void (*save_file_flush_callback)(NesEmulatorSaveFile* save_file, u32 offset, u32 size);
+//writes back everything that's left and waits for it
+typedef void (*save_file_unmap_callback)(NesEmulatorSaveFile* save_file);
 
 struct NesEmulatorPlatformCallbacks {
     file_read_callback open_and_read_file;
     file_close_callback close_and_free_file;
     file_write_callback open_and_write_to_file;
+    save_file_map_callback map_save_file;
+    save_file_flush_callback flush_save_file;
+    save_file_unmap_callback unmap_save_file;
+};
+
+//everything a frame can change, prg rom and the frame buffer are left out on purpose
+//so saving and restoring is a handful of small copies
+struct NesEmulatorSnapshot {
+    NesCpuRegisters registers;
+    NesCpuInstruction current_instr;
+    u64 cycle_count;
+    u64 instruction_count;
+    NesCpuIdleLoop idle_loop;
+    u8 interrupts_pending;
+    NesMemoryMapRam ram;
+    NesMemoryMapIoRegisters io_registers;
+    u8 expansion_rom[NES_MEM_MAP_EXPANSION_ROM_SIZE];
+    u8 sram[NES_MEM_MAP_SRAM_SIZE];
+    NesMemoryMapControllers controllers;
+    NesPpu ppu;
+    u64 frame_count;
+    //which state hash update this was taken after
+    u64 state_hash_count_updates;
+};
+
+#define NES_EMULATOR_RUN_AHEAD_MAX_FRAMES 4
+
+#define NES_EMULATOR_STATE_HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+//hash of the whole machine, rebuilt at the end of every update from just the pages written since the last one
+struct NesEmulatorStateHash {
+    //the last hash of every dirty tracked page, indexed the same as NesMemoryMapPageTable::dirty
+    u64 page_hashes[NES_MEM_MAP_PAGE_COUNT];
+    //the page hashes xor'd together, a rehashed page swaps its old hash out
+    u64 pages_hash;
+    u64 hash;
+    u64 count_updates;
+    u64 pages_rehashed;
 };
 
 struct NesEmulator {
     NesCpu cpu;
+    NesPpu ppu;
     NesRom rom;
     NesEmulatorPlatformCallbacks platform_callbacks;
+    //the platform layer drains this on its own thread into a file that stays open
+    NesLog* log;
+    NesEmulatorSaveFile save_file;
+    //the code/data log, mapped next to the rom the same way as the save file
+    NesEmulatorSaveFile cdl_file;
+    u64 frame_count;
+    //frames emulated past the real one each update, 0 turns run-ahead off
+    u32 run_ahead_frames;
+    NesEmulatorSnapshot run_ahead_snapshot;
+    NesEmulatorStateHash state_hash;
 };
 
 
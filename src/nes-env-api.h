@@ -0,0 +1,44 @@
+#ifndef NES_ENV_API_H
+#define NES_ENV_API_H
+
+//c interface for stepping a batch of emulators at once, nes-linux-env.cpp builds it as a shared library
+//every array holds one entry per instance, back to back, and is owned by the caller
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct NesEnvHandle NesEnvHandle;
+
+//count_threads includes the thread calling nes_env_step, 0 uses every core
+NesEnvHandle* nes_env_open(const char* rom_path, unsigned int count_instances, unsigned int count_threads);
+void          nes_env_close(NesEnvHandle* env);
+
+//frames start out as one nes palette index per pixel, 256 x 240, this switches them to grayscale
+//averaged down to width x height (84 x 84, 128 x 120, ...) as they're drawn, 0 x 0 switches back
+//max_pool keeps the brighter of the last two frames of every step for each pixel
+void nes_env_set_observation(NesEnvHandle* env, unsigned int width, unsigned int height, int max_pool);
+
+//bytes per instance
+unsigned int nes_env_frame_observation_size(NesEnvHandle* env);
+unsigned int nes_env_ram_observation_size(void);
+
+//puts an instance back to the state it powered on in
+void nes_env_reset(NesEnvHandle* env, unsigned int instance_index);
+
+//runs count_frames frames on every instance with its controller 1 buttons held
+//(a, b, select, start, up, down, left, right from bit 0), then writes the last frame and ram out,
+//buttons can be NULL for no input and either observation can be NULL to skip it
+void nes_env_step(NesEnvHandle* env,
+                  const unsigned char* buttons,
+                  unsigned int count_frames,
+                  unsigned char* frame_observations,
+                  unsigned char* ram_observations);
+
+unsigned long long nes_env_state_hash(NesEnvHandle* env, unsigned int instance_index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //NES_ENV_API_H
@@ -0,0 +1,225 @@
+#include "nes-env.hpp"
+
+internal NesEnv
+nes_env_create_and_initialize(char* rom_path, u32 count_instances, NesEmulatorPlatformCallbacks platform_callbacks) {
+
+    NesEnv env = {0};
+
+    //the rom is loaded once and shared, it never changes
+    env.power_on = nes_emulator_create_and_initialize(rom_path, platform_callbacks);
+
+    //only needed for the gray shades of reduced observations
+    nes_palette_initialize();
+
+    env.power_on_snapshot = (NesEmulatorSnapshot*)malloc(sizeof(NesEmulatorSnapshot));
+    nes_emulator_snapshot_save(&env.power_on, env.power_on_snapshot);
+
+    env.count_instances = count_instances;
+    env.instances       = (NesEmulator*)malloc(count_instances * sizeof(NesEmulator));
+    for (u32 instance_index = 0; instance_index < count_instances; ++instance_index) {
+        env.instances[instance_index] = nes_emulator_create_copy(&env.power_on);
+        //a fresh instance reports the same power on hash a reset one does
+        nes_emulator_state_hash_update(&env.instances[instance_index]);
+    }
+
+    return env;
+}
+
+internal void
+nes_env_destroy(NesEnv* env) {
+
+    for (u32 instance_index = 0; instance_index < env->count_instances; ++instance_index) {
+        nes_emulator_destroy_copy(&env->instances[instance_index]);
+    }
+    free(env->instances);
+    free(env->power_on_snapshot);
+    free(env->observations);
+
+    //nothing ever drains the power on machine's log, and it's never run
+    NesEmulator* power_on = &env->power_on;
+#if NES_CDL
+    nes_emulator_cdl_close(power_on);
+#endif
+    nes_log_destroy(power_on->log);
+    nes_cpu_destroy_and_free_debug_info(&power_on->cpu);
+    nes_ppu_destroy(&power_on->ppu);
+    nes_rom_destroy(&power_on->rom);
+
+    *env = {0};
+}
+
+internal void
+nes_env_instance_reset(NesEnv* env, u32 instance_index) {
+
+    ASSERT(instance_index < env->count_instances);
+    NesEmulator* instance = &env->instances[instance_index];
+
+    nes_emulator_snapshot_restore(instance, env->power_on_snapshot);
+
+    //the hash is only brought up to date at the end of a frame, a reset has to do it itself
+    nes_emulator_state_hash_update(instance);
+}
+
+//width or height of 0 goes back to full size palette indices, anything else gets drawn as a grayscale
+//frame averaged down to width x height, which has to fit in 256 x 240
+internal void
+nes_env_observation_set(NesEnv* env, u32 width, u32 height, b32 max_pool) {
+
+    free(env->observations);
+    env->observations         = NULL;
+    env->observation_width    = 0;
+    env->observation_height   = 0;
+    env->observation_max_pool = FALSE;
+
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    ASSERT(width <= NES_PPU_FRAME_BUFFER_WIDTH && height <= NES_PPU_FRAME_BUFFER_HEIGHT);
+
+    env->observation_width    = width;
+    env->observation_height   = height;
+    env->observation_max_pool = max_pool;
+
+    //every instance gets its own, the row sums are only good for the frame being drawn
+    env->observations = (NesPpuObservation*)malloc(env->count_instances * sizeof(NesPpuObservation));
+    for (u32 instance_index = 0; instance_index < env->count_instances; ++instance_index) {
+        NesPpuObservation* observation = &env->observations[instance_index];
+        nes_ppu_observation_initialize(observation, width, height, NULL);
+        nes_palette_observation_initialize(observation);
+    }
+}
+
+internal u32
+nes_env_observation_frame_size(NesEnv* env) {
+
+    return (env->observations)
+        ? env->observation_width * env->observation_height
+        : NES_ENV_FRAME_OBSERVATION_SIZE;
+}
+
+//holds buttons down on controller 1 and points the ppu at the caller's memory for the step,
+//returns the instance's own frame buffer for nes_env_instance_step_end to put back
+internal u8*
+nes_env_instance_step_begin(NesEnv* env, u32 instance_index, nes_val buttons, u8* frame_observation) {
+
+    ASSERT(instance_index < env->count_instances);
+    NesEmulator* instance = &env->instances[instance_index];
+
+    nes_emulator_set_controller(instance, 0, buttons);
+
+    //the ppu draws into whatever it's pointed at, so point it at the caller's memory for the step
+    u8* frame_buffer = instance->ppu.frame_buffer;
+    if (frame_observation) {
+        if (env->observations) {
+            NesPpuObservation* observation = &env->observations[instance_index];
+            observation->pixels       = frame_observation;
+            observation->max_pool     = FALSE;
+            instance->ppu.observation = observation;
+        }
+        else {
+            instance->ppu.frame_buffer = frame_observation;
+        }
+    }
+
+    return frame_buffer;
+}
+
+internal void
+nes_env_instance_step_end(NesEnv* env, u32 instance_index, u8* frame_buffer, u8* ram_observation) {
+
+    NesEmulator* instance = &env->instances[instance_index];
+
+    instance->ppu.frame_buffer = frame_buffer;
+    instance->ppu.observation  = NULL;
+
+    if (ram_observation) {
+        memcpy(ram_observation, &instance->cpu.mem_map.ram, NES_ENV_RAM_OBSERVATION_SIZE);
+    }
+}
+
+//how many of the last frames of a step get drawn, max pooling needs two
+internal u32
+nes_env_step_count_frames_rendered(NesEnv* env, u32 count_frames, b32 observed) {
+
+    return (observed == TRUE && env->observations && env->observation_max_pool == TRUE && count_frames >= 2) ? 2 : 1;
+}
+
+//the first frame drawn lays the shades down, the second only brightens them
+internal void
+nes_env_step_frame_begin(NesEnv* env, u32 instance_index, u32 frame_index, u32 count_frames, u32 count_frames_rendered) {
+
+    if (env->observations && env->instances[instance_index].ppu.observation &&
+        frame_index + 1 == count_frames && count_frames_rendered == 2) {
+        env->observations[instance_index].max_pool = TRUE;
+    }
+}
+
+//runs count_frames frames holding buttons down on controller 1
+//the last frame is drawn straight into frame_observation and ram is copied out after it,
+//either can be NULL to skip it, and with no frame observation nothing gets drawn at all
+//max pooling draws the frame before the last one as well and keeps the brighter of the two
+internal void
+nes_env_instance_step(NesEnv* env, u32 instance_index, nes_val buttons, u32 count_frames, u8* frame_observation, u8* ram_observation) {
+
+    u8* frame_buffer = nes_env_instance_step_begin(env, instance_index, buttons, frame_observation);
+    u32 count_frames_rendered = nes_env_step_count_frames_rendered(env, count_frames, (frame_observation) ? TRUE : FALSE);
+
+    for (u32 frame_index = 0; frame_index < count_frames; ++frame_index) {
+
+        b32 render = (frame_observation && frame_index + count_frames_rendered >= count_frames) ? TRUE : FALSE;
+
+        nes_env_step_frame_begin(env, instance_index, frame_index, count_frames, count_frames_rendered);
+        nes_emulator_update_and_render(&env->instances[instance_index], render);
+    }
+
+    nes_env_instance_step_end(env, instance_index, frame_buffer, ram_observation);
+}
+
+//nes_env_instance_step for count_instances instances from first_instance on, all stepped together through the
+//batch cpu, the arrays hold one entry per instance for the whole env and any of them can be NULL
+internal void
+nes_env_instances_step(NesEnv* env,
+                       u32 first_instance,
+                       u32 count_instances,
+                       const u8* buttons,
+                       u32 count_frames,
+                       u8* frame_observations,
+                       u8* ram_observations) {
+
+    ASSERT(count_instances <= NES_CPU_BATCH_LANES && first_instance + count_instances <= env->count_instances);
+
+    u32 frame_observation_size = nes_env_observation_frame_size(env);
+
+    NesEmulator* instances[NES_CPU_BATCH_LANES];
+    u8* frame_buffers[NES_CPU_BATCH_LANES];
+
+    for (u32 lane = 0; lane < count_instances; ++lane) {
+        u32 instance_index = first_instance + lane;
+        instances[lane]     = &env->instances[instance_index];
+        frame_buffers[lane] = nes_env_instance_step_begin(env,
+            instance_index,
+            (buttons) ? buttons[instance_index] : 0,
+            (frame_observations) ? &frame_observations[instance_index * frame_observation_size] : NULL);
+    }
+
+    u32 count_frames_rendered = nes_env_step_count_frames_rendered(env, count_frames, (frame_observations) ? TRUE : FALSE);
+
+    for (u32 frame_index = 0; frame_index < count_frames; ++frame_index) {
+
+        b32 render = (frame_observations && frame_index + count_frames_rendered >= count_frames) ? TRUE : FALSE;
+
+        for (u32 lane = 0; lane < count_instances; ++lane) {
+            nes_env_step_frame_begin(env, first_instance + lane, frame_index, count_frames, count_frames_rendered);
+        }
+        nes_emulator_update_and_render_batch(instances, count_instances, render);
+    }
+
+    for (u32 lane = 0; lane < count_instances; ++lane) {
+        u32 instance_index = first_instance + lane;
+        nes_env_instance_step_end(env,
+            instance_index,
+            frame_buffers[lane],
+            (ram_observations) ? &ram_observations[instance_index * NES_ENV_RAM_OBSERVATION_SIZE] : NULL);
+    }
+}
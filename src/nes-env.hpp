@@ -0,0 +1,29 @@
+#ifndef NES_ENV_HPP
+#define NES_ENV_HPP
+
+#include "nes-types.h"
+#include "nes-emulator.cpp"
+#include "nes-palette.cpp"
+
+//what one step hands back per instance, packed back to back in the caller's arrays
+//frames are full size palette indices unless a reduced observation has been set
+#define NES_ENV_FRAME_OBSERVATION_SIZE NES_PPU_FRAME_BUFFER_SIZE
+#define NES_ENV_RAM_OBSERVATION_SIZE   sizeof(NesMemoryMapRam)
+
+//a batch of machines all running the same rom, made for stepping from a thread pool
+//every instance is only ever touched by whoever is stepping it, so they can run in any order
+struct NesEnv {
+    //the machine everything was copied from, it never runs and is what a reset goes back to
+    NesEmulator power_on;
+    NesEmulatorSnapshot* power_on_snapshot;
+    NesEmulator* instances;
+    u32 count_instances;
+    //one per instance once a reduced observation has been set, NULL for full size frames
+    NesPpuObservation* observations;
+    u32 observation_width;
+    u32 observation_height;
+    //the last two frames of a step get max pooled together
+    b32 observation_max_pool;
+};
+
+#endif //NES_ENV_HPP
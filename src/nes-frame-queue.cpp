@@ -0,0 +1,65 @@
+#include "nes-frame-queue.hpp"
+
+internal NesFrameQueue*
+nes_frame_queue_create_and_initialize() {
+
+    //all the frame buffers are allocated up front, nothing gets allocated per frame
+    NesFrameQueue* queue = (NesFrameQueue*)malloc(sizeof(NesFrameQueue));
+    memset(queue, 0, sizeof(NesFrameQueue));
+
+    return queue;
+}
+
+internal void
+nes_frame_queue_destroy(NesFrameQueue* queue) {
+
+    free(queue);
+}
+
+//producer side, returns the next free frame or NULL if the consumer is behind
+internal NesFrameQueueFrame*
+nes_frame_queue_write_begin(NesFrameQueue* queue) {
+
+    u32 write_index = queue->write_index;
+    u32 read_index  = AtomicLoadAcquireU32(&queue->read_index);
+
+    if ((write_index - read_index) == NES_FRAME_QUEUE_SIZE) {
+        ++queue->frames_dropped;
+        return NULL;
+    }
+
+    return &queue->frames[write_index & NES_FRAME_QUEUE_MASK];
+}
+
+//producer side, hands the frame from write_begin over to the consumer
+internal void
+nes_frame_queue_write_end(NesFrameQueue* queue) {
+
+    AtomicStoreReleaseU32(&queue->write_index, queue->write_index + 1);
+}
+
+//consumer side, returns the newest frame or NULL if there is nothing new
+//anything older than the newest frame is skipped, we only ever want to show the latest
+internal NesFrameQueueFrame*
+nes_frame_queue_read_begin_latest(NesFrameQueue* queue) {
+
+    u32 read_index  = queue->read_index;
+    u32 write_index = AtomicLoadAcquireU32(&queue->write_index);
+
+    if (write_index == read_index) {
+        return NULL;
+    }
+
+    //the producer can't touch this frame until we move the read index past it
+    queue->read_latest_index = write_index - 1;
+    queue->frames_skipped   += queue->read_latest_index - read_index;
+
+    return &queue->frames[queue->read_latest_index & NES_FRAME_QUEUE_MASK];
+}
+
+//consumer side, gives the frame from read_begin_latest and everything before it back to the producer
+internal void
+nes_frame_queue_read_end(NesFrameQueue* queue) {
+
+    AtomicStoreReleaseU32(&queue->read_index, queue->read_latest_index + 1);
+}
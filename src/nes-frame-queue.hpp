@@ -0,0 +1,34 @@
+#ifndef NES_FRAME_QUEUE_HPP
+#define NES_FRAME_QUEUE_HPP
+
+#include "nes-types.h"
+#include "nes-ppu.hpp"
+
+//has to be a power of 2 so the indices can wrap freely
+#define NES_FRAME_QUEUE_SIZE 4
+#define NES_FRAME_QUEUE_MASK (NES_FRAME_QUEUE_SIZE - 1)
+
+struct NesFrameQueueFrame {
+    u64 frame_number;
+    u8 frame_buffer[NES_PPU_FRAME_BUFFER_SIZE];
+    u8 row_emphasis[NES_PPU_FRAME_BUFFER_HEIGHT];
+};
+
+//single producer (emulation) single consumer (presentation) ring of frame buffers
+//the producer never waits, if the ring is full the new frame is dropped
+struct NesFrameQueue {
+    NesFrameQueueFrame frames[NES_FRAME_QUEUE_SIZE];
+
+    //only written by the producer
+    volatile u32 write_index;
+    u64 frames_dropped;
+    u8 producer_padding[CACHE_LINE_SIZE];
+
+    //only written by the consumer
+    volatile u32 read_index;
+    u32 read_latest_index;
+    u64 frames_skipped;
+    u8 consumer_padding[CACHE_LINE_SIZE];
+};
+
+#endif //NES_FRAME_QUEUE_HPP
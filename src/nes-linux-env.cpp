@@ -0,0 +1,279 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "nes-linux-io.cpp"
+#include "nes-env.cpp"
+#include "nes-env-api.h"
+
+//build as a shared library with the debug strings off:
+//g++ -O2 -w -shared -fPIC -fvisibility=hidden -DNES_CPU_DEBUG_LOG=0 nes-linux-env.cpp -o libnes-env.so
+
+#define NES_LINUX_ENV_API extern "C" __attribute__((visibility("default")))
+
+#define NES_LINUX_ENV_MAX_THREADS 256
+
+//what the current step asked for, the workers read it once they've been woken up
+struct NesLinuxEnvStep {
+    const u8* buttons;
+    u32 count_frames;
+    u8* frame_observations;
+    u8* ram_observations;
+};
+
+//the workers sleep on work_ready between steps, and the instances get handed out a batch cpu's worth at a
+//time off next_instance so a slow batch doesn't hold up a whole slice of the env
+struct NesLinuxEnvThreadPool {
+    pthread_t threads[NES_LINUX_ENV_MAX_THREADS];
+    u32 count_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    //bumped for every step, a worker runs once for every generation it sees
+    u32 generation;
+    u32 count_threads_done;
+    b32 running;
+    volatile u32 next_instance;
+};
+
+struct NesEnvHandle {
+    NesEnv env;
+    NesLinuxEnvStep step;
+    NesLinuxEnvThreadPool pool;
+};
+
+internal void
+nes_linux_env_read_file(NesEmulatorFileBuffer* file_buffer) {
+
+    file_buffer->file_buffer = nes_linux_io_open_and_read_file(file_buffer->file_name);
+}
+
+internal void
+nes_linux_env_free_file(NesEmulatorFileBuffer* file_buffer) {
+
+    nes_linux_io_destroy_file_info(file_buffer->file_buffer);
+}
+
+internal void
+nes_linux_env_write_file(NesEmulatorFileBuffer* file_buffer) {
+
+    nes_linux_io_open_and_write_file(file_buffer->file_name, file_buffer->file_buffer.buffer_contents, (u32)file_buffer->file_buffer.buffer_size);
+}
+
+//thousands of instances can't share one save file, so nothing gets mapped and sram starts out empty
+internal void
+nes_linux_env_map_save_file(NesEmulatorSaveFile* save_file) {
+
+    save_file->memory = NULL;
+}
+
+internal void
+nes_linux_env_flush_save_file(NesEmulatorSaveFile* save_file, u32 offset, u32 size) {
+}
+
+internal void
+nes_linux_env_unmap_save_file(NesEmulatorSaveFile* save_file) {
+}
+
+/***************
+ * THREAD POOL *
+ ***************/
+
+//every thread, the caller included, takes instances a batch cpu's worth at a time until there are none left
+internal void
+nes_linux_env_run_instances(NesEnvHandle* handle) {
+
+    NesEnv* env = &handle->env;
+    NesLinuxEnvStep* step = &handle->step;
+
+    for (;;) {
+
+        u32 first_instance = AtomicAddU32(&handle->pool.next_instance, NES_CPU_BATCH_LANES);
+        if (first_instance >= env->count_instances) {
+            break;
+        }
+
+        u32 count_instances = env->count_instances - first_instance;
+        if (count_instances > NES_CPU_BATCH_LANES) {
+            count_instances = NES_CPU_BATCH_LANES;
+        }
+
+        nes_env_instances_step(env,
+            first_instance,
+            count_instances,
+            step->buttons,
+            step->count_frames,
+            step->frame_observations,
+            step->ram_observations);
+    }
+}
+
+internal void*
+nes_linux_env_worker(void* parameter) {
+
+    NesEnvHandle* handle = (NesEnvHandle*)parameter;
+    NesLinuxEnvThreadPool* pool = &handle->pool;
+
+    u32 generation = 0;
+
+    for (;;) {
+
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->running == TRUE && pool->generation == generation) {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        }
+        if (pool->running != TRUE) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        nes_linux_env_run_instances(handle);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (++pool->count_threads_done == pool->count_threads) {
+            pthread_cond_signal(&pool->work_done);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return NULL;
+}
+
+internal void
+nes_linux_env_thread_pool_start(NesEnvHandle* handle, u32 count_threads) {
+
+    NesLinuxEnvThreadPool* pool = &handle->pool;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    pool->running       = TRUE;
+    pool->count_threads = 0;
+
+    for (u32 thread_index = 0; thread_index < count_threads && thread_index < NES_LINUX_ENV_MAX_THREADS; ++thread_index) {
+        if (pthread_create(&pool->threads[thread_index], NULL, nes_linux_env_worker, handle) != 0) {
+            break;
+        }
+        ++pool->count_threads;
+    }
+}
+
+internal void
+nes_linux_env_thread_pool_stop(NesEnvHandle* handle) {
+
+    NesLinuxEnvThreadPool* pool = &handle->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->running = FALSE;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (u32 thread_index = 0; thread_index < pool->count_threads; ++thread_index) {
+        pthread_join(pool->threads[thread_index], NULL);
+    }
+
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+/*******
+ * API *
+ *******/
+
+NES_LINUX_ENV_API NesEnvHandle*
+nes_env_open(const char* rom_path, unsigned int count_instances, unsigned int count_threads) {
+
+    NesEmulatorPlatformCallbacks platform_callbacks = {0};
+    platform_callbacks.open_and_read_file     = nes_linux_env_read_file;
+    platform_callbacks.close_and_free_file    = nes_linux_env_free_file;
+    platform_callbacks.open_and_write_to_file = nes_linux_env_write_file;
+    platform_callbacks.map_save_file          = nes_linux_env_map_save_file;
+    platform_callbacks.flush_save_file        = nes_linux_env_flush_save_file;
+    platform_callbacks.unmap_save_file        = nes_linux_env_unmap_save_file;
+
+    NesEnvHandle* handle = (NesEnvHandle*)malloc(sizeof(NesEnvHandle));
+    memset(handle, 0, sizeof(NesEnvHandle));
+
+    handle->env = nes_env_create_and_initialize((char*)rom_path, count_instances, platform_callbacks);
+
+    if (count_threads == 0) {
+        count_threads = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    //the thread calling step does its share, so it doesn't need a worker of its own
+    nes_linux_env_thread_pool_start(handle, (count_threads > 1) ? count_threads - 1 : 0);
+
+    return handle;
+}
+
+NES_LINUX_ENV_API void
+nes_env_close(NesEnvHandle* handle) {
+
+    nes_linux_env_thread_pool_stop(handle);
+    nes_env_destroy(&handle->env);
+    free(handle);
+}
+
+NES_LINUX_ENV_API void
+nes_env_set_observation(NesEnvHandle* handle, unsigned int width, unsigned int height, int max_pool) {
+
+    nes_env_observation_set(&handle->env, width, height, (max_pool) ? TRUE : FALSE);
+}
+
+NES_LINUX_ENV_API unsigned int
+nes_env_frame_observation_size(NesEnvHandle* handle) {
+
+    return nes_env_observation_frame_size(&handle->env);
+}
+
+NES_LINUX_ENV_API unsigned int
+nes_env_ram_observation_size(void) {
+
+    return (unsigned int)NES_ENV_RAM_OBSERVATION_SIZE;
+}
+
+NES_LINUX_ENV_API void
+nes_env_reset(NesEnvHandle* handle, unsigned int instance_index) {
+
+    nes_env_instance_reset(&handle->env, instance_index);
+}
+
+NES_LINUX_ENV_API void
+nes_env_step(NesEnvHandle* handle,
+             const unsigned char* buttons,
+             unsigned int count_frames,
+             unsigned char* frame_observations,
+             unsigned char* ram_observations) {
+
+    NesLinuxEnvThreadPool* pool = &handle->pool;
+
+    handle->step.buttons                = buttons;
+    handle->step.count_frames           = count_frames;
+    handle->step.frame_observations     = frame_observations;
+    handle->step.ram_observations       = ram_observations;
+
+    //the mutex publishes the step to the workers along with the new generation
+    pthread_mutex_lock(&pool->mutex);
+    pool->next_instance      = 0;
+    pool->count_threads_done = 0;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    nes_linux_env_run_instances(handle);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->count_threads_done < pool->count_threads) {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+NES_LINUX_ENV_API unsigned long long
+nes_env_state_hash(NesEnvHandle* handle, unsigned int instance_index) {
+
+    ASSERT(instance_index < handle->env.count_instances);
+    return nes_emulator_state_hash(&handle->env.instances[instance_index]);
+}
@@ -0,0 +1,376 @@
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include "nes-types.h"
+
+//we talk to the kernel directly, there's no liburing to lean on
+#define NES_LINUX_IO_URING_DEFAULT_ENTRIES 256
+
+enum NesLinuxIoUringOp {
+    io_read,
+    io_write
+};
+
+//one file read or write, the caller owns the memory and it can't move until complete is TRUE
+struct NesLinuxIoUringRequest {
+    NesLinuxIoUringOp op;
+    i32 file_descriptor;
+    b32 close_on_complete;
+    char* buffer;
+    u32 size;
+    u64 offset;
+    u32 bytes_done;
+    //0 on success, -errno otherwise
+    i32 result;
+    b32 complete;
+};
+
+struct NesLinuxIoUring {
+    //FALSE if the kernel said no, every request then runs synchronously
+    b32 available;
+    i32 ring_file_descriptor;
+
+    //submission ring, we own the tail and the kernel owns the head
+    u32* sq_head;
+    u32* sq_tail;
+    u32* sq_mask;
+    u32* sq_array;
+    u32 sq_entries;
+    struct io_uring_sqe* sqes;
+    u32 count_to_submit;
+
+    //completion ring, the kernel owns the tail and we own the head
+    u32* cq_head;
+    u32* cq_tail;
+    u32* cq_mask;
+    u32 cq_entries;
+    struct io_uring_cqe* cqes;
+
+    //never let more than cq_entries be in flight so completions can't overflow
+    u32 count_in_flight;
+
+    void* sq_ring_memory;
+    u64 sq_ring_size;
+    void* cq_ring_memory;
+    u64 cq_ring_size;
+    u64 sqes_size;
+};
+
+internal NesLinuxIoUring
+nes_linux_io_uring_create_and_initialize(u32 entries) {
+
+    NesLinuxIoUring ring = {0};
+    ring.available = FALSE;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring.ring_file_descriptor = (i32)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring.ring_file_descriptor < 0) {
+        return ring;
+    }
+
+    ring.sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(u32));
+    ring.cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    ring.sqes_size    = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    //newer kernels put both rings in one mapping
+    b32 single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) ? TRUE : FALSE;
+    if (single_mmap == TRUE) {
+        if (ring.cq_ring_size > ring.sq_ring_size) {
+            ring.sq_ring_size = ring.cq_ring_size;
+        }
+        ring.cq_ring_size = ring.sq_ring_size;
+    }
+
+    ring.sq_ring_memory = mmap(NULL, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_file_descriptor, IORING_OFF_SQ_RING);
+    ring.cq_ring_memory = (single_mmap == TRUE)
+        ? ring.sq_ring_memory
+        : mmap(NULL, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_file_descriptor, IORING_OFF_CQ_RING);
+    ring.sqes = (struct io_uring_sqe*)mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_file_descriptor, IORING_OFF_SQES);
+
+    if (ring.sq_ring_memory == MAP_FAILED || ring.cq_ring_memory == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        close(ring.ring_file_descriptor);
+        ring = {0};
+        ring.available = FALSE;
+        return ring;
+    }
+
+    u8* sq_ring = (u8*)ring.sq_ring_memory;
+    ring.sq_head    = (u32*)(sq_ring + params.sq_off.head);
+    ring.sq_tail    = (u32*)(sq_ring + params.sq_off.tail);
+    ring.sq_mask    = (u32*)(sq_ring + params.sq_off.ring_mask);
+    ring.sq_array   = (u32*)(sq_ring + params.sq_off.array);
+    ring.sq_entries = params.sq_entries;
+
+    u8* cq_ring = (u8*)ring.cq_ring_memory;
+    ring.cq_head    = (u32*)(cq_ring + params.cq_off.head);
+    ring.cq_tail    = (u32*)(cq_ring + params.cq_off.tail);
+    ring.cq_mask    = (u32*)(cq_ring + params.cq_off.ring_mask);
+    ring.cqes       = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+    ring.cq_entries = params.cq_entries;
+
+    ring.available = TRUE;
+
+    return ring;
+}
+
+internal void
+nes_linux_io_uring_destroy(NesLinuxIoUring* ring) {
+
+    if (ring->available == TRUE) {
+        munmap(ring->sqes, ring->sqes_size);
+        if (ring->cq_ring_memory != ring->sq_ring_memory) {
+            munmap(ring->cq_ring_memory, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring_memory, ring->sq_ring_size);
+        close(ring->ring_file_descriptor);
+    }
+
+    *ring = {0};
+}
+
+//hands everything queued so far to the kernel, optionally waiting for at least wait_count completions
+internal void
+nes_linux_io_uring_submit(NesLinuxIoUring* ring, u32 wait_count) {
+
+    if (ring->available != TRUE || (ring->count_to_submit == 0 && wait_count == 0)) {
+        return;
+    }
+
+    u32 flags = (wait_count > 0) ? IORING_ENTER_GETEVENTS : 0;
+    i32 submit_result = (i32)syscall(__NR_io_uring_enter, ring->ring_file_descriptor, ring->count_to_submit, wait_count, flags, NULL, 0);
+
+    if (submit_result >= 0) {
+        ring->count_to_submit -= (u32)submit_result;
+    }
+}
+
+internal void
+nes_linux_io_uring_request_finish(NesLinuxIoUringRequest* request, i32 result) {
+
+    request->result = result;
+
+    if (request->close_on_complete == TRUE) {
+        close(request->file_descriptor);
+        request->file_descriptor = -1;
+    }
+
+    //reads are null terminated like everything else that comes out of the io layer
+    if (request->op == NesLinuxIoUringOp::io_read && request->buffer) {
+        request->buffer[request->bytes_done] = '\0';
+    }
+
+    request->complete = TRUE;
+}
+
+//blocking fallback for when we couldn't get a ring
+internal void
+nes_linux_io_uring_request_run_synchronous(NesLinuxIoUringRequest* request) {
+
+    i32 result = 0;
+    while (request->bytes_done < request->size) {
+
+        ssize_t io_result = (request->op == NesLinuxIoUringOp::io_read)
+            ? pread(request->file_descriptor, request->buffer + request->bytes_done, request->size - request->bytes_done, request->offset + request->bytes_done)
+            : pwrite(request->file_descriptor, request->buffer + request->bytes_done, request->size - request->bytes_done, request->offset + request->bytes_done);
+
+        if (io_result <= 0) {
+            result = (io_result < 0) ? -1 : 0;
+            break;
+        }
+        request->bytes_done += (u32)io_result;
+    }
+
+    nes_linux_io_uring_request_finish(request, result);
+}
+
+internal u32 nes_linux_io_uring_complete(NesLinuxIoUring* ring, u32 wait_count);
+
+//queues whatever is left of the request, short reads and writes come back through here
+internal void
+nes_linux_io_uring_queue(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request) {
+
+    //make room, first in the completion ring then in the submission ring
+    while (ring->count_in_flight >= ring->cq_entries) {
+        nes_linux_io_uring_complete(ring, 1);
+    }
+
+    u32 sq_tail = *ring->sq_tail;
+    if (sq_tail - AtomicLoadAcquireU32(ring->sq_head) == ring->sq_entries) {
+        nes_linux_io_uring_submit(ring, 0);
+        ASSERT(sq_tail - AtomicLoadAcquireU32(ring->sq_head) < ring->sq_entries);
+    }
+
+    u32 sq_index = sq_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[sq_index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    sqe->opcode    = (request->op == NesLinuxIoUringOp::io_read) ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd        = request->file_descriptor;
+    sqe->addr      = (u64)(request->buffer + request->bytes_done);
+    sqe->len       = request->size - request->bytes_done;
+    sqe->off       = request->offset + request->bytes_done;
+    sqe->user_data = (u64)request;
+
+    ring->sq_array[sq_index] = sq_index;
+    AtomicStoreReleaseU32(ring->sq_tail, sq_tail + 1);
+
+    ++ring->count_to_submit;
+    ++ring->count_in_flight;
+}
+
+//reaps finished requests, waits for at least wait_count of them, returns how many requests finished
+internal u32
+nes_linux_io_uring_complete(NesLinuxIoUring* ring, u32 wait_count) {
+
+    if (ring->available != TRUE) {
+        return 0;
+    }
+
+    u32 count_complete = 0;
+    for (;;) {
+
+        u32 cq_head = *ring->cq_head;
+        u32 cq_tail = AtomicLoadAcquireU32(ring->cq_tail);
+
+        for (; cq_head != cq_tail; ++cq_head) {
+
+            struct io_uring_cqe* cqe = &ring->cqes[cq_head & *ring->cq_mask];
+            NesLinuxIoUringRequest* request = (NesLinuxIoUringRequest*)cqe->user_data;
+            i32 cqe_result = cqe->res;
+
+            --ring->count_in_flight;
+
+            if (cqe_result > 0) {
+                request->bytes_done += (u32)cqe_result;
+            }
+
+            //a short transfer goes back in the ring, a read returning 0 means the file is shorter than we thought
+            if (cqe_result > 0 && request->bytes_done < request->size) {
+                AtomicStoreReleaseU32(ring->cq_head, cq_head + 1);
+                nes_linux_io_uring_queue(ring, request);
+                continue;
+            }
+
+            nes_linux_io_uring_request_finish(request, (cqe_result < 0) ? cqe_result : 0);
+            ++count_complete;
+        }
+
+        AtomicStoreReleaseU32(ring->cq_head, cq_head);
+
+        if (count_complete >= wait_count || ring->count_in_flight == 0) {
+            break;
+        }
+
+        nes_linux_io_uring_submit(ring, 1);
+    }
+
+    return count_complete;
+}
+
+internal void
+nes_linux_io_uring_begin(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request) {
+
+    request->bytes_done = 0;
+    request->result     = 0;
+    request->complete   = FALSE;
+
+    if (request->size == 0) {
+        nes_linux_io_uring_request_finish(request, 0);
+    }
+    else if (ring->available == TRUE) {
+        nes_linux_io_uring_queue(ring, request);
+    }
+    else {
+        nes_linux_io_uring_request_run_synchronous(request);
+    }
+}
+
+//opens the file and queues a read of the whole thing into a new null terminated buffer
+internal b32
+nes_linux_io_uring_read_file_begin(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request, char* file_name) {
+
+    memset(request, 0, sizeof(NesLinuxIoUringRequest));
+    request->op = NesLinuxIoUringOp::io_read;
+
+    //the open and the size are cheap metadata calls, only the data goes through the ring
+    request->file_descriptor = open(file_name, O_RDONLY);
+    if (request->file_descriptor < 0) {
+        request->result   = -1;
+        request->complete = TRUE;
+        return FALSE;
+    }
+
+    struct stat file_stat;
+    fstat(request->file_descriptor, &file_stat);
+
+    request->close_on_complete = TRUE;
+    request->size              = (u32)file_stat.st_size;
+    request->buffer            = (char*)malloc(request->size + 1);
+
+    nes_linux_io_uring_begin(ring, request);
+
+    return TRUE;
+}
+
+//opens (and truncates) the file and queues a write of the whole buffer, the buffer has to outlive the request
+internal b32
+nes_linux_io_uring_write_file_begin(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request, char* file_name, char* data, u32 data_size) {
+
+    memset(request, 0, sizeof(NesLinuxIoUringRequest));
+    request->op = NesLinuxIoUringOp::io_write;
+
+    request->file_descriptor = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (request->file_descriptor < 0) {
+        request->result   = -1;
+        request->complete = TRUE;
+        return FALSE;
+    }
+
+    request->close_on_complete = TRUE;
+    request->buffer            = data;
+    request->size              = data_size;
+
+    nes_linux_io_uring_begin(ring, request);
+
+    return TRUE;
+}
+
+//queues a write into a file the caller already has open, lets many writes share one file
+internal void
+nes_linux_io_uring_write_begin(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request, i32 file_descriptor, char* data, u32 data_size, u64 offset) {
+
+    memset(request, 0, sizeof(NesLinuxIoUringRequest));
+    request->op              = NesLinuxIoUringOp::io_write;
+    request->file_descriptor = file_descriptor;
+    request->buffer          = data;
+    request->size            = data_size;
+    request->offset          = offset;
+
+    nes_linux_io_uring_begin(ring, request);
+}
+
+//submits and blocks until nothing is left in flight
+internal void
+nes_linux_io_uring_wait_all(NesLinuxIoUring* ring) {
+
+    nes_linux_io_uring_submit(ring, 0);
+    while (ring->count_in_flight > 0) {
+        nes_linux_io_uring_complete(ring, ring->count_in_flight);
+    }
+}
+
+internal void
+nes_linux_io_uring_wait(NesLinuxIoUring* ring, NesLinuxIoUringRequest* request) {
+
+    nes_linux_io_uring_submit(ring, 0);
+    while (request->complete != TRUE) {
+        nes_linux_io_uring_complete(ring, 1);
+    }
+}
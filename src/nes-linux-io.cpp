@@ -0,0 +1,144 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdlib.h>
+#include "nes-types.h"
+
+internal void
+nes_linux_io_open_and_write_file(char* file_name, char* write_str, u32 write_str_size) {
+
+    //same behavior as the win32 layer, open always and write from the start of the file
+    i32 file_descriptor = open(file_name, O_WRONLY | O_CREAT, 0644);
+    ASSERT(file_descriptor >= 0);
+
+    u32 bytes_written = 0;
+    while (bytes_written < write_str_size) {
+        ssize_t write_result = pwrite(file_descriptor, write_str + bytes_written, write_str_size - bytes_written, bytes_written);
+        ASSERT(write_result > 0);
+        bytes_written += (u32)write_result;
+    }
+
+    //close the file
+    close(file_descriptor);
+}
+
+//the file stays open for the whole session, it starts out empty
+internal i32
+nes_linux_io_open_file_for_append(char* file_name) {
+
+    i32 file_descriptor = open(file_name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    ASSERT(file_descriptor >= 0);
+
+    return file_descriptor;
+}
+
+internal void
+nes_linux_io_append_file(i32 file_descriptor, char* data, u32 data_size) {
+
+    u32 bytes_written = 0;
+    while (bytes_written < data_size) {
+        ssize_t write_result = write(file_descriptor, data + bytes_written, data_size - bytes_written);
+        ASSERT(write_result > 0);
+        bytes_written += (u32)write_result;
+    }
+}
+
+//for files written at known offsets, it starts out empty
+internal i32
+nes_linux_io_open_file_for_write(char* file_name) {
+
+    return open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+internal void
+nes_linux_io_write_file_at(i32 file_descriptor, u64 offset, char* data, u32 data_size) {
+
+    u32 bytes_written = 0;
+    while (bytes_written < data_size) {
+        ssize_t write_result = pwrite(file_descriptor, data + bytes_written, data_size - bytes_written, offset + bytes_written);
+        ASSERT(write_result > 0);
+        bytes_written += (u32)write_result;
+    }
+}
+
+internal void
+nes_linux_io_close_file(i32 file_descriptor) {
+
+    close(file_descriptor);
+}
+
+//maps the file shared so writes to the memory are writes to the file, it's grown to size if it's new or short
+internal nes_val*
+nes_linux_io_map_file(char* file_name, u32 size) {
+
+    i32 file_descriptor = open(file_name, O_RDWR | O_CREAT, 0644);
+    if (file_descriptor < 0) {
+        return NULL;
+    }
+
+    struct stat file_stat;
+    fstat(file_descriptor, &file_stat);
+    if ((u64)file_stat.st_size < size && ftruncate(file_descriptor, size) != 0) {
+        close(file_descriptor);
+        return NULL;
+    }
+
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+
+    //the mapping keeps the file alive
+    close(file_descriptor);
+
+    return (memory == MAP_FAILED) ? NULL : (nes_val*)memory;
+}
+
+//offset has to be page aligned
+internal void
+nes_linux_io_flush_mapped_file(nes_val* memory, u32 offset, u32 size, b32 wait) {
+
+    msync(memory + offset, size, (wait == TRUE) ? MS_SYNC : MS_ASYNC);
+}
+
+internal void
+nes_linux_io_unmap_file(nes_val* memory, u32 size) {
+
+    nes_linux_io_flush_mapped_file(memory, 0, size, TRUE);
+    munmap(memory, size);
+}
+
+internal Buffer
+nes_linux_io_open_and_read_file(char* file_name) {
+
+    Buffer file_buffer = {0};
+
+    i32 file_descriptor = open(file_name, O_RDONLY);
+    ASSERT(file_descriptor >= 0);
+
+    //get the file size and create a buffer
+    struct stat file_stat;
+    fstat(file_descriptor, &file_stat);
+    file_buffer.buffer_size = file_stat.st_size + 1;
+    file_buffer.buffer_contents = (char*)malloc(sizeof(char) * file_buffer.buffer_size);
+
+    //read the file into a null terminated buffer
+    u64 bytes_read = 0;
+    while (bytes_read < (u64)file_stat.st_size) {
+        ssize_t read_result = pread(file_descriptor, file_buffer.buffer_contents + bytes_read, file_stat.st_size - bytes_read, bytes_read);
+        ASSERT(read_result > 0);
+        bytes_read += (u64)read_result;
+    }
+
+    file_buffer.buffer_contents[file_buffer.buffer_size - 1] = '\0';
+
+    //close the file
+    close(file_descriptor);
+
+    return (file_buffer);
+}
+
+internal void
+nes_linux_io_destroy_file_info(Buffer file_buffer) {
+    if (file_buffer.buffer_contents != NULL) {
+        free(file_buffer.buffer_contents);
+    }
+}
@@ -0,0 +1,1057 @@
+#include <time.h>
+#include <pthread.h>
+#include "nes-linux-io.cpp"
+#include "nes-linux-io-uring.cpp"
+#include "nes-linux-perf.cpp"
+#include "nes-emulator.cpp"
+#include "nes-palette.cpp"
+
+#define NES_LINUX_MAIN_DEFAULT_FRAMES 600
+#define NES_LINUX_MAIN_PALETTE_BENCH_FRAMES 2000
+#define NES_LINUX_MAIN_IO_BENCH_FILE_NAME   "nes-io-bench-checkpoints.bin"
+#define NES_LINUX_MAIN_LOG_FILE_NAME        "nes-emulator-log.txt"
+//how long the log writer sleeps between flushes, everything logged in between goes out in one write
+#define NES_LINUX_MAIN_LOG_FLUSH_INTERVAL_NS 10000000
+#define NES_LINUX_MAIN_TRAP_PRINT_COUNT      8
+//chunks fill up a lot faster than log lines, so the trace writer checks in more often
+#define NES_LINUX_MAIN_TRACE_FLUSH_INTERVAL_NS 1000000
+
+//random starting states every op code gets run from by --cpu-op-check
+#define NES_LINUX_MAIN_CPU_OP_CHECK_STATES 2000
+//all of memory gets new random bytes this often, zero page and the stack every state
+#define NES_LINUX_MAIN_CPU_OP_CHECK_REFILL 64
+#define NES_LINUX_MAIN_CPU_OP_CHECK_SEED   0x9E3779B97F4A7C15
+//every lane copies the whole cpu each state, so the batch check gets through fewer of them
+#define NES_LINUX_MAIN_CPU_BATCH_CHECK_STATES 16
+
+struct NesLinuxMainArgs {
+    char* rom_path;
+    u32 count_frames;
+    b32 perf;
+    b32 perf_frames;
+    u32 run_ahead_frames;
+    b32 render;
+    b32 palette_bench;
+    u32 io_bench_count;
+    //-1 when not set, otherwise the address to stop on
+    i32 break_address;
+    i32 watch_address;
+    b32 hash_frames;
+    char* trace_path;
+    b32 cpu_check;
+    b32 cpu_op_check;
+};
+
+struct NesLinuxMainLogWriter {
+    pthread_t thread;
+    NesLog* log;
+    i32 file_descriptor;
+    volatile u32 running;
+};
+
+struct NesLinuxMainTraceWriter {
+    pthread_t thread;
+    NesTrace* trace;
+    i32 file_descriptor;
+    volatile u32 running;
+};
+
+//every file the platform layer touches goes through this ring
+global NesLinuxIoUring linux_main_io_uring;
+
+internal void 
+nes_linux_main_open_file_for_emulator(NesEmulatorFileBuffer* file_buffer) {
+
+    NesLinuxIoUringRequest request;
+    b32 open_result = nes_linux_io_uring_read_file_begin(&linux_main_io_uring, &request, file_buffer->file_name);
+    ASSERT(open_result == TRUE);
+    nes_linux_io_uring_wait(&linux_main_io_uring, &request);
+    ASSERT(request.result == 0);
+
+    file_buffer->file_buffer.buffer_contents = request.buffer;
+    file_buffer->file_buffer.buffer_size     = request.bytes_done + 1;
+}
+
+internal void
+nes_linux_main_open_and_write_buffer_to_file(NesEmulatorFileBuffer* file_buffer) {
+
+    NesLinuxIoUringRequest request;
+    b32 open_result = nes_linux_io_uring_write_file_begin(&linux_main_io_uring, &request, file_buffer->file_name, file_buffer->file_buffer.buffer_contents, file_buffer->file_buffer.buffer_size);
+    ASSERT(open_result == TRUE);
+    nes_linux_io_uring_wait(&linux_main_io_uring, &request);
+    ASSERT(request.result == 0);
+}
+
+internal void
+nes_linux_main_close_and_free_file_for_nes_emulator(NesEmulatorFileBuffer* file_buffer) {
+
+    nes_linux_io_destroy_file_info(file_buffer->file_buffer);
+}
+
+internal void
+nes_linux_main_map_save_file(NesEmulatorSaveFile* save_file) {
+
+    save_file->memory = nes_linux_io_map_file(save_file->file_name, save_file->size);
+}
+
+internal void
+nes_linux_main_flush_save_file(NesEmulatorSaveFile* save_file, u32 offset, u32 size) {
+
+    nes_linux_io_flush_mapped_file(save_file->memory, offset, size, FALSE);
+}
+
+internal void
+nes_linux_main_unmap_save_file(NesEmulatorSaveFile* save_file) {
+
+    nes_linux_io_unmap_file(save_file->memory, save_file->size);
+}
+
+internal u64
+nes_linux_main_timestamp() {
+
+    struct timespec time_spec;
+    clock_gettime(CLOCK_MONOTONIC, &time_spec);
+    return ((u64)time_spec.tv_sec * 1000000000) + (u64)time_spec.tv_nsec;
+}
+
+internal void
+nes_linux_main_log_write(void* context, char* data, u32 data_size) {
+
+    NesLinuxMainLogWriter* log_writer = (NesLinuxMainLogWriter*)context;
+    nes_linux_io_append_file(log_writer->file_descriptor, data, data_size);
+}
+
+internal void*
+nes_linux_main_log_writer_thread(void* thread_parameter) {
+
+    NesLinuxMainLogWriter* log_writer = (NesLinuxMainLogWriter*)thread_parameter;
+
+    struct timespec flush_interval = {0};
+    flush_interval.tv_nsec = NES_LINUX_MAIN_LOG_FLUSH_INTERVAL_NS;
+
+    while (AtomicLoadAcquireU32(&log_writer->running) == TRUE) {
+        nes_log_flush(log_writer->log, nes_linux_main_log_write, log_writer);
+        nanosleep(&flush_interval, NULL);
+    }
+
+    //whatever was logged before shutdown still makes it out
+    nes_log_flush(log_writer->log, nes_linux_main_log_write, log_writer);
+
+    return NULL;
+}
+
+internal void
+nes_linux_main_log_writer_start(NesLinuxMainLogWriter* log_writer, NesLog* log) {
+
+    *log_writer = {0};
+    log_writer->log             = log;
+    log_writer->file_descriptor = nes_linux_io_open_file_for_append(NES_LINUX_MAIN_LOG_FILE_NAME);
+    log_writer->running         = TRUE;
+
+    i32 create_result = pthread_create(&log_writer->thread, NULL, nes_linux_main_log_writer_thread, log_writer);
+    ASSERT(create_result == 0);
+}
+
+internal void
+nes_linux_main_log_writer_stop(NesLinuxMainLogWriter* log_writer) {
+
+    AtomicStoreReleaseU32(&log_writer->running, FALSE);
+    pthread_join(log_writer->thread, NULL);
+    nes_linux_io_close_file(log_writer->file_descriptor);
+}
+
+#if NES_TRACE
+
+internal void
+nes_linux_main_trace_write(void* context, u64 offset, u8* data, u32 size) {
+
+    NesLinuxMainTraceWriter* trace_writer = (NesLinuxMainTraceWriter*)context;
+    nes_linux_io_write_file_at(trace_writer->file_descriptor, offset, (char*)data, size);
+}
+
+internal void*
+nes_linux_main_trace_writer_thread(void* thread_parameter) {
+
+    NesLinuxMainTraceWriter* trace_writer = (NesLinuxMainTraceWriter*)thread_parameter;
+
+    struct timespec flush_interval = {0};
+    flush_interval.tv_nsec = NES_LINUX_MAIN_TRACE_FLUSH_INTERVAL_NS;
+
+    while (AtomicLoadAcquireU32(&trace_writer->running) == TRUE) {
+        nes_trace_flush(trace_writer->trace, nes_linux_main_trace_write, trace_writer);
+        nanosleep(&flush_interval, NULL);
+    }
+
+    return NULL;
+}
+
+internal b32
+nes_linux_main_trace_writer_start(NesLinuxMainTraceWriter* trace_writer, char* trace_path) {
+
+    *trace_writer = {0};
+    trace_writer->file_descriptor = nes_linux_io_open_file_for_write(trace_path);
+    if (trace_writer->file_descriptor < 0) {
+        return FALSE;
+    }
+
+    trace_writer->trace   = nes_trace_create_and_initialize();
+    trace_writer->running = TRUE;
+    nes_trace_open_file(trace_writer->trace, nes_linux_main_trace_write, trace_writer);
+
+    i32 create_result = pthread_create(&trace_writer->thread, NULL, nes_linux_main_trace_writer_thread, trace_writer);
+    ASSERT(create_result == 0);
+
+    return TRUE;
+}
+
+//the cpu has to be done with the trace by now, what's left gets written out here along with the index
+internal void
+nes_linux_main_trace_writer_stop(NesLinuxMainTraceWriter* trace_writer, char* trace_path) {
+
+    AtomicStoreReleaseU32(&trace_writer->running, FALSE);
+    pthread_join(trace_writer->thread, NULL);
+
+    NesTrace* trace = trace_writer->trace;
+    nes_trace_finish(trace);
+    nes_trace_close_file(trace, nes_linux_main_trace_write, trace_writer);
+    nes_linux_io_close_file(trace_writer->file_descriptor);
+
+    printf("trace: %s (%llu instructions, %llu bytes, %.2f bytes/instruction, %llu chunks dropped)\n",
+        trace_path,
+        trace->count_records,
+        trace->bytes_written,
+        (trace->count_records > 0) ? (double)trace->bytes_written / (double)trace->count_records : 0.0,
+        trace->count_chunks_dropped);
+
+    nes_trace_destroy(trace);
+}
+
+#endif
+
+internal b32
+nes_linux_main_parse_args(i32 argc, char** argv, NesLinuxMainArgs* args) {
+
+    *args = {0};
+    args->count_frames = NES_LINUX_MAIN_DEFAULT_FRAMES;
+    args->render       = TRUE;
+    args->break_address = -1;
+    args->watch_address = -1;
+
+    for (i32 arg_index = 1; arg_index < argc; ++arg_index) {
+
+        char* arg = argv[arg_index];
+
+        if (strcmp(arg, "--frames") == 0 && arg_index + 1 < argc) {
+            args->count_frames = (u32)strtoul(argv[++arg_index], NULL, 10);
+        }
+        else if (strcmp(arg, "--run-ahead") == 0 && arg_index + 1 < argc) {
+            args->run_ahead_frames = (u32)strtoul(argv[++arg_index], NULL, 10);
+        }
+        else if (strcmp(arg, "--no-render") == 0) {
+            args->render = FALSE;
+        }
+        else if (strcmp(arg, "--io-bench") == 0 && arg_index + 1 < argc) {
+            args->io_bench_count = (u32)strtoul(argv[++arg_index], NULL, 10);
+        }
+        else if (strcmp(arg, "--break") == 0 && arg_index + 1 < argc) {
+            args->break_address = (i32)(strtoul(argv[++arg_index], NULL, 16) & 0xFFFF);
+        }
+        else if (strcmp(arg, "--watch") == 0 && arg_index + 1 < argc) {
+            args->watch_address = (i32)(strtoul(argv[++arg_index], NULL, 16) & 0xFFFF);
+        }
+        else if (strcmp(arg, "--hash-frames") == 0) {
+            args->hash_frames = TRUE;
+        }
+        else if (strcmp(arg, "--trace") == 0 && arg_index + 1 < argc) {
+            args->trace_path = argv[++arg_index];
+        }
+        else if (strcmp(arg, "--cpu-check") == 0) {
+            args->cpu_check = TRUE;
+        }
+        else if (strcmp(arg, "--cpu-op-check") == 0) {
+            args->cpu_op_check = TRUE;
+        }
+        else if (strcmp(arg, "--palette-bench") == 0) {
+            args->palette_bench = TRUE;
+        }
+        else if (strcmp(arg, "--perf") == 0) {
+            args->perf = TRUE;
+        }
+        else if (strcmp(arg, "--perf-frames") == 0) {
+            args->perf        = TRUE;
+            args->perf_frames = TRUE;
+        }
+        else if (args->rom_path == NULL) {
+            args->rom_path = arg;
+        }
+        else {
+            return FALSE;
+        }
+    }
+
+    //the palette benchmark and the op code check don't need a rom
+    return (args->rom_path != NULL || args->palette_bench == TRUE || args->cpu_op_check == TRUE) ? TRUE : FALSE;
+}
+
+//runs every palette kernel this cpu supports at every scale and checks them against scalar
+internal void
+nes_linux_main_palette_bench() {
+
+    nes_palette_initialize();
+
+    //every color index shows up in every row, and the emphasis cycles through all 8 palettes
+    u8* frame_buffer = (u8*)malloc(NES_PPU_FRAME_BUFFER_SIZE);
+    u8 row_emphasis[NES_PPU_FRAME_BUFFER_HEIGHT];
+    for (u32 row = 0; row < NES_PPU_FRAME_BUFFER_HEIGHT; ++row) {
+        row_emphasis[row] = (u8)(row % NES_PALETTE_EMPHASIS_COUNT);
+        for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; ++column) {
+            frame_buffer[(row * NES_PPU_FRAME_BUFFER_WIDTH) + column] = (u8)((column * 7) + row);
+        }
+    }
+
+    u32 max_pixels = NES_PPU_FRAME_BUFFER_SIZE * NES_PALETTE_MAX_SCALE * NES_PALETTE_MAX_SCALE;
+    nes_pixel* reference_pixels = (nes_pixel*)malloc(max_pixels * sizeof(nes_pixel));
+    nes_pixel* pixels           = (nes_pixel*)malloc(max_pixels * sizeof(nes_pixel));
+
+    NesPaletteKernel best_kernel = nes_palette_tables.kernel;
+
+    for (u32 scale = 1; scale <= NES_PALETTE_MAX_SCALE; ++scale) {
+
+        u32 count_pixels = NES_PPU_FRAME_BUFFER_SIZE * scale * scale;
+
+        nes_palette_set_kernel(NesPaletteKernel::scalar);
+        nes_palette_convert_frame(frame_buffer, row_emphasis, reference_pixels, scale);
+
+        for (u32 kernel = 0; kernel < NesPaletteKernel::kernel_count; ++kernel) {
+
+            if (nes_palette_set_kernel((NesPaletteKernel)kernel) != TRUE) {
+                printf("palette %-6s %ux: not supported\n", nes_palette_kernel_str((NesPaletteKernel)kernel), scale);
+                continue;
+            }
+
+            memset(pixels, 0, count_pixels * sizeof(nes_pixel));
+            nes_palette_convert_frame(frame_buffer, row_emphasis, pixels, scale);
+            b32 matches = (memcmp(pixels, reference_pixels, count_pixels * sizeof(nes_pixel)) == 0) ? TRUE : FALSE;
+
+            u64 timestamp_begin = nes_linux_main_timestamp();
+            for (u32 frame_index = 0; frame_index < NES_LINUX_MAIN_PALETTE_BENCH_FRAMES; ++frame_index) {
+                nes_palette_convert_frame(frame_buffer, row_emphasis, pixels, scale);
+            }
+            u64 timestamp_end = nes_linux_main_timestamp();
+
+            double frame_us = (double)(timestamp_end - timestamp_begin) / (1000.0 * NES_LINUX_MAIN_PALETTE_BENCH_FRAMES);
+            printf("palette %-6s %ux: %8.2fus/frame %8.1fM output pixels/s %s\n",
+                nes_palette_kernel_str((NesPaletteKernel)kernel),
+                scale,
+                frame_us,
+                count_pixels / frame_us,
+                (matches == TRUE) ? "" : "MISMATCH");
+        }
+    }
+
+    nes_palette_set_kernel(best_kernel);
+
+    free(pixels);
+    free(reference_pixels);
+    free(frame_buffer);
+}
+
+internal void
+nes_linux_main_print_perf_sample(char* label, NesLinuxPerfCounters* counters, NesLinuxPerfSample* sample, double divisor) {
+
+    printf("%-22s", label);
+    for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+        if (nes_linux_perf_counter_available(counters, counter_type) == TRUE) {
+            printf(" %s: %.1f", nes_linux_perf_counter_name(counter_type), (double)sample->values[counter_type] / divisor);
+        }
+        else {
+            printf(" %s: n/a", nes_linux_perf_counter_name(counter_type));
+        }
+    }
+    printf("\n");
+}
+
+//reads the rom and checkpoints the emulator count times, batched through the ring and then one blocking call at a time
+internal void
+nes_linux_main_io_bench(NesEmulator* nes_emulator, char* rom_path, u32 count) {
+
+    NesLinuxIoUringRequest* requests = (NesLinuxIoUringRequest*)malloc(count * sizeof(NesLinuxIoUringRequest));
+
+    //batched rom reads
+    u64 timestamp_begin = nes_linux_main_timestamp();
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        nes_linux_io_uring_read_file_begin(&linux_main_io_uring, &requests[request_index], rom_path);
+    }
+    nes_linux_io_uring_submit(&linux_main_io_uring, 0);
+    u64 timestamp_submitted = nes_linux_main_timestamp();
+    nes_linux_io_uring_wait_all(&linux_main_io_uring);
+    u64 timestamp_end = nes_linux_main_timestamp();
+
+    u32 count_failed = 0;
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        if (requests[request_index].result != 0 || requests[request_index].bytes_done != requests[0].bytes_done) {
+            ++count_failed;
+        }
+        free(requests[request_index].buffer);
+    }
+    printf("io batch rom reads:    %u in %.3fms (%.3fms to queue and submit) failed: %u\n",
+        count, (timestamp_end - timestamp_begin) / 1000000.0, (timestamp_submitted - timestamp_begin) / 1000000.0, count_failed);
+
+    timestamp_begin = nes_linux_main_timestamp();
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        Buffer rom_buffer = nes_linux_io_open_and_read_file(rom_path);
+        nes_linux_io_destroy_file_info(rom_buffer);
+    }
+    timestamp_end = nes_linux_main_timestamp();
+    printf("io blocking rom reads: %u in %.3fms\n", count, (timestamp_end - timestamp_begin) / 1000000.0);
+
+    //batched checkpoints, every instance gets its own slot in one file
+    NesEmulatorSnapshot* snapshot = (NesEmulatorSnapshot*)malloc(sizeof(NesEmulatorSnapshot));
+    nes_emulator_snapshot_save(nes_emulator, snapshot);
+
+    i32 file_descriptor = open(NES_LINUX_MAIN_IO_BENCH_FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT(file_descriptor >= 0);
+
+    timestamp_begin = nes_linux_main_timestamp();
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        nes_linux_io_uring_write_begin(&linux_main_io_uring, &requests[request_index], file_descriptor, (char*)snapshot, sizeof(NesEmulatorSnapshot), (u64)request_index * sizeof(NesEmulatorSnapshot));
+    }
+    nes_linux_io_uring_submit(&linux_main_io_uring, 0);
+    timestamp_submitted = nes_linux_main_timestamp();
+    nes_linux_io_uring_wait_all(&linux_main_io_uring);
+    timestamp_end = nes_linux_main_timestamp();
+
+    count_failed = 0;
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        if (requests[request_index].result != 0) {
+            ++count_failed;
+        }
+    }
+    printf("io batch checkpoints:    %u x %u bytes in %.3fms (%.3fms to queue and submit) failed: %u\n",
+        count, (u32)sizeof(NesEmulatorSnapshot), (timestamp_end - timestamp_begin) / 1000000.0, (timestamp_submitted - timestamp_begin) / 1000000.0, count_failed);
+
+    timestamp_begin = nes_linux_main_timestamp();
+    for (u32 request_index = 0; request_index < count; ++request_index) {
+        pwrite(file_descriptor, snapshot, sizeof(NesEmulatorSnapshot), (u64)request_index * sizeof(NesEmulatorSnapshot));
+    }
+    timestamp_end = nes_linux_main_timestamp();
+    printf("io blocking checkpoints: %u x %u bytes in %.3fms\n", count, (u32)sizeof(NesEmulatorSnapshot), (timestamp_end - timestamp_begin) / 1000000.0);
+
+    close(file_descriptor);
+    unlink(NES_LINUX_MAIN_IO_BENCH_FILE_NAME);
+    free(snapshot);
+    free(requests);
+}
+
+#if NES_CPU_THREADED
+//runs a copy on the switch dispatched cpu core next to the computed goto one and stops at the
+//first frame where they don't agree
+internal void
+nes_linux_main_cpu_check(NesEmulator* nes_emulator, NesLinuxMainArgs* args) {
+
+    NesEmulator reference = nes_emulator_create_copy(nes_emulator);
+    reference.cpu.reference_core = TRUE;
+
+    u32 frame_index = 0;
+    for (; frame_index < args->count_frames; ++frame_index) {
+
+        nes_emulator_update_and_render(nes_emulator, args->render);
+        nes_emulator_update_and_render(&reference, args->render);
+
+        NesCpuRegisters* registers           = &nes_emulator->cpu.registers;
+        NesCpuRegisters* reference_registers = &reference.cpu.registers;
+
+        if (nes_emulator_state_hash(nes_emulator) != nes_emulator_state_hash(&reference) ||
+            nes_emulator->cpu.cycle_count       != reference.cpu.cycle_count       ||
+            nes_emulator->cpu.instruction_count != reference.cpu.instruction_count ||
+            registers->pc    != reference_registers->pc    ||
+            registers->sp    != reference_registers->sp    ||
+            registers->acc_a != reference_registers->acc_a ||
+            registers->ir_x  != reference_registers->ir_x  ||
+            registers->ir_y  != reference_registers->ir_y  ||
+            registers->p     != reference_registers->p     ||
+            (args->render == TRUE && memcmp(nes_emulator->ppu.frame_buffer, reference.ppu.frame_buffer, NES_PPU_FRAME_BUFFER_SIZE) != 0)) {
+
+            printf("cpu check: frame %u differs\n", frame_index);
+            printf("  threaded:  pc: %04X a: %02X x: %02X y: %02X sp: %02X p: %02X cycle: %llu instr: %llu\n",
+                registers->pc, registers->acc_a, registers->ir_x, registers->ir_y, registers->sp, registers->p,
+                nes_emulator->cpu.cycle_count, nes_emulator->cpu.instruction_count);
+            printf("  reference: pc: %04X a: %02X x: %02X y: %02X sp: %02X p: %02X cycle: %llu instr: %llu\n",
+                reference_registers->pc, reference_registers->acc_a, reference_registers->ir_x, reference_registers->ir_y, reference_registers->sp, reference_registers->p,
+                reference.cpu.cycle_count, reference.cpu.instruction_count);
+            break;
+        }
+    }
+
+    if (frame_index == args->count_frames) {
+        printf("cpu check: %u frames ok (%llu guest instructions)\n", args->count_frames, nes_emulator->cpu.instruction_count);
+    }
+
+    nes_emulator_destroy_copy(&reference);
+}
+#endif
+
+internal u64
+nes_linux_main_random(u64* state) {
+
+    //xorshift64, the check only needs something cheap that comes out the same every run
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+internal void
+nes_linux_main_random_fill(u64* state, u8* memory, u32 size) {
+
+    for (u32 offset = 0; offset < size; offset += sizeof(u64)) {
+        u64 value = nes_linux_main_random(state);
+        memcpy(&memory[offset], &value, (size - offset < sizeof(u64)) ? size - offset : sizeof(u64));
+    }
+}
+
+//random registers and memory with op_code at pc, for the op checks
+//indirect pointers and pulls come out of zero page and the stack, so those change every state and the rest every so often
+internal void
+nes_linux_main_cpu_randomize(NesCpu* cpu, u64* random, u32 state_index, nes_val op_code) {
+
+    if ((state_index % NES_LINUX_MAIN_CPU_OP_CHECK_REFILL) == 0) {
+        nes_linux_main_random_fill(random, (u8*)&cpu->mem_map.ram,     sizeof(cpu->mem_map.ram));
+        nes_linux_main_random_fill(random, cpu->mem_map.expansion_rom, sizeof(cpu->mem_map.expansion_rom));
+        nes_linux_main_random_fill(random, cpu->mem_map.sram,          sizeof(cpu->mem_map.sram));
+        nes_linux_main_random_fill(random, (u8*)&cpu->mem_map.prg_rom, sizeof(cpu->mem_map.prg_rom));
+    }
+    else {
+        nes_linux_main_random_fill(random, cpu->mem_map.ram.zero_page, sizeof(cpu->mem_map.ram.zero_page));
+        nes_linux_main_random_fill(random, cpu->mem_map.ram.stack,     sizeof(cpu->mem_map.ram.stack));
+    }
+
+    u64 registers = nes_linux_main_random(random);
+    cpu->registers.acc_a = (nes_val)(registers);
+    cpu->registers.ir_x  = (nes_val)(registers >> 8);
+    cpu->registers.ir_y  = (nes_val)(registers >> 16);
+    cpu->registers.sp    = (nes_val)(registers >> 24);
+    cpu->registers.p     = (nes_val)(registers >> 32);
+
+    //half in ram and half in prg rom, never so close to the end that the operands wrap
+    cpu->registers.pc = (registers & ((u64)1 << 40))
+        ? (nes_addr)((registers >> 48) % (NES_MEM_MAP_RAM_END - 2))
+        : (nes_addr)(NES_MEM_MAP_LOWER_PRG_ROM_ADDR + ((registers >> 48) % (0x8000 - 2)));
+    *nes_memory_map_address(&cpu->mem_map, cpu->registers.pc) = op_code;
+    *nes_memory_map_address(&cpu->mem_map, (nes_addr)(cpu->registers.pc + 1)) = (nes_val)nes_linux_main_random(random);
+    *nes_memory_map_address(&cpu->mem_map, (nes_addr)(cpu->registers.pc + 2)) = (nes_val)nes_linux_main_random(random);
+}
+
+//prints the first thing two cpus that ran the same instructions don't agree on, core names the one that isn't
+//the reference, returns FALSE if they do
+internal b32
+nes_linux_main_cpu_compare(NesCpu* cpu, NesCpu* reference, char* core) {
+
+    NesCpuRegisters* registers           = &cpu->registers;
+    NesCpuRegisters* reference_registers = &reference->registers;
+
+    if (registers->pc    != reference_registers->pc    ||
+        registers->sp    != reference_registers->sp    ||
+        registers->acc_a != reference_registers->acc_a ||
+        registers->ir_x  != reference_registers->ir_x  ||
+        registers->ir_y  != reference_registers->ir_y  ||
+        registers->p     != reference_registers->p) {
+        printf("  %-10s pc: %04X a: %02X x: %02X y: %02X sp: %02X p: %02X\n",
+            core, registers->pc, registers->acc_a, registers->ir_x, registers->ir_y, registers->sp, registers->p);
+        printf("  reference: pc: %04X a: %02X x: %02X y: %02X sp: %02X p: %02X\n",
+            reference_registers->pc, reference_registers->acc_a, reference_registers->ir_x, reference_registers->ir_y, reference_registers->sp, reference_registers->p);
+        return TRUE;
+    }
+
+    if (cpu->cycle_count != reference->cycle_count || cpu->instruction_count != reference->instruction_count) {
+        printf("  %-10s cycle: %llu instr: %llu\n  reference: cycle: %llu instr: %llu\n",
+            core, cpu->cycle_count, cpu->instruction_count, reference->cycle_count, reference->instruction_count);
+        return TRUE;
+    }
+
+    if (cpu->current_instr.operand_access  != reference->current_instr.operand_access ||
+        cpu->current_instr.operand_address != reference->current_instr.operand_address) {
+        printf("  %-10s operand $%04X access: %u\n  reference: operand $%04X access: %u\n",
+            core, cpu->current_instr.operand_address, cpu->current_instr.operand_access,
+            reference->current_instr.operand_address, reference->current_instr.operand_access);
+        return TRUE;
+    }
+
+    //everything the cpu can reach is in the map, the io registers and page table dirty bits included
+    u8* memory           = (u8*)&cpu->mem_map;
+    u8* reference_memory = (u8*)&reference->mem_map;
+    if (memcmp(memory, reference_memory, sizeof(NesMemoryMap)) == 0) {
+        return FALSE;
+    }
+    for (u32 offset = 0; offset < sizeof(NesMemoryMap); ++offset) {
+        if (memory[offset] != reference_memory[offset]) {
+            printf("  memory map byte %u: %s %02X reference: %02X\n", offset, core, memory[offset], reference_memory[offset]);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+#if NES_CPU_THREADED
+//runs every op code, the ones the core doesn't know included, on both cpu cores from the same random
+//registers and memory and stops at the first one they don't agree on
+//a whole game only ever reaches the op codes and states it happens to use, this gets all of them
+internal b32
+nes_linux_main_cpu_op_check() {
+
+    NesCpu cpu = nes_cpu_create_and_initialize();
+    u64 random = NES_LINUX_MAIN_CPU_OP_CHECK_SEED;
+
+    NesCpu* threaded  = (NesCpu*)malloc(sizeof(NesCpu));
+    NesCpu* reference = (NesCpu*)malloc(sizeof(NesCpu));
+
+    u32 count_known = 0;
+    b32 differs     = FALSE;
+
+    for (u32 op_code = 0; op_code < 256 && differs != TRUE; ++op_code) {
+
+        if (nes_cpu_disasm_op_code((nes_val)op_code)->valid == TRUE) {
+            ++count_known;
+        }
+
+        for (u32 state_index = 0; state_index < NES_LINUX_MAIN_CPU_OP_CHECK_STATES; ++state_index) {
+
+            nes_linux_main_cpu_randomize(&cpu, &random, state_index, (nes_val)op_code);
+
+            //byte for byte, padding included, so the map can be compared the same way afterwards
+            memcpy(threaded,  &cpu, sizeof(NesCpu));
+            memcpy(reference, &cpu, sizeof(NesCpu));
+            reference->reference_core = TRUE;
+
+            //every instruction takes at least a cycle, so a budget of one runs exactly one
+            nes_cpu_run(threaded,  1);
+            nes_cpu_run(reference, 1);
+
+            if (nes_linux_main_cpu_compare(threaded, reference, "threaded:") == TRUE) {
+                printf("cpu op check: op code %02X (%s) differs from pc: %04X a: %02X x: %02X y: %02X sp: %02X p: %02X (state %u)\n",
+                    op_code, nes_cpu_disasm_op_code((nes_val)op_code)->mnemonic,
+                    cpu.registers.pc, cpu.registers.acc_a, cpu.registers.ir_x, cpu.registers.ir_y, cpu.registers.sp, cpu.registers.p,
+                    state_index);
+                differs = TRUE;
+                break;
+            }
+        }
+    }
+
+    if (differs != TRUE) {
+        printf("cpu op check: 256 op codes (%u known) x %u states ok\n", count_known, NES_LINUX_MAIN_CPU_OP_CHECK_STATES);
+    }
+
+    free(threaded);
+    free(reference);
+    nes_cpu_destroy_and_free_debug_info(&cpu);
+
+    return (differs == TRUE) ? FALSE : TRUE;
+}
+#endif
+
+internal void
+nes_linux_main_cpu_expect(b32* ok, b32 condition, char* what) {
+
+    if (condition != TRUE) {
+        printf("cpu interrupt check: %s\n", what);
+        *ok = FALSE;
+    }
+}
+
+//nothing in the emulator raises irq yet, so the line gets driven by hand: it has to push pc and the
+//status with the break flag clear, stay up while interrupts are disabled and stop once it's released,
+//while nmi is taken once per raise and brk keeps pushing whatever is at pc+2
+internal b32
+nes_linux_main_cpu_interrupt_check() {
+
+    NesCpu cpu = nes_cpu_create_and_initialize();
+    u8* stack  = cpu.mem_map.ram.stack;
+    b32 ok     = TRUE;
+
+    //the break flag is set going in so the push has to clear it
+    cpu.registers.pc = 0x0234;
+    cpu.registers.sp = 0xFD;
+    cpu.registers.p  = (1 << NES_CPU_FLAG_B) | (1 << NES_CPU_FLAG_C);
+    *nes_memory_map_address(&cpu.mem_map, 0x0236) = 0xAB;
+    *nes_memory_map_address(&cpu.mem_map, 0x0237) = 0xCD;
+
+    nes_cpu_interrupt_raise(&cpu, NES_CPU_INTERRUPT_PENDING_IRQ);
+    nes_cpu_interrupts_service(&cpu);
+
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.pc == NES_CPU_INTERRUPT_VECTOR_BRK) ? TRUE : FALSE, "irq didn't go to the irq vector");
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.sp == 0xFB) ? TRUE : FALSE, "irq didn't push two bytes");
+    nes_linux_main_cpu_expect(&ok, (stack[0xFD] == 0x34) ? TRUE : FALSE, "irq didn't push pc");
+    nes_linux_main_cpu_expect(&ok, (stack[0xFC] == (1 << NES_CPU_FLAG_C)) ? TRUE : FALSE, "irq didn't push the status with the break flag clear");
+    nes_linux_main_cpu_expect(&ok, ((ReadBitInByte(NES_CPU_FLAG_I, cpu.registers.p)) == 1) ? TRUE : FALSE, "irq didn't disable interrupts");
+    nes_linux_main_cpu_expect(&ok, (cpu.interrupts_pending & NES_CPU_INTERRUPT_PENDING_IRQ) ? TRUE : FALSE, "irq went down on its own");
+
+    //still up, but masked
+    nes_cpu_interrupts_service(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.sp == 0xFB) ? TRUE : FALSE, "irq was taken with interrupts disabled");
+
+    //a cli in the handler lets it straight back in
+    ClearBitInByte(NES_CPU_FLAG_I, cpu.registers.p);
+    nes_cpu_interrupts_service(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.sp == 0xF9) ? TRUE : FALSE, "irq wasn't taken again while it was still up");
+
+    //and once it's released it's gone
+    nes_cpu_interrupt_release(&cpu, NES_CPU_INTERRUPT_PENDING_IRQ);
+    ClearBitInByte(NES_CPU_FLAG_I, cpu.registers.p);
+    nes_cpu_interrupts_service(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.sp == 0xF9) ? TRUE : FALSE, "irq was taken after it was released");
+
+    nes_cpu_interrupt_raise(&cpu, NES_CPU_INTERRUPT_PENDING_NMI);
+    nes_cpu_interrupts_service(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.pc == NES_CPU_INTERRUPT_VECTOR_NMI && cpu.registers.sp == 0xF7) ? TRUE : FALSE, "nmi wasn't taken");
+    nes_linux_main_cpu_expect(&ok, (cpu.interrupts_pending == 0) ? TRUE : FALSE, "nmi is still pending after it was taken");
+    nes_cpu_interrupts_service(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.sp == 0xF7) ? TRUE : FALSE, "nmi was taken twice for one raise");
+
+    //brk with interrupts enabled, pc+2 is counted from after the op code
+    cpu.registers.pc = 0x0234;
+    ClearBitInByte(NES_CPU_FLAG_I, cpu.registers.p);
+    *nes_memory_map_address(&cpu.mem_map, 0x0234) = NES_CPU_INSTR_BRK_IMP;
+    nes_cpu_tick(&cpu);
+    nes_linux_main_cpu_expect(&ok, (cpu.registers.pc == NES_CPU_INTERRUPT_VECTOR_BRK && cpu.registers.sp == 0xF5) ? TRUE : FALSE, "brk didn't go to the irq vector");
+    nes_linux_main_cpu_expect(&ok, (stack[0xF7] == 0xCD) ? TRUE : FALSE, "brk doesn't push the byte at pc+2 anymore");
+
+    if (ok == TRUE) {
+        printf("cpu interrupt check: ok\n");
+    }
+
+    nes_cpu_destroy_and_free_debug_info(&cpu);
+
+    return ok;
+}
+
+//runs every op code through the batch cpu, a lane at a time against nes_cpu_run on a copy
+//most of the lanes share the op code so it goes in lockstep, every so often one gets another op code or a
+//pending nmi so the scalar fallback and the interrupts at the start of a run get mixed in with it
+internal b32
+nes_linux_main_cpu_batch_check() {
+
+    NesCpu cpu = nes_cpu_create_and_initialize();
+    u64 random = NES_LINUX_MAIN_CPU_OP_CHECK_SEED;
+
+    NesCpu* lanes[NES_CPU_BATCH_LANES];
+    NesCpu* references[NES_CPU_BATCH_LANES];
+    for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {
+        lanes[lane]      = (NesCpu*)malloc(sizeof(NesCpu));
+        references[lane] = (NesCpu*)malloc(sizeof(NesCpu));
+    }
+
+    NesCpuBatch batch = nes_cpu_batch_create_and_initialize(lanes, NES_CPU_BATCH_LANES);
+    u64 cycle_ends[NES_CPU_BATCH_LANES];
+    nes_val lane_op_codes[NES_CPU_BATCH_LANES];
+    u32 lane_bits = (1 << NES_CPU_BATCH_LANES) - 1;
+
+    b32 differs = FALSE;
+
+    for (u32 op_code = 0; op_code < 256 && differs != TRUE; ++op_code) {
+
+        for (u32 state_index = 0; state_index < NES_LINUX_MAIN_CPU_BATCH_CHECK_STATES && differs != TRUE; ++state_index) {
+
+            for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {
+
+                u64 mix = nes_linux_main_random(&random);
+                lane_op_codes[lane] = ((mix & 7) == 0) ? (nes_val)(mix >> 8) : (nes_val)op_code;
+
+                nes_linux_main_cpu_randomize(&cpu, &random, state_index * NES_CPU_BATCH_LANES + lane, lane_op_codes[lane]);
+
+                memcpy(lanes[lane], &cpu, sizeof(NesCpu));
+                if (((mix >> 16) & 15) == 0) {
+                    nes_cpu_interrupt_raise(lanes[lane], NES_CPU_INTERRUPT_PENDING_NMI);
+                }
+                memcpy(references[lane], lanes[lane], sizeof(NesCpu));
+
+                //every instruction takes at least a cycle, so a budget of one runs exactly one
+                cycle_ends[lane] = lanes[lane]->cycle_count + 1;
+                nes_cpu_run(references[lane], 1);
+            }
+
+            nes_cpu_batch_run_until(&batch, lane_bits, cycle_ends);
+
+            for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {
+                if (nes_linux_main_cpu_compare(lanes[lane], references[lane], "batch:") == TRUE) {
+                    printf("cpu batch check: op code %02X (%s) differs in lane %u (batch of %02X, state %u)\n",
+                        lane_op_codes[lane], nes_cpu_disasm_op_code(lane_op_codes[lane])->mnemonic, lane, op_code, state_index);
+                    differs = TRUE;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (differs != TRUE) {
+        printf("cpu batch check: 256 op codes x %u states x %u lanes ok (%llu lockstep, %llu scalar)\n",
+            NES_LINUX_MAIN_CPU_BATCH_CHECK_STATES, NES_CPU_BATCH_LANES, batch.lockstep_lane_instructions, batch.scalar_lane_instructions);
+    }
+
+    for (u32 lane = 0; lane < NES_CPU_BATCH_LANES; ++lane) {
+        free(lanes[lane]);
+        free(references[lane]);
+    }
+    nes_cpu_destroy_and_free_debug_info(&cpu);
+
+    return (differs == TRUE) ? FALSE : TRUE;
+}
+
+internal void
+nes_linux_main_loop(NesEmulator* nes_emulator, NesLinuxMainArgs* args) {
+
+    NesLinuxPerfCounters perf_counters = {0};
+    perf_counters.group_file_descriptor = -1;
+
+    if (args->perf == TRUE) {
+        perf_counters = nes_linux_perf_open();
+        if (nes_linux_perf_available(&perf_counters) == FALSE) {
+            printf("perf: no hardware counters available (check /proc/sys/kernel/perf_event_paranoid)\n");
+        }
+    }
+
+    if (args->break_address >= 0) {
+        nes_emulator_watchpoint_add(nes_emulator, (nes_addr)args->break_address, (nes_addr)args->break_address, NES_MEM_MAP_WATCH_EXECUTE);
+    }
+    if (args->watch_address >= 0) {
+        nes_emulator_watchpoint_add(nes_emulator, (nes_addr)args->watch_address, (nes_addr)args->watch_address, NES_MEM_MAP_WATCH_WRITE);
+    }
+
+    NesLinuxPerfSample perf_total = {0};
+    u64 guest_instructions_begin  = nes_emulator->cpu.instruction_count;
+    u64 guest_cycles_begin        = nes_emulator->cpu.cycle_count;
+    u64 timestamp_begin           = nes_linux_main_timestamp();
+
+    for (u32 frame_index = 0; frame_index < args->count_frames; ++frame_index) {
+
+        u64 frame_guest_instructions = nes_emulator->cpu.instruction_count;
+        NesLinuxPerfSample perf_frame_begin = nes_linux_perf_read(&perf_counters);
+
+        //there's no one at the console, report the stop and carry on
+        while (nes_emulator_update_and_render(nes_emulator, args->render) != TRUE) {
+            NesMemoryMapDebug* debug = &nes_emulator->cpu.mem_map.debug;
+            if (debug->count_traps <= NES_LINUX_MAIN_TRAP_PRINT_COUNT) {
+                printf("trap: %s $%04X value: %02X pc: %04X cycle: %llu\n",
+                    (debug->trap.watch_flag == NES_MEM_MAP_WATCH_EXECUTE) ? "execute" : "write",
+                    debug->trap.address,
+                    debug->trap.value,
+                    nes_emulator->cpu.registers.pc,
+                    nes_emulator->cpu.cycle_count);
+            }
+            nes_emulator_debug_continue(nes_emulator);
+        }
+
+        NesLinuxPerfSample perf_frame_end = nes_linux_perf_read(&perf_counters);
+        NesLinuxPerfSample perf_frame     = nes_linux_perf_sample_delta(&perf_frame_begin, &perf_frame_end);
+
+        for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+            perf_total.values[counter_type] += perf_frame.values[counter_type];
+        }
+
+        if (args->hash_frames == TRUE) {
+            printf("frame %u state hash: %016llx\n", frame_index, nes_emulator_state_hash(nes_emulator));
+        }
+
+        if (args->perf_frames == TRUE) {
+            char frame_label[32];
+            sprintf(frame_label, "frame %u (%llu instr)", frame_index, nes_emulator->cpu.instruction_count - frame_guest_instructions);
+            nes_linux_main_print_perf_sample(frame_label, &perf_counters, &perf_frame, 1.0);
+        }
+    }
+
+    u64 timestamp_end      = nes_linux_main_timestamp();
+    u64 guest_instructions = nes_emulator->cpu.instruction_count - guest_instructions_begin;
+    u64 guest_cycles       = nes_emulator->cpu.cycle_count - guest_cycles_begin;
+    double elapsed_seconds = (double)(timestamp_end - timestamp_begin) / 1000000000.0;
+    u32 count_frames       = (args->count_frames > 0) ? args->count_frames : 1;
+
+    printf("frames: %u (run-ahead: %u, render: %s) guest instructions: %llu guest cycles: %llu (idle loop skipped: %llu)\n",
+        args->count_frames,
+        nes_emulator->run_ahead_frames,
+        (args->render == TRUE) ? "on" : "off",
+        guest_instructions,
+        guest_cycles,
+        nes_emulator->cpu.idle_loop.skipped_cycles);
+    printf("elapsed: %.3fs (%.1f frames/s, %.3fms/frame, %.2fM guest instructions/s)\n",
+        elapsed_seconds,
+        args->count_frames / elapsed_seconds,
+        (elapsed_seconds * 1000.0) / count_frames,
+        (guest_instructions / 1000000.0) / elapsed_seconds);
+
+    NesEmulatorStateHash* state_hash = &nes_emulator->state_hash;
+    printf("state hash: %016llx (%llu pages rehashed over %llu updates)\n",
+        state_hash->hash,
+        state_hash->pages_rehashed,
+        state_hash->count_updates);
+
+    if (nes_emulator->cpu.mem_map.debug.count_watchpoints > 0) {
+        printf("traps: %llu\n", nes_emulator->cpu.mem_map.debug.count_traps);
+    }
+
+    if (nes_linux_perf_available(&perf_counters) == TRUE) {
+
+        nes_linux_main_print_perf_sample("per frame", &perf_counters, &perf_total, (double)count_frames);
+
+        double guest_millions = (guest_instructions > 0) ? (guest_instructions / 1000000.0) : 1.0;
+        nes_linux_main_print_perf_sample("per 1M guest instr", &perf_counters, &perf_total, guest_millions);
+
+        if (nes_linux_perf_counter_available(&perf_counters, NesLinuxPerfCounterType::perf_cycles) == TRUE &&
+            nes_linux_perf_counter_available(&perf_counters, NesLinuxPerfCounterType::perf_instructions) == TRUE &&
+            perf_total.values[NesLinuxPerfCounterType::perf_cycles] > 0) {
+            printf("host IPC: %.3f\n",
+                (double)perf_total.values[NesLinuxPerfCounterType::perf_instructions] /
+                (double)perf_total.values[NesLinuxPerfCounterType::perf_cycles]);
+        }
+
+        nes_linux_perf_close(&perf_counters);
+    }
+}
+
+#if NES_CDL
+
+internal void
+nes_linux_main_print_cdl(NesEmulator* nes_emulator) {
+
+    NesCdl* cdl = nes_emulator->cpu.cdl;
+
+    u32 count_logged[3] = {0};
+    for (u32 offset = 0; offset < cdl->size; ++offset) {
+        for (u32 flag_index = 0; flag_index < 3; ++flag_index) {
+            if (cdl->flags[offset] & (1 << flag_index)) {
+                ++count_logged[flag_index];
+            }
+        }
+    }
+
+    //the analysis is from load time, so it's what the log looked like when we started
+    printf("cdl: %s (%u opcode, %u operand, %u data bytes of %u) static: %u instructions, %u blocks, %u jump targets, %u indirect jumps\n",
+        (nes_emulator->cdl_file.memory) ? nes_emulator->cdl_file.file_name : "not saved",
+        count_logged[0],
+        count_logged[1],
+        count_logged[2],
+        cdl->size,
+        cdl->analysis.count_instrs,
+        cdl->analysis.count_blocks,
+        cdl->analysis.count_jump_targets,
+        cdl->analysis.count_indirect_jumps);
+}
+
+#endif
+
+i32 main(i32 argc, char** argv) {
+
+    NesLinuxMainArgs args;
+    if (nes_linux_main_parse_args(argc, argv, &args) == FALSE) {
+        printf("usage: %s <rom> [--frames N] [--run-ahead N] [--no-render] [--io-bench N] [--break ADDR] [--watch ADDR] [--hash-frames] [--trace FILE] [--cpu-check] [--cpu-op-check] [--perf] [--perf-frames] [--palette-bench]\n", argv[0]);
+        return 1;
+    }
+
+    if (args.palette_bench == TRUE) {
+        nes_linux_main_palette_bench();
+    }
+
+    if (args.cpu_op_check == TRUE) {
+        if (nes_linux_main_cpu_interrupt_check() != TRUE) {
+            return 1;
+        }
+#if NES_CPU_THREADED
+        if (nes_linux_main_cpu_op_check() != TRUE) {
+            return 1;
+        }
+#else
+        printf("cpu op check: only one cpu core in this build (NES_CPU_THREADED=0)\n");
+#endif
+        if (nes_linux_main_cpu_batch_check() != TRUE) {
+            return 1;
+        }
+    }
+
+    if (args.rom_path == NULL) {
+        return 0;
+    }
+
+    linux_main_io_uring = nes_linux_io_uring_create_and_initialize(NES_LINUX_IO_URING_DEFAULT_ENTRIES);
+
+    NesEmulatorPlatformCallbacks platform_callbacks = {0};
+    platform_callbacks.open_and_read_file     = nes_linux_main_open_file_for_emulator;
+    platform_callbacks.close_and_free_file    = nes_linux_main_close_and_free_file_for_nes_emulator;
+    platform_callbacks.open_and_write_to_file = nes_linux_main_open_and_write_buffer_to_file;
+    platform_callbacks.map_save_file          = nes_linux_main_map_save_file;
+    platform_callbacks.flush_save_file        = nes_linux_main_flush_save_file;
+    platform_callbacks.unmap_save_file        = nes_linux_main_unmap_save_file;
+
+#if NES_TIMELINE
+    nes_timeline_initialize(nes_linux_main_timestamp, 1000000000);
+#endif
+
+    NesEmulator nes_emulator = nes_emulator_create_and_initialize(args.rom_path, platform_callbacks);
+    nes_emulator_set_run_ahead_frames(&nes_emulator, args.run_ahead_frames);
+
+    NesLinuxMainLogWriter log_writer;
+    nes_linux_main_log_writer_start(&log_writer, nes_emulator.log);
+
+#if NES_TRACE
+    NesLinuxMainTraceWriter trace_writer;
+    if (args.trace_path) {
+        if (nes_linux_main_trace_writer_start(&trace_writer, args.trace_path) == TRUE) {
+            nes_emulator.cpu.trace = trace_writer.trace;
+        }
+        else {
+            printf("trace: couldn't open %s\n", args.trace_path);
+        }
+    }
+#endif
+
+#if NES_CPU_THREADED
+    if (args.cpu_check == TRUE) {
+        nes_linux_main_cpu_check(&nes_emulator, &args);
+    }
+    else {
+        nes_linux_main_loop(&nes_emulator, &args);
+    }
+#else
+    if (args.cpu_check == TRUE) {
+        printf("cpu check: only one cpu core in this build (NES_CPU_THREADED=0)\n");
+    }
+    nes_linux_main_loop(&nes_emulator, &args);
+#endif
+
+    nes_linux_main_log_writer_stop(&log_writer);
+
+#if NES_TRACE
+    if (nes_emulator.cpu.trace) {
+        nes_emulator.cpu.trace = NULL;
+        nes_linux_main_trace_writer_stop(&trace_writer, args.trace_path);
+    }
+#endif
+
+    if (nes_emulator.save_file.memory) {
+        printf("save: %s (%llu pages flushed)\n", nes_emulator.save_file.file_name, nes_emulator.save_file.pages_flushed);
+    }
+    nes_emulator_save_file_close(&nes_emulator);
+
+#if NES_PROFILER
+    //the hot spots get marked from the code/data log's analysis, so this goes before it's closed
+    nes_emulator_profiler_write_report(&nes_emulator);
+#endif
+
+#if NES_CDL
+    nes_linux_main_print_cdl(&nes_emulator);
+    nes_emulator_cdl_close(&nes_emulator);
+#endif
+    printf("log: %llu bytes flushed, %llu bytes dropped\n", nes_emulator.log->bytes_flushed, nes_emulator.log->bytes_dropped);
+
+    if (args.io_bench_count > 0) {
+        printf("io: %s\n", (linux_main_io_uring.available == TRUE) ? "io_uring" : "blocking fallback");
+        nes_linux_main_io_bench(&nes_emulator, args.rom_path, args.io_bench_count);
+    }
+
+#if NES_TIMELINE
+    nes_emulator_timeline_write(&nes_emulator);
+#endif
+
+    nes_linux_io_uring_destroy(&linux_main_io_uring);
+
+    return 0;
+}
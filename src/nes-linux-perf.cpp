@@ -0,0 +1,174 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include "nes-types.h"
+
+enum NesLinuxPerfCounterType {
+    perf_cycles,
+    perf_instructions,
+    perf_branch_misses,
+    perf_l1d_read_misses,
+    perf_counter_count
+};
+
+struct NesLinuxPerfCounters {
+    //every counter is opened in one group so they are scheduled together
+    i32 group_file_descriptor;
+    i32 file_descriptors[NesLinuxPerfCounterType::perf_counter_count];
+    //where each open counter lands in a group read, -1 if it didn't open
+    i32 group_indices[NesLinuxPerfCounterType::perf_counter_count];
+    u32 count_open;
+};
+
+struct NesLinuxPerfSample {
+    u64 values[NesLinuxPerfCounterType::perf_counter_count];
+};
+
+internal char*
+nes_linux_perf_counter_name(u32 counter_type) {
+
+    switch (counter_type) {
+        case NesLinuxPerfCounterType::perf_cycles:          return "cycles";
+        case NesLinuxPerfCounterType::perf_instructions:    return "instructions";
+        case NesLinuxPerfCounterType::perf_branch_misses:   return "branch-misses";
+        case NesLinuxPerfCounterType::perf_l1d_read_misses: return "L1d-misses";
+        default:                                            return "unknown";
+    }
+}
+
+internal i32
+nes_linux_perf_event_open(u32 type, u64 config, i32 group_file_descriptor) {
+
+    struct perf_event_attr event_attr;
+    memset(&event_attr, 0, sizeof(event_attr));
+    event_attr.size           = sizeof(event_attr);
+    event_attr.type           = type;
+    event_attr.config         = config;
+    event_attr.disabled       = (group_file_descriptor == -1) ? 1 : 0;
+    event_attr.exclude_kernel = 1;
+    event_attr.exclude_hv     = 1;
+    event_attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    //counts this thread on any cpu
+    return (i32)syscall(SYS_perf_event_open, &event_attr, 0, -1, group_file_descriptor, 0);
+}
+
+internal NesLinuxPerfCounters
+nes_linux_perf_open() {
+
+    NesLinuxPerfCounters counters = {0};
+    counters.group_file_descriptor = -1;
+
+    for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+
+        u32 type   = PERF_TYPE_HARDWARE;
+        u64 config = 0;
+
+        switch (counter_type) {
+            case NesLinuxPerfCounterType::perf_cycles:          config = PERF_COUNT_HW_CPU_CYCLES;    break;
+            case NesLinuxPerfCounterType::perf_instructions:    config = PERF_COUNT_HW_INSTRUCTIONS;  break;
+            case NesLinuxPerfCounterType::perf_branch_misses:   config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case NesLinuxPerfCounterType::perf_l1d_read_misses: {
+                type   = PERF_TYPE_HW_CACHE;
+                config = PERF_COUNT_HW_CACHE_L1D
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            } break;
+        }
+
+        //not every machine (or vm) exposes every counter, we report what we can
+        i32 file_descriptor = nes_linux_perf_event_open(type, config, counters.group_file_descriptor);
+        counters.file_descriptors[counter_type] = file_descriptor;
+        counters.group_indices[counter_type]    = -1;
+
+        if (file_descriptor < 0) {
+            continue;
+        }
+
+        if (counters.group_file_descriptor == -1) {
+            counters.group_file_descriptor = file_descriptor;
+        }
+        counters.group_indices[counter_type] = (i32)counters.count_open;
+        ++counters.count_open;
+    }
+
+    if (counters.group_file_descriptor != -1) {
+        ioctl(counters.group_file_descriptor, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+        ioctl(counters.group_file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    return counters;
+}
+
+internal b32
+nes_linux_perf_available(NesLinuxPerfCounters* counters) {
+
+    return (counters->count_open > 0) ? TRUE : FALSE;
+}
+
+internal b32
+nes_linux_perf_counter_available(NesLinuxPerfCounters* counters, u32 counter_type) {
+
+    return (counters->group_indices[counter_type] >= 0) ? TRUE : FALSE;
+}
+
+//reads the running totals of every counter, scaled up if the kernel had to multiplex the group
+internal NesLinuxPerfSample
+nes_linux_perf_read(NesLinuxPerfCounters* counters) {
+
+    NesLinuxPerfSample sample = {0};
+
+    if (counters->group_file_descriptor == -1) {
+        return sample;
+    }
+
+    //nr, time enabled, time running, then one value per counter
+    u64 read_values[3 + NesLinuxPerfCounterType::perf_counter_count] = {0};
+    ssize_t read_result = read(counters->group_file_descriptor, read_values, sizeof(read_values));
+    if (read_result <= 0) {
+        return sample;
+    }
+
+    u64 time_enabled = read_values[1];
+    u64 time_running = read_values[2];
+
+    for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+
+        i32 group_index = counters->group_indices[counter_type];
+        if (group_index < 0) {
+            continue;
+        }
+
+        u64 value = read_values[3 + group_index];
+        if (time_running > 0 && time_running < time_enabled) {
+            value = (u64)((double)value * ((double)time_enabled / (double)time_running));
+        }
+        sample.values[counter_type] = value;
+    }
+
+    return sample;
+}
+
+internal NesLinuxPerfSample
+nes_linux_perf_sample_delta(NesLinuxPerfSample* begin, NesLinuxPerfSample* end) {
+
+    NesLinuxPerfSample delta = {0};
+    for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+        delta.values[counter_type] = end->values[counter_type] - begin->values[counter_type];
+    }
+    return delta;
+}
+
+internal void
+nes_linux_perf_close(NesLinuxPerfCounters* counters) {
+
+    for (u32 counter_type = 0; counter_type < NesLinuxPerfCounterType::perf_counter_count; ++counter_type) {
+        if (counters->file_descriptors[counter_type] >= 0) {
+            close(counters->file_descriptors[counter_type]);
+        }
+    }
+    *counters = {0};
+    counters->group_file_descriptor = -1;
+}
@@ -0,0 +1,462 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "nes-linux-io.cpp"
+#include "nes-env.cpp"
+#include "nes-server-api.h"
+
+//hosts a pool of emulators for local clients, each one behind a shared memory region laid out in
+//nes-server-api.h, and runs until it gets SIGINT or SIGTERM
+//g++ -O2 -w -DNES_CPU_DEBUG_LOG=0 nes-linux-server.cpp -o nes-server -lpthread
+
+#define NES_LINUX_SERVER_DEFAULT_NAME      "default"
+#define NES_LINUX_SERVER_DEFAULT_INSTANCES 1
+#define NES_LINUX_SERVER_REGION_NAME_SIZE  128
+
+//a worker sleeps on all of its instances' rings with one futex_waitv, which takes at most this many
+#define NES_LINUX_SERVER_WORKER_MAX_INSTANCES FUTEX_WAITV_MAX
+
+struct NesLinuxServerArgs {
+    char* rom_path;
+    char* name;
+    u32 count_instances;
+    //0 for one per cpu
+    u32 count_workers;
+    //0 x 0 for full size palette indices
+    u32 observation_width;
+    u32 observation_height;
+    b32 observation_max_pool;
+};
+
+struct NesLinuxServer;
+
+struct NesLinuxServerInstance {
+    NesLinuxServer* server;
+    u32 instance_index;
+    NesServerRegion* region;
+    char region_name[NES_LINUX_SERVER_REGION_NAME_SIZE];
+};
+
+//the instances are split into runs, one per worker, and a worker is the only one that ever
+//touches its instances, so each ring still has exactly one consumer and one producer
+struct NesLinuxServerWorker {
+    NesLinuxServer* server;
+    u32 first_instance;
+    u32 count_instances;
+    pthread_t thread;
+};
+
+struct NesLinuxServer {
+    NesEnv env;
+    NesLinuxServerInstance* instances;
+    NesLinuxServerWorker* workers;
+    u32 count_workers;
+    //the workers' own shutdown flag, the regions' is for the clients
+    volatile u32 shutdown;
+};
+
+internal void
+nes_linux_server_read_file(NesEmulatorFileBuffer* file_buffer) {
+
+    file_buffer->file_buffer = nes_linux_io_open_and_read_file(file_buffer->file_name);
+}
+
+internal void
+nes_linux_server_free_file(NesEmulatorFileBuffer* file_buffer) {
+
+    nes_linux_io_destroy_file_info(file_buffer->file_buffer);
+}
+
+internal void
+nes_linux_server_write_file(NesEmulatorFileBuffer* file_buffer) {
+
+    nes_linux_io_open_and_write_file(file_buffer->file_name, file_buffer->file_buffer.buffer_contents, (u32)file_buffer->file_buffer.buffer_size);
+}
+
+//same as the env library, the instances can't all share one save file
+internal void
+nes_linux_server_map_save_file(NesEmulatorSaveFile* save_file) {
+
+    save_file->memory = NULL;
+}
+
+internal void
+nes_linux_server_flush_save_file(NesEmulatorSaveFile* save_file, u32 offset, u32 size) {
+}
+
+internal void
+nes_linux_server_unmap_save_file(NesEmulatorSaveFile* save_file) {
+}
+
+/***********
+ * REGIONS *
+ ***********/
+
+internal NesServerRegion*
+nes_linux_server_region_create(char* region_name) {
+
+    //a region left behind by a server that crashed is no use to anyone
+    shm_unlink(region_name);
+
+    i32 file_descriptor = shm_open(region_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (file_descriptor < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(file_descriptor, sizeof(NesServerRegion)) != 0) {
+        close(file_descriptor);
+        shm_unlink(region_name);
+        return NULL;
+    }
+
+    void* memory = mmap(NULL, sizeof(NesServerRegion), PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (memory == MAP_FAILED) {
+        shm_unlink(region_name);
+        return NULL;
+    }
+
+    //a fresh shm object is all zeros, so the rings start out empty
+    return (NesServerRegion*)memory;
+}
+
+internal void
+nes_linux_server_region_destroy(NesServerRegion* region, char* region_name) {
+
+    munmap(region, sizeof(NesServerRegion));
+    shm_unlink(region_name);
+}
+
+//wakes anyone asleep on any of the region's rings, they'll see the shutdown flag and give up
+internal void
+nes_linux_server_region_shutdown(NesServerRegion* region) {
+
+    AtomicStoreReleaseU32(&region->shutdown, 1);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    nes_server_futex_wake(&region->command_indices.head);
+    nes_server_futex_wake(&region->command_indices.tail);
+    nes_server_futex_wake(&region->response_indices.head);
+    nes_server_futex_wake(&region->response_indices.tail);
+}
+
+/************
+ * COMMANDS *
+ ************/
+
+internal void
+nes_linux_server_execute(NesLinuxServerInstance* instance, NesServerCommand* command, NesServerResponse* response) {
+
+    NesEnv* env = &instance->server->env;
+    NesServerRegion* region = instance->region;
+
+    response->sequence = command->sequence;
+    response->status   = NES_SERVER_STATUS_OK;
+
+    switch (command->type) {
+
+        case NES_SERVER_COMMAND_STEP: {
+            //the frame and ram go straight into the region, the client reads them where they land
+            nes_env_instance_step(env, instance->instance_index, (nes_val)command->buttons, command->count_frames, region->frame, region->ram);
+        } break;
+
+        case NES_SERVER_COMMAND_RESET: {
+            nes_env_instance_reset(env, instance->instance_index);
+        } break;
+
+        default: {
+            response->status = NES_SERVER_STATUS_UNKNOWN_COMMAND;
+        } break;
+    }
+
+    NesEmulator* emulator = &env->instances[instance->instance_index];
+    response->frame_count = emulator->frame_count;
+    response->state_hash  = nes_emulator_state_hash(emulator);
+}
+
+//runs the oldest command if there is one and room for its response, returns FALSE if there was nothing to do
+//a client that stops reading responses only holds up its own instance
+internal b32
+nes_linux_server_instance_service(NesLinuxServerInstance* instance) {
+
+    NesServerRegion* region = instance->region;
+    NesServerRingIndices* command_indices  = &region->command_indices;
+    NesServerRingIndices* response_indices = &region->response_indices;
+
+    if (AtomicLoadAcquireU32(&command_indices->tail) == command_indices->head) {
+        return FALSE;
+    }
+    if (response_indices->tail - AtomicLoadAcquireU32(&response_indices->head) == NES_SERVER_RING_SIZE) {
+        return FALSE;
+    }
+
+    NesServerCommand* command   = &region->commands[command_indices->head & NES_SERVER_RING_MASK];
+    NesServerResponse* response = &region->responses[response_indices->tail & NES_SERVER_RING_MASK];
+
+    nes_linux_server_execute(instance, command, response);
+
+    //the command slot can be reused once we're done with it, then the client gets its answer
+    nes_server_ring_pop_end(command_indices);
+    nes_server_ring_push_end(response_indices);
+
+    return TRUE;
+}
+
+//sleeps until any of the worker's instances might have something to do, the same handshake as
+//nes_server_ring_wait but on every ring at once
+internal void
+nes_linux_server_worker_sleep(NesLinuxServerWorker* worker) {
+
+    NesLinuxServer* server = worker->server;
+    struct futex_waitv waiters[NES_LINUX_SERVER_WORKER_MAX_INSTANCES] = {0};
+
+    for (u32 waiter_index = 0; waiter_index < worker->count_instances; ++waiter_index) {
+
+        NesServerRegion* region = server->instances[worker->first_instance + waiter_index].region;
+        NesServerRingIndices* command_indices  = &region->command_indices;
+        NesServerRingIndices* response_indices = &region->response_indices;
+
+        //a command that's waiting can only be stuck on a full response ring, otherwise wait for a command
+        volatile u32* word;
+        volatile u32* waiting;
+        if (AtomicLoadAcquireU32(&command_indices->tail) != command_indices->head) {
+            word    = &response_indices->head;
+            waiting = &response_indices->producer_waiting;
+        }
+        else {
+            word    = &command_indices->tail;
+            waiting = &command_indices->consumer_waiting;
+        }
+
+        AtomicStoreReleaseU32(waiting, 1);
+
+        waiters[waiter_index].uaddr = (u64)(size_t)word;
+        waiters[waiter_index].val   = AtomicLoadAcquireU32(word);
+        //the regions are shared between processes, so no FUTEX2_PRIVATE
+        waiters[waiter_index].flags = FUTEX_32;
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    //the kernel checks every word against val under its own lock, so anything published after
+    //the loads above wakes us or makes the wait fail straight away
+    if (AtomicLoadAcquireU32(&server->shutdown) == 0) {
+
+        struct timespec timeout;
+        clock_gettime(CLOCK_MONOTONIC, &timeout);
+        timeout.tv_nsec += NES_SERVER_WAIT_TIMEOUT_NS;
+        if (timeout.tv_nsec >= 1000000000) {
+            timeout.tv_nsec -= 1000000000;
+            ++timeout.tv_sec;
+        }
+
+        syscall(SYS_futex_waitv, waiters, worker->count_instances, 0, &timeout, CLOCK_MONOTONIC);
+    }
+
+    for (u32 instance_index = worker->first_instance; instance_index < worker->first_instance + worker->count_instances; ++instance_index) {
+        NesServerRegion* region = server->instances[instance_index].region;
+        AtomicStoreReleaseU32(&region->command_indices.consumer_waiting, 0);
+        AtomicStoreReleaseU32(&region->response_indices.producer_waiting, 0);
+    }
+}
+
+internal void*
+nes_linux_server_worker_thread(void* thread_parameter) {
+
+    NesLinuxServerWorker* worker = (NesLinuxServerWorker*)thread_parameter;
+    NesLinuxServer* server = worker->server;
+
+    u32 spin_count = nes_server_spin_count();
+    u32 spin       = 0;
+
+    while (AtomicLoadAcquireU32(&server->shutdown) == 0) {
+
+        //one command per instance per pass, so a client stepping back to back can't starve the rest
+        b32 serviced = FALSE;
+        for (u32 instance_index = worker->first_instance; instance_index < worker->first_instance + worker->count_instances; ++instance_index) {
+            if (nes_linux_server_instance_service(&server->instances[instance_index]) == TRUE) {
+                serviced = TRUE;
+            }
+        }
+
+        if (serviced == TRUE) {
+            spin = 0;
+        }
+        else if (spin < spin_count) {
+            ++spin;
+            nes_server_spin_pause();
+        }
+        else {
+            nes_linux_server_worker_sleep(worker);
+            spin = 0;
+        }
+    }
+
+    return NULL;
+}
+
+/********
+ * MAIN *
+ ********/
+
+internal b32
+nes_linux_server_parse_args(i32 argc, char** argv, NesLinuxServerArgs* args) {
+
+    *args = {0};
+    args->name                 = NES_LINUX_SERVER_DEFAULT_NAME;
+    args->count_instances      = NES_LINUX_SERVER_DEFAULT_INSTANCES;
+    args->observation_max_pool = FALSE;
+
+    for (i32 arg_index = 1; arg_index < argc; ++arg_index) {
+
+        char* arg = argv[arg_index];
+
+        if (strcmp(arg, "--instances") == 0 && arg_index + 1 < argc) {
+            args->count_instances = (u32)strtoul(argv[++arg_index], NULL, 10);
+        }
+        else if (strcmp(arg, "--workers") == 0 && arg_index + 1 < argc) {
+            args->count_workers = (u32)strtoul(argv[++arg_index], NULL, 10);
+        }
+        else if (strcmp(arg, "--name") == 0 && arg_index + 1 < argc) {
+            args->name = argv[++arg_index];
+        }
+        else if (strcmp(arg, "--observation") == 0 && arg_index + 1 < argc) {
+            if (sscanf(argv[++arg_index], "%ux%u", &args->observation_width, &args->observation_height) != 2) {
+                return FALSE;
+            }
+        }
+        else if (strcmp(arg, "--max-pool") == 0) {
+            args->observation_max_pool = TRUE;
+        }
+        else if (args->rom_path == NULL) {
+            args->rom_path = arg;
+        }
+        else {
+            return FALSE;
+        }
+    }
+
+    if (args->observation_width  > NES_PPU_FRAME_BUFFER_WIDTH ||
+        args->observation_height > NES_PPU_FRAME_BUFFER_HEIGHT) {
+        return FALSE;
+    }
+
+    return (args->rom_path != NULL && args->count_instances > 0) ? TRUE : FALSE;
+}
+
+i32 main(i32 argc, char** argv) {
+
+    NesLinuxServerArgs args;
+    if (nes_linux_server_parse_args(argc, argv, &args) != TRUE) {
+        printf("usage: %s <rom> [--instances N] [--workers N] [--name NAME] [--observation WxH] [--max-pool]\n", argv[0]);
+        return 1;
+    }
+
+    //every thread we start inherits this, so the signals only ever come to us in sigwait
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    NesEmulatorPlatformCallbacks platform_callbacks = {0};
+    platform_callbacks.open_and_read_file     = nes_linux_server_read_file;
+    platform_callbacks.close_and_free_file    = nes_linux_server_free_file;
+    platform_callbacks.open_and_write_to_file = nes_linux_server_write_file;
+    platform_callbacks.map_save_file          = nes_linux_server_map_save_file;
+    platform_callbacks.flush_save_file        = nes_linux_server_flush_save_file;
+    platform_callbacks.unmap_save_file        = nes_linux_server_unmap_save_file;
+
+    NesLinuxServer server = {0};
+    server.env = nes_env_create_and_initialize(args.rom_path, args.count_instances, platform_callbacks);
+    nes_env_observation_set(&server.env, args.observation_width, args.observation_height, args.observation_max_pool);
+
+    u32 frame_width  = (server.env.observations) ? server.env.observation_width  : NES_PPU_FRAME_BUFFER_WIDTH;
+    u32 frame_height = (server.env.observations) ? server.env.observation_height : NES_PPU_FRAME_BUFFER_HEIGHT;
+
+    server.instances = (NesLinuxServerInstance*)calloc(args.count_instances, sizeof(NesLinuxServerInstance));
+
+    u32 count_started = 0;
+    for (u32 instance_index = 0; instance_index < args.count_instances; ++instance_index) {
+
+        NesLinuxServerInstance* instance = &server.instances[instance_index];
+        instance->server         = &server;
+        instance->instance_index = instance_index;
+        snprintf(instance->region_name, NES_LINUX_SERVER_REGION_NAME_SIZE, NES_SERVER_REGION_NAME_FORMAT, args.name, instance_index);
+
+        instance->region = nes_linux_server_region_create(instance->region_name);
+        if (!instance->region) {
+            printf("couldn't create %s\n", instance->region_name);
+            break;
+        }
+
+        NesServerRegion* region = instance->region;
+        region->frame_width  = frame_width;
+        region->frame_height = frame_height;
+        region->frame_size   = nes_env_observation_frame_size(&server.env);
+        region->ram_size     = NES_ENV_RAM_OBSERVATION_SIZE;
+        region->version      = NES_SERVER_VERSION;
+        //clients wait for the magic before they touch anything else
+        AtomicStoreReleaseU32(&region->magic, NES_SERVER_MAGIC);
+
+        ++count_started;
+    }
+
+    //one worker per cpu by default, but never more than there are instances or so few that
+    //one of them has more instances than it can sleep on
+    u32 count_workers = (args.count_workers > 0) ? args.count_workers : (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    u32 min_workers   = (args.count_instances + NES_LINUX_SERVER_WORKER_MAX_INSTANCES - 1) / NES_LINUX_SERVER_WORKER_MAX_INSTANCES;
+    if (count_workers < min_workers) {
+        count_workers = min_workers;
+    }
+    if (count_workers > args.count_instances) {
+        count_workers = args.count_instances;
+    }
+
+    server.workers = (NesLinuxServerWorker*)calloc(count_workers, sizeof(NesLinuxServerWorker));
+
+    if (count_started == args.count_instances) {
+        for (u32 worker_index = 0; worker_index < count_workers; ++worker_index) {
+
+            NesLinuxServerWorker* worker = &server.workers[worker_index];
+            worker->server          = &server;
+            worker->first_instance  = (u32)(((u64)worker_index * args.count_instances) / count_workers);
+            worker->count_instances = (u32)(((u64)(worker_index + 1) * args.count_instances) / count_workers) - worker->first_instance;
+
+            if (pthread_create(&worker->thread, NULL, nes_linux_server_worker_thread, worker) != 0) {
+                break;
+            }
+            ++server.count_workers;
+        }
+    }
+
+    if (server.count_workers == count_workers) {
+        printf("serving %u instances of %s as " NES_SERVER_REGION_NAME_FORMAT " and up on %u workers, %ux%u frames\n",
+            count_started, args.rom_path, args.name, 0, server.count_workers, frame_width, frame_height);
+        fflush(stdout);
+
+        i32 signal_number = 0;
+        sigwait(&stop_signals, &signal_number);
+    }
+
+    AtomicStoreReleaseU32(&server.shutdown, 1);
+    for (u32 instance_index = 0; instance_index < count_started; ++instance_index) {
+        nes_linux_server_region_shutdown(server.instances[instance_index].region);
+    }
+    for (u32 worker_index = 0; worker_index < server.count_workers; ++worker_index) {
+        pthread_join(server.workers[worker_index].thread, NULL);
+    }
+    for (u32 instance_index = 0; instance_index < count_started; ++instance_index) {
+        NesLinuxServerInstance* instance = &server.instances[instance_index];
+        nes_linux_server_region_destroy(instance->region, instance->region_name);
+    }
+
+    free(server.workers);
+    free(server.instances);
+    nes_env_destroy(&server.env);
+
+    return (count_started == args.count_instances && server.count_workers == count_workers) ? 0 : 1;
+}
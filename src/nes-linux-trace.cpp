@@ -0,0 +1,369 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nes-linux-io.cpp"
+#include "nes-emulator.cpp"
+
+//reads the traces nes-linux-main writes with --trace
+//g++ -O2 -w nes-linux-trace.cpp -o nes-trace -lpthread
+
+//pc and write queries go through <trace>.query, built the first time it's needed
+#define NES_LINUX_TRACE_QUERY_EXTENSION ".query"
+#define NES_LINUX_TRACE_MAX_THREADS     64
+#define NES_LINUX_TRACE_FILE_NAME_SIZE  1024
+
+struct NesLinuxTraceFile {
+    u8* memory;
+    u64 size;
+};
+
+internal b32
+nes_linux_trace_map_file(char* file_name, NesLinuxTraceFile* trace_file) {
+
+    *trace_file = {0};
+
+    i32 file_descriptor = open(file_name, O_RDONLY);
+    if (file_descriptor < 0) {
+        return FALSE;
+    }
+
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(file_descriptor);
+        return FALSE;
+    }
+
+    void* memory = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (memory == MAP_FAILED) {
+        return FALSE;
+    }
+
+    trace_file->memory = (u8*)memory;
+    trace_file->size   = (u64)file_stat.st_size;
+    return TRUE;
+}
+
+internal void
+nes_linux_trace_unmap_file(NesLinuxTraceFile* trace_file) {
+
+    munmap(trace_file->memory, trace_file->size);
+}
+
+internal void
+nes_linux_trace_print_record(NesTraceRecord* record) {
+
+    nes_val instr_bytes[3] = {record->op_code, record->operands[0], record->operands[1]};
+    char disasm_str[32];
+    nes_cpu_disasm_format(record->pc, instr_bytes, disasm_str);
+
+    printf("%10llu %12llu  %04X  %-16s A:%02X X:%02X Y:%02X SP:%02X P:%02X",
+        record->instruction, record->cycle, record->pc, disasm_str,
+        record->acc_a, record->ir_x, record->ir_y, record->sp, record->p);
+
+    if (record->access) {
+        printf("  %s%s $%04X",
+            (record->access & NES_TRACE_RECORD_FLAG_READ)  ? "r" : "",
+            (record->access & NES_TRACE_RECORD_FLAG_WRITE) ? "w" : "",
+            record->address);
+    }
+    if (record->count_stack_writes > 0) {
+        printf("  push");
+        for (u32 stack_write_index = 0; stack_write_index < record->count_stack_writes; ++stack_write_index) {
+            printf(" $%04X", nes_trace_stack_write_address(record, stack_write_index));
+        }
+    }
+    printf("\n");
+}
+
+//the chunks the writer had to drop that hold any of the instructions between first_instruction and end_instruction
+internal u32
+nes_linux_trace_count_dropped(NesTraceReader* reader, u64 first_instruction, u64 end_instruction) {
+
+    u64 end_chunk = (end_instruction + NES_TRACE_RECORDS_PER_CHUNK - 1) / NES_TRACE_RECORDS_PER_CHUNK;
+    if (end_chunk > reader->header->count_chunks) {
+        end_chunk = reader->header->count_chunks;
+    }
+
+    u32 count_dropped = 0;
+    for (u64 chunk_number = first_instruction / NES_TRACE_RECORDS_PER_CHUNK; chunk_number < end_chunk; ++chunk_number) {
+        if (reader->index[chunk_number].offset == 0) {
+            ++count_dropped;
+        }
+    }
+    return count_dropped;
+}
+
+internal void
+nes_linux_trace_summary(NesTraceReader* reader) {
+
+    NesTraceFileHeader* header = reader->header;
+
+    u32 count_dropped = nes_linux_trace_count_dropped(reader, 0, header->count_records);
+
+    printf("instructions: %llu chunks: %u (%u dropped) bytes: %llu (%.2f bytes/instruction)\n",
+        header->count_records, header->count_chunks, count_dropped, reader->file_size,
+        (header->count_records > 0) ? (double)reader->file_size / (double)header->count_records : 0.0);
+}
+
+//decodes the chunk an instruction is in only once, then walks it
+internal void
+nes_linux_trace_dump(NesTraceReader* reader, u64 first_instruction, u64 count_instructions) {
+
+    NesTraceRecord* records = (NesTraceRecord*)malloc(NES_TRACE_RECORDS_PER_CHUNK * sizeof(NesTraceRecord));
+
+    u64 instruction = first_instruction;
+    u64 end         = first_instruction + count_instructions;
+    if (end > reader->header->count_records) {
+        end = reader->header->count_records;
+    }
+
+    while (instruction < end) {
+
+        u32 chunk_number  = (u32)(instruction / NES_TRACE_RECORDS_PER_CHUNK);
+        u32 count_records = nes_trace_reader_decode_chunk(reader, chunk_number, records, NES_TRACE_RECORDS_PER_CHUNK);
+        u64 chunk_end     = (u64)(chunk_number + 1) * NES_TRACE_RECORDS_PER_CHUNK;
+
+        if (count_records == 0) {
+            printf("(instructions %llu to %llu were dropped)\n", instruction, ((chunk_end < end) ? chunk_end : end) - 1);
+        }
+
+        for (; instruction < end && instruction < chunk_end; ++instruction) {
+            u32 record_index = (u32)(instruction % NES_TRACE_RECORDS_PER_CHUNK);
+            if (record_index < count_records) {
+                nes_linux_trace_print_record(&records[record_index]);
+            }
+        }
+    }
+
+    free(records);
+}
+
+/*********
+ * QUERY *
+ *********/
+
+struct NesLinuxTraceQueryWorker {
+    pthread_t thread;
+    NesTraceReader* reader;
+    NesTraceQueryRange* range;
+    NesTraceQueryIndex* index;
+};
+
+internal void*
+nes_linux_trace_query_count_thread(void* thread_parameter) {
+
+    NesLinuxTraceQueryWorker* worker = (NesLinuxTraceQueryWorker*)thread_parameter;
+    nes_trace_query_range_count(worker->reader, worker->range);
+    return NULL;
+}
+
+internal void*
+nes_linux_trace_query_fill_thread(void* thread_parameter) {
+
+    NesLinuxTraceQueryWorker* worker = (NesLinuxTraceQueryWorker*)thread_parameter;
+    nes_trace_query_range_fill(worker->reader, worker->range, worker->index);
+    return NULL;
+}
+
+//runs one pass on every worker at once, the first worker's pass runs right here
+internal void
+nes_linux_trace_query_run(NesLinuxTraceQueryWorker* workers, u32 count_workers, void* (*pass)(void*)) {
+
+    for (u32 worker_index = 1; worker_index < count_workers; ++worker_index) {
+        i32 create_result = pthread_create(&workers[worker_index].thread, NULL, pass, &workers[worker_index]);
+        ASSERT(create_result == 0);
+    }
+    pass(&workers[0]);
+    for (u32 worker_index = 1; worker_index < count_workers; ++worker_index) {
+        pthread_join(workers[worker_index].thread, NULL);
+    }
+}
+
+//splits the chunks into one range per cpu, counts, lays the index out, then fills it
+internal void
+nes_linux_trace_query_build(NesTraceReader* reader, NesTraceQueryIndex* index) {
+
+    u32 count_chunks  = reader->header->count_chunks;
+    i64 count_cpus    = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 count_workers = (count_cpus > 0) ? (u32)count_cpus : 1;
+    if (count_workers > NES_LINUX_TRACE_MAX_THREADS) count_workers = NES_LINUX_TRACE_MAX_THREADS;
+    if (count_workers > count_chunks)                count_workers = (count_chunks > 0) ? count_chunks : 1;
+
+    NesTraceQueryRange ranges[NES_LINUX_TRACE_MAX_THREADS];
+    NesLinuxTraceQueryWorker workers[NES_LINUX_TRACE_MAX_THREADS];
+
+    for (u32 worker_index = 0; worker_index < count_workers; ++worker_index) {
+        u32 first_chunk = (u32)(((u64)count_chunks * worker_index)       / count_workers);
+        u32 end_chunk   = (u32)(((u64)count_chunks * (worker_index + 1)) / count_workers);
+        nes_trace_query_range_initialize(&ranges[worker_index], first_chunk, end_chunk);
+
+        workers[worker_index].reader = reader;
+        workers[worker_index].range  = &ranges[worker_index];
+        workers[worker_index].index  = index;
+    }
+
+    nes_linux_trace_query_run(workers, count_workers, nes_linux_trace_query_count_thread);
+    nes_trace_query_index_create(reader, ranges, count_workers, index);
+    nes_linux_trace_query_run(workers, count_workers, nes_linux_trace_query_fill_thread);
+
+    for (u32 worker_index = 0; worker_index < count_workers; ++worker_index) {
+        nes_trace_query_range_destroy(&ranges[worker_index]);
+    }
+}
+
+internal void
+nes_linux_trace_query_save(NesTraceQueryIndex* index, char* query_path) {
+
+    i32 file_descriptor = nes_linux_io_open_file_for_write(query_path);
+    if (file_descriptor < 0) {
+        printf("couldn't write %s\n", query_path);
+        return;
+    }
+
+    //pwrite takes it a gigabyte at a time
+    for (u64 offset = 0; offset < index->size; offset += 0x40000000) {
+        u64 size = index->size - offset;
+        nes_linux_io_write_file_at(file_descriptor, offset, (char*)(index->memory + offset), (u32)((size < 0x40000000) ? size : 0x40000000));
+    }
+    nes_linux_io_close_file(file_descriptor);
+}
+
+//maps <trace>.query if it goes with this trace, otherwise builds it and saves it for next time
+internal b32
+nes_linux_trace_query_load(NesTraceReader* reader, char* trace_path, b32 rebuild, NesTraceQueryIndex* index, NesLinuxTraceFile* query_file) {
+
+    char query_path[NES_LINUX_TRACE_FILE_NAME_SIZE];
+    snprintf(query_path, NES_LINUX_TRACE_FILE_NAME_SIZE, "%s" NES_LINUX_TRACE_QUERY_EXTENSION, trace_path);
+
+    *query_file = {0};
+    if (rebuild != TRUE && nes_linux_trace_map_file(query_path, query_file) == TRUE) {
+        if (nes_trace_query_index_open(index, query_file->memory, query_file->size, reader) == TRUE) {
+            return TRUE;
+        }
+        nes_linux_trace_unmap_file(query_file);
+        *query_file = {0};
+    }
+
+    nes_linux_trace_query_build(reader, index);
+    nes_linux_trace_query_save(index, query_path);
+
+    printf("built %s (%llu pc, %llu write entries)\n", query_path,
+        index->header->count_entries[NES_TRACE_QUERY_PC], index->header->count_entries[NES_TRACE_QUERY_WRITE]);
+
+    return FALSE;
+}
+
+//prints every instruction in the list, a chunk only gets decoded again when the list moves on to another one
+internal void
+nes_linux_trace_print_instructions(NesTraceReader* reader, u64* instructions, u64 count_instructions) {
+
+    NesTraceRecord* records = (NesTraceRecord*)malloc(NES_TRACE_RECORDS_PER_CHUNK * sizeof(NesTraceRecord));
+    u32 decoded_chunk = 0xFFFFFFFF;
+    u32 count_records = 0;
+
+    for (u64 instruction_index = 0; instruction_index < count_instructions; ++instruction_index) {
+
+        u64 instruction  = instructions[instruction_index];
+        u32 chunk_number = (u32)(instruction / NES_TRACE_RECORDS_PER_CHUNK);
+        if (chunk_number != decoded_chunk) {
+            count_records = nes_trace_reader_decode_chunk(reader, chunk_number, records, NES_TRACE_RECORDS_PER_CHUNK);
+            decoded_chunk = chunk_number;
+        }
+
+        u32 record_index = (u32)(instruction % NES_TRACE_RECORDS_PER_CHUNK);
+        if (record_index < count_records) {
+            nes_linux_trace_print_record(&records[record_index]);
+        }
+    }
+
+    free(records);
+}
+
+/********
+ * MAIN *
+ ********/
+
+internal void
+nes_linux_trace_usage(char* program) {
+
+    printf("usage: %s <trace> [dump FIRST COUNT]\n"
+           "       %s <trace> index\n"
+           "       %s <trace> pc|write ADDR [FIRST END]\n", program, program, program);
+}
+
+i32 main(i32 argc, char** argv) {
+
+    if (argc < 2) {
+        nes_linux_trace_usage(argv[0]);
+        return 1;
+    }
+
+    char* trace_path = argv[1];
+    char* command    = (argc > 2) ? argv[2] : NULL;
+
+    NesLinuxTraceFile trace_file;
+    if (nes_linux_trace_map_file(trace_path, &trace_file) != TRUE) {
+        printf("couldn't open %s\n", trace_path);
+        return 1;
+    }
+
+    NesTraceReader reader;
+    if (nes_trace_reader_open(&reader, trace_file.memory, trace_file.size) != TRUE) {
+        printf("%s isn't a finished trace\n", trace_path);
+        nes_linux_trace_unmap_file(&trace_file);
+        return 1;
+    }
+
+    i32 result = 0;
+
+    if (!command) {
+        nes_linux_trace_summary(&reader);
+    }
+    else if (strcmp(command, "dump") == 0 && argc == 5) {
+        nes_linux_trace_dump(&reader, strtoull(argv[3], NULL, 10), strtoull(argv[4], NULL, 10));
+    }
+    else if (strcmp(command, "index") == 0 && argc == 3) {
+        NesTraceQueryIndex index;
+        NesLinuxTraceFile query_file;
+        nes_linux_trace_query_load(&reader, trace_path, TRUE, &index, &query_file);
+        free(index.memory);
+    }
+    else if ((strcmp(command, "pc") == 0 || strcmp(command, "write") == 0) && (argc == 4 || argc == 6)) {
+
+        u32 query = (strcmp(command, "pc") == 0) ? NES_TRACE_QUERY_PC : NES_TRACE_QUERY_WRITE;
+        nes_addr key = (nes_addr)(strtoul(argv[3], NULL, 16) & 0xFFFF);
+        u64 first_instruction = (argc == 6) ? strtoull(argv[4], NULL, 10) : 0;
+        u64 end_instruction   = (argc == 6) ? strtoull(argv[5], NULL, 10) : reader.header->count_records;
+
+        NesTraceQueryIndex index;
+        NesLinuxTraceFile query_file;
+        b32 mapped = nes_linux_trace_query_load(&reader, trace_path, FALSE, &index, &query_file);
+
+        u64 count_instructions = 0;
+        u64* instructions = nes_trace_query_find(&index, query, key, first_instruction, end_instruction, &count_instructions);
+
+        //a dropped chunk's instructions can't be in the answer, so it's only complete if there were none
+        printf("%llu instructions with %s $%04X between %llu and %llu (%u chunks dropped)\n", count_instructions,
+            (query == NES_TRACE_QUERY_PC) ? "pc at" : "a write to", key, first_instruction, end_instruction,
+            nes_linux_trace_count_dropped(&reader, first_instruction, end_instruction));
+        nes_linux_trace_print_instructions(&reader, instructions, count_instructions);
+
+        if (mapped == TRUE) {
+            nes_linux_trace_unmap_file(&query_file);
+        }
+        else {
+            free(index.memory);
+        }
+    }
+    else {
+        nes_linux_trace_usage(argv[0]);
+        result = 1;
+    }
+
+    nes_linux_trace_unmap_file(&trace_file);
+    return result;
+}
@@ -0,0 +1,98 @@
+#include "nes-log.hpp"
+
+internal NesLog*
+nes_log_create_and_initialize() {
+
+    //the whole append buffer is allocated up front, logging never allocates
+    NesLog* log = (NesLog*)malloc(sizeof(NesLog));
+    memset(log, 0, sizeof(NesLog));
+    log->buffer = (char*)malloc(NES_LOG_BUFFER_SIZE);
+
+    return log;
+}
+
+internal void
+nes_log_destroy(NesLog* log) {
+
+    free(log->buffer);
+    free(log);
+}
+
+//producer side, copies the message into the ring, returns FALSE if it didn't fit
+internal b32
+nes_log_write(NesLog* log, char* data, u32 data_size) {
+
+    u32 write_index = log->write_index;
+    u32 read_index  = AtomicLoadAcquireU32(&log->read_index);
+
+    if (data_size > NES_LOG_BUFFER_SIZE - (write_index - read_index)) {
+        log->bytes_dropped += data_size;
+        return FALSE;
+    }
+
+    //the message might wrap around the end of the buffer
+    u32 buffer_offset = write_index & NES_LOG_BUFFER_MASK;
+    u32 first_size    = NES_LOG_BUFFER_SIZE - buffer_offset;
+    if (first_size > data_size) {
+        first_size = data_size;
+    }
+    memcpy(&log->buffer[buffer_offset], data, first_size);
+    memcpy(log->buffer, data + first_size, data_size - first_size);
+
+    AtomicStoreReleaseU32(&log->write_index, write_index + data_size);
+
+    return TRUE;
+}
+
+internal b32
+nes_log_printf(NesLog* log, char* format, ...) {
+
+    char line[NES_LOG_LINE_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    i32 line_size = vsnprintf(line, NES_LOG_LINE_SIZE, format, args);
+    va_end(args);
+
+    if (line_size < 0) {
+        return FALSE;
+    }
+
+    //long lines are cut off rather than spilling into a second message
+    if (line_size >= NES_LOG_LINE_SIZE) {
+        line_size = NES_LOG_LINE_SIZE - 1;
+    }
+
+    return nes_log_write(log, line, (u32)line_size);
+}
+
+//consumer side, hands everything written so far to the callback in at most two contiguous pieces
+//and returns how many bytes went out
+internal u32
+nes_log_flush(NesLog* log, nes_log_flush_callback flush_callback, void* context) {
+
+    u32 read_index  = log->read_index;
+    u32 write_index = AtomicLoadAcquireU32(&log->write_index);
+    u32 flush_size  = write_index - read_index;
+
+    if (flush_size == 0) {
+        return 0;
+    }
+
+    u32 buffer_offset = read_index & NES_LOG_BUFFER_MASK;
+    u32 first_size    = NES_LOG_BUFFER_SIZE - buffer_offset;
+    if (first_size > flush_size) {
+        first_size = flush_size;
+    }
+    flush_callback(context, &log->buffer[buffer_offset], first_size);
+    if (flush_size > first_size) {
+        flush_callback(context, log->buffer, flush_size - first_size);
+    }
+
+    log->bytes_flushed += flush_size;
+
+    //the producer can reuse the space now
+    AtomicStoreReleaseU32(&log->read_index, write_index);
+
+    return flush_size;
+}
@@ -0,0 +1,33 @@
+#ifndef NES_LOG_HPP
+#define NES_LOG_HPP
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nes-types.h"
+
+//has to be a power of 2 so the indices can wrap freely
+#define NES_LOG_BUFFER_SIZE (1 << 20)
+#define NES_LOG_BUFFER_MASK (NES_LOG_BUFFER_SIZE - 1)
+#define NES_LOG_LINE_SIZE   256
+
+typedef void (*nes_log_flush_callback)(void* context, char* data, u32 data_size);
+
+//single producer (emulation) single consumer (log writer) byte ring
+//the producer never waits, if the ring is full the whole message is dropped
+struct NesLog {
+    char* buffer;
+
+    //only written by the producer
+    volatile u32 write_index;
+    u64 bytes_dropped;
+    u8 producer_padding[CACHE_LINE_SIZE];
+
+    //only written by the consumer
+    volatile u32 read_index;
+    u64 bytes_flushed;
+    u8 consumer_padding[CACHE_LINE_SIZE];
+};
+
+#endif //NES_LOG_HPP
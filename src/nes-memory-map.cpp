@@ -1,32 +1,454 @@
 #include "nes-memory-map.hpp"
 
+internal void
+nes_memory_map_page_table_set(NesMemoryMap* map, u32 page, u32 offset, u8 read_flags, u8 write_flags) {
+
+    map->page_table.offsets[page]     = offset;
+    map->page_table.read_flags[page]  = read_flags;
+    map->page_table.write_flags[page] = write_flags;
+}
+
+internal void
+nes_memory_map_initialize(NesMemoryMap* map) {
+
+    u32 ram_offset       = (u32)offsetof(NesMemoryMap, ram);
+    u32 io_offset        = (u32)offsetof(NesMemoryMap, io_registers);
+    u32 expansion_offset = (u32)offsetof(NesMemoryMap, expansion_rom);
+    u32 sram_offset      = (u32)offsetof(NesMemoryMap, sram);
+    u32 prg_rom_offset   = (u32)offsetof(NesMemoryMap, prg_rom);
+
+    for (u32 page = 0; page < NES_MEM_MAP_PAGE_COUNT; ++page) {
+
+        nes_addr page_address = (nes_addr)(page << NES_MEM_MAP_PAGE_SHIFT);
+
+        if (page_address <= NES_MEM_MAP_RAM_END) {
+            //2KB of ram mirrored four times
+            nes_memory_map_page_table_set(map, page, ram_offset + ((page << NES_MEM_MAP_PAGE_SHIFT) & 0x07FF), 0, 0);
+        }
+        else if (page_address < NES_MEM_MAP_UPPER_IO_REG_ADDR + NES_MEM_MAP_PAGE_SIZE) {
+            //io registers mirror every 8 bytes, and $4000 shares its page with the start of expansion rom
+            nes_memory_map_page_table_set(map, page, io_offset, NES_MEM_MAP_PAGE_FLAG_IO, NES_MEM_MAP_PAGE_FLAG_IO);
+        }
+        else if (page_address < NES_MEM_MAP_SRAM_ADDR) {
+            nes_memory_map_page_table_set(map, page, expansion_offset + page_address - NES_MEM_MAP_EXPANSION_ROM_ADDR, 0, 0);
+        }
+        else if (page_address < NES_MEM_MAP_LOWER_PRG_ROM_ADDR) {
+            nes_memory_map_page_table_set(map, page, sram_offset + page_address - NES_MEM_MAP_SRAM_ADDR, 0, 0);
+        }
+        else {
+            //writes to rom are for the mapper, nrom doesn't have one so they go nowhere
+            nes_memory_map_page_table_set(map, page, prg_rom_offset + page_address - NES_MEM_MAP_LOWER_PRG_ROM_ADDR, 0, NES_MEM_MAP_PAGE_FLAG_ROM);
+        }
+    }
+
+    //nothing has been hashed yet, so everything starts out dirty
+    for (u32 page = 0; page < NES_MEM_MAP_PAGE_COUNT; ++page) {
+        map->page_table.dirty[page] = NES_MEM_MAP_DIRTY_STATE_HASH;
+    }
+}
+
+//the byte backing an io register, with the mirroring sorted out
+internal nes_val*
+nes_memory_map_io_register(NesMemoryMap* map, nes_addr address) {
+
+    if (address < NES_MEM_MAP_UPPER_IO_REG_ADDR) {
+        return &map->io_registers.io_registers_lower[address & (NES_MEM_MAP_LOWER_IO_REG_SIZE - 1)];
+    }
+    if (address < NES_MEM_MAP_EXPANSION_ROM_ADDR) {
+        return &map->io_registers.io_registers_upper[address - NES_MEM_MAP_UPPER_IO_REG_ADDR];
+    }
+    return &map->expansion_rom[address - NES_MEM_MAP_EXPANSION_ROM_ADDR];
+}
+
+//raw access to the memory behind an address, no devices and no traps
+internal nes_val*
+nes_memory_map_address(NesMemoryMap* map, nes_addr address) {
+
+    if (map->page_table.read_flags[address >> NES_MEM_MAP_PAGE_SHIFT] & NES_MEM_MAP_PAGE_FLAG_IO) {
+        return nes_memory_map_io_register(map, address);
+    }
+
+    return &(((nes_val*)(map))[map->page_table.offsets[address >> NES_MEM_MAP_PAGE_SHIFT] + (address & NES_MEM_MAP_PAGE_MASK)]);
+}
+
+/*****************
+ * PRG ROM BANKS *
+ *****************/
+
+internal void
+nes_memory_map_prg_rom_banks_map(NesMemoryMapPrgRomBanks* banks, u32 low_bank, u32 high_bank) {
+
+    banks->mapped[0] = low_bank;
+    banks->mapped[1] = high_bank;
+}
+
+//offset into the whole prg rom of an address in $8000 - $FFFF
+internal u32
+nes_memory_map_prg_rom_offset(NesMemoryMapPrgRomBanks* banks, nes_addr address) {
+
+    //bit 14 of the address tells us which of the two prg rom windows we are in
+    u32 bank = banks->mapped[(address >> 14) & 1];
+    return (bank * NES_MEM_MAP_PRG_ROM_BANK_SIZE) + (address & (NES_MEM_MAP_PRG_ROM_BANK_SIZE - 1));
+}
+
+//the other way around, a bank mapped into both windows shows up in the low one
+internal nes_addr
+nes_memory_map_prg_rom_address(NesMemoryMapPrgRomBanks* banks, u32 offset) {
+
+    u32 bank = offset / NES_MEM_MAP_PRG_ROM_BANK_SIZE;
+    nes_addr window = (banks->mapped[1] == bank && banks->mapped[0] != bank)
+        ? NES_MEM_MAP_UPPER_PRG_ROM_ADDR
+        : NES_MEM_MAP_LOWER_PRG_ROM_ADDR;
+    return window + (nes_addr)(offset % NES_MEM_MAP_PRG_ROM_BANK_SIZE);
+}
+
+/******************
+ * DIRTY TRACKING *
+ ******************/
+
+//the page a write to page gets counted against, or NES_MEM_MAP_PAGE_COUNT if it isn't tracked
+internal u32
+nes_memory_map_dirty_page(u32 page) {
+
+    if (page < NES_MEM_MAP_DIRTY_RAM_PAGES * NES_MEM_MAP_DIRTY_RAM_MIRRORS) {
+        return page & (NES_MEM_MAP_DIRTY_RAM_PAGES - 1);
+    }
+    if (page >= NES_MEM_MAP_DIRTY_UPPER_BEGIN && page < NES_MEM_MAP_DIRTY_UPPER_END) {
+        return page;
+    }
+    return NES_MEM_MAP_PAGE_COUNT;
+}
+
+//NES_MEM_MAP_DIRTY_* for everyone that cares about writes to dirty_page
+internal u8
+nes_memory_map_dirty_bits(NesMemoryMap* map, u32 dirty_page) {
+
+    if (dirty_page >= NES_MEM_MAP_DIRTY_SRAM_BEGIN) {
+        return NES_MEM_MAP_DIRTY_STATE_HASH | map->page_table.dirty_sram_bits;
+    }
+
+    return NES_MEM_MAP_DIRTY_STATE_HASH;
+}
+
+internal void
+nes_memory_map_dirty_page_track(NesMemoryMap* map, u32 dirty_page, b32 track) {
+
+    //every mirror of a ram page has to trap
+    u32 count_mirrors = (dirty_page < NES_MEM_MAP_DIRTY_RAM_PAGES) ? NES_MEM_MAP_DIRTY_RAM_MIRRORS : 1;
+
+    for (u32 mirror_index = 0; mirror_index < count_mirrors; ++mirror_index) {
+        u32 page = dirty_page + (mirror_index * NES_MEM_MAP_DIRTY_RAM_PAGES);
+        if (track == TRUE) {
+            map->page_table.write_flags[page] |= NES_MEM_MAP_PAGE_FLAG_TRACK;
+        }
+        else {
+            map->page_table.write_flags[page] &= ~NES_MEM_MAP_PAGE_FLAG_TRACK;
+        }
+    }
+}
+
+//first write to a clean page since it was cleared, after this writes to it are back on the fast path
+internal void
+nes_memory_map_dirty_mark(NesMemoryMap* map, u32 page) {
+
+    u32 dirty_page = nes_memory_map_dirty_page(page);
+    if (dirty_page == NES_MEM_MAP_PAGE_COUNT) {
+        return;
+    }
+
+    map->page_table.dirty[dirty_page] |= nes_memory_map_dirty_bits(map, dirty_page);
+    nes_memory_map_dirty_page_track(map, dirty_page, FALSE);
+}
+
+//the caller (one of NES_MEM_MAP_DIRTY_*) has caught up with the page, once everyone has
+//the next write to it traps once and marks it dirty again
+internal void
+nes_memory_map_dirty_clear(NesMemoryMap* map, u32 dirty_page, u8 dirty_bit) {
+
+    map->page_table.dirty[dirty_page] &= ~dirty_bit;
+    if (map->page_table.dirty[dirty_page] == 0) {
+        nes_memory_map_dirty_page_track(map, dirty_page, TRUE);
+    }
+}
+
+//for anyone that writes the memory behind the bus's back, like a snapshot restore
+internal void
+nes_memory_map_dirty_all(NesMemoryMap* map) {
+
+    for (u32 page = 0; page < NES_MEM_MAP_PAGE_COUNT; ++page) {
+        u32 dirty_page = nes_memory_map_dirty_page(page);
+        if (dirty_page == page) {
+            map->page_table.dirty[dirty_page] |= nes_memory_map_dirty_bits(map, dirty_page);
+            nes_memory_map_dirty_page_track(map, dirty_page, FALSE);
+        }
+    }
+}
+
+/*************
+ * DEBUGGING *
+ *************/
+
+internal void
+nes_memory_map_trap(NesMemoryMap* map, nes_addr address, nes_val value, u8 watch_flag) {
+
+    NesMemoryMapDebug* debug = &map->debug;
+
+    for (u32 watchpoint_index = 0; watchpoint_index < NES_MEM_MAP_WATCHPOINT_COUNT; ++watchpoint_index) {
+
+        NesMemoryMapWatchpoint* watchpoint = &debug->watchpoints[watchpoint_index];
+
+        if (watchpoint->enabled == TRUE &&
+            (watchpoint->watch_flags & watch_flag) &&
+            address >= watchpoint->address_begin &&
+            address <= watchpoint->address_end) {
+
+            //only the first hit of an instruction is kept
+            if (debug->stopped != TRUE) {
+                debug->stopped                = TRUE;
+                debug->trap.address           = address;
+                debug->trap.value             = value;
+                debug->trap.watch_flag        = watch_flag;
+                debug->trap.watchpoint_index  = watchpoint_index;
+            }
+            ++debug->count_traps;
+            return;
+        }
+    }
+}
+
+//called before an instruction is fetched from a page with an execute breakpoint,
+//returns TRUE if the cpu has to stop before running it
+internal b32
+nes_memory_map_execute_trap(NesMemoryMap* map, nes_addr pc) {
+
+    NesMemoryMapDebug* debug = &map->debug;
+
+    if (debug->resume_skip == TRUE) {
+        debug->resume_skip = FALSE;
+        if (debug->resume_pc == pc) {
+            return FALSE;
+        }
+    }
+
+    nes_memory_map_trap(map, pc, 0, NES_MEM_MAP_WATCH_EXECUTE);
+
+    return debug->stopped;
+}
+
+//moves every page touched by a watchpoint onto the slow path and everything else back off it
+internal void
+nes_memory_map_watchpoint_update_pages(NesMemoryMap* map) {
+
+    NesMemoryMapDebug* debug = &map->debug;
+    NesMemoryMapPageTable* page_table = &map->page_table;
+
+    for (u32 page = 0; page < NES_MEM_MAP_PAGE_COUNT; ++page) {
+        page_table->read_flags[page]   &= ~NES_MEM_MAP_PAGE_FLAG_TRAP;
+        page_table->write_flags[page]  &= ~NES_MEM_MAP_PAGE_FLAG_TRAP;
+        page_table->execute_flags[page] = 0;
+    }
+
+    debug->count_watchpoints = 0;
+
+    for (u32 watchpoint_index = 0; watchpoint_index < NES_MEM_MAP_WATCHPOINT_COUNT; ++watchpoint_index) {
+
+        NesMemoryMapWatchpoint* watchpoint = &debug->watchpoints[watchpoint_index];
+        if (watchpoint->enabled != TRUE) {
+            continue;
+        }
+
+        ++debug->count_watchpoints;
+
+        u32 page_end = watchpoint->address_end >> NES_MEM_MAP_PAGE_SHIFT;
+        for (u32 page = watchpoint->address_begin >> NES_MEM_MAP_PAGE_SHIFT; page <= page_end; ++page) {
+            if (watchpoint->watch_flags & NES_MEM_MAP_WATCH_READ) {
+                page_table->read_flags[page] |= NES_MEM_MAP_PAGE_FLAG_TRAP;
+            }
+            if (watchpoint->watch_flags & NES_MEM_MAP_WATCH_WRITE) {
+                page_table->write_flags[page] |= NES_MEM_MAP_PAGE_FLAG_TRAP;
+            }
+            if (watchpoint->watch_flags & NES_MEM_MAP_WATCH_EXECUTE) {
+                page_table->execute_flags[page] = 1;
+            }
+        }
+    }
+}
+
+//returns the watchpoint index or -1 if they're all taken
+internal i32
+nes_memory_map_watchpoint_add(NesMemoryMap* map, nes_addr address_begin, nes_addr address_end, u8 watch_flags) {
+
+    if (address_end < address_begin || watch_flags == 0) {
+        return -1;
+    }
+
+    for (u32 watchpoint_index = 0; watchpoint_index < NES_MEM_MAP_WATCHPOINT_COUNT; ++watchpoint_index) {
+
+        NesMemoryMapWatchpoint* watchpoint = &map->debug.watchpoints[watchpoint_index];
+        if (watchpoint->enabled == TRUE) {
+            continue;
+        }
+
+        watchpoint->address_begin = address_begin;
+        watchpoint->address_end   = address_end;
+        watchpoint->watch_flags   = watch_flags;
+        watchpoint->enabled       = TRUE;
+
+        nes_memory_map_watchpoint_update_pages(map);
+
+        return (i32)watchpoint_index;
+    }
+
+    return -1;
+}
+
+internal void
+nes_memory_map_watchpoint_remove(NesMemoryMap* map, u32 watchpoint_index) {
+
+    ASSERT(watchpoint_index < NES_MEM_MAP_WATCHPOINT_COUNT);
+
+    map->debug.watchpoints[watchpoint_index] = {0};
+    map->debug.watchpoints[watchpoint_index].enabled = FALSE;
+
+    nes_memory_map_watchpoint_update_pages(map);
+}
+
+//clears the stop, if we stopped on an execute breakpoint the instruction there runs next instead of trapping again
+internal void
+nes_memory_map_debug_resume(NesMemoryMap* map, nes_addr pc) {
+
+    NesMemoryMapDebug* debug = &map->debug;
+
+    debug->resume_skip = (debug->stopped == TRUE && debug->trap.watch_flag == NES_MEM_MAP_WATCH_EXECUTE) ? TRUE : FALSE;
+    debug->resume_pc   = pc;
+    debug->stopped     = FALSE;
+}
+
+/***************
+ * CONTROLLERS *
+ ***************/
+
 internal nes_val
-nes_memory_map_read(NesMemoryMap* map, nes_addr address) {
+nes_memory_map_controller_read(NesMemoryMap* map, u32 controller_index) {
+
+    NesMemoryMapControllers* controllers = &map->controllers;
+
+    //while the strobe is held the shift register keeps reloading, so reads keep returning a
+    if (controllers->strobe == TRUE) {
+        controllers->shift[controller_index] = controllers->buttons[controller_index];
+    }
+
+    nes_val value = (controllers->shift[controller_index] & 1) | NES_MEM_MAP_CONTROLLER_OPEN_BUS;
+
+    //once all 8 buttons are out, official controllers read back 1s
+    controllers->shift[controller_index] = (controllers->shift[controller_index] >> 1) | 0x80;
+
+    return value;
+}
+
+internal void
+nes_memory_map_controller_strobe(NesMemoryMap* map, nes_val value) {
 
-    //read from RAM
-    if ((address >= NES_MEM_MAP_RAM_BEGIN) && (address <= NES_MEM_MAP_RAM_END)) {
-        //we can do a bitwise mask here because this address is mirrored between 0x0800 and 0x2000
-        return ((nes_val*)(&(map->ram)))[address & 0x07FF];
+    NesMemoryMapControllers* controllers = &map->controllers;
+
+    controllers->strobe = (value & 1) ? TRUE : FALSE;
+    if (controllers->strobe == TRUE) {
+        for (u32 controller_index = 0; controller_index < NES_MEM_MAP_CONTROLLER_COUNT; ++controller_index) {
+            controllers->shift[controller_index] = controllers->buttons[controller_index];
+        }
+    }
+}
+
+/***********
+ * OAM DMA *
+ ***********/
+
+internal void
+nes_memory_map_oam_dma(NesMemoryMap* map, nes_val page) {
+
+    //the copy happens before the cpu gets the bus back, so later writes to the page don't make it into this one
+    nes_addr page_address = (nes_addr)(page << NES_MEM_MAP_PAGE_SHIFT);
+    for (u32 byte_index = 0; byte_index < NES_MEM_MAP_OAM_DMA_SIZE; ++byte_index) {
+        map->oam_dma.page[byte_index] = *nes_memory_map_address(map, (nes_addr)(page_address + byte_index));
+    }
+
+    map->oam_dma.pending = TRUE;
+    map->oam_dma.stall   = TRUE;
+}
+
+/*******
+ * BUS *
+ *******/
+
+internal nes_val
+nes_memory_map_read_slow(NesMemoryMap* map, nes_addr address) {
+
+    u32 page = address >> NES_MEM_MAP_PAGE_SHIFT;
+    u8 read_flags = map->page_table.read_flags[page];
+
+    nes_val value = 0;
+    if (address == NES_MEM_MAP_CONTROLLER_1_ADDR || address == NES_MEM_MAP_CONTROLLER_2_ADDR) {
+        value = nes_memory_map_controller_read(map, address - NES_MEM_MAP_CONTROLLER_1_ADDR);
+    }
+    else {
+        value = *nes_memory_map_address(map, address);
     }
-    //read from io registers
-    if ((address >= NES_MEM_MAP_IO_REG_BEGIN) && (address <= NES_MEM_MAP_IO_REG_END)) {
-        //TODO - io registers have not been defined yet
+
+    if (read_flags & NES_MEM_MAP_PAGE_FLAG_TRAP) {
+        nes_memory_map_trap(map, address, value, NES_MEM_MAP_WATCH_READ);
     }
 
+    return value;
 }
 
 internal void
-nes_memory_map_write(NesMemoryMap* map, nes_addr address, nes_val value) {
-    
-    //read from RAM
-    if ((address >= NES_MEM_MAP_RAM_BEGIN) && (address <= NES_MEM_MAP_RAM_END)) {
-        //we can do a bitwise mask here because this address is mirrored between 0x0800 and 0x2000
-        ((nes_val*)(&(map->ram)))[address & 0x07FF] = value;
+nes_memory_map_write_slow(NesMemoryMap* map, nes_addr address, nes_val value) {
+
+    u32 page = address >> NES_MEM_MAP_PAGE_SHIFT;
+    u8 write_flags = map->page_table.write_flags[page];
+
+    if (write_flags & NES_MEM_MAP_PAGE_FLAG_TRAP) {
+        nes_memory_map_trap(map, address, value, NES_MEM_MAP_WATCH_WRITE);
+    }
+
+    if (write_flags & NES_MEM_MAP_PAGE_FLAG_TRACK) {
+        nes_memory_map_dirty_mark(map, page);
+    }
+
+    //$4017 is the apu frame counter on writes, only $4016 talks to the controllers
+    if (address == NES_MEM_MAP_CONTROLLER_1_ADDR) {
+        nes_memory_map_controller_strobe(map, value);
+    }
+    else if (address == NES_MEM_MAP_OAM_DMA_ADDR) {
+        nes_memory_map_oam_dma(map, value);
+    }
+
+    if ((write_flags & NES_MEM_MAP_PAGE_FLAG_ROM) == 0) {
+        *nes_memory_map_address(map, address) = value;
     }
 }
 
-internal nes_val*
-nes_memory_map_address(NesMemoryMap* map, nes_addr address) {
+internal nes_val
+nes_memory_map_read(NesMemoryMap* map, nes_addr address) {
+
+    u32 page = address >> NES_MEM_MAP_PAGE_SHIFT;
 
-    return &(((nes_val*)(map))[address]);
-}
\ No newline at end of file
+    if (map->page_table.read_flags[page] == 0) {
+        return ((nes_val*)map)[map->page_table.offsets[page] + (address & NES_MEM_MAP_PAGE_MASK)];
+    }
+
+    return nes_memory_map_read_slow(map, address);
+}
+
+internal void
+nes_memory_map_write(NesMemoryMap* map, nes_addr address, nes_val value) {
+    
+    u32 page = address >> NES_MEM_MAP_PAGE_SHIFT;
+
+    if (map->page_table.write_flags[page] == 0) {
+        ((nes_val*)map)[map->page_table.offsets[page] + (address & NES_MEM_MAP_PAGE_MASK)] = value;
+        return;
+    }
+
+    nes_memory_map_write_slow(map, address, value);
+}
@@ -1,6 +1,7 @@
 #ifndef NES_MEMORY_MAP_HPP
 #define NES_MEMORY_MAP_HPP
 
+#include <stddef.h>
 #include "nes-types.h"
 
 #define NES_MEM_MAP_ZERO_PAGE_ADDR  0x0000
@@ -39,7 +40,44 @@ struct NesMemoryMapRam {
 #define NES_MEM_MAP_IO_REG_MIRROR_SIZE 0x1FF8
 
 #define NES_MEM_MAP_UPPER_IO_REG_ADDR  0x4000
-#define NES_MEM_MAP_UPPER_IO_REG_SIZE  0x0008
+#define NES_MEM_MAP_UPPER_IO_REG_SIZE  0x0020
+
+//standard controllers, reads shift the buttons out one at a time in this order
+#define NES_MEM_MAP_CONTROLLER_1_ADDR    0x4016
+#define NES_MEM_MAP_CONTROLLER_2_ADDR    0x4017
+#define NES_MEM_MAP_CONTROLLER_COUNT     2
+#define NES_MEM_MAP_CONTROLLER_A         0x01
+#define NES_MEM_MAP_CONTROLLER_B         0x02
+#define NES_MEM_MAP_CONTROLLER_SELECT    0x04
+#define NES_MEM_MAP_CONTROLLER_START     0x08
+#define NES_MEM_MAP_CONTROLLER_UP        0x10
+#define NES_MEM_MAP_CONTROLLER_DOWN      0x20
+#define NES_MEM_MAP_CONTROLLER_LEFT      0x40
+#define NES_MEM_MAP_CONTROLLER_RIGHT     0x80
+//the upper bits of a controller read are whatever was last on the bus, which is $40 from the address
+#define NES_MEM_MAP_CONTROLLER_OPEN_BUS  0x40
+
+struct NesMemoryMapControllers {
+    //what's held down right now, set by the platform
+    nes_val buttons[NES_MEM_MAP_CONTROLLER_COUNT];
+    //latched on the strobe, reads shift it out
+    nes_val shift[NES_MEM_MAP_CONTROLLER_COUNT];
+    b32 strobe;
+};
+
+//writing a page number here copies that whole page of cpu memory into the ppu's oam
+#define NES_MEM_MAP_OAM_DMA_ADDR   0x4014
+#define NES_MEM_MAP_OAM_DMA_SIZE   0x0100
+//the cpu is held off the bus while the page goes over, one cycle more if it starts on an odd cycle
+#define NES_MEM_MAP_OAM_DMA_CYCLES 513
+
+struct NesMemoryMapOamDma {
+    //the page as it was when $4014 was written, the ppu isn't ours so it picks it up after the burst
+    u8 page[NES_MEM_MAP_OAM_DMA_SIZE];
+    b32 pending;
+    //the cpu pays for the copy after the instruction that started it
+    b32 stall;
+};
 
 //$2000 - $401F
 struct NesMemoryMapIoRegisters {
@@ -71,6 +109,89 @@ struct NesMemoryMapPrgRom {
     u8 upper_bank[NES_MEM_MAP_UPPER_PRG_ROM_SIZE];
 };
 
+//which 16kb banks of the whole prg rom sit in $8000 - $BFFF and $C000 - $FFFF, for
+//anything that keeps per byte state over all of prg rom rather than just what's mapped
+#define NES_MEM_MAP_PRG_ROM_BANK_SIZE 0x4000
+
+struct NesMemoryMapPrgRomBanks {
+    u32 mapped[2];
+};
+
+//the bus is split into 256 byte pages, each one either points straight at its memory
+//or takes the slow path for devices, rom and debug traps
+#define NES_MEM_MAP_PAGE_COUNT 256
+#define NES_MEM_MAP_PAGE_SIZE  256
+#define NES_MEM_MAP_PAGE_SHIFT 8
+#define NES_MEM_MAP_PAGE_MASK  0xFF
+
+//why a page is on the slow path, 0 means direct access
+#define NES_MEM_MAP_PAGE_FLAG_IO   0x01
+#define NES_MEM_MAP_PAGE_FLAG_ROM  0x02
+#define NES_MEM_MAP_PAGE_FLAG_TRAP 0x04
+//clean page being watched for its first write, see nes_memory_map_dirty_track
+#define NES_MEM_MAP_PAGE_FLAG_TRACK 0x08
+
+//dirty tracking covers the writable memory that isn't a device, ram is tracked by its
+//first 2KB and a write to any mirror dirties the same page
+#define NES_MEM_MAP_DIRTY_RAM_PAGES   (NES_MEM_MAP_RAM_MIRROR_ADDR >> NES_MEM_MAP_PAGE_SHIFT)
+#define NES_MEM_MAP_DIRTY_RAM_MIRRORS ((NES_MEM_MAP_RAM_END + 1) / NES_MEM_MAP_RAM_MIRROR_ADDR)
+//$4100 - $7FFF, the rest of expansion rom and sram
+#define NES_MEM_MAP_DIRTY_UPPER_BEGIN ((NES_MEM_MAP_UPPER_IO_REG_ADDR >> NES_MEM_MAP_PAGE_SHIFT) + 1)
+#define NES_MEM_MAP_DIRTY_UPPER_END   (NES_MEM_MAP_LOWER_PRG_ROM_ADDR >> NES_MEM_MAP_PAGE_SHIFT)
+#define NES_MEM_MAP_DIRTY_SRAM_BEGIN  (NES_MEM_MAP_SRAM_ADDR >> NES_MEM_MAP_PAGE_SHIFT)
+
+//who a page is dirty for, each clears its own bit once it has caught up and the
+//page only goes back to trapping its first write when nobody is left
+#define NES_MEM_MAP_DIRTY_STATE_HASH 0x01
+#define NES_MEM_MAP_DIRTY_SAVE_FILE  0x02
+
+struct NesMemoryMapPageTable {
+    //where each page lives as a byte offset into the memory map, offsets stay valid when the map is copied
+    u32 offsets[NES_MEM_MAP_PAGE_COUNT];
+    u8 read_flags[NES_MEM_MAP_PAGE_COUNT];
+    u8 write_flags[NES_MEM_MAP_PAGE_COUNT];
+    //non zero if an execute breakpoint sits somewhere in the page
+    u8 execute_flags[NES_MEM_MAP_PAGE_COUNT];
+    //NES_MEM_MAP_DIRTY_* for everyone that hasn't caught up with a write to the page yet, ram mirrors use their first page
+    u8 dirty[NES_MEM_MAP_PAGE_COUNT];
+    //what a write to sram dirties on top of the state hash, the save file only joins in once there is one
+    u8 dirty_sram_bits;
+};
+
+#define NES_MEM_MAP_WATCHPOINT_COUNT 16
+
+#define NES_MEM_MAP_WATCH_READ    0x01
+#define NES_MEM_MAP_WATCH_WRITE   0x02
+#define NES_MEM_MAP_WATCH_EXECUTE 0x04
+
+struct NesMemoryMapWatchpoint {
+    nes_addr address_begin;
+    //inclusive
+    nes_addr address_end;
+    u8 watch_flags;
+    b32 enabled;
+};
+
+//the access that stopped the cpu
+struct NesMemoryMapTrap {
+    nes_addr address;
+    nes_val value;
+    u8 watch_flag;
+    u32 watchpoint_index;
+};
+
+struct NesMemoryMapDebug {
+    NesMemoryMapWatchpoint watchpoints[NES_MEM_MAP_WATCHPOINT_COUNT];
+    u32 count_watchpoints;
+    //set when a watchpoint fires, the cpu stops once the current instruction is done
+    b32 stopped;
+    NesMemoryMapTrap trap;
+    u64 count_traps;
+    //lets the instruction sitting on an execute breakpoint run once we resume
+    b32 resume_skip;
+    nes_addr resume_pc;
+};
+
 struct NesMemoryMap {
     //$0000 - $1FFF
     NesMemoryMapRam ram;
@@ -82,6 +203,11 @@ struct NesMemoryMap {
     u8 sram[NES_MEM_MAP_SRAM_SIZE];
     //$8000 - $10000
     NesMemoryMapPrgRom prg_rom;
+
+    NesMemoryMapPageTable page_table;
+    NesMemoryMapDebug debug;
+    NesMemoryMapControllers controllers;
+    NesMemoryMapOamDma oam_dma;
 };
 
 #endif //NES_MEMORY_MAP_HPP
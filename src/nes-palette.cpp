@@ -0,0 +1,388 @@
+#include "nes-palette.hpp"
+
+//2C02 ntsc palette
+global nes_pixel nes_palette_base_colors[NES_PALETTE_COLOR_COUNT] = {
+    0xFF666666, 0xFF002A88, 0xFF1412A7, 0xFF3B00A4, 0xFF5C007E, 0xFF6E0040, 0xFF6C0600, 0xFF561D00,
+    0xFF333500, 0xFF0B4800, 0xFF005200, 0xFF004F08, 0xFF00404D, 0xFF000000, 0xFF000000, 0xFF000000,
+    0xFFADADAD, 0xFF155FD9, 0xFF4240FF, 0xFF7527FE, 0xFFA01ACC, 0xFFB71E7B, 0xFFB53120, 0xFF994E00,
+    0xFF6B6D00, 0xFF388700, 0xFF0C9300, 0xFF008F32, 0xFF007C8D, 0xFF000000, 0xFF000000, 0xFF000000,
+    0xFFFFFEFF, 0xFF64B0FF, 0xFF9290FF, 0xFFC676FF, 0xFFF36AFF, 0xFFFE6ECC, 0xFFFE8170, 0xFFEA9E22,
+    0xFFBCBE00, 0xFF88D800, 0xFF5CE430, 0xFF45E082, 0xFF48CDDE, 0xFF4F4F4F, 0xFF000000, 0xFF000000,
+    0xFFFFFEFF, 0xFFC0DFFF, 0xFFD3D2FF, 0xFFE8C8FF, 0xFFFBC2FF, 0xFFFEC4EA, 0xFFFECCC5, 0xFFF7D8A5,
+    0xFFE4E594, 0xFFCFEF96, 0xFFBDF4AB, 0xFFB3F3CC, 0xFFB5EBF2, 0xFFB8B8B8, 0xFF000000, 0xFF000000
+};
+
+global NesPaletteTables nes_palette_tables;
+
+internal void
+nes_palette_convert_row_scalar(u8* palette_indices, u32 emphasis, nes_pixel* pixels, u32 pixels_pitch, u32 scale) {
+
+    nes_pixel* colors = nes_palette_tables.colors[emphasis];
+
+    if (scale == 1) {
+        for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; ++column) {
+            pixels[column] = colors[palette_indices[column] & NES_PALETTE_COLOR_MASK];
+        }
+        return;
+    }
+
+    //stretch horizontally into the first output row...
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; ++column) {
+        nes_pixel pixel = colors[palette_indices[column] & NES_PALETTE_COLOR_MASK];
+        for (u32 scale_index = 0; scale_index < scale; ++scale_index) {
+            pixels[(column * scale) + scale_index] = pixel;
+        }
+    }
+
+    //...then copy it down for the rest
+    for (u32 scale_index = 1; scale_index < scale; ++scale_index) {
+        memcpy(&pixels[scale_index * pixels_pitch], pixels, NES_PPU_FRAME_BUFFER_WIDTH * scale * sizeof(nes_pixel));
+    }
+}
+
+#if NES_PALETTE_X86
+
+//4 pixels go out to every one of the scale rows
+NES_PALETTE_TARGET_SSE41 internal inline void
+nes_palette_store_sse41(__m128i four_pixels, nes_pixel* pixels, u32 pixels_pitch, u32 scale) {
+
+    for (u32 scale_index = 0; scale_index < scale; ++scale_index) {
+
+        __m128i* row = (__m128i*)&pixels[scale_index * pixels_pitch];
+
+        switch (scale) {
+            case 1: {
+                _mm_storeu_si128(row, four_pixels);
+            } break;
+            case 2: {
+                _mm_storeu_si128(row + 0, _mm_unpacklo_epi32(four_pixels, four_pixels));
+                _mm_storeu_si128(row + 1, _mm_unpackhi_epi32(four_pixels, four_pixels));
+            } break;
+            case 3: {
+                _mm_storeu_si128(row + 0, _mm_shuffle_epi32(four_pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+                _mm_storeu_si128(row + 1, _mm_shuffle_epi32(four_pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+                _mm_storeu_si128(row + 2, _mm_shuffle_epi32(four_pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+            } break;
+        }
+    }
+}
+
+//each byte plane is looked up 16 entries at a time with pshufb, the top 2 index bits pick which 16
+NES_PALETTE_TARGET_SSE41 internal void
+nes_palette_convert_row_sse41(u8* palette_indices, u32 emphasis, nes_pixel* pixels, u32 pixels_pitch, u32 scale) {
+
+    __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    __m128i alpha       = _mm_set1_epi8((char)0xFF);
+
+    __m128i plane_tables[3][4];
+    for (u32 plane = 0; plane < 3; ++plane) {
+        for (u32 quarter = 0; quarter < 4; ++quarter) {
+            plane_tables[plane][quarter] = _mm_loadu_si128((__m128i*)&nes_palette_tables.planes[emphasis][plane][quarter * 16]);
+        }
+    }
+
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; column += 16) {
+
+        __m128i indices = _mm_loadu_si128((__m128i*)&palette_indices[column]);
+        __m128i low     = _mm_and_si128(indices, nibble_mask);
+        __m128i high    = _mm_and_si128(_mm_srli_epi16(indices, 4), _mm_set1_epi8(0x03));
+
+        __m128i select_1 = _mm_cmpeq_epi8(high, _mm_set1_epi8(1));
+        __m128i select_2 = _mm_cmpeq_epi8(high, _mm_set1_epi8(2));
+        __m128i select_3 = _mm_cmpeq_epi8(high, _mm_set1_epi8(3));
+
+        __m128i planes[3];
+        for (u32 plane = 0; plane < 3; ++plane) {
+            __m128i value = _mm_shuffle_epi8(plane_tables[plane][0], low);
+            value = _mm_blendv_epi8(value, _mm_shuffle_epi8(plane_tables[plane][1], low), select_1);
+            value = _mm_blendv_epi8(value, _mm_shuffle_epi8(plane_tables[plane][2], low), select_2);
+            value = _mm_blendv_epi8(value, _mm_shuffle_epi8(plane_tables[plane][3], low), select_3);
+            planes[plane] = value;
+        }
+
+        //interleave the planes back into BGRA
+        __m128i blue_green_low  = _mm_unpacklo_epi8(planes[0], planes[1]);
+        __m128i blue_green_high = _mm_unpackhi_epi8(planes[0], planes[1]);
+        __m128i red_alpha_low   = _mm_unpacklo_epi8(planes[2], alpha);
+        __m128i red_alpha_high  = _mm_unpackhi_epi8(planes[2], alpha);
+
+        nes_pixel* column_pixels = &pixels[column * scale];
+        nes_palette_store_sse41(_mm_unpacklo_epi16(blue_green_low,  red_alpha_low),  column_pixels + (0  * scale), pixels_pitch, scale);
+        nes_palette_store_sse41(_mm_unpackhi_epi16(blue_green_low,  red_alpha_low),  column_pixels + (4  * scale), pixels_pitch, scale);
+        nes_palette_store_sse41(_mm_unpacklo_epi16(blue_green_high, red_alpha_high), column_pixels + (8  * scale), pixels_pitch, scale);
+        nes_palette_store_sse41(_mm_unpackhi_epi16(blue_green_high, red_alpha_high), column_pixels + (12 * scale), pixels_pitch, scale);
+    }
+}
+
+//same lookup as the color kernels but with one plane, then widened to 16 bits and added on
+NES_PALETTE_TARGET_SSE41 internal void
+nes_palette_observation_row_sse41(u8* row, u8* gray, u16* column_sums) {
+
+    __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    __m128i zero        = _mm_setzero_si128();
+
+    __m128i gray_tables[4];
+    for (u32 quarter = 0; quarter < 4; ++quarter) {
+        gray_tables[quarter] = _mm_loadu_si128((__m128i*)&gray[quarter * 16]);
+    }
+
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; column += 16) {
+
+        __m128i indices = _mm_loadu_si128((__m128i*)&row[column]);
+        __m128i low     = _mm_and_si128(indices, nibble_mask);
+        __m128i high    = _mm_and_si128(_mm_srli_epi16(indices, 4), _mm_set1_epi8(0x03));
+
+        __m128i shades = _mm_shuffle_epi8(gray_tables[0], low);
+        shades = _mm_blendv_epi8(shades, _mm_shuffle_epi8(gray_tables[1], low), _mm_cmpeq_epi8(high, _mm_set1_epi8(1)));
+        shades = _mm_blendv_epi8(shades, _mm_shuffle_epi8(gray_tables[2], low), _mm_cmpeq_epi8(high, _mm_set1_epi8(2)));
+        shades = _mm_blendv_epi8(shades, _mm_shuffle_epi8(gray_tables[3], low), _mm_cmpeq_epi8(high, _mm_set1_epi8(3)));
+
+        __m128i* sums = (__m128i*)&column_sums[column];
+        _mm_storeu_si128(sums + 0, _mm_add_epi16(_mm_loadu_si128(sums + 0), _mm_unpacklo_epi8(shades, zero)));
+        _mm_storeu_si128(sums + 1, _mm_add_epi16(_mm_loadu_si128(sums + 1), _mm_unpackhi_epi8(shades, zero)));
+    }
+}
+
+//8 pixels go out to every one of the scale rows
+NES_PALETTE_TARGET_AVX2 internal inline void
+nes_palette_store_avx2(__m256i eight_pixels, nes_pixel* pixels, u32 pixels_pitch, u32 scale) {
+
+    for (u32 scale_index = 0; scale_index < scale; ++scale_index) {
+
+        __m256i* row = (__m256i*)&pixels[scale_index * pixels_pitch];
+
+        switch (scale) {
+            case 1: {
+                _mm256_storeu_si256(row, eight_pixels);
+            } break;
+            case 2: {
+                _mm256_storeu_si256(row + 0, _mm256_permutevar8x32_epi32(eight_pixels, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3)));
+                _mm256_storeu_si256(row + 1, _mm256_permutevar8x32_epi32(eight_pixels, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7)));
+            } break;
+            case 3: {
+                _mm256_storeu_si256(row + 0, _mm256_permutevar8x32_epi32(eight_pixels, _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2)));
+                _mm256_storeu_si256(row + 1, _mm256_permutevar8x32_epi32(eight_pixels, _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5)));
+                _mm256_storeu_si256(row + 2, _mm256_permutevar8x32_epi32(eight_pixels, _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7)));
+            } break;
+        }
+    }
+}
+
+//same idea as sse41, 32 pixels at a time with the 16 entry tables repeated in both lanes
+NES_PALETTE_TARGET_AVX2 internal void
+nes_palette_convert_row_avx2(u8* palette_indices, u32 emphasis, nes_pixel* pixels, u32 pixels_pitch, u32 scale) {
+
+    __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    __m256i alpha       = _mm256_set1_epi8((char)0xFF);
+
+    __m256i plane_tables[3][4];
+    for (u32 plane = 0; plane < 3; ++plane) {
+        for (u32 quarter = 0; quarter < 4; ++quarter) {
+            plane_tables[plane][quarter] = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)&nes_palette_tables.planes[emphasis][plane][quarter * 16]));
+        }
+    }
+
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; column += 32) {
+
+        __m256i indices = _mm256_loadu_si256((__m256i*)&palette_indices[column]);
+        __m256i low     = _mm256_and_si256(indices, nibble_mask);
+        __m256i high    = _mm256_and_si256(_mm256_srli_epi16(indices, 4), _mm256_set1_epi8(0x03));
+
+        __m256i select_1 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(1));
+        __m256i select_2 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(2));
+        __m256i select_3 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(3));
+
+        __m256i planes[3];
+        for (u32 plane = 0; plane < 3; ++plane) {
+            __m256i value = _mm256_shuffle_epi8(plane_tables[plane][0], low);
+            value = _mm256_blendv_epi8(value, _mm256_shuffle_epi8(plane_tables[plane][1], low), select_1);
+            value = _mm256_blendv_epi8(value, _mm256_shuffle_epi8(plane_tables[plane][2], low), select_2);
+            value = _mm256_blendv_epi8(value, _mm256_shuffle_epi8(plane_tables[plane][3], low), select_3);
+            planes[plane] = value;
+        }
+
+        //unpacks stay inside each 128 bit lane, so lane 0 has pixels 0-15 and lane 1 has 16-31
+        __m256i blue_green_low  = _mm256_unpacklo_epi8(planes[0], planes[1]);
+        __m256i blue_green_high = _mm256_unpackhi_epi8(planes[0], planes[1]);
+        __m256i red_alpha_low   = _mm256_unpacklo_epi8(planes[2], alpha);
+        __m256i red_alpha_high  = _mm256_unpackhi_epi8(planes[2], alpha);
+
+        __m256i pixels_0_3   = _mm256_unpacklo_epi16(blue_green_low,  red_alpha_low);
+        __m256i pixels_4_7   = _mm256_unpackhi_epi16(blue_green_low,  red_alpha_low);
+        __m256i pixels_8_11  = _mm256_unpacklo_epi16(blue_green_high, red_alpha_high);
+        __m256i pixels_12_15 = _mm256_unpackhi_epi16(blue_green_high, red_alpha_high);
+
+        nes_pixel* column_pixels = &pixels[column * scale];
+        nes_palette_store_avx2(_mm256_permute2x128_si256(pixels_0_3,  pixels_4_7,   0x20), column_pixels + (0  * scale), pixels_pitch, scale);
+        nes_palette_store_avx2(_mm256_permute2x128_si256(pixels_8_11, pixels_12_15, 0x20), column_pixels + (8  * scale), pixels_pitch, scale);
+        nes_palette_store_avx2(_mm256_permute2x128_si256(pixels_0_3,  pixels_4_7,   0x31), column_pixels + (16 * scale), pixels_pitch, scale);
+        nes_palette_store_avx2(_mm256_permute2x128_si256(pixels_8_11, pixels_12_15, 0x31), column_pixels + (24 * scale), pixels_pitch, scale);
+    }
+}
+
+internal void
+nes_palette_cpuid(u32 leaf, u32 sub_leaf, u32* registers) {
+
+#if defined(_MSC_VER)
+    __cpuidex((int*)registers, (int)leaf, (int)sub_leaf);
+#else
+    __cpuid_count(leaf, sub_leaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+internal u64
+nes_palette_xgetbv() {
+
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    u32 eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((u64)edx << 32) | eax;
+#endif
+}
+
+#endif //NES_PALETTE_X86
+
+internal void
+nes_palette_detect_kernels(b32* kernel_available) {
+
+    kernel_available[NesPaletteKernel::scalar] = TRUE;
+    kernel_available[NesPaletteKernel::sse41]  = FALSE;
+    kernel_available[NesPaletteKernel::avx2]   = FALSE;
+
+#if NES_PALETTE_X86
+    u32 registers[4] = {0};
+
+    nes_palette_cpuid(0, 0, registers);
+    u32 max_leaf = registers[0];
+
+    nes_palette_cpuid(1, 0, registers);
+    b32 has_ssse3   = ((registers[2] >> 9)  & 1) ? TRUE : FALSE;
+    b32 has_sse41   = ((registers[2] >> 19) & 1) ? TRUE : FALSE;
+    b32 has_osxsave = ((registers[2] >> 27) & 1) ? TRUE : FALSE;
+    b32 has_avx     = ((registers[2] >> 28) & 1) ? TRUE : FALSE;
+
+    if (has_ssse3 == TRUE && has_sse41 == TRUE) {
+        kernel_available[NesPaletteKernel::sse41] = TRUE;
+    }
+
+    //the os has to save the upper halves of the ymm registers too
+    if (max_leaf >= 7 && has_osxsave == TRUE && has_avx == TRUE && (nes_palette_xgetbv() & 0x6) == 0x6) {
+        nes_palette_cpuid(7, 0, registers);
+        if ((registers[1] >> 5) & 1) {
+            kernel_available[NesPaletteKernel::avx2] = TRUE;
+        }
+    }
+#endif
+}
+
+internal b32
+nes_palette_set_kernel(NesPaletteKernel kernel) {
+
+    if (nes_palette_tables.kernel_available[kernel] != TRUE) {
+        return FALSE;
+    }
+
+    nes_palette_tables.kernel = kernel;
+
+    switch (kernel) {
+#if NES_PALETTE_X86
+        case NesPaletteKernel::avx2:  nes_palette_tables.convert_row = nes_palette_convert_row_avx2;  break;
+        case NesPaletteKernel::sse41: nes_palette_tables.convert_row = nes_palette_convert_row_sse41; break;
+#endif
+        default:                      nes_palette_tables.convert_row = nes_palette_convert_row_scalar; break;
+    }
+
+    return TRUE;
+}
+
+internal char*
+nes_palette_kernel_str(NesPaletteKernel kernel) {
+
+    switch (kernel) {
+        case NesPaletteKernel::scalar: return "scalar";
+        case NesPaletteKernel::sse41:  return "sse4.1";
+        case NesPaletteKernel::avx2:   return "avx2";
+        default:                       return "???";
+    }
+}
+
+//builds the emphasis palettes and picks the fastest kernel this cpu can run
+internal void
+nes_palette_initialize() {
+
+    for (u32 emphasis = 0; emphasis < NES_PALETTE_EMPHASIS_COUNT; ++emphasis) {
+        for (u32 color_index = 0; color_index < NES_PALETTE_COLOR_COUNT; ++color_index) {
+
+            nes_pixel base_color = nes_palette_base_colors[color_index];
+            u32 red   = (base_color >> 16) & 0xFF;
+            u32 green = (base_color >> 8)  & 0xFF;
+            u32 blue  = base_color         & 0xFF;
+
+            //with no emphasis bits set, nothing changes
+            if (emphasis != 0) {
+                if (!(emphasis & NES_PALETTE_EMPHASIS_RED))   red   = NES_PALETTE_EMPHASIS_ATTENUATE(red);
+                if (!(emphasis & NES_PALETTE_EMPHASIS_GREEN)) green = NES_PALETTE_EMPHASIS_ATTENUATE(green);
+                if (!(emphasis & NES_PALETTE_EMPHASIS_BLUE))  blue  = NES_PALETTE_EMPHASIS_ATTENUATE(blue);
+            }
+
+            nes_palette_tables.colors[emphasis][color_index]    = 0xFF000000 | (red << 16) | (green << 8) | blue;
+            nes_palette_tables.planes[emphasis][0][color_index] = (u8)blue;
+            nes_palette_tables.planes[emphasis][1][color_index] = (u8)green;
+            nes_palette_tables.planes[emphasis][2][color_index] = (u8)red;
+        }
+    }
+
+    nes_palette_detect_kernels(nes_palette_tables.kernel_available);
+
+    //best first
+    if      (nes_palette_set_kernel(NesPaletteKernel::avx2)  == TRUE) {}
+    else if (nes_palette_set_kernel(NesPaletteKernel::sse41) == TRUE) {}
+    else    nes_palette_set_kernel(NesPaletteKernel::scalar);
+}
+
+//fills in the gray shades for a grayscale observation and picks the fastest way to add rows up,
+//bt.601 luma so it matches what most image libraries give you for rgb to gray
+//nes_palette_initialize has to have been called
+internal void
+nes_palette_observation_initialize(NesPpuObservation* observation) {
+
+    for (u32 emphasis = 0; emphasis < NES_PALETTE_EMPHASIS_COUNT; ++emphasis) {
+        for (u32 color_index = 0; color_index < NES_PALETTE_COLOR_COUNT; ++color_index) {
+
+            nes_pixel color = nes_palette_tables.colors[emphasis][color_index];
+            u32 red   = (color >> 16) & 0xFF;
+            u32 green = (color >> 8)  & 0xFF;
+            u32 blue  = color         & 0xFF;
+
+            observation->gray[emphasis][color_index] = (u8)(((red * 299) + (green * 587) + (blue * 114) + 500) / 1000);
+        }
+    }
+
+    //avx2 only has 16 byte shuffles too, so it wouldn't buy anything here
+#if NES_PALETTE_X86
+    if (nes_palette_tables.kernel != NesPaletteKernel::scalar) {
+        observation->accumulate_row = nes_palette_observation_row_sse41;
+    }
+#endif
+}
+
+//converts a whole ppu frame and scales it up by a whole number, pixels has to be (256 * scale) x (240 * scale)
+//every row can have its own emphasis since games can change $2001 mid frame
+internal void
+nes_palette_convert_frame(u8* frame_buffer, u8* row_emphasis, nes_pixel* pixels, u32 scale) {
+
+    ASSERT(scale >= 1 && scale <= NES_PALETTE_MAX_SCALE);
+
+    u32 pixels_pitch = NES_PPU_FRAME_BUFFER_WIDTH * scale;
+
+    for (u32 row = 0; row < NES_PPU_FRAME_BUFFER_HEIGHT; ++row) {
+        nes_palette_tables.convert_row(
+            &frame_buffer[row * NES_PPU_FRAME_BUFFER_WIDTH],
+            row_emphasis[row] & (NES_PALETTE_EMPHASIS_COUNT - 1),
+            &pixels[row * scale * pixels_pitch],
+            pixels_pitch,
+            scale);
+    }
+}
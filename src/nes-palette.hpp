@@ -0,0 +1,60 @@
+#ifndef NES_PALETTE_HPP
+#define NES_PALETTE_HPP
+
+#include "nes-types.h"
+#include "nes-ppu.hpp"
+
+//the ppu only ever outputs 6 bit color indices
+#define NES_PALETTE_COLOR_COUNT 64
+#define NES_PALETTE_COLOR_MASK  0x3F
+
+//$2001 bits 5-7, one palette per combination
+#define NES_PALETTE_EMPHASIS_COUNT 8
+#define NES_PALETTE_EMPHASIS_RED   0x01
+#define NES_PALETTE_EMPHASIS_GREEN 0x02
+#define NES_PALETTE_EMPHASIS_BLUE  0x04
+
+//channels that aren't emphasized get darkened by 3/4
+#define NES_PALETTE_EMPHASIS_ATTENUATE(channel) (((channel) * 3) / 4)
+
+#define NES_PALETTE_MAX_SCALE 3
+
+//pixels are 0xAARRGGBB, which is BGRA in memory and what 32 bit windows DIBs expect
+typedef u32 nes_pixel;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define NES_PALETTE_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        //msvc lets us use any intrinsic without changing the target
+        #define NES_PALETTE_TARGET_SSE41
+        #define NES_PALETTE_TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #define NES_PALETTE_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define NES_PALETTE_TARGET_AVX2  __attribute__((target("avx2")))
+    #endif
+#else
+    #define NES_PALETTE_X86 0
+#endif
+
+enum NesPaletteKernel {
+    scalar,
+    sse41,
+    avx2,
+    kernel_count
+};
+
+//converts one row of ppu output and writes it to scale rows of pixels, pixels_pitch is in pixels
+typedef void (*nes_palette_convert_row_proc)(u8* palette_indices, u32 emphasis, nes_pixel* pixels, u32 pixels_pitch, u32 scale);
+
+struct NesPaletteTables {
+    nes_pixel colors[NES_PALETTE_EMPHASIS_COUNT][NES_PALETTE_COLOR_COUNT];
+    //the same colors split into blue, green and red byte planes for the shuffle kernels
+    u8 planes[NES_PALETTE_EMPHASIS_COUNT][3][NES_PALETTE_COLOR_COUNT];
+    b32 kernel_available[NesPaletteKernel::kernel_count];
+    NesPaletteKernel kernel;
+    nes_palette_convert_row_proc convert_row;
+};
+
+#endif //NES_PALETTE_HPP
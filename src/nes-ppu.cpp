@@ -0,0 +1,331 @@
+#include "nes-ppu.hpp"
+
+internal NesPpu
+nes_ppu_create_and_initialize() {
+
+    NesPpu ppu = {0};
+    ppu.render_skip  = FALSE;
+    ppu.frame_buffer = (u8*)malloc(NES_PPU_FRAME_BUFFER_SIZE);
+    memset(ppu.frame_buffer, 0, NES_PPU_FRAME_BUFFER_SIZE);
+    ppu.row_emphasis = (u8*)malloc(NES_PPU_FRAME_BUFFER_HEIGHT);
+    memset(ppu.row_emphasis, 0, NES_PPU_FRAME_BUFFER_HEIGHT);
+
+    return ppu;
+}
+
+internal void
+nes_ppu_destroy(NesPpu* ppu) {
+
+    free(ppu->frame_buffer);
+    free(ppu->row_emphasis);
+    *ppu = {0};
+}
+
+internal void
+nes_ppu_observation_row_scalar(u8* row, u8* gray, u16* column_sums) {
+
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; ++column) {
+        column_sums[column] += gray[row[column] & NES_PPU_COLOR_MASK];
+    }
+}
+
+//gray has to be filled in separately, the ppu doesn't know what color anything is
+internal void
+nes_ppu_observation_initialize(NesPpuObservation* observation, u32 width, u32 height, u8* pixels) {
+
+    ASSERT(width  >= 1 && width  <= NES_PPU_FRAME_BUFFER_WIDTH);
+    ASSERT(height >= 1 && height <= NES_PPU_FRAME_BUFFER_HEIGHT);
+
+    observation->width    = width;
+    observation->height   = height;
+    observation->pixels   = pixels;
+    observation->max_pool = FALSE;
+
+    observation->accumulate_row = nes_ppu_observation_row_scalar;
+
+    memset(observation->count_scanlines, 0, sizeof(observation->count_scanlines));
+    memset(observation->column_sums,     0, sizeof(observation->column_sums));
+
+    //source column c lands in output column (c * width) / 256, so each output column is one run of them
+    for (u32 x = 0; x <= width; ++x) {
+        observation->column_begin[x] = (u16)(((x * NES_PPU_FRAME_BUFFER_WIDTH) + width - 1) / width);
+    }
+    for (u32 scanline = 0; scanline < NES_PPU_FRAME_BUFFER_HEIGHT; ++scanline) {
+        observation->scanline_y[scanline] = (u8)((scanline * height) / NES_PPU_FRAME_BUFFER_HEIGHT);
+        ++observation->count_scanlines[observation->scanline_y[scanline]];
+    }
+}
+
+//adds a drawn scanline into the column sums, and on the last scanline of an output row
+//averages the sums across into that row
+internal void
+nes_ppu_observation_scanline(NesPpuObservation* observation, u32 scanline, u32 emphasis) {
+
+    u16* column_sums = observation->column_sums;
+
+    //every column is independent here, the horizontal work only happens once per output row
+    observation->accumulate_row(observation->row, observation->gray[emphasis], column_sums);
+
+    u32 y = observation->scanline_y[scanline];
+    if (scanline + 1 < NES_PPU_FRAME_BUFFER_HEIGHT && observation->scanline_y[scanline + 1] == y) {
+        return;
+    }
+
+    //pixels could point anywhere as far as the compiler knows, so keep everything we need out of it
+    u32  width           = observation->width;
+    b32  max_pool        = observation->max_pool;
+    u16* column_begin    = observation->column_begin;
+    u32  count_scanlines = observation->count_scanlines[y];
+    u8*  pixels          = &observation->pixels[y * width];
+
+    //running totals across the row, so every output pixel is one subtraction instead of a short loop
+    //with a different trip count each time
+    u32 column_totals[NES_PPU_FRAME_BUFFER_WIDTH + 1];
+    column_totals[0] = 0;
+    for (u32 column = 0; column < NES_PPU_FRAME_BUFFER_WIDTH; ++column) {
+        column_totals[column + 1] = column_totals[column] + column_sums[column];
+    }
+
+    //every output column is either 256 / width source columns wide or one more than that, so two
+    //reciprocals cover the whole row and we don't divide per pixel, they're exact for sums under 2^24
+    u32 count_columns_narrow = NES_PPU_FRAME_BUFFER_WIDTH / width;
+    u64 reciprocals[2];
+    for (u32 wide = 0; wide < 2; ++wide) {
+        u64 count_sources = (count_columns_narrow + wide) * count_scanlines;
+        reciprocals[wide] = ((1ULL << NES_PPU_OBSERVATION_RECIPROCAL_SHIFT) + count_sources - 1) / count_sources;
+    }
+
+    for (u32 x = 0; x < width; ++x) {
+
+        u32 count_columns = column_begin[x + 1] - column_begin[x];
+        u32 sum           = column_totals[column_begin[x + 1]] - column_totals[column_begin[x]];
+        u64 rounded_sum   = sum + ((count_columns * count_scanlines) / 2);
+        u8 shade = (u8)((rounded_sum * reciprocals[count_columns - count_columns_narrow]) >> NES_PPU_OBSERVATION_RECIPROCAL_SHIFT);
+
+        if (max_pool != TRUE || shade > pixels[x]) {
+            pixels[x] = shade;
+        }
+    }
+
+    memset(column_sums, 0, sizeof(observation->column_sums));
+}
+
+internal void
+nes_ppu_render_scanline(NesPpu* ppu, nes_val ppu_mask) {
+
+    u32 emphasis = (ppu_mask >> NES_PPU_MASK_EMPHASIS_SHIFT) & NES_PPU_MASK_EMPHASIS_MASK;
+    ppu->row_emphasis[ppu->scanline] = (u8)emphasis;
+
+    //an observation only needs the one row at a time, it never goes near the frame buffer
+    u8* frame_buffer_row = (ppu->observation)
+        ? ppu->observation->row
+        : &ppu->frame_buffer[ppu->scanline * NES_PPU_FRAME_BUFFER_WIDTH];
+
+    //we don't fetch background or sprite tiles yet, so every pixel is the backdrop color
+    memset(frame_buffer_row, ppu->palette[0] & NES_PPU_COLOR_MASK, NES_PPU_FRAME_BUFFER_WIDTH);
+
+    if (ppu->observation) {
+        nes_ppu_observation_scanline(ppu->observation, ppu->scanline, emphasis);
+    }
+}
+
+internal void
+nes_ppu_update_pattern_tables(NesPpu* ppu, nes_val* pattern_tables) {
+
+    ppu->pattern_tables = pattern_tables;
+}
+
+//$4014, copies a whole page of cpu memory into oam
+internal void
+nes_ppu_oam_dma(NesPpu* ppu, nes_val* page) {
+
+    memcpy(ppu->oam, page, NES_PPU_OAM_SIZE);
+}
+
+//the cpu cycle a dot on the current scanline lands on, counted from power on
+internal u64
+nes_ppu_dot_cpu_cycle(NesPpu* ppu, u32 dot) {
+
+    u64 frame_dot = (ppu->frame_count * NES_PPU_DOTS_PER_FRAME) + (ppu->scanline * NES_PPU_DOTS_PER_SCANLINE) + dot;
+
+    //round up so the cpu never gets there early
+    return (frame_dot + NES_PPU_DOTS_PER_CPU_CYCLE - 1) / NES_PPU_DOTS_PER_CPU_CYCLE;
+}
+
+//the cpu cycle the current scanline finishes on, counted from power on
+internal u64
+nes_ppu_scanline_end_cpu_cycle(NesPpu* ppu) {
+
+    return nes_ppu_dot_cpu_cycle(ppu, NES_PPU_DOTS_PER_SCANLINE);
+}
+
+//bit 7 is the leftmost pixel of the row, a pixel is opaque if either plane has it set
+internal u8
+nes_ppu_sprite_row_opaque_bits(NesPpu* ppu, nes_val ppu_ctrl, u8* sprite, u32 row, u32 sprite_height) {
+
+    if (!ppu->pattern_tables) {
+        return 0;
+    }
+
+    u8 tile       = sprite[1];
+    u8 attributes = sprite[2];
+
+    if (ReadBitInByte(NES_PPU_SPRITE_ATTR_FLIP_V, attributes)) {
+        row = (sprite_height - 1) - row;
+    }
+
+    //8x16 sprites pick their table with bit 0 of the tile and use two tiles stacked
+    u32 pattern_table = 0;
+    if (sprite_height == 16) {
+        pattern_table = (tile & 1) * NES_PPU_PATTERN_TABLE_SIZE;
+        tile = (tile & 0xFE) + ((row >= 8) ? 1 : 0);
+        row &= 7;
+    }
+    else {
+        pattern_table = (ReadBitInByte(NES_PPU_CTRL_FLAG_SPRITE_TABLE, ppu_ctrl)) * NES_PPU_PATTERN_TABLE_SIZE;
+    }
+
+    nes_val* pattern = &ppu->pattern_tables[pattern_table + (tile * NES_PPU_PATTERN_TILE_SIZE) + row];
+    u8 opaque_bits = pattern[0] | pattern[8];
+
+    if (ReadBitInByte(NES_PPU_SPRITE_ATTR_FLIP_H, attributes)) {
+        //reverse the bits
+        opaque_bits = ((opaque_bits & 0xF0) >> 4) | ((opaque_bits & 0x0F) << 4);
+        opaque_bits = ((opaque_bits & 0xCC) >> 2) | ((opaque_bits & 0x33) << 2);
+        opaque_bits = ((opaque_bits & 0xAA) >> 1) | ((opaque_bits & 0x55) << 1);
+    }
+
+    return opaque_bits;
+}
+
+//works out sprite overflow and where sprite 0 hits on the current scanline, this only needs oam and
+//the pattern tables so it's cheap enough to run on frames we never draw
+internal void
+nes_ppu_sprite_evaluation(NesPpu* ppu, NesMemoryMap* mem_map, NesPpuSpriteEvaluation* evaluation) {
+
+    evaluation->overflow               = FALSE;
+    evaluation->sprite_0_hit           = FALSE;
+    evaluation->sprite_0_hit_cpu_cycle = 0;
+
+    if (ppu->scanline >= NES_PPU_SCANLINE_VISIBLE_END) {
+        return;
+    }
+
+    nes_val ppu_ctrl   = *nes_memory_map_address(mem_map, NES_PPU_REG_CTRL);
+    nes_val ppu_mask   = *nes_memory_map_address(mem_map, NES_PPU_REG_MASK);
+    nes_val ppu_status = *nes_memory_map_address(mem_map, NES_PPU_REG_STATUS);
+
+    b32 show_background = (ReadBitInByte(NES_PPU_MASK_FLAG_BACKGROUND, ppu_mask)) ? TRUE : FALSE;
+    b32 show_sprites    = (ReadBitInByte(NES_PPU_MASK_FLAG_SPRITES, ppu_mask))    ? TRUE : FALSE;
+
+    //sprite evaluation doesn't happen at all with rendering off
+    if (show_background != TRUE && show_sprites != TRUE) {
+        return;
+    }
+
+    u32 sprite_height = (ReadBitInByte(NES_PPU_CTRL_FLAG_SPRITE_SIZE, ppu_ctrl)) ? 16 : 8;
+
+    //a sprite shows up on the scanline after its y
+    u32 count_sprites = 0;
+    for (u32 sprite_index = 0; sprite_index < NES_PPU_SPRITE_COUNT; ++sprite_index) {
+        u32 row = ppu->scanline - 1 - ppu->oam[sprite_index * NES_PPU_SPRITE_SIZE];
+        if (row < sprite_height) {
+            ++count_sprites;
+        }
+    }
+    evaluation->overflow = (count_sprites > NES_PPU_SPRITES_PER_SCANLINE) ? TRUE : FALSE;
+
+    //sprite 0 hit needs both layers on and only happens once a frame
+    if (show_background != TRUE || show_sprites != TRUE || ReadBitInByte(NES_PPU_STATUS_FLAG_SPRITE_0_HIT, ppu_status)) {
+        return;
+    }
+
+    u8* sprite_0 = &ppu->oam[0];
+    u32 row = ppu->scanline - 1 - sprite_0[0];
+    if (row >= sprite_height) {
+        return;
+    }
+
+    u8 opaque_bits = nes_ppu_sprite_row_opaque_bits(ppu, ppu_ctrl, sprite_0, row, sprite_height);
+
+    //the left 8 pixels can be clipped for either layer
+    b32 clip_left = (ReadBitInByte(NES_PPU_MASK_FLAG_BACKGROUND_LEFT, ppu_mask) && ReadBitInByte(NES_PPU_MASK_FLAG_SPRITES_LEFT, ppu_mask)) ? FALSE : TRUE;
+
+    for (u32 column = 0; column < 8; ++column) {
+
+        u32 x = sprite_0[3] + column;
+
+        //there's never a hit on the last pixel
+        if (x >= NES_PPU_FRAME_BUFFER_WIDTH - 1) {
+            break;
+        }
+        if (x < 8 && clip_left == TRUE) {
+            continue;
+        }
+
+        //we don't have nametables yet, so the background is treated as opaque under the sprite
+        if ((opaque_bits >> (7 - column)) & 1) {
+            evaluation->sprite_0_hit = TRUE;
+            //pixel x is output on dot x + 1
+            evaluation->sprite_0_hit_cpu_cycle = nes_ppu_dot_cpu_cycle(ppu, x + 1);
+            break;
+        }
+    }
+}
+
+internal void
+nes_ppu_sprite_0_hit(NesPpu* ppu, NesMemoryMap* mem_map) {
+
+    nes_val* ppu_status = nes_memory_map_address(mem_map, NES_PPU_REG_STATUS);
+    SetBitInByte(NES_PPU_STATUS_FLAG_SPRITE_0_HIT, *ppu_status);
+}
+
+internal void
+nes_ppu_scanline(NesPpu* ppu, NesMemoryMap* mem_map, NesPpuSpriteEvaluation* sprite_evaluation, NesPpuScanlineResult* result) {
+
+    result->status_changed = FALSE;
+    result->nmi            = FALSE;
+    result->frame_complete = FALSE;
+
+    //the registers live in the cpu memory map, so we go through the same address lookup the cpu does
+    nes_val* ppu_ctrl   = nes_memory_map_address(mem_map, NES_PPU_REG_CTRL);
+    nes_val* ppu_mask   = nes_memory_map_address(mem_map, NES_PPU_REG_MASK);
+    nes_val* ppu_status = nes_memory_map_address(mem_map, NES_PPU_REG_STATUS);
+
+    if (ppu->scanline < NES_PPU_SCANLINE_VISIBLE_END && ppu->render_skip != TRUE) {
+        nes_ppu_render_scanline(ppu, *ppu_mask);
+    }
+
+    //overflow sticks until the pre-render line
+    if (sprite_evaluation->overflow == TRUE) {
+        SetBitInByte(NES_PPU_STATUS_FLAG_SPRITE_OVERFLOW, *ppu_status);
+        result->status_changed = TRUE;
+    }
+
+    switch (ppu->scanline) {
+
+        case NES_PPU_SCANLINE_VISIBLE_END: {
+            //vblank starts on the next scanline, let the cpu know right away if it asked for an nmi
+            SetBitInByte(NES_PPU_STATUS_FLAG_VBLANK, *ppu_status);
+            result->status_changed = TRUE;
+            result->nmi = ((ReadBitInByte(NES_PPU_CTRL_FLAG_NMI, *ppu_ctrl)) == 1) ? TRUE : FALSE;
+        } break;
+
+        case NES_PPU_SCANLINE_PRE_RENDER: {
+            //the pre-render line clears all of the status flags
+            ClearBitInByte(NES_PPU_STATUS_FLAG_VBLANK, *ppu_status);
+            ClearBitInByte(NES_PPU_STATUS_FLAG_SPRITE_0_HIT, *ppu_status);
+            ClearBitInByte(NES_PPU_STATUS_FLAG_SPRITE_OVERFLOW, *ppu_status);
+            result->status_changed = TRUE;
+        } break;
+
+        default: break;
+    }
+
+    ++ppu->scanline;
+    if (ppu->scanline == NES_PPU_SCANLINES_PER_FRAME) {
+        ppu->scanline = 0;
+        ++ppu->frame_count;
+        result->frame_complete = TRUE;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef NES_PPU_HPP
+#define NES_PPU_HPP
+
+#include "nes-types.h"
+#include "nes-memory-map.hpp"
+
+//ntsc timing, the ppu runs 3 dots for every cpu cycle
+#define NES_PPU_DOTS_PER_SCANLINE    341
+#define NES_PPU_SCANLINES_PER_FRAME  262
+#define NES_PPU_DOTS_PER_FRAME       (NES_PPU_DOTS_PER_SCANLINE * NES_PPU_SCANLINES_PER_FRAME)
+#define NES_PPU_DOTS_PER_CPU_CYCLE   3
+
+#define NES_PPU_FRAME_BUFFER_WIDTH   256
+#define NES_PPU_FRAME_BUFFER_HEIGHT  240
+#define NES_PPU_FRAME_BUFFER_SIZE    (NES_PPU_FRAME_BUFFER_WIDTH * NES_PPU_FRAME_BUFFER_HEIGHT)
+
+#define NES_PPU_PALETTE_SIZE         32
+#define NES_PPU_COLOR_COUNT          64
+#define NES_PPU_COLOR_MASK           0x3F
+
+//oam holds 64 sprites, 4 bytes each (y, tile, attributes, x)
+#define NES_PPU_OAM_SIZE              256
+#define NES_PPU_SPRITE_COUNT          64
+#define NES_PPU_SPRITE_SIZE           4
+#define NES_PPU_SPRITES_PER_SCANLINE  8
+#define NES_PPU_SPRITE_ATTR_FLIP_H    6
+#define NES_PPU_SPRITE_ATTR_FLIP_V    7
+
+#define NES_PPU_PATTERN_TABLE_SIZE    0x1000
+#define NES_PPU_PATTERN_TILE_SIZE     16
+
+#define NES_PPU_SCANLINE_VISIBLE_END 240
+#define NES_PPU_SCANLINE_VBLANK      241
+#define NES_PPU_SCANLINE_PRE_RENDER  261
+
+//cpu mapped registers
+#define NES_PPU_REG_CTRL   0x2000
+#define NES_PPU_REG_MASK   0x2001
+#define NES_PPU_REG_STATUS 0x2002
+
+//$2000 bits
+#define NES_PPU_CTRL_FLAG_SPRITE_TABLE 3
+#define NES_PPU_CTRL_FLAG_SPRITE_SIZE  5
+#define NES_PPU_CTRL_FLAG_NMI          7
+
+//$2001 bits, 5-7 are the red, green and blue color emphasis
+#define NES_PPU_MASK_FLAG_BACKGROUND_LEFT 1
+#define NES_PPU_MASK_FLAG_SPRITES_LEFT    2
+#define NES_PPU_MASK_FLAG_BACKGROUND      3
+#define NES_PPU_MASK_FLAG_SPRITES         4
+#define NES_PPU_MASK_EMPHASIS_SHIFT 5
+#define NES_PPU_MASK_EMPHASIS_MASK  0x07
+#define NES_PPU_EMPHASIS_COUNT      8
+
+//$2002 bits
+#define NES_PPU_STATUS_FLAG_SPRITE_OVERFLOW 5
+#define NES_PPU_STATUS_FLAG_SPRITE_0_HIT    6
+#define NES_PPU_STATUS_FLAG_VBLANK          7
+
+#define NES_PPU_OBSERVATION_RECIPROCAL_SHIFT 40
+
+//adds the gray shade of every pixel in a drawn row onto its column's sum
+typedef void (*nes_ppu_observation_row_proc)(u8* row, u8* gray, u16* column_sums);
+
+//a reduced grayscale frame built up one scanline at a time as the ppu draws, so a full size frame never
+//gets written out, every source column and row lands in exactly one output pixel and gets averaged in
+struct NesPpuObservation {
+    u32 width;
+    u32 height;
+    //width * height shades, owned by whoever set the observation up
+    u8* pixels;
+    //keep the brighter of what's already in pixels and the new frame, this gets rid of sprite flicker
+    b32 max_pool;
+    //gray shade for every color index, one table per combination of emphasis bits
+    u8 gray[NES_PPU_EMPHASIS_COUNT][NES_PPU_COLOR_COUNT];
+    //scalar unless the platform has something faster
+    nes_ppu_observation_row_proc accumulate_row;
+    //output column x averages source columns column_begin[x] up to column_begin[x + 1]
+    u16 column_begin[NES_PPU_FRAME_BUFFER_WIDTH + 1];
+    u8 scanline_y[NES_PPU_FRAME_BUFFER_HEIGHT];
+    u16 count_scanlines[NES_PPU_FRAME_BUFFER_HEIGHT];
+    //the scanline gets drawn in here instead of the frame buffer
+    u8 row[NES_PPU_FRAME_BUFFER_WIDTH];
+    //every source column summed down the scanlines of the output row we're in the middle of,
+    //240 rows of the brightest shade still fit
+    u16 column_sums[NES_PPU_FRAME_BUFFER_WIDTH];
+};
+
+struct NesPpu {
+    //the scanline that will be run by the next step
+    u32 scanline;
+    u64 frame_count;
+    //$3F00 - $3F1F
+    u8 palette[NES_PPU_PALETTE_SIZE];
+    u8 oam[NES_PPU_OAM_SIZE];
+    //$0000 - $1FFF, points straight into chr rom
+    nes_val* pattern_tables;
+    //timing and status flags still run, but nothing gets drawn
+    b32 render_skip;
+    //one palette index per pixel, owned by the ppu but not part of its state
+    u8* frame_buffer;
+    //the color emphasis bits each row was drawn with
+    u8* row_emphasis;
+    //when set, drawn scanlines go here instead of the frame buffer
+    NesPpuObservation* observation;
+};
+
+//sprite side effects for one scanline, these have to be worked out whether or not we draw it
+struct NesPpuSpriteEvaluation {
+    b32 overflow;
+    b32 sprite_0_hit;
+    //when the hit becomes visible to the cpu
+    u64 sprite_0_hit_cpu_cycle;
+};
+
+//what happened during a scanline that the rest of the system needs to react to
+struct NesPpuScanlineResult {
+    b32 status_changed;
+    b32 nmi;
+    b32 frame_complete;
+};
+
+#endif //NES_PPU_HPP
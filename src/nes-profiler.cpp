@@ -0,0 +1,89 @@
+#include "nes-profiler.hpp"
+
+internal NesProfiler*
+nes_profiler_create_and_initialize(u32 count_prg_rom_banks) {
+
+    NesProfiler* profiler = (NesProfiler*)malloc(sizeof(NesProfiler));
+    *profiler = {0};
+
+    //the counters are allocated once up front so recording is just two adds
+    profiler->count_prg_rom_banks = count_prg_rom_banks;
+    profiler->count_pc_counters   = NES_PROFILER_UNBANKED_SIZE + (count_prg_rom_banks * NES_PROFILER_PRG_ROM_BANK_SIZE);
+    profiler->pc_counters         = (NesProfilerCounter*)calloc(profiler->count_pc_counters, sizeof(NesProfilerCounter));
+
+    return profiler;
+}
+
+internal void
+nes_profiler_destroy(NesProfiler* profiler) {
+
+    free(profiler->pc_counters);
+    free(profiler);
+}
+
+internal u32
+nes_profiler_counter_index(NesProfiler* profiler, nes_addr pc) {
+
+    if (pc < NES_PROFILER_UNBANKED_SIZE) {
+        return pc;
+    }
+
+    return NES_PROFILER_UNBANKED_SIZE + nes_memory_map_prg_rom_offset(&profiler->prg_rom_banks, pc);
+}
+
+internal void
+nes_profiler_counter_address(NesProfiler* profiler, u32 counter_index, i32* bank, nes_addr* pc) {
+
+    if (counter_index < NES_PROFILER_UNBANKED_SIZE) {
+        *bank = -1;
+        *pc   = (nes_addr)counter_index;
+        return;
+    }
+
+    u32 prg_offset = counter_index - NES_PROFILER_UNBANKED_SIZE;
+    *bank = (i32)(prg_offset / NES_PROFILER_PRG_ROM_BANK_SIZE);
+    *pc   = nes_memory_map_prg_rom_address(&profiler->prg_rom_banks, prg_offset);
+}
+
+internal void
+nes_profiler_record_instr(NesProfiler* profiler, nes_addr pc, nes_val op_code, u32 cycles) {
+
+    NesProfilerCounter* pc_counter = &profiler->pc_counters[nes_profiler_counter_index(profiler, pc)];
+    ++pc_counter->exec_count;
+    pc_counter->cycle_count += cycles;
+
+    NesProfilerCounter* op_code_counter = &profiler->op_code_counters[op_code];
+    ++op_code_counter->exec_count;
+    op_code_counter->cycle_count += cycles;
+
+    ++profiler->total_instructions;
+    profiler->total_cycles += cycles;
+}
+
+//fills top_indices with the indices of the counters with the most cycles, highest first
+//a sorted insert is plenty here since the top list is tiny compared to the counters
+internal u32
+nes_profiler_top_counters(NesProfilerCounter* counters, u32 count_counters, u32* top_indices, u32 max_top) {
+
+    u32 count_top = 0;
+
+    for (u32 counter_index = 0; counter_index < count_counters; ++counter_index) {
+
+        u64 cycles = counters[counter_index].cycle_count;
+        if (counters[counter_index].exec_count == 0) {
+            continue;
+        }
+        if (count_top == max_top && cycles <= counters[top_indices[max_top - 1]].cycle_count) {
+            continue;
+        }
+
+        u32 insert_index = (count_top < max_top) ? count_top++ : max_top - 1;
+        while (insert_index > 0 && counters[top_indices[insert_index - 1]].cycle_count < cycles) {
+            top_indices[insert_index] = top_indices[insert_index - 1];
+            --insert_index;
+        }
+        top_indices[insert_index] = counter_index;
+    }
+
+    return count_top;
+}
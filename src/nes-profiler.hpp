@@ -0,0 +1,45 @@
+#ifndef NES_PROFILER_HPP
+#define NES_PROFILER_HPP
+
+#include "nes-types.h"
+#include "nes-memory-map.hpp"
+#include <stdlib.h>
+
+//build with NES_PROFILER=1 to count guest instructions and cycles,
+//otherwise every profiler hook compiles to nothing
+#ifndef NES_PROFILER
+#define NES_PROFILER 0
+#endif
+
+//$0000 - $7FFF is never banked, so it gets one counter per address
+#define NES_PROFILER_UNBANKED_SIZE     0x8000
+#define NES_PROFILER_PRG_ROM_BANK_SIZE NES_MEM_MAP_PRG_ROM_BANK_SIZE
+
+#define NES_PROFILER_REPORT_HOT_SPOTS  64
+#define NES_PROFILER_REPORT_OP_CODES   256
+#define NES_PROFILER_REPORT_FILE_NAME  "nes-emulator-profile.txt"
+
+struct NesProfilerCounter {
+    u64 exec_count;
+    u64 cycle_count;
+};
+
+struct NesProfiler {
+    //one counter per address in $0000 - $7FFF, followed by one
+    //counter per byte of every 16kb prg rom bank
+    NesProfilerCounter* pc_counters;
+    u32 count_pc_counters;
+    u32 count_prg_rom_banks;
+    NesMemoryMapPrgRomBanks prg_rom_banks;
+    NesProfilerCounter op_code_counters[256];
+    u64 total_instructions;
+    u64 total_cycles;
+};
+
+#if NES_PROFILER
+    #define NesProfilerRecordInstr(profiler, pc, op_code, cycles) nes_profiler_record_instr(profiler, pc, op_code, cycles)
+#else
+    #define NesProfilerRecordInstr(profiler, pc, op_code, cycles)
+#endif
+
+#endif //NES_PROFILER_HPP
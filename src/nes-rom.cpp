@@ -26,9 +26,7 @@ nes_rom_parse_file_header(char* rom_file_header_str) {
     NesRomFileHeader rom_header = {0};
 
     //make sure we have a valid ROM header
-    char header[3];
-    memccpy(header, rom_file_header_str, 0, 3);    
-    if (strcmp(header, NES_ROM_HEADER_STR) != 0) {
+    if (memcmp(rom_file_header_str, NES_ROM_HEADER_STR, 3) != 0) {
         return rom_header;
     }
 
@@ -94,10 +92,10 @@ nes_rom_prg_rom_create_and_initialize(char* nes_rom_str, u32 count_prg_rom_banks
 internal void
 nes_rom_prg_rom_destroy(NesRomPrgRomBank* prg_rom, u32 count_prg_rom_banks) {
     
-    for (u32 i; i < count_prg_rom_banks; ++i) {
+    for (u32 i = 0; i < count_prg_rom_banks; ++i) {
         prg_rom[i] = {0};
     }
-    free(nes_rom_prg_rom_destroy);
+    free(prg_rom);
 }
 
 internal void
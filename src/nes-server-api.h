@@ -0,0 +1,273 @@
+#ifndef NES_SERVER_API_H
+#define NES_SERVER_API_H
+
+//shared memory layout for nes-linux-server, every emulator the server hosts gets a region of its own
+//named NES_SERVER_REGION_NAME_FORMAT that a client maps with shm_open and mmap
+
+//a client pushes commands onto one ring and pops responses off the other, each ring has exactly one
+//producer and one consumer so neither side ever takes a lock
+//whoever finds a ring empty (or full) spins for a bit and then sleeps on a futex, the other side only
+//makes the wake syscall if it sees someone asleep
+//the server services its instances from a fixed set of worker threads, a worker sleeps on every
+//command ring it looks after at once, so clients follow the same rules no matter who's on the other end
+
+//the frame and ram are written in place by the server and belong to the client from the moment it
+//pops the response to a step until it pushes the next one
+
+//the helpers below are what the server uses too, other languages only need the layout and the
+//futex rules spelled out in nes_server_ring_wait
+
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define NES_SERVER_MAGIC   0x5345524E
+#define NES_SERVER_VERSION 1
+
+#define NES_SERVER_REGION_NAME_FORMAT "/nes-server-%s-%u"
+
+//has to be a power of 2 so the indices can wrap freely
+#define NES_SERVER_RING_SIZE 64
+#define NES_SERVER_RING_MASK (NES_SERVER_RING_SIZE - 1)
+
+#define NES_SERVER_FRAME_MAX_SIZE (256 * 240)
+#define NES_SERVER_RAM_SIZE       0x800
+
+//how many times to look again before going to sleep, a round trip is a few microseconds so this
+//covers a client that's stepping back to back without a syscall on either side
+//with only one cpu the other side can't run while we spin, so we go straight to the futex
+#define NES_SERVER_SPIN_COUNT 1000
+
+//how long a sleeper goes before it looks at the shutdown flag again, shutdown wakes everyone
+//but someone that looked at the flag just before it was set can go to sleep after the wake
+#define NES_SERVER_WAIT_TIMEOUT_NS 50000000
+
+#define NES_SERVER_COMMAND_STEP  1
+#define NES_SERVER_COMMAND_RESET 2
+
+#define NES_SERVER_STATUS_OK              0
+#define NES_SERVER_STATUS_UNKNOWN_COMMAND 1
+
+typedef struct NesServerCommand {
+    //handed back in the response so the client can match them up
+    uint32_t sequence;
+    uint32_t type;
+    //controller 1, a, b, select, start, up, down, left, right from bit 0
+    uint32_t buttons;
+    uint32_t count_frames;
+} NesServerCommand;
+
+typedef struct NesServerResponse {
+    uint32_t sequence;
+    uint32_t status;
+    uint64_t frame_count;
+    uint64_t state_hash;
+} NesServerResponse;
+
+//head is only written by the consumer and tail by the producer, they're on their own cache lines
+//so the two sides don't fight over them
+typedef struct NesServerRingIndices {
+    volatile uint32_t head;
+    //set by the producer while it's asleep on head waiting for space
+    volatile uint32_t producer_waiting;
+    uint8_t head_padding[56];
+    volatile uint32_t tail;
+    //set by the consumer while it's asleep on tail waiting for entries
+    volatile uint32_t consumer_waiting;
+    uint8_t tail_padding[56];
+} NesServerRingIndices;
+
+typedef struct NesServerRegion {
+    uint32_t magic;
+    uint32_t version;
+    //frames are one palette index per pixel at full size, or gray shades if the server was
+    //started with a reduced observation
+    uint32_t frame_width;
+    uint32_t frame_height;
+    uint32_t frame_size;
+    uint32_t ram_size;
+    //set when the server is going away, everyone asleep gets woken up
+    volatile uint32_t shutdown;
+    uint8_t header_padding[36];
+
+    //client to server
+    NesServerRingIndices command_indices;
+    NesServerCommand commands[NES_SERVER_RING_SIZE];
+
+    //server to client
+    NesServerRingIndices response_indices;
+    NesServerResponse responses[NES_SERVER_RING_SIZE];
+
+    uint8_t ram[NES_SERVER_RAM_SIZE];
+    uint8_t frame[NES_SERVER_FRAME_MAX_SIZE];
+} NesServerRegion;
+
+static inline void
+nes_server_futex_wait(volatile uint32_t* word, uint32_t value) {
+
+    struct timespec timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_nsec = NES_SERVER_WAIT_TIMEOUT_NS;
+
+    //the region is shared between processes, so no FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+static inline void
+nes_server_futex_wake(volatile uint32_t* word) {
+
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void
+nes_server_spin_pause(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint32_t
+nes_server_spin_count(void) {
+
+    //0 until we've asked, racing on it is harmless since everyone gets the same answer
+    static uint32_t spin_count = 0;
+
+    uint32_t count = __atomic_load_n(&spin_count, __ATOMIC_RELAXED);
+    if (count == 0) {
+        count = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? NES_SERVER_SPIN_COUNT + 1 : 1;
+        __atomic_store_n(&spin_count, count, __ATOMIC_RELAXED);
+    }
+    return count - 1;
+}
+
+//waits for *word to stop being value, returns 0 if the server shut down first
+//the sleeper sets waiting, then fences, then looks at word one last time before the futex,
+//the other side changes word, then fences, then looks at waiting, so one of them always sees the other
+//shutdown doesn't change word, so the futex wait is timed and the flag is looked at again every time around
+static inline int
+nes_server_ring_wait(NesServerRegion* region, volatile uint32_t* word, uint32_t value, volatile uint32_t* waiting) {
+
+    uint32_t spin_count = nes_server_spin_count();
+    for (uint32_t spin = 0; spin < spin_count; ++spin) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value) {
+            return 1;
+        }
+        nes_server_spin_pause();
+    }
+
+    for (;;) {
+        if (__atomic_load_n(&region->shutdown, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+
+        __atomic_store_n(waiting, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value) {
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return 1;
+        }
+
+        //the kernel checks word again under its own lock, so a change after our last look still wakes us
+        nes_server_futex_wait(word, value);
+        __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value) {
+            return 1;
+        }
+    }
+}
+
+//publishes a new value for word and wakes the other side if it went to sleep on it
+static inline void
+nes_server_ring_publish(volatile uint32_t* word, uint32_t value, volatile uint32_t* waiting) {
+
+    __atomic_store_n(word, value, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+        nes_server_futex_wake(word);
+    }
+}
+
+//producer side, returns a slot to fill in or NULL if the server shut down while we waited for space
+static inline void*
+nes_server_ring_push_begin(NesServerRegion* region, NesServerRingIndices* indices, void* entries, uint32_t entry_size) {
+
+    uint32_t tail = indices->tail;
+    uint32_t head = __atomic_load_n(&indices->head, __ATOMIC_ACQUIRE);
+
+    while (tail - head == NES_SERVER_RING_SIZE) {
+        if (!nes_server_ring_wait(region, &indices->head, head, &indices->producer_waiting)) {
+            return NULL;
+        }
+        head = __atomic_load_n(&indices->head, __ATOMIC_ACQUIRE);
+    }
+
+    return (uint8_t*)entries + ((tail & NES_SERVER_RING_MASK) * entry_size);
+}
+
+static inline void
+nes_server_ring_push_end(NesServerRingIndices* indices) {
+
+    nes_server_ring_publish(&indices->tail, indices->tail + 1, &indices->consumer_waiting);
+}
+
+//consumer side, returns the oldest entry or NULL if the server shut down while we waited for one
+static inline void*
+nes_server_ring_pop_begin(NesServerRegion* region, NesServerRingIndices* indices, void* entries, uint32_t entry_size) {
+
+    uint32_t head = indices->head;
+
+    if (__atomic_load_n(&indices->tail, __ATOMIC_ACQUIRE) == head) {
+        if (!nes_server_ring_wait(region, &indices->tail, head, &indices->consumer_waiting)) {
+            return NULL;
+        }
+    }
+
+    return (uint8_t*)entries + ((head & NES_SERVER_RING_MASK) * entry_size);
+}
+
+static inline void
+nes_server_ring_pop_end(NesServerRingIndices* indices) {
+
+    nes_server_ring_publish(&indices->head, indices->head + 1, &indices->producer_waiting);
+}
+
+/**********
+ * CLIENT *
+ **********/
+
+//returns 0 if the server shut down
+static inline int
+nes_server_client_send(NesServerRegion* region, const NesServerCommand* command) {
+
+    NesServerCommand* slot = (NesServerCommand*)nes_server_ring_push_begin(region, &region->command_indices, region->commands, sizeof(NesServerCommand));
+    if (!slot) {
+        return 0;
+    }
+
+    *slot = *command;
+    nes_server_ring_push_end(&region->command_indices);
+    return 1;
+}
+
+//blocks until the next response comes in, returns 0 if the server shut down
+static inline int
+nes_server_client_receive(NesServerRegion* region, NesServerResponse* response) {
+
+    NesServerResponse* slot = (NesServerResponse*)nes_server_ring_pop_begin(region, &region->response_indices, region->responses, sizeof(NesServerResponse));
+    if (!slot) {
+        return 0;
+    }
+
+    *response = *slot;
+    nes_server_ring_pop_end(&region->response_indices);
+    return 1;
+}
+
+#endif //NES_SERVER_API_H
@@ -0,0 +1,143 @@
+#include "nes-timeline.hpp"
+
+global NesTimeline nes_timeline;
+thread_local NesTimelineThreadBuffer* nes_timeline_thread_buffer = NULL;
+
+internal void
+nes_timeline_initialize(timestamp_callback get_timestamp, u64 timestamp_frequency) {
+
+    nes_timeline = {0};
+    nes_timeline.get_timestamp       = get_timestamp;
+    nes_timeline.timestamp_frequency = timestamp_frequency;
+    nes_timeline.timestamp_start     = get_timestamp();
+}
+
+internal NesTimelineThreadBuffer*
+nes_timeline_thread_buffer_get() {
+
+    if (nes_timeline_thread_buffer != NULL) {
+        return nes_timeline_thread_buffer;
+    }
+
+    //first event on this thread, so claim a slot for its buffer
+    u32 thread_index = AtomicAddU32(&nes_timeline.count_thread_buffers, 1);
+    if (thread_index >= NES_TIMELINE_MAX_THREADS) {
+        return NULL;
+    }
+
+    NesTimelineThreadBuffer* thread_buffer = (NesTimelineThreadBuffer*)calloc(1, sizeof(NesTimelineThreadBuffer));
+    thread_buffer->thread_index = thread_index;
+
+    nes_timeline.thread_buffers[thread_index] = thread_buffer;
+    nes_timeline_thread_buffer = thread_buffer;
+
+    return thread_buffer;
+}
+
+internal void
+nes_timeline_record(char* name, char* category, u64 timestamp_begin, u64 timestamp_end) {
+
+    NesTimelineThreadBuffer* thread_buffer = nes_timeline_thread_buffer_get();
+    if (thread_buffer == NULL) {
+        return;
+    }
+
+    u32 event_index = thread_buffer->count_events;
+    if (event_index == NES_TIMELINE_EVENTS_PER_THREAD) {
+        ++thread_buffer->count_dropped_events;
+        return;
+    }
+
+    NesTimelineEvent* event = &thread_buffer->events[event_index];
+    event->name            = name;
+    event->category        = category;
+    event->timestamp_begin = timestamp_begin;
+    event->timestamp_end   = timestamp_end;
+
+    //publish the event
+    AtomicAddU32(&thread_buffer->count_events, 1);
+}
+
+struct NesTimelineScope {
+
+    char* name;
+    char* category;
+    u64 timestamp_begin;
+
+    NesTimelineScope(char* scope_name, char* scope_category) {
+        name            = scope_name;
+        category        = scope_category;
+        timestamp_begin = nes_timeline.get_timestamp();
+    }
+
+    ~NesTimelineScope() {
+        nes_timeline_record(name, category, timestamp_begin, nes_timeline.get_timestamp());
+    }
+};
+
+internal double
+nes_timeline_timestamp_to_microseconds(u64 timestamp) {
+
+    return ((double)(timestamp - nes_timeline.timestamp_start) * 1000000.0) / (double)nes_timeline.timestamp_frequency;
+}
+
+//writes every recorded event as a chrome trace event json document
+//the returned buffer is owned by the caller
+internal Buffer
+nes_timeline_export_chrome_trace() {
+
+    u32 count_thread_buffers = nes_timeline.count_thread_buffers;
+    if (count_thread_buffers > NES_TIMELINE_MAX_THREADS) {
+        count_thread_buffers = NES_TIMELINE_MAX_THREADS;
+    }
+
+    u64 count_events = 0;
+    for (u32 thread_index = 0; thread_index < count_thread_buffers; ++thread_index) {
+        if (nes_timeline.thread_buffers[thread_index] != NULL) {
+            count_events += nes_timeline.thread_buffers[thread_index]->count_events;
+        }
+    }
+
+    Buffer export_buffer = {0};
+    export_buffer.buffer_contents = (char*)malloc((count_events + 1) * NES_TIMELINE_EXPORT_BYTES_PER_EVENT);
+
+    char* export_write = export_buffer.buffer_contents;
+    export_write += sprintf(export_write, "{\"traceEvents\":[\n");
+
+    b32 first_event = TRUE;
+
+    for (u32 thread_index = 0; thread_index < count_thread_buffers; ++thread_index) {
+
+        NesTimelineThreadBuffer* thread_buffer = nes_timeline.thread_buffers[thread_index];
+        if (thread_buffer == NULL) {
+            continue;
+        }
+
+        //only events published before this point are exported
+        u32 count_thread_events = thread_buffer->count_events;
+
+        for (u32 event_index = 0; event_index < count_thread_events; ++event_index) {
+
+            NesTimelineEvent* event = &thread_buffer->events[event_index];
+
+            double event_begin = nes_timeline_timestamp_to_microseconds(event->timestamp_begin);
+            double event_end   = nes_timeline_timestamp_to_microseconds(event->timestamp_end);
+
+            export_write += sprintf(export_write,
+                "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                (first_event == TRUE) ? "" : ",\n",
+                event->name,
+                event->category,
+                event_begin,
+                event_end - event_begin,
+                thread_buffer->thread_index);
+
+            first_event = FALSE;
+        }
+    }
+
+    export_write += sprintf(export_write, "\n]}\n");
+    export_buffer.buffer_size = (u64)(export_write - export_buffer.buffer_contents);
+
+    return export_buffer;
+}
@@ -0,0 +1,63 @@
+#ifndef NES_TIMELINE_HPP
+#define NES_TIMELINE_HPP
+
+#include "nes-types.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//build with NES_TIMELINE=1 to record scoped timers as chrome trace events,
+//otherwise every timeline scope compiles to nothing
+#ifndef NES_TIMELINE
+#define NES_TIMELINE 0
+#endif
+
+#define NES_TIMELINE_MAX_THREADS            16
+#define NES_TIMELINE_EVENTS_PER_THREAD      0x40000
+#define NES_TIMELINE_EXPORT_BYTES_PER_EVENT 128
+#define NES_TIMELINE_FILE_NAME              "nes-emulator-timeline.json"
+
+#define NES_TIMELINE_CATEGORY_FRAME  "frame"
+#define NES_TIMELINE_CATEGORY_CPU    "cpu"
+#define NES_TIMELINE_CATEGORY_PPU    "ppu"
+#define NES_TIMELINE_CATEGORY_APU    "apu"
+#define NES_TIMELINE_CATEGORY_MAPPER "mapper"
+#define NES_TIMELINE_CATEGORY_IO     "io"
+
+typedef u64 (*timestamp_callback)();
+
+struct NesTimelineEvent {
+    //names and categories must be string literals, we only keep the pointer
+    char* name;
+    char* category;
+    u64 timestamp_begin;
+    u64 timestamp_end;
+};
+
+//each thread owns its buffer, so it is the only writer and never takes a lock
+//the event count is published after the event is written so a reader only
+//ever sees complete events
+struct NesTimelineThreadBuffer {
+    u32 thread_index;
+    volatile u32 count_events;
+    u32 count_dropped_events;
+    NesTimelineEvent events[NES_TIMELINE_EVENTS_PER_THREAD];
+};
+
+struct NesTimeline {
+    timestamp_callback get_timestamp;
+    u64 timestamp_frequency;
+    u64 timestamp_start;
+    NesTimelineThreadBuffer* thread_buffers[NES_TIMELINE_MAX_THREADS];
+    volatile u32 count_thread_buffers;
+};
+
+#define NesTimelineConcatInner(a, b) a##b
+#define NesTimelineConcat(a, b)      NesTimelineConcatInner(a, b)
+
+#if NES_TIMELINE
+    #define NesTimelineScoped(name, category) NesTimelineScope NesTimelineConcat(nes_timeline_scope_, __LINE__)(name, category)
+#else
+    #define NesTimelineScoped(name, category)
+#endif
+
+#endif //NES_TIMELINE_HPP
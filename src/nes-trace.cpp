@@ -0,0 +1,631 @@
+#include "nes-trace.hpp"
+
+internal NesTrace*
+nes_trace_create_and_initialize() {
+
+    NesTrace* trace = (NesTrace*)malloc(sizeof(NesTrace));
+    memset(trace, 0, sizeof(NesTrace));
+
+    //every chunk is allocated up front, nothing gets allocated per instruction
+    trace->chunks = (NesTraceChunk*)malloc(NES_TRACE_QUEUE_SIZE * sizeof(NesTraceChunk));
+    trace->chunk_dropping = FALSE;
+
+    return trace;
+}
+
+internal void
+nes_trace_destroy(NesTrace* trace) {
+
+    free(trace->index);
+    free(trace->chunks);
+    free(trace);
+}
+
+internal u32
+nes_trace_put_varint(u8* data, u64 value) {
+
+    u32 size = 0;
+    while (value >= 0x80) {
+        data[size++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (u8)value;
+    return size;
+}
+
+internal u64
+nes_trace_get_varint(u8** data) {
+
+    u64 value = 0;
+    u32 shift = 0;
+    u8 byte   = 0;
+    do {
+        byte   = *(*data)++;
+        value |= (u64)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/************
+ * PRODUCER *
+ ************/
+
+//starts a new chunk off of the record, returns FALSE if there's nowhere to put it
+internal b32
+nes_trace_chunk_begin(NesTrace* trace, NesTraceRecord* record) {
+
+    u32 read_index = AtomicLoadAcquireU32(&trace->read_index);
+    if ((trace->write_index - read_index) == NES_TRACE_QUEUE_SIZE) {
+        return FALSE;
+    }
+
+    NesTraceChunk* chunk = &trace->chunks[trace->write_index & NES_TRACE_QUEUE_MASK];
+    NesTraceChunkHeader* header = (NesTraceChunkHeader*)chunk->data;
+
+    *header = {0};
+    header->first_instruction = record->instruction;
+    header->first_cycle       = record->cycle;
+    header->pc                = record->pc;
+    header->acc_a             = record->acc_a;
+    header->ir_x              = record->ir_x;
+    header->ir_y              = record->ir_y;
+    header->sp                = record->sp;
+    header->p                 = record->p;
+
+    chunk->size = sizeof(NesTraceChunkHeader);
+    trace->count_stack_writes = 0;
+
+    //the first record gets encoded against itself, so only its op code and access go in
+    trace->previous = *record;
+
+    return TRUE;
+}
+
+//hands the chunk over to the consumer
+internal void
+nes_trace_chunk_end(NesTrace* trace) {
+
+    NesTraceChunk* chunk = &trace->chunks[trace->write_index & NES_TRACE_QUEUE_MASK];
+    NesTraceChunkHeader* header = (NesTraceChunkHeader*)chunk->data;
+
+    u32 stack_writes_size = trace->count_stack_writes * sizeof(NesTraceStackWrite);
+    memcpy(&chunk->data[chunk->size], trace->stack_writes, stack_writes_size);
+    chunk->size += stack_writes_size;
+
+    header->count_records      = trace->count_chunk_records;
+    header->size               = chunk->size - sizeof(NesTraceChunkHeader);
+    header->count_stack_writes = trace->count_stack_writes;
+
+    AtomicStoreReleaseU32(&trace->write_index, trace->write_index + 1);
+}
+
+//the cpu calls this before every push it makes, sp is where the first byte goes
+//pushes only ever go down one after the other until the next record, so a start and a count covers them
+internal void
+nes_trace_stack_write(NesTrace* trace, nes_val sp, u8 count_stack_writes) {
+
+    if (trace->count_pending_stack_writes == 0) {
+        trace->pending_stack_sp = sp;
+    }
+    trace->count_pending_stack_writes += count_stack_writes;
+}
+
+internal void
+nes_trace_record(NesTrace* trace, NesTraceRecord* record) {
+
+    record->instruction        = trace->count_records++;
+    record->count_stack_writes = trace->count_pending_stack_writes;
+    record->stack_sp           = trace->pending_stack_sp;
+    trace->count_pending_stack_writes = 0;
+
+    if (trace->count_chunk_records == 0) {
+        trace->chunk_dropping = (nes_trace_chunk_begin(trace, record) == TRUE) ? FALSE : TRUE;
+        if (trace->chunk_dropping == TRUE) {
+            ++trace->count_chunks_dropped;
+        }
+    }
+
+    if (trace->chunk_dropping != TRUE) {
+
+        NesTraceChunk* chunk = &trace->chunks[trace->write_index & NES_TRACE_QUEUE_MASK];
+        NesTraceRecord* previous = &trace->previous;
+
+        //where pc would be if the instruction before didn't jump anywhere
+        nes_addr next_pc = (trace->count_chunk_records == 0)
+            ? record->pc
+            : (nes_addr)(previous->pc + nes_cpu_disasm_op_code(previous->op_code)->size);
+
+        u8 flags = record->access & (NES_TRACE_RECORD_FLAG_READ | NES_TRACE_RECORD_FLAG_WRITE);
+        if (record->acc_a != previous->acc_a) flags |= NES_TRACE_RECORD_FLAG_A;
+        if (record->ir_x  != previous->ir_x)  flags |= NES_TRACE_RECORD_FLAG_X;
+        if (record->ir_y  != previous->ir_y)  flags |= NES_TRACE_RECORD_FLAG_Y;
+        if (record->sp    != previous->sp)    flags |= NES_TRACE_RECORD_FLAG_SP;
+        if (record->p     != previous->p)     flags |= NES_TRACE_RECORD_FLAG_P;
+        if (record->pc    != next_pc)         flags |= NES_TRACE_RECORD_FLAG_JUMP;
+
+        u8* data = &chunk->data[chunk->size];
+        u8* data_begin = data;
+
+        *data++ = flags;
+        *data++ = record->op_code;
+        for (u32 operand_index = 0; operand_index + 1 < nes_cpu_disasm_op_code(record->op_code)->size; ++operand_index) {
+            *data++ = record->operands[operand_index];
+        }
+        data += nes_trace_put_varint(data, record->cycle - previous->cycle);
+        if (flags & NES_TRACE_RECORD_FLAG_JUMP) {
+            *data++ = (u8)record->pc;
+            *data++ = (u8)(record->pc >> 8);
+        }
+        if (flags & NES_TRACE_RECORD_FLAG_A)  *data++ = record->acc_a;
+        if (flags & NES_TRACE_RECORD_FLAG_X)  *data++ = record->ir_x;
+        if (flags & NES_TRACE_RECORD_FLAG_Y)  *data++ = record->ir_y;
+        if (flags & NES_TRACE_RECORD_FLAG_SP) *data++ = record->sp;
+        if (flags & NES_TRACE_RECORD_FLAG_P)  *data++ = record->p;
+        if (flags & (NES_TRACE_RECORD_FLAG_READ | NES_TRACE_RECORD_FLAG_WRITE)) {
+            *data++ = (u8)record->address;
+            *data++ = (u8)(record->address >> 8);
+        }
+
+        chunk->size += (u32)(data - data_begin);
+        *previous = *record;
+
+        if (record->count_stack_writes > 0) {
+            NesTraceStackWrite* stack_write = &trace->stack_writes[trace->count_stack_writes++];
+            stack_write->record_index       = (u16)trace->count_chunk_records;
+            stack_write->stack_sp           = record->stack_sp;
+            stack_write->count_stack_writes = record->count_stack_writes;
+        }
+    }
+
+    if (++trace->count_chunk_records == NES_TRACE_RECORDS_PER_CHUNK) {
+        if (trace->chunk_dropping != TRUE) {
+            nes_trace_chunk_end(trace);
+        }
+        trace->count_chunk_records = 0;
+    }
+}
+
+//hands over whatever is in the chunk being filled, only call this once the cpu has stopped for good
+//since the next record would land at the wrong spot in the index
+internal void
+nes_trace_finish(NesTrace* trace) {
+
+    if (trace->count_chunk_records > 0 && trace->chunk_dropping != TRUE) {
+        nes_trace_chunk_end(trace);
+    }
+    trace->count_chunk_records        = 0;
+    trace->count_pending_stack_writes = 0;
+}
+
+/************
+ * CONSUMER *
+ ************/
+
+internal void
+nes_trace_index_add(NesTrace* trace, u32 chunk_number, u64 offset, u32 size, u32 count_records) {
+
+    if (chunk_number >= trace->index_capacity) {
+        u32 index_capacity = (trace->index_capacity) ? trace->index_capacity : 64;
+        while (index_capacity <= chunk_number) {
+            index_capacity *= 2;
+        }
+        trace->index = (NesTraceIndexEntry*)realloc(trace->index, index_capacity * sizeof(NesTraceIndexEntry));
+        memset(&trace->index[trace->index_capacity], 0, (index_capacity - trace->index_capacity) * sizeof(NesTraceIndexEntry));
+        trace->index_capacity = index_capacity;
+    }
+
+    trace->index[chunk_number].offset        = offset;
+    trace->index[chunk_number].size          = size;
+    trace->index[chunk_number].count_records = count_records;
+
+    if (chunk_number >= trace->count_index_entries) {
+        trace->count_index_entries = chunk_number + 1;
+    }
+}
+
+//leaves room for the header, it only gets filled in by nes_trace_close_file
+internal void
+nes_trace_open_file(NesTrace* trace, nes_trace_write_callback write, void* context) {
+
+    NesTraceFileHeader header = {0};
+    write(context, 0, (u8*)&header, sizeof(NesTraceFileHeader));
+
+    trace->file_offset   = sizeof(NesTraceFileHeader);
+    trace->bytes_written = sizeof(NesTraceFileHeader);
+}
+
+//writes out every chunk the producer has finished
+internal void
+nes_trace_flush(NesTrace* trace, nes_trace_write_callback write, void* context) {
+
+    u32 read_index  = trace->read_index;
+    u32 write_index = AtomicLoadAcquireU32(&trace->write_index);
+
+    while (read_index != write_index) {
+
+        NesTraceChunk* chunk = &trace->chunks[read_index & NES_TRACE_QUEUE_MASK];
+        NesTraceChunkHeader* header = (NesTraceChunkHeader*)chunk->data;
+
+        write(context, trace->file_offset, chunk->data, chunk->size);
+        nes_trace_index_add(trace,
+            (u32)(header->first_instruction / NES_TRACE_RECORDS_PER_CHUNK),
+            trace->file_offset,
+            chunk->size,
+            header->count_records);
+
+        trace->file_offset   += chunk->size;
+        trace->bytes_written += chunk->size;
+
+        //the producer can reuse the chunk as soon as it's out
+        ++read_index;
+        AtomicStoreReleaseU32(&trace->read_index, read_index);
+    }
+}
+
+//flushes what's left, then writes the index and the real header, call nes_trace_finish first
+internal void
+nes_trace_close_file(NesTrace* trace, nes_trace_write_callback write, void* context) {
+
+    nes_trace_flush(trace, write, context);
+
+    //chunks dropped at the very end never made it into the index, the reader
+    //has to see them as dropped entries rather than the trace just stopping short
+    u32 count_chunks = (u32)((trace->count_records + NES_TRACE_RECORDS_PER_CHUNK - 1) / NES_TRACE_RECORDS_PER_CHUNK);
+    if (count_chunks > trace->count_index_entries) {
+        nes_trace_index_add(trace, count_chunks - 1, 0, 0, 0);
+    }
+
+    u64 index_offset = trace->file_offset;
+    u32 index_size   = count_chunks * sizeof(NesTraceIndexEntry);
+    if (index_size > 0) {
+        write(context, index_offset, (u8*)trace->index, index_size);
+    }
+    trace->bytes_written += index_size;
+
+    NesTraceFileHeader header = {0};
+    header.magic             = NES_TRACE_MAGIC;
+    header.version           = NES_TRACE_VERSION;
+    header.records_per_chunk = NES_TRACE_RECORDS_PER_CHUNK;
+    header.count_chunks      = count_chunks;
+    header.count_records     = trace->count_records;
+    header.index_offset      = index_offset;
+    write(context, 0, (u8*)&header, sizeof(NesTraceFileHeader));
+}
+
+/**********
+ * READER *
+ **********/
+
+internal b32
+nes_trace_reader_open(NesTraceReader* reader, u8* file, u64 file_size) {
+
+    *reader = {0};
+
+    if (file_size < sizeof(NesTraceFileHeader)) {
+        return FALSE;
+    }
+
+    NesTraceFileHeader* header = (NesTraceFileHeader*)file;
+    if (header->magic != NES_TRACE_MAGIC ||
+        header->version != NES_TRACE_VERSION ||
+        header->records_per_chunk != NES_TRACE_RECORDS_PER_CHUNK ||
+        header->index_offset + ((u64)header->count_chunks * sizeof(NesTraceIndexEntry)) > file_size) {
+        return FALSE;
+    }
+
+    reader->file      = file;
+    reader->file_size = file_size;
+    reader->header    = header;
+    reader->index     = (NesTraceIndexEntry*)&file[header->index_offset];
+
+    return TRUE;
+}
+
+//decodes up to count_records records from the start of a chunk into records,
+//returns how many there were, 0 if the chunk was dropped or doesn't exist
+internal u32
+nes_trace_reader_decode_chunk(NesTraceReader* reader, u32 chunk_number, NesTraceRecord* records, u32 count_records) {
+
+    if (chunk_number >= reader->header->count_chunks) {
+        return 0;
+    }
+
+    NesTraceIndexEntry* entry = &reader->index[chunk_number];
+    if (entry->offset == 0 || entry->offset + entry->size > reader->file_size) {
+        return 0;
+    }
+
+    NesTraceChunkHeader* header = (NesTraceChunkHeader*)&reader->file[entry->offset];
+    u8* data = (u8*)(header + 1);
+
+    u32 stack_writes_size = header->count_stack_writes * sizeof(NesTraceStackWrite);
+    if (stack_writes_size > header->size) {
+        return 0;
+    }
+    NesTraceStackWrite* stack_writes = (NesTraceStackWrite*)(data + header->size - stack_writes_size);
+
+    if (count_records > header->count_records) {
+        count_records = header->count_records;
+    }
+
+    NesTraceRecord previous = {0};
+    previous.cycle = header->first_cycle;
+    previous.acc_a = header->acc_a;
+    previous.ir_x  = header->ir_x;
+    previous.ir_y  = header->ir_y;
+    previous.sp    = header->sp;
+    previous.p     = header->p;
+    nes_addr next_pc = header->pc;
+
+    for (u32 record_index = 0; record_index < count_records; ++record_index) {
+
+        NesTraceRecord* record = &records[record_index];
+        *record = previous;
+
+        u8 flags = *data++;
+        record->instruction = header->first_instruction + record_index;
+        record->op_code     = *data++;
+
+        u32 size = nes_cpu_disasm_op_code(record->op_code)->size;
+        record->operands[0] = (size > 1) ? *data++ : 0;
+        record->operands[1] = (size > 2) ? *data++ : 0;
+
+        record->cycle = previous.cycle + nes_trace_get_varint(&data);
+        record->pc    = next_pc;
+        if (flags & NES_TRACE_RECORD_FLAG_JUMP) {
+            record->pc = (nes_addr)(data[0] | (data[1] << 8));
+            data += 2;
+        }
+        if (flags & NES_TRACE_RECORD_FLAG_A)  record->acc_a = *data++;
+        if (flags & NES_TRACE_RECORD_FLAG_X)  record->ir_x  = *data++;
+        if (flags & NES_TRACE_RECORD_FLAG_Y)  record->ir_y  = *data++;
+        if (flags & NES_TRACE_RECORD_FLAG_SP) record->sp    = *data++;
+        if (flags & NES_TRACE_RECORD_FLAG_P)  record->p     = *data++;
+
+        record->access  = flags & (NES_TRACE_RECORD_FLAG_READ | NES_TRACE_RECORD_FLAG_WRITE);
+        record->address = 0;
+        if (record->access) {
+            record->address = (nes_addr)(data[0] | (data[1] << 8));
+            data += 2;
+        }
+
+        record->count_stack_writes = 0;
+        record->stack_sp           = 0;
+
+        next_pc  = (nes_addr)(record->pc + size);
+        previous = *record;
+    }
+
+    //the entries are in record order, the ones past what was asked for are left alone
+    for (u32 stack_write_index = 0; stack_write_index < header->count_stack_writes; ++stack_write_index) {
+        NesTraceStackWrite* stack_write = &stack_writes[stack_write_index];
+        if (stack_write->record_index >= count_records) {
+            break;
+        }
+        records[stack_write->record_index].count_stack_writes = stack_write->count_stack_writes;
+        records[stack_write->record_index].stack_sp           = stack_write->stack_sp;
+    }
+
+    return count_records;
+}
+
+//decodes a single instruction, at most one chunk's worth of records gets decoded to get there
+//records has to have room for NES_TRACE_RECORDS_PER_CHUNK
+internal b32
+nes_trace_reader_seek(NesTraceReader* reader, u64 instruction, NesTraceRecord* records, NesTraceRecord* record) {
+
+    u32 chunk_number = (u32)(instruction / NES_TRACE_RECORDS_PER_CHUNK);
+    u32 record_index = (u32)(instruction % NES_TRACE_RECORDS_PER_CHUNK);
+
+    u32 count_records = nes_trace_reader_decode_chunk(reader, chunk_number, records, record_index + 1);
+    if (count_records <= record_index) {
+        return FALSE;
+    }
+
+    *record = records[record_index];
+    return TRUE;
+}
+
+//where a record's stack_write_index-th push went, sp wraps around inside page one
+internal inline nes_addr
+nes_trace_stack_write_address(NesTraceRecord* record, u32 stack_write_index) {
+
+    return (nes_addr)(NES_MEM_MAP_STACK_ADDR + (u8)(record->stack_sp - stack_write_index));
+}
+
+/***************
+ * QUERY INDEX *
+ ***************/
+
+internal void
+nes_trace_query_range_initialize(NesTraceQueryRange* range, u32 first_chunk, u32 end_chunk) {
+
+    range->first_chunk = first_chunk;
+    range->end_chunk   = end_chunk;
+    range->counts      = (u64*)calloc(NES_TRACE_QUERY_COUNT * NES_TRACE_QUERY_KEY_COUNT, sizeof(u64));
+    range->cursors     = (u64*)calloc(NES_TRACE_QUERY_COUNT * NES_TRACE_QUERY_KEY_COUNT, sizeof(u64));
+    range->records     = (NesTraceRecord*)malloc(NES_TRACE_RECORDS_PER_CHUNK * sizeof(NesTraceRecord));
+}
+
+internal void
+nes_trace_query_range_destroy(NesTraceQueryRange* range) {
+
+    free(range->counts);
+    free(range->cursors);
+    free(range->records);
+}
+
+//first pass, only touches the range's own counts
+internal void
+nes_trace_query_range_count(NesTraceReader* reader, NesTraceQueryRange* range) {
+
+    u64* pc_counts    = &range->counts[NES_TRACE_QUERY_PC    * NES_TRACE_QUERY_KEY_COUNT];
+    u64* write_counts = &range->counts[NES_TRACE_QUERY_WRITE * NES_TRACE_QUERY_KEY_COUNT];
+
+    for (u32 chunk_number = range->first_chunk; chunk_number < range->end_chunk; ++chunk_number) {
+
+        u32 count_records = nes_trace_reader_decode_chunk(reader, chunk_number, range->records, NES_TRACE_RECORDS_PER_CHUNK);
+        for (u32 record_index = 0; record_index < count_records; ++record_index) {
+
+            NesTraceRecord* record = &range->records[record_index];
+            ++pc_counts[record->pc];
+            if (record->access & NES_TRACE_RECORD_FLAG_WRITE) {
+                ++write_counts[record->address];
+            }
+            for (u32 stack_write_index = 0; stack_write_index < record->count_stack_writes; ++stack_write_index) {
+                ++write_counts[nes_trace_stack_write_address(record, stack_write_index)];
+            }
+        }
+    }
+}
+
+//once every range is counted, lays the index out and hands every range the slots it fills,
+//ranges have to be in chunk order so the instruction numbers come out sorted
+internal void
+nes_trace_query_index_create(NesTraceReader* reader, NesTraceQueryRange* ranges, u32 count_ranges, NesTraceQueryIndex* index) {
+
+    u64 count_entries[NES_TRACE_QUERY_COUNT] = {0};
+    for (u32 range_index = 0; range_index < count_ranges; ++range_index) {
+        for (u32 query = 0; query < NES_TRACE_QUERY_COUNT; ++query) {
+            for (u32 key = 0; key < NES_TRACE_QUERY_KEY_COUNT; ++key) {
+                count_entries[query] += ranges[range_index].counts[(query * NES_TRACE_QUERY_KEY_COUNT) + key];
+            }
+        }
+    }
+
+    u64 offsets_size = (NES_TRACE_QUERY_KEY_COUNT + 1) * sizeof(u64);
+    u64 size         = sizeof(NesTraceQueryFileHeader);
+    for (u32 query = 0; query < NES_TRACE_QUERY_COUNT; ++query) {
+        size += offsets_size + (count_entries[query] * sizeof(u64));
+    }
+
+    *index = {0};
+    index->memory = (u8*)malloc(size);
+    index->size   = size;
+    index->header = (NesTraceQueryFileHeader*)index->memory;
+
+    NesTraceQueryFileHeader* header = index->header;
+    memset(header, 0, sizeof(NesTraceQueryFileHeader));
+    header->magic         = NES_TRACE_QUERY_MAGIC;
+    header->version       = NES_TRACE_QUERY_VERSION;
+    header->count_records = reader->header->count_records;
+
+    u8* memory = index->memory + sizeof(NesTraceQueryFileHeader);
+    for (u32 query = 0; query < NES_TRACE_QUERY_COUNT; ++query) {
+
+        header->count_entries[query] = count_entries[query];
+        index->offsets[query]        = (u64*)memory;
+        index->instructions[query]   = (u64*)(memory + offsets_size);
+        memory += offsets_size + (count_entries[query] * sizeof(u64));
+
+        //a key's entries start where the key before it ended, each range gets its share in order
+        u64 offset = 0;
+        for (u32 key = 0; key < NES_TRACE_QUERY_KEY_COUNT; ++key) {
+            index->offsets[query][key] = offset;
+            for (u32 range_index = 0; range_index < count_ranges; ++range_index) {
+                u32 count_index = (query * NES_TRACE_QUERY_KEY_COUNT) + key;
+                ranges[range_index].cursors[count_index] = offset;
+                offset += ranges[range_index].counts[count_index];
+            }
+        }
+        index->offsets[query][NES_TRACE_QUERY_KEY_COUNT] = offset;
+    }
+}
+
+//second pass, every range writes to its own slots so they can all go at once
+internal void
+nes_trace_query_range_fill(NesTraceReader* reader, NesTraceQueryRange* range, NesTraceQueryIndex* index) {
+
+    u64* pc_cursors    = &range->cursors[NES_TRACE_QUERY_PC    * NES_TRACE_QUERY_KEY_COUNT];
+    u64* write_cursors = &range->cursors[NES_TRACE_QUERY_WRITE * NES_TRACE_QUERY_KEY_COUNT];
+    u64* pc_instructions    = index->instructions[NES_TRACE_QUERY_PC];
+    u64* write_instructions = index->instructions[NES_TRACE_QUERY_WRITE];
+
+    for (u32 chunk_number = range->first_chunk; chunk_number < range->end_chunk; ++chunk_number) {
+
+        u32 count_records = nes_trace_reader_decode_chunk(reader, chunk_number, range->records, NES_TRACE_RECORDS_PER_CHUNK);
+        for (u32 record_index = 0; record_index < count_records; ++record_index) {
+
+            NesTraceRecord* record = &range->records[record_index];
+            pc_instructions[pc_cursors[record->pc]++] = record->instruction;
+            if (record->access & NES_TRACE_RECORD_FLAG_WRITE) {
+                write_instructions[write_cursors[record->address]++] = record->instruction;
+            }
+            for (u32 stack_write_index = 0; stack_write_index < record->count_stack_writes; ++stack_write_index) {
+                nes_addr address = nes_trace_stack_write_address(record, stack_write_index);
+                write_instructions[write_cursors[address]++] = record->instruction;
+            }
+        }
+    }
+}
+
+//for an index that was saved and mapped back in, it's used where it is
+internal b32
+nes_trace_query_index_open(NesTraceQueryIndex* index, u8* memory, u64 size, NesTraceReader* reader) {
+
+    *index = {0};
+
+    if (size < sizeof(NesTraceQueryFileHeader)) {
+        return FALSE;
+    }
+
+    NesTraceQueryFileHeader* header = (NesTraceQueryFileHeader*)memory;
+    if (header->magic != NES_TRACE_QUERY_MAGIC ||
+        header->version != NES_TRACE_QUERY_VERSION ||
+        header->count_records != reader->header->count_records) {
+        return FALSE;
+    }
+
+    u64 offsets_size  = (NES_TRACE_QUERY_KEY_COUNT + 1) * sizeof(u64);
+    u64 expected_size = sizeof(NesTraceQueryFileHeader);
+    for (u32 query = 0; query < NES_TRACE_QUERY_COUNT; ++query) {
+        expected_size += offsets_size + (header->count_entries[query] * sizeof(u64));
+    }
+    if (expected_size != size) {
+        return FALSE;
+    }
+
+    index->memory = memory;
+    index->size   = size;
+    index->header = header;
+
+    memory += sizeof(NesTraceQueryFileHeader);
+    for (u32 query = 0; query < NES_TRACE_QUERY_COUNT; ++query) {
+        index->offsets[query]      = (u64*)memory;
+        index->instructions[query] = (u64*)(memory + offsets_size);
+        memory += offsets_size + (header->count_entries[query] * sizeof(u64));
+    }
+
+    return TRUE;
+}
+
+//first entry that's >= instruction
+internal u64*
+nes_trace_query_lower_bound(u64* first, u64* end, u64 instruction) {
+
+    u64 count = end - first;
+    while (count > 0) {
+        u64 step = count / 2;
+        if (first[step] < instruction) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+//the instructions for key between first_instruction and end_instruction, in order
+internal u64*
+nes_trace_query_find(NesTraceQueryIndex* index, u32 query, nes_addr key, u64 first_instruction, u64 end_instruction, u64* count) {
+
+    u64* instructions = index->instructions[query];
+    u64* first = nes_trace_query_lower_bound(&instructions[index->offsets[query][key]], &instructions[index->offsets[query][key + 1]], first_instruction);
+    u64* end   = nes_trace_query_lower_bound(first, &instructions[index->offsets[query][key + 1]], end_instruction);
+
+    *count = end - first;
+    return first;
+}
@@ -0,0 +1,213 @@
+#ifndef NES_TRACE_HPP
+#define NES_TRACE_HPP
+
+#include "nes-types.h"
+#include <stdlib.h>
+#include <string.h>
+
+//binary execution trace, one record per instruction delta encoded against the one before it
+//build with NES_TRACE=0 and the cpu hook compiles to nothing
+#ifndef NES_TRACE
+#define NES_TRACE 1
+#endif
+
+#define NES_TRACE_MAGIC   0x4543524E
+#define NES_TRACE_VERSION 2
+
+//every chunk holds this many records, so the chunk an instruction is in is just a divide
+#define NES_TRACE_RECORDS_PER_CHUNK 4096
+
+//flags, op code, 2 operand bytes, a 10 byte varint cycle delta, pc, 5 registers and an address
+#define NES_TRACE_RECORD_MAX_SIZE 24
+//the records, then at most one stack write entry for each of them
+#define NES_TRACE_CHUNK_MAX_SIZE  (sizeof(NesTraceChunkHeader) + (NES_TRACE_RECORDS_PER_CHUNK * (NES_TRACE_RECORD_MAX_SIZE + sizeof(NesTraceStackWrite))))
+
+//has to be a power of 2 so the indices can wrap freely
+#define NES_TRACE_QUEUE_SIZE 16
+#define NES_TRACE_QUEUE_MASK (NES_TRACE_QUEUE_SIZE - 1)
+
+//what changed since the record before, the fields that did follow in this order
+#define NES_TRACE_RECORD_FLAG_A     0x01
+#define NES_TRACE_RECORD_FLAG_X     0x02
+#define NES_TRACE_RECORD_FLAG_Y     0x04
+#define NES_TRACE_RECORD_FLAG_SP    0x08
+#define NES_TRACE_RECORD_FLAG_P     0x10
+//pc isn't right after the instruction before, so it's stored
+#define NES_TRACE_RECORD_FLAG_JUMP  0x20
+//the instruction read and/or wrote its operand in memory, the address is stored
+#define NES_TRACE_RECORD_FLAG_READ  0x40
+#define NES_TRACE_RECORD_FLAG_WRITE 0x80
+
+//one instruction, the registers are what they were before it ran
+struct NesTraceRecord {
+    //counted from the start of the trace
+    u64 instruction;
+    u64 cycle;
+    nes_addr pc;
+    nes_val op_code;
+    nes_val operands[2];
+    nes_val acc_a;
+    nes_val ir_x;
+    nes_val ir_y;
+    nes_val sp;
+    nes_val p;
+    //NES_TRACE_RECORD_FLAG_READ and/or NES_TRACE_RECORD_FLAG_WRITE, address is only good if either is set
+    u8 access;
+    nes_addr address;
+    //bytes pushed, the first one went to $0100 + stack_sp and the rest below it
+    //an interrupt's pushes land on the first instruction of its handler
+    u8 count_stack_writes;
+    nes_val stack_sp;
+};
+
+//pushes don't go through the operand, so they're kept out of the records and listed at the end of
+//the chunk, only the few instructions that push pay for them
+struct NesTraceStackWrite {
+    u16 record_index;
+    nes_val stack_sp;
+    u8 count_stack_writes;
+};
+
+/***************
+ * FILE LAYOUT *
+ ***************/
+
+//a header, the chunks back to back, then the index
+//the header gets written again once the trace is finished, a trace that never finished has no index
+
+struct NesTraceFileHeader {
+    u32 magic;
+    u32 version;
+    u32 records_per_chunk;
+    u32 count_chunks;
+    u64 count_records;
+    u64 index_offset;
+    u8 padding[32];
+};
+
+//every chunk starts from the full state of its first record, so it decodes on its own
+struct NesTraceChunkHeader {
+    u64 first_instruction;
+    u64 first_cycle;
+    u32 count_records;
+    //bytes of records and stack writes after this header
+    u32 size;
+    //the last count_stack_writes * sizeof(NesTraceStackWrite) bytes of them
+    u32 count_stack_writes;
+    nes_addr pc;
+    nes_val acc_a;
+    nes_val ir_x;
+    nes_val ir_y;
+    nes_val sp;
+    nes_val p;
+    u8 padding[5];
+};
+
+//one per chunk number, a chunk the writer had to drop has a 0 offset
+struct NesTraceIndexEntry {
+    u64 offset;
+    u32 size;
+    u32 count_records;
+};
+
+/**********
+ * WRITER *
+ **********/
+
+struct NesTraceChunk {
+    u32 size;
+    u8 data[NES_TRACE_CHUNK_MAX_SIZE];
+};
+
+typedef void (*nes_trace_write_callback)(void* context, u64 offset, u8* data, u32 size);
+
+//single producer (the cpu) single consumer (a writer thread) ring of chunks
+//the producer never waits, if every chunk is still waiting to be written the new one is dropped and
+//its slot in the index stays empty, everything else in the trace is still good
+struct NesTrace {
+    NesTraceChunk* chunks;
+
+    //only touched by the producer
+    volatile u32 write_index;
+    u32 count_chunk_records;
+    b32 chunk_dropping;
+    u64 count_records;
+    u64 count_chunks_dropped;
+    NesTraceRecord previous;
+    //pushed since the last record, they go on the next one
+    nes_val pending_stack_sp;
+    u8 count_pending_stack_writes;
+    u32 count_stack_writes;
+    NesTraceStackWrite stack_writes[NES_TRACE_RECORDS_PER_CHUNK];
+    u8 producer_padding[CACHE_LINE_SIZE];
+
+    //only touched by the consumer
+    volatile u32 read_index;
+    u64 file_offset;
+    NesTraceIndexEntry* index;
+    u32 count_index_entries;
+    u32 index_capacity;
+    u64 bytes_written;
+    u8 consumer_padding[CACHE_LINE_SIZE];
+};
+
+/**********
+ * READER *
+ **********/
+
+//works straight off a mapped trace file, nothing gets copied until a chunk is decoded
+struct NesTraceReader {
+    u8* file;
+    u64 file_size;
+    NesTraceFileHeader* header;
+    NesTraceIndexEntry* index;
+};
+
+/***************
+ * QUERY INDEX *
+ ***************/
+
+//instruction numbers grouped by pc and by the address they wrote (pushes included), built once from a finished trace
+//so a query is a lookup and a binary search instead of decoding the whole thing
+
+#define NES_TRACE_QUERY_MAGIC   0x5851524E
+#define NES_TRACE_QUERY_VERSION 2
+
+//one key per address
+#define NES_TRACE_QUERY_KEY_COUNT 0x10000
+
+#define NES_TRACE_QUERY_PC    0
+#define NES_TRACE_QUERY_WRITE 1
+#define NES_TRACE_QUERY_COUNT 2
+
+//the file is the header, then for each query NES_TRACE_QUERY_KEY_COUNT + 1 offsets into its
+//instruction numbers, then the instruction numbers themselves, sorted within every key
+struct NesTraceQueryFileHeader {
+    u32 magic;
+    u32 version;
+    //of the trace it was built from, an index for some other trace is no good
+    u64 count_records;
+    u64 count_entries[NES_TRACE_QUERY_COUNT];
+    u8 padding[32];
+};
+
+struct NesTraceQueryIndex {
+    u8* memory;
+    u64 size;
+    NesTraceQueryFileHeader* header;
+    u64* offsets[NES_TRACE_QUERY_COUNT];
+    u64* instructions[NES_TRACE_QUERY_COUNT];
+};
+
+//building goes chunk range by chunk range, so any number of threads can each take a range
+//every range counts its keys first, then once all the counts are in it fills its own slots
+struct NesTraceQueryRange {
+    u32 first_chunk;
+    u32 end_chunk;
+    //NES_TRACE_QUERY_COUNT * NES_TRACE_QUERY_KEY_COUNT, counts and then where this range writes next
+    u64* counts;
+    u64* cursors;
+    NesTraceRecord* records;
+};
+
+#endif //NES_TRACE_HPP
@@ -6,15 +6,15 @@
 #define Fatal() ASSERT(1 == 0)
 
 //data types
-typedef char  i8;  
-typedef short i16; 
-typedef int   i32;   
-typedef long  i64;
+typedef signed char i8;  
+typedef short       i16; 
+typedef int         i32;   
+typedef long long   i64;
 
-typedef unsigned char  u8;
-typedef unsigned short u16;
-typedef unsigned int   u32;
-typedef unsigned long  u64;
+typedef unsigned char      u8;
+typedef unsigned short     u16;
+typedef unsigned int       u32;
+typedef unsigned long long u64;
 
 typedef u8  nes_val;
 typedef u16 nes_addr;
@@ -32,6 +32,20 @@ typedef i32 b32;
 #define ClearBitInByte(val_bit_index, val_byte) val_byte &= ~(1 << val_bit_index)
 #define ReadBitInByte(val_bit_index, val_byte)  (val_byte >> val_bit_index) & 1
 
+//atomics, adds are full barriers and loads/stores are at least acquire/release on both compilers
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define AtomicAddU32(ptr, value)          ((u32)_InterlockedExchangeAdd((volatile long*)(ptr), (long)(value)))
+    #define AtomicLoadAcquireU32(ptr)         ((u32)_InterlockedOr((volatile long*)(ptr), 0))
+    #define AtomicStoreReleaseU32(ptr, value) _InterlockedExchange((volatile long*)(ptr), (long)(value))
+#else
+    #define AtomicAddU32(ptr, value)          ((u32)__sync_fetch_and_add((ptr), (value)))
+    #define AtomicLoadAcquireU32(ptr)         ((u32)__atomic_load_n((ptr), __ATOMIC_ACQUIRE))
+    #define AtomicStoreReleaseU32(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#endif
+
+#define CACHE_LINE_SIZE 64
+
 #define BUFFER_DEFAULT_SIZE 256
 
 struct Buffer {
@@ -4,8 +4,8 @@
 global u64 bytes_read = 0;
 
 void CALLBACK
-nes_win32_io_completion_routine(u64 error_code,
-                                 u64 bytes_transferred,
+nes_win32_io_completion_routine(DWORD error_code,
+                                 DWORD bytes_transferred,
                                  LPOVERLAPPED lpOverlapped) {
         
     bytes_read = bytes_transferred;
@@ -38,6 +38,97 @@ nes_win32_io_open_and_write_file(char* file_name, char* write_str, u32 write_str
     CloseHandle(file_handle);
 }
 
+//the file stays open for the whole session, it starts out empty
+internal HANDLE
+nes_win32_io_open_file_for_append(char* file_name) {
+
+    HANDLE file_handle = CreateFileA(file_name,
+                                    FILE_APPEND_DATA,
+                                    FILE_SHARE_READ,
+                                    NULL,
+                                    CREATE_ALWAYS,
+                                    FILE_ATTRIBUTE_NORMAL,
+                                    NULL);
+
+    ASSERT(file_handle != INVALID_HANDLE_VALUE);
+
+    return file_handle;
+}
+
+//this blocks, it's only called from the log writer thread
+internal void
+nes_win32_io_append_file(HANDLE file_handle, char* data, u32 data_size) {
+
+    u32 bytes_written = 0;
+    while (bytes_written < data_size) {
+        DWORD write_size = 0;
+        BOOL write_result = WriteFile(file_handle,
+                                      data + bytes_written,
+                                      data_size - bytes_written,
+                                      &write_size,
+                                      NULL);
+        ASSERT(write_result && write_size > 0);
+        bytes_written += write_size;
+    }
+}
+
+internal void
+nes_win32_io_close_file(HANDLE file_handle) {
+
+    CloseHandle(file_handle);
+}
+
+//maps the file so writes to the memory are writes to the file, the mapping grows the file to size if it's new or short
+//the file handle is kept so unmapping can wait for the disk
+internal nes_val*
+nes_win32_io_map_file(char* file_name, u32 size, HANDLE* file_handle) {
+
+    *file_handle = CreateFileA(file_name,
+                               GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ,
+                               NULL,
+                               OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               NULL);
+
+    if (*file_handle == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    HANDLE mapping_handle = CreateFileMappingA(*file_handle, NULL, PAGE_READWRITE, 0, size, NULL);
+    if (!mapping_handle) {
+        CloseHandle(*file_handle);
+        return NULL;
+    }
+
+    nes_val* memory = (nes_val*)MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+
+    //the view keeps the mapping alive
+    CloseHandle(mapping_handle);
+
+    if (!memory) {
+        CloseHandle(*file_handle);
+    }
+
+    return memory;
+}
+
+//starts writing back part of the view, doesn't wait for the disk
+internal void
+nes_win32_io_flush_mapped_file(nes_val* memory, u32 offset, u32 size) {
+
+    FlushViewOfFile(memory + offset, size);
+}
+
+internal void
+nes_win32_io_unmap_file(nes_val* memory, u32 size, HANDLE file_handle) {
+
+    FlushViewOfFile(memory, size);
+    UnmapViewOfFile(memory);
+    FlushFileBuffers(file_handle);
+    CloseHandle(file_handle);
+}
+
 internal Buffer 
 nes_win32_io_open_and_read_file(char *file_name) {
 
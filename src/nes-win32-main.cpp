@@ -1,6 +1,43 @@
 #include <Windows.h>
 #include "nes-win32-io.cpp"
 #include "nes-emulator.cpp"
+#include "nes-frame-queue.cpp"
+#include "nes-palette.cpp"
+
+#define NES_WIN32_MAIN_WINDOW_CLASS_NAME "NesEmulatorWindowClass"
+#define NES_WIN32_MAIN_WINDOW_TITLE      "NES Emulator"
+#define NES_WIN32_MAIN_WINDOW_SCALE      3
+#define NES_WIN32_MAIN_FRAMES_PER_SECOND 60
+#define NES_WIN32_MAIN_LOG_FILE_NAME     "nes-emulator-log.txt"
+//how long the log writer sleeps between flushes, everything logged in between goes out in one write
+#define NES_WIN32_MAIN_LOG_FLUSH_INTERVAL_MS 10
+
+//everything the emulation thread touches, the presentation thread only shares the frame queue
+struct NesWin32MainEmulationThread {
+    HANDLE thread_handle;
+    NesEmulator* emulator;
+    NesFrameQueue* frame_queue;
+    //signaled every time a frame is pushed, the emulation thread never waits on it
+    HANDLE frame_ready_event;
+    volatile u32 running;
+};
+
+struct NesWin32MainLogWriter {
+    HANDLE thread_handle;
+    NesLog* log;
+    HANDLE file_handle;
+    volatile u32 running;
+};
+
+struct NesWin32MainPresentation {
+    HWND window;
+    BITMAPINFO bitmap_info;
+    nes_pixel* pixels;
+    u32 scale;
+    u32 width;
+    u32 height;
+    u64 frames_presented;
+};
 
 
 internal void 
@@ -22,10 +59,269 @@ nes_win32_main_close_and_free_file_for_nes_emulator(NesEmulatorFileBuffer* file_
 }
 
 internal void
-nes_win32_main_loop(NesEmulator* nes_emulator) {
+nes_win32_main_map_save_file(NesEmulatorSaveFile* save_file) {
+
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    save_file->memory        = nes_win32_io_map_file(save_file->file_name, save_file->size, &file_handle);
+    save_file->platform_file = (void*)file_handle;
+}
+
+internal void
+nes_win32_main_flush_save_file(NesEmulatorSaveFile* save_file, u32 offset, u32 size) {
+
+    nes_win32_io_flush_mapped_file(save_file->memory, offset, size);
+}
+
+internal void
+nes_win32_main_unmap_save_file(NesEmulatorSaveFile* save_file) {
+
+    nes_win32_io_unmap_file(save_file->memory, save_file->size, (HANDLE)save_file->platform_file);
+}
+
+internal u64
+nes_win32_main_timestamp() {
+
+    LARGE_INTEGER performance_counter;
+    QueryPerformanceCounter(&performance_counter);
+    return (u64)performance_counter.QuadPart;
+}
+
+internal void
+nes_win32_main_log_write(void* context, char* data, u32 data_size) {
+
+    NesWin32MainLogWriter* log_writer = (NesWin32MainLogWriter*)context;
+    nes_win32_io_append_file(log_writer->file_handle, data, data_size);
+}
+
+internal DWORD WINAPI
+nes_win32_main_log_writer_thread(LPVOID thread_parameter) {
+
+    NesWin32MainLogWriter* log_writer = (NesWin32MainLogWriter*)thread_parameter;
+
+    while (AtomicLoadAcquireU32(&log_writer->running) == TRUE) {
+        nes_log_flush(log_writer->log, nes_win32_main_log_write, log_writer);
+        Sleep(NES_WIN32_MAIN_LOG_FLUSH_INTERVAL_MS);
+    }
+
+    //whatever was logged before shutdown still makes it out
+    nes_log_flush(log_writer->log, nes_win32_main_log_write, log_writer);
+
+    return 0;
+}
+
+internal void
+nes_win32_main_log_writer_start(NesWin32MainLogWriter* log_writer, NesLog* log) {
+
+    *log_writer = {0};
+    log_writer->log           = log;
+    log_writer->file_handle   = nes_win32_io_open_file_for_append(NES_WIN32_MAIN_LOG_FILE_NAME);
+    log_writer->running       = TRUE;
+    log_writer->thread_handle = CreateThread(NULL, 0, nes_win32_main_log_writer_thread, log_writer, 0, NULL);
+    ASSERT(log_writer->thread_handle);
+}
+
+internal void
+nes_win32_main_log_writer_stop(NesWin32MainLogWriter* log_writer) {
+
+    AtomicStoreReleaseU32(&log_writer->running, FALSE);
+    WaitForSingleObject(log_writer->thread_handle, INFINITE);
+    CloseHandle(log_writer->thread_handle);
+    nes_win32_io_close_file(log_writer->file_handle);
+}
 
-    //todo - we need to loop this, but we can wait until we have a way for the user to escape
-    nes_emulator_update_and_render(nes_emulator);
+internal DWORD WINAPI
+nes_win32_main_emulation_thread(LPVOID thread_parameter) {
+
+    NesWin32MainEmulationThread* emulation_thread = (NesWin32MainEmulationThread*)thread_parameter;
+    NesEmulator* emulator = emulation_thread->emulator;
+
+    LARGE_INTEGER performance_frequency;
+    QueryPerformanceFrequency(&performance_frequency);
+    u64 ticks_per_frame = (u64)performance_frequency.QuadPart / NES_WIN32_MAIN_FRAMES_PER_SECOND;
+    u64 frame_deadline  = nes_win32_main_timestamp() + ticks_per_frame;
+
+    while (AtomicLoadAcquireU32(&emulation_thread->running) == TRUE) {
+
+        nes_emulator_update_and_render(emulator, TRUE);
+
+        //hand the frame over, if presentation is behind we drop it rather than wait
+        NesFrameQueueFrame* frame = nes_frame_queue_write_begin(emulation_thread->frame_queue);
+        if (frame) {
+            frame->frame_number = emulator->frame_count;
+            memcpy(frame->frame_buffer, emulator->ppu.frame_buffer, NES_PPU_FRAME_BUFFER_SIZE);
+            memcpy(frame->row_emphasis, emulator->ppu.row_emphasis, NES_PPU_FRAME_BUFFER_HEIGHT);
+            nes_frame_queue_write_end(emulation_thread->frame_queue);
+            SetEvent(emulation_thread->frame_ready_event);
+        }
+
+        //pace to 60hz, if we fell behind we start counting again from now instead of trying to catch up
+        u64 timestamp = nes_win32_main_timestamp();
+        if (timestamp < frame_deadline) {
+            u32 sleep_ms = (u32)(((frame_deadline - timestamp) * 1000) / (u64)performance_frequency.QuadPart);
+            if (sleep_ms > 0) {
+                Sleep(sleep_ms);
+            }
+            frame_deadline += ticks_per_frame;
+        }
+        else {
+            frame_deadline = timestamp + ticks_per_frame;
+        }
+    }
+
+    return 0;
+}
+
+internal NesWin32MainPresentation
+nes_win32_main_presentation_create_and_initialize(HWND window, u32 scale) {
+
+    NesWin32MainPresentation presentation = {0};
+    presentation.window = window;
+    presentation.scale  = scale;
+    presentation.width  = NES_PPU_FRAME_BUFFER_WIDTH * scale;
+    presentation.height = NES_PPU_FRAME_BUFFER_HEIGHT * scale;
+    presentation.pixels = (nes_pixel*)malloc(presentation.width * presentation.height * sizeof(nes_pixel));
+    memset(presentation.pixels, 0, presentation.width * presentation.height * sizeof(nes_pixel));
+
+    //negative height makes the DIB top-down, same as the frame buffer
+    presentation.bitmap_info.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    presentation.bitmap_info.bmiHeader.biWidth       = presentation.width;
+    presentation.bitmap_info.bmiHeader.biHeight      = -(i32)presentation.height;
+    presentation.bitmap_info.bmiHeader.biPlanes      = 1;
+    presentation.bitmap_info.bmiHeader.biBitCount    = 32;
+    presentation.bitmap_info.bmiHeader.biCompression = BI_RGB;
+
+    return presentation;
+}
+
+internal void
+nes_win32_main_presentation_destroy(NesWin32MainPresentation* presentation) {
+
+    free(presentation->pixels);
+    *presentation = {0};
+}
+
+internal void
+nes_win32_main_present(NesWin32MainPresentation* presentation) {
+
+    RECT client_rect;
+    GetClientRect(presentation->window, &client_rect);
+
+    HDC device_context = GetDC(presentation->window);
+    StretchDIBits(device_context,
+                  0, 0, client_rect.right - client_rect.left, client_rect.bottom - client_rect.top,
+                  0, 0, presentation->width, presentation->height,
+                  presentation->pixels,
+                  &presentation->bitmap_info,
+                  DIB_RGB_COLORS,
+                  SRCCOPY);
+    ReleaseDC(presentation->window, device_context);
+}
+
+internal void
+nes_win32_main_present_latest_frame(NesWin32MainPresentation* presentation, NesFrameQueue* frame_queue) {
+
+    NesFrameQueueFrame* frame = nes_frame_queue_read_begin_latest(frame_queue);
+    if (!frame) {
+        return;
+    }
+
+    //convert straight out of the queue, the emulation thread can't reuse this frame until we're done
+    nes_palette_convert_frame(frame->frame_buffer, frame->row_emphasis, presentation->pixels, presentation->scale);
+    nes_frame_queue_read_end(frame_queue);
+
+    nes_win32_main_present(presentation);
+    ++presentation->frames_presented;
+}
+
+internal LRESULT CALLBACK
+nes_win32_main_window_callback(HWND window, UINT message, WPARAM w_param, LPARAM l_param) {
+
+    switch (message) {
+
+        case WM_CLOSE:
+        case WM_DESTROY: {
+            PostQuitMessage(0);
+        } break;
+
+        default: {
+            return DefWindowProcA(window, message, w_param, l_param);
+        }
+    }
+
+    return 0;
+}
+
+internal HWND
+nes_win32_main_create_window(HINSTANCE instance, u32 scale) {
+
+    WNDCLASSA window_class     = {0};
+    window_class.style         = CS_HREDRAW | CS_VREDRAW;
+    window_class.lpfnWndProc   = nes_win32_main_window_callback;
+    window_class.hInstance     = instance;
+    window_class.hCursor       = LoadCursor(NULL, IDC_ARROW);
+    window_class.lpszClassName = NES_WIN32_MAIN_WINDOW_CLASS_NAME;
+    RegisterClassA(&window_class);
+
+    //size the window so the client area fits the scaled frame exactly
+    RECT window_rect = {0, 0, (LONG)(NES_PPU_FRAME_BUFFER_WIDTH * scale), (LONG)(NES_PPU_FRAME_BUFFER_HEIGHT * scale)};
+    AdjustWindowRect(&window_rect, WS_OVERLAPPEDWINDOW, FALSE);
+
+    HWND window = CreateWindowExA(0,
+                                  NES_WIN32_MAIN_WINDOW_CLASS_NAME,
+                                  NES_WIN32_MAIN_WINDOW_TITLE,
+                                  WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+                                  CW_USEDEFAULT, CW_USEDEFAULT,
+                                  window_rect.right - window_rect.left,
+                                  window_rect.bottom - window_rect.top,
+                                  NULL, NULL, instance, NULL);
+    ASSERT(window);
+
+    return window;
+}
+
+internal void
+nes_win32_main_loop(NesEmulator* nes_emulator, HINSTANCE instance) {
+
+    nes_palette_initialize();
+
+    HWND window = nes_win32_main_create_window(instance, NES_WIN32_MAIN_WINDOW_SCALE);
+    NesWin32MainPresentation presentation = nes_win32_main_presentation_create_and_initialize(window, NES_WIN32_MAIN_WINDOW_SCALE);
+
+    //emulation runs on its own thread, this thread pumps messages and presents
+    NesWin32MainEmulationThread emulation_thread = {0};
+    emulation_thread.emulator          = nes_emulator;
+    emulation_thread.frame_queue       = nes_frame_queue_create_and_initialize();
+    emulation_thread.frame_ready_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    emulation_thread.running           = TRUE;
+    emulation_thread.thread_handle     = CreateThread(NULL, 0, nes_win32_main_emulation_thread, &emulation_thread, 0, NULL);
+    ASSERT(emulation_thread.thread_handle);
+
+    b32 running = TRUE;
+    while (running == TRUE) {
+
+        //wake up for either a new frame or window messages
+        MsgWaitForMultipleObjects(1, &emulation_thread.frame_ready_event, FALSE, INFINITE, QS_ALLINPUT);
+
+        MSG message;
+        while (PeekMessageA(&message, NULL, 0, 0, PM_REMOVE)) {
+            if (message.message == WM_QUIT) {
+                running = FALSE;
+            }
+            TranslateMessage(&message);
+            DispatchMessageA(&message);
+        }
+
+        nes_win32_main_present_latest_frame(&presentation, emulation_thread.frame_queue);
+    }
+
+    //let the emulation thread finish its frame before we tear anything down
+    AtomicStoreReleaseU32(&emulation_thread.running, FALSE);
+    WaitForSingleObject(emulation_thread.thread_handle, INFINITE);
+    CloseHandle(emulation_thread.thread_handle);
+    CloseHandle(emulation_thread.frame_ready_event);
+
+    nes_frame_queue_destroy(emulation_thread.frame_queue);
+    nes_win32_main_presentation_destroy(&presentation);
 }
 
 i32 WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance,
@@ -35,10 +331,37 @@ i32 WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance,
     platform_callbacks.open_and_read_file     = nes_win32_main_open_file_for_emulator;
     platform_callbacks.close_and_free_file    = nes_win32_main_close_and_free_file_for_nes_emulator;
     platform_callbacks.open_and_write_to_file = nes_win32_main_open_and_write_buffer_to_file;
+    platform_callbacks.map_save_file          = nes_win32_main_map_save_file;
+    platform_callbacks.flush_save_file        = nes_win32_main_flush_save_file;
+    platform_callbacks.unmap_save_file        = nes_win32_main_unmap_save_file;
+
+#if NES_TIMELINE
+    LARGE_INTEGER performance_frequency;
+    QueryPerformanceFrequency(&performance_frequency);
+    nes_timeline_initialize(nes_win32_main_timestamp, (u64)performance_frequency.QuadPart);
+#endif
 
     //TODO - we should probably tokenize the cmd line, but for now we are only passing in one argument
     NesEmulator nes_emulator = nes_emulator_create_and_initialize(cmd_line, platform_callbacks);
-    nes_win32_main_loop(&nes_emulator);
+
+    NesWin32MainLogWriter log_writer;
+    nes_win32_main_log_writer_start(&log_writer, nes_emulator.log);
+
+    nes_win32_main_loop(&nes_emulator, instance);
+
+    nes_win32_main_log_writer_stop(&log_writer);
+    nes_emulator_save_file_close(&nes_emulator);
+#if NES_CDL
+    nes_emulator_cdl_close(&nes_emulator);
+#endif
+
+#if NES_PROFILER
+    nes_emulator_profiler_write_report(&nes_emulator);
+#endif
+
+#if NES_TIMELINE
+    nes_emulator_timeline_write(&nes_emulator);
+#endif
     
     return 0;
 }
\ No newline at end of file